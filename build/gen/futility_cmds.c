@@ -0,0 +1,47 @@
+const char futility_version[] = "v0.0.37-4c94eb3-dirty 2026-10-19 15:19:04 ";
+#define _CMD(NAME) extern const struct futil_cmd_t __cmd_##NAME;
+_CMD(bdb)
+_CMD(create)
+_CMD(dump_fmap)
+_CMD(dump_kernel_config)
+_CMD(gbb)
+_CMD(gbb_utility)
+_CMD(help)
+_CMD(load_fmap)
+_CMD(pcr)
+_CMD(serve)
+_CMD(show)
+_CMD(sign)
+_CMD(update)
+_CMD(validate_rec_mrc)
+_CMD(vbutil_firmware)
+_CMD(vbutil_kernel)
+_CMD(vbutil_key)
+_CMD(vbutil_keyblock)
+_CMD(verify)
+_CMD(version)
+#undef _CMD
+#define _CMD(NAME) &__cmd_##NAME,
+const struct futil_cmd_t *const futil_cmds[] = {
+_CMD(bdb)
+_CMD(create)
+_CMD(dump_fmap)
+_CMD(dump_kernel_config)
+_CMD(gbb)
+_CMD(gbb_utility)
+_CMD(help)
+_CMD(load_fmap)
+_CMD(pcr)
+_CMD(serve)
+_CMD(show)
+_CMD(sign)
+_CMD(update)
+_CMD(validate_rec_mrc)
+_CMD(vbutil_firmware)
+_CMD(vbutil_kernel)
+_CMD(vbutil_key)
+_CMD(vbutil_keyblock)
+_CMD(verify)
+_CMD(version)
+0};  /* null-terminated */
+#undef _CMD
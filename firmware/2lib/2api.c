@@ -26,6 +26,82 @@ int vb2api_secdata_create(struct vb2_context *ctx)
 	return vb2_secdata_create(ctx);
 }
 
+__attribute__((weak))
+int vb2ex_secdata_read_all(struct vb2_context *ctx,
+			   struct vb2_secdata_snapshot *snapshot)
+{
+	return VB2_ERROR_EX_SECDATA_READ_ALL_UNIMPLEMENTED;
+}
+
+int vb2api_secdata_read_all(struct vb2_context *ctx)
+{
+	struct vb2_shared_data *sd = vb2_get_sd(ctx);
+	struct vb2_secdata_snapshot *snapshot;
+	struct vb2_workbuf wb;
+	uint32_t offset;
+	int attempts = 3;
+	int rv;
+
+	/* Only need to read it once per boot */
+	if (sd->workbuf_secdata_snapshot_offset)
+		return VB2_SUCCESS;
+
+	vb2_workbuf_from_ctx(ctx, &wb);
+	snapshot = vb2_workbuf_alloc(&wb, sizeof(*snapshot));
+	if (!snapshot)
+		return VB2_ERROR_SECDATA_SNAPSHOT_WORKBUF;
+
+	/*
+	 * If any CRC is bad, read everything again.  It could just be noise,
+	 * and the spaces should be consistent with each other.
+	 */
+	do {
+		memset(snapshot, 0, sizeof(*snapshot));
+		rv = vb2ex_secdata_read_all(ctx, snapshot);
+		if (rv)
+			return rv;
+
+		rv = vb2_secdata_snapshot_check(snapshot);
+		if (rv == VB2_SUCCESS)
+			break;
+		VB2_DEBUG("Bad secdata snapshot (0x%x)\n", rv);
+	} while (--attempts && rv != VB2_ERROR_SECDATA_FWMP_SIZE);
+
+	if (rv)
+		return rv;
+
+	/* Can't go on without the firmware space */
+	if (!(snapshot->spaces & VB2_SECDATA_SPACE_FIRMWARE))
+		return VB2_ERROR_SECDATA_SNAPSHOT_NO_FIRMWARE;
+
+	memcpy(ctx->secdata, snapshot->secdata, sizeof(ctx->secdata));
+	if (snapshot->spaces & VB2_SECDATA_SPACE_KERNEL)
+		memcpy(ctx->secdatak, snapshot->secdatak,
+		       sizeof(ctx->secdatak));
+
+	/* Keep the snapshot for the rest of the boot */
+	offset = vb2_offset_of(ctx->workbuf, snapshot);
+	sd->workbuf_secdata_snapshot_offset = offset;
+	vb2_set_workbuf_used(ctx, offset + sizeof(*snapshot));
+
+	return VB2_SUCCESS;
+}
+
+int vb2api_get_secdata_snapshot(struct vb2_context *ctx,
+				const struct vb2_secdata_snapshot **snapshot)
+{
+	struct vb2_shared_data *sd = vb2_get_sd(ctx);
+
+	if (!sd->workbuf_secdata_snapshot_offset) {
+		*snapshot = NULL;
+		return VB2_ERROR_SECDATA_SNAPSHOT_MISSING;
+	}
+
+	*snapshot = (const struct vb2_secdata_snapshot *)
+		(ctx->workbuf + sd->workbuf_secdata_snapshot_offset);
+	return VB2_SUCCESS;
+}
+
 void vb2api_fail(struct vb2_context *ctx, uint8_t reason, uint8_t subcode)
 {
 	/* Initialize the vboot context if it hasn't been yet */
@@ -65,6 +141,15 @@ int vb2api_fw_phase1(struct vb2_context *ctx)
 		return VB2_ERROR_API_PHASE1_SECDATA_REBOOT;
 	}
 
+	/*
+	 * Load secure data in one pass if the platform can, so the kernel
+	 * and FWMP spaces are at hand too.  Otherwise the caller has already
+	 * loaded ctx->secdata.
+	 */
+	rv = vb2api_secdata_read_all(ctx);
+	if (rv && rv != VB2_ERROR_EX_SECDATA_READ_ALL_UNIMPLEMENTED)
+		vb2_fail(ctx, VB2_RECOVERY_SECDATA_INIT, rv);
+
 	/* Initialize secure data */
 	rv = vb2_secdata_init(ctx);
 	if (rv)
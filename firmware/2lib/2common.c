@@ -11,25 +11,70 @@
 #include "2rsa.h"
 #include "2sha.h"
 
+/*
+ * Words for the constant-time compare loops.  Which path those loops take
+ * depends only on the pointers and the size, never on the data.  Words are
+ * loaded with memcpy() so the byte buffers aren't accessed through another
+ * type; the compiler turns that into a plain load.
+ */
+typedef uintptr_t vb2_word_t;
+#define VB2_WORD_MASK (sizeof(vb2_word_t) - 1)
+
 int vb2_safe_memcmp(const void *s1, const void *s2, size_t size)
 {
 	const unsigned char *us1 = s1;
 	const unsigned char *us2 = s2;
-	int result = 0;
+	vb2_word_t w1, w2;
+	vb2_word_t result = 0;
 
 	if (0 == size)
 		return 0;
 
 	/*
 	 * Code snippet without data-dependent branch due to Nate Lawson
-	 * (nate@root.org) of Root Labs.
+	 * (nate@root.org) of Root Labs.  If the buffers share alignment, the
+	 * middle of them is compared a word at a time.
 	 */
+	if (!(((uintptr_t)us1 ^ (uintptr_t)us2) & VB2_WORD_MASK)) {
+		for (; size && ((uintptr_t)us1 & VB2_WORD_MASK); size--)
+			result |= *us1++ ^ *us2++;
+		for (; size >= sizeof(vb2_word_t); size -= sizeof(vb2_word_t)) {
+			memcpy(&w1, us1, sizeof(w1));
+			memcpy(&w2, us2, sizeof(w2));
+			result |= w1 ^ w2;
+			us1 += sizeof(vb2_word_t);
+			us2 += sizeof(vb2_word_t);
+		}
+	}
 	while (size--)
 		result |= *us1++ ^ *us2++;
 
 	return result != 0;
 }
 
+int vb2_safe_memcmp_fill(const void *s, uint8_t c, size_t size)
+{
+	const unsigned char *us = s;
+	vb2_word_t pattern = (vb2_word_t)-1 / 0xff * c;
+	vb2_word_t w;
+	vb2_word_t result = 0;
+
+	if (0 == size)
+		return 0;
+
+	for (; size && ((uintptr_t)us & VB2_WORD_MASK); size--)
+		result |= *us++ ^ c;
+	for (; size >= sizeof(vb2_word_t); size -= sizeof(vb2_word_t)) {
+		memcpy(&w, us, sizeof(w));
+		result |= w ^ pattern;
+		us += sizeof(vb2_word_t);
+	}
+	while (size--)
+		result |= *us++ ^ c;
+
+	return result != 0;
+}
+
 int vb2_align(uint8_t **ptr, uint32_t *size, uint32_t align, uint32_t want_size)
 {
 	uintptr_t p = (uintptr_t)*ptr;
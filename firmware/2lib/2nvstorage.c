@@ -96,360 +96,242 @@ void vb2_nv_init(struct vb2_context *ctx)
 		sd->status |= VB2_SD_STATUS_NV_INIT;
 }
 
-/* Macro for vb2_nv_get() single-bit settings to reduce duplicate code. */
-#define GETBIT(offs, mask) (p[offs] & mask ? 1 : 0)
-
-uint32_t vb2_nv_get(struct vb2_context *ctx, enum vb2_nv_param param)
-{
-	const uint8_t *p = ctx->nvdata;
-
+/*
+ * Where each param lives in the non-volatile data.
+ *
+ * Fields with size=1 are bits inside a single byte.  Larger fields are whole
+ * bytes, least significant first; their bytes needn't be next to each other.
+ */
+struct vb2_nv_field {
+	uint8_t offs[4];	/* Byte offsets (enum vb2_nv_offset) */
+	uint8_t size;		/* Number of bytes; 0 if param is unknown */
+	uint8_t mask;		/* For size=1, bits of the byte used */
+	uint8_t shift;		/* For size=1, position of the lowest bit */
+	uint8_t flags;		/* VB2_NV_FIELD_* */
+	uint32_t fixup;		/* See flags */
+};
+
+/* Writes of values too big for the field are clipped to the largest value */
+#define VB2_NV_FIELD_CLIP	0x01
+/* Writes of values too big for the field store fixup instead */
+#define VB2_NV_FIELD_CHECK	0x02
+/* Field is only present in V2; reads return fixup on V1, writes are ignored */
+#define VB2_NV_FIELD_V2		0x04
+
+/* Position of the lowest bit set in a byte mask */
+#define NV_SHIFT(mask) ((mask) & 0x01 ? 0 : (mask) & 0x02 ? 1 :		\
+			(mask) & 0x04 ? 2 : (mask) & 0x08 ? 3 :		\
+			(mask) & 0x10 ? 4 : (mask) & 0x20 ? 5 :		\
+			(mask) & 0x40 ? 6 : 7)
+/* Several bits in one byte */
+#define NV_BITS(offs, mask, flags, fixup) \
+	{ { offs }, 1, mask, NV_SHIFT(mask), flags, fixup }
+/* Single bit, set by any non-zero value */
+#define NV_BIT(offs, mask) NV_BITS(offs, mask, VB2_NV_FIELD_CLIP, 0)
+/* Whole byte */
+#define NV_BYTE(offs, flags, fixup) NV_BITS(offs, 0xff, flags, fixup)
+
+/*
+ * TODO: We could reduce the binary size for this table by #ifdef'ing out the
+ * params not used by firmware verification.
+ */
+static const struct vb2_nv_field vb2_nv_fields[VB2_NV_PARAM_COUNT] = {
+	[VB2_NV_FIRMWARE_SETTINGS_RESET] =
+		NV_BIT(VB2_NV_OFFS_HEADER, VB2_NV_HEADER_FW_SETTINGS_RESET),
+	[VB2_NV_KERNEL_SETTINGS_RESET] =
+		NV_BIT(VB2_NV_OFFS_HEADER,
+		       VB2_NV_HEADER_KERNEL_SETTINGS_RESET),
+	[VB2_NV_DEBUG_RESET_MODE] =
+		NV_BIT(VB2_NV_OFFS_BOOT, VB2_NV_BOOT_DEBUG_RESET),
+	[VB2_NV_TRY_NEXT] =
+		NV_BIT(VB2_NV_OFFS_BOOT2, VB2_NV_BOOT2_TRY_NEXT),
+	/* Clip to valid range. */
+	[VB2_NV_TRY_COUNT] =
+		NV_BITS(VB2_NV_OFFS_BOOT, VB2_NV_BOOT_TRY_COUNT_MASK,
+			VB2_NV_FIELD_CLIP, 0),
 	/*
-	 * TODO: We could reduce the binary size for this code by #ifdef'ing
-	 * out the params not used by firmware verification.
+	 * Map values outside the valid range to the legacy reason, since we
+	 * can't determine if we're called from kernel or user mode.
 	 */
-	switch (param) {
-	case VB2_NV_FIRMWARE_SETTINGS_RESET:
-		return GETBIT(VB2_NV_OFFS_HEADER,
-			      VB2_NV_HEADER_FW_SETTINGS_RESET);
-
-	case VB2_NV_KERNEL_SETTINGS_RESET:
-		return GETBIT(VB2_NV_OFFS_HEADER,
-			      VB2_NV_HEADER_KERNEL_SETTINGS_RESET);
-
-	case VB2_NV_DEBUG_RESET_MODE:
-		return GETBIT(VB2_NV_OFFS_BOOT, VB2_NV_BOOT_DEBUG_RESET);
-
-	case VB2_NV_TRY_NEXT:
-		return GETBIT(VB2_NV_OFFS_BOOT2, VB2_NV_BOOT2_TRY_NEXT);
-
-	case VB2_NV_TRY_COUNT:
-		return p[VB2_NV_OFFS_BOOT] & VB2_NV_BOOT_TRY_COUNT_MASK;
-
-	case VB2_NV_FW_TRIED:
-		return GETBIT(VB2_NV_OFFS_BOOT2, VB2_NV_BOOT2_TRIED);
-
-	case VB2_NV_FW_RESULT:
-		return p[VB2_NV_OFFS_BOOT2] & VB2_NV_BOOT2_RESULT_MASK;
-
-	case VB2_NV_FW_PREV_TRIED:
-		return GETBIT(VB2_NV_OFFS_BOOT2, VB2_NV_BOOT2_PREV_TRIED);
-
-	case VB2_NV_FW_PREV_RESULT:
-		return (p[VB2_NV_OFFS_BOOT2] & VB2_NV_BOOT2_PREV_RESULT_MASK)
-			>> VB2_NV_BOOT2_PREV_RESULT_SHIFT;
-
-	case VB2_NV_RECOVERY_REQUEST:
-		return p[VB2_NV_OFFS_RECOVERY];
-
-	case VB2_NV_RECOVERY_SUBCODE:
-		return p[VB2_NV_OFFS_RECOVERY_SUBCODE];
-
-	case VB2_NV_LOCALIZATION_INDEX:
-		return p[VB2_NV_OFFS_LOCALIZATION];
-
-	case VB2_NV_KERNEL_FIELD:
-		return p[VB2_NV_OFFS_KERNEL1] | (p[VB2_NV_OFFS_KERNEL2] << 8);
-
-	case VB2_NV_DEV_BOOT_USB:
-		return GETBIT(VB2_NV_OFFS_DEV, VB2_NV_DEV_FLAG_USB);
-
-	case VB2_NV_DEV_BOOT_LEGACY:
-		return GETBIT(VB2_NV_OFFS_DEV, VB2_NV_DEV_FLAG_LEGACY);
-
-	case VB2_NV_DEV_BOOT_SIGNED_ONLY:
-		return GETBIT(VB2_NV_OFFS_DEV, VB2_NV_DEV_FLAG_SIGNED_ONLY);
-
-	case VB2_NV_DEV_BOOT_FASTBOOT_FULL_CAP:
-		return GETBIT(VB2_NV_OFFS_DEV,
-			      VB2_NV_DEV_FLAG_FASTBOOT_FULL_CAP);
-
-	case VB2_NV_DEV_DEFAULT_BOOT:
-		return (p[VB2_NV_OFFS_DEV] & VB2_NV_DEV_FLAG_DEFAULT_BOOT)
-			>> VB2_NV_DEV_DEFAULT_BOOT_SHIFT;
-
-	case VB2_NV_DEV_ENABLE_UDC:
-		return GETBIT(VB2_NV_OFFS_DEV, VB2_NV_DEV_FLAG_UDC);
-
-	case VB2_NV_DISABLE_DEV_REQUEST:
-		return GETBIT(VB2_NV_OFFS_BOOT, VB2_NV_BOOT_DISABLE_DEV);
-
-	case VB2_NV_OPROM_NEEDED:
-		return GETBIT(VB2_NV_OFFS_BOOT, VB2_NV_BOOT_OPROM_NEEDED);
-
-	case VB2_NV_BACKUP_NVRAM_REQUEST:
-		return GETBIT(VB2_NV_OFFS_BOOT, VB2_NV_BOOT_BACKUP_NVRAM);
-
-	case VB2_NV_CLEAR_TPM_OWNER_REQUEST:
-		return GETBIT(VB2_NV_OFFS_TPM, VB2_NV_TPM_CLEAR_OWNER_REQUEST);
-
-	case VB2_NV_CLEAR_TPM_OWNER_DONE:
-		return GETBIT(VB2_NV_OFFS_TPM, VB2_NV_TPM_CLEAR_OWNER_DONE);
+	[VB2_NV_RECOVERY_REQUEST] =
+		NV_BYTE(VB2_NV_OFFS_RECOVERY, VB2_NV_FIELD_CHECK,
+			VB2_RECOVERY_LEGACY),
+	/* Map values outside the valid range to the default index. */
+	[VB2_NV_LOCALIZATION_INDEX] =
+		NV_BYTE(VB2_NV_OFFS_LOCALIZATION, VB2_NV_FIELD_CHECK, 0),
+	[VB2_NV_KERNEL_FIELD] =
+		{ { VB2_NV_OFFS_KERNEL1, VB2_NV_OFFS_KERNEL2 }, 2 },
+	[VB2_NV_DEV_BOOT_USB] =
+		NV_BIT(VB2_NV_OFFS_DEV, VB2_NV_DEV_FLAG_USB),
+	[VB2_NV_DEV_BOOT_LEGACY] =
+		NV_BIT(VB2_NV_OFFS_DEV, VB2_NV_DEV_FLAG_LEGACY),
+	[VB2_NV_DEV_BOOT_SIGNED_ONLY] =
+		NV_BIT(VB2_NV_OFFS_DEV, VB2_NV_DEV_FLAG_SIGNED_ONLY),
+	[VB2_NV_DEV_BOOT_FASTBOOT_FULL_CAP] =
+		NV_BIT(VB2_NV_OFFS_DEV, VB2_NV_DEV_FLAG_FASTBOOT_FULL_CAP),
+	/* Map out of range values to disk */
+	[VB2_NV_DEV_DEFAULT_BOOT] =
+		NV_BITS(VB2_NV_OFFS_DEV, VB2_NV_DEV_FLAG_DEFAULT_BOOT,
+			VB2_NV_FIELD_CHECK, VB2_DEV_DEFAULT_BOOT_DISK),
+	[VB2_NV_DEV_ENABLE_UDC] =
+		NV_BIT(VB2_NV_OFFS_DEV, VB2_NV_DEV_FLAG_UDC),
+	[VB2_NV_DISABLE_DEV_REQUEST] =
+		NV_BIT(VB2_NV_OFFS_BOOT, VB2_NV_BOOT_DISABLE_DEV),
+	[VB2_NV_OPROM_NEEDED] =
+		NV_BIT(VB2_NV_OFFS_BOOT, VB2_NV_BOOT_OPROM_NEEDED),
+	[VB2_NV_CLEAR_TPM_OWNER_REQUEST] =
+		NV_BIT(VB2_NV_OFFS_TPM, VB2_NV_TPM_CLEAR_OWNER_REQUEST),
+	[VB2_NV_CLEAR_TPM_OWNER_DONE] =
+		NV_BIT(VB2_NV_OFFS_TPM, VB2_NV_TPM_CLEAR_OWNER_DONE),
+	[VB2_NV_TPM_REQUESTED_REBOOT] =
+		NV_BIT(VB2_NV_OFFS_TPM, VB2_NV_TPM_REBOOTED),
+	[VB2_NV_RECOVERY_SUBCODE] =
+		NV_BYTE(VB2_NV_OFFS_RECOVERY_SUBCODE, 0, 0),
+	[VB2_NV_BACKUP_NVRAM_REQUEST] =
+		NV_BIT(VB2_NV_OFFS_BOOT, VB2_NV_BOOT_BACKUP_NVRAM),
+	[VB2_NV_FW_TRIED] =
+		NV_BIT(VB2_NV_OFFS_BOOT2, VB2_NV_BOOT2_TRIED),
+	/* Map out of range values to unknown */
+	[VB2_NV_FW_RESULT] =
+		NV_BITS(VB2_NV_OFFS_BOOT2, VB2_NV_BOOT2_RESULT_MASK,
+			VB2_NV_FIELD_CHECK, VB2_FW_RESULT_UNKNOWN),
+	[VB2_NV_FW_PREV_TRIED] =
+		NV_BIT(VB2_NV_OFFS_BOOT2, VB2_NV_BOOT2_PREV_TRIED),
+	[VB2_NV_FW_PREV_RESULT] =
+		NV_BITS(VB2_NV_OFFS_BOOT2, VB2_NV_BOOT2_PREV_RESULT_MASK,
+			VB2_NV_FIELD_CHECK, VB2_FW_RESULT_UNKNOWN),
+	[VB2_NV_REQ_WIPEOUT] =
+		NV_BIT(VB2_NV_OFFS_HEADER, VB2_NV_HEADER_WIPEOUT),
+	[VB2_NV_FASTBOOT_UNLOCK_IN_FW] =
+		NV_BIT(VB2_NV_OFFS_MISC, VB2_NV_MISC_UNLOCK_FASTBOOT),
+	[VB2_NV_BOOT_ON_AC_DETECT] =
+		NV_BIT(VB2_NV_OFFS_MISC, VB2_NV_MISC_BOOT_ON_AC_DETECT),
+	[VB2_NV_TRY_RO_SYNC] =
+		NV_BIT(VB2_NV_OFFS_MISC, VB2_NV_MISC_TRY_RO_SYNC),
+	[VB2_NV_BATTERY_CUTOFF_REQUEST] =
+		NV_BIT(VB2_NV_OFFS_MISC, VB2_NV_MISC_BATTERY_CUTOFF),
+	[VB2_NV_KERNEL_MAX_ROLLFORWARD] =
+		{ { VB2_NV_OFFS_KERNEL_MAX_ROLLFORWARD1,
+		    VB2_NV_OFFS_KERNEL_MAX_ROLLFORWARD2,
+		    VB2_NV_OFFS_KERNEL_MAX_ROLLFORWARD3,
+		    VB2_NV_OFFS_KERNEL_MAX_ROLLFORWARD4 }, 4 },
+	[VB2_NV_FW_MAX_ROLLFORWARD] =
+		{ { VB2_NV_OFFS_FW_MAX_ROLLFORWARD1,
+		    VB2_NV_OFFS_FW_MAX_ROLLFORWARD2,
+		    VB2_NV_OFFS_FW_MAX_ROLLFORWARD3,
+		    VB2_NV_OFFS_FW_MAX_ROLLFORWARD4 }, 4, 0, 0,
+		  VB2_NV_FIELD_V2, VB2_FW_MAX_ROLLFORWARD_V1_DEFAULT },
+	[VB2_NV_ENABLE_ALT_OS_REQUEST] =
+		NV_BIT(VB2_NV_OFFS_MISC, VB2_NV_MISC_ENABLE_ALT_OS),
+	[VB2_NV_DISABLE_ALT_OS_REQUEST] =
+		NV_BIT(VB2_NV_OFFS_MISC, VB2_NV_MISC_DISABLE_ALT_OS),
+	[VB2_NV_POST_EC_SYNC_DELAY] =
+		NV_BIT(VB2_NV_OFFS_MISC, VB2_NV_MISC_POST_EC_SYNC_DELAY),
+};
+
+#undef NV_SHIFT
+#undef NV_BITS
+#undef NV_BIT
+#undef NV_BYTE
+
+/* Look up a param, or return NULL if it isn't in this version of the data */
+static const struct vb2_nv_field *vb2_nv_field(struct vb2_context *ctx,
+					       enum vb2_nv_param param)
+{
+	const struct vb2_nv_field *f;
 
-	case VB2_NV_TPM_REQUESTED_REBOOT:
-		return GETBIT(VB2_NV_OFFS_TPM, VB2_NV_TPM_REBOOTED);
+	if ((unsigned)param >= VB2_NV_PARAM_COUNT)
+		return NULL;
 
-	case VB2_NV_REQ_WIPEOUT:
-		return GETBIT(VB2_NV_OFFS_HEADER , VB2_NV_HEADER_WIPEOUT);
+	f = vb2_nv_fields + param;
+	if (!f->size)
+		return NULL;
 
-	case VB2_NV_FASTBOOT_UNLOCK_IN_FW:
-		return GETBIT(VB2_NV_OFFS_MISC, VB2_NV_MISC_UNLOCK_FASTBOOT);
+	if ((f->flags & VB2_NV_FIELD_V2) &&
+	    !(ctx->flags & VB2_CONTEXT_NVDATA_V2))
+		return NULL;
 
-	case VB2_NV_BOOT_ON_AC_DETECT:
-		return GETBIT(VB2_NV_OFFS_MISC, VB2_NV_MISC_BOOT_ON_AC_DETECT);
+	return f;
+}
 
-	case VB2_NV_TRY_RO_SYNC:
-		return GETBIT(VB2_NV_OFFS_MISC, VB2_NV_MISC_TRY_RO_SYNC);
+static uint32_t vb2_nv_field_get(const uint8_t *p,
+				 const struct vb2_nv_field *f)
+{
+	uint32_t value = 0;
+	int i;
 
-	case VB2_NV_BATTERY_CUTOFF_REQUEST:
-		return GETBIT(VB2_NV_OFFS_MISC, VB2_NV_MISC_BATTERY_CUTOFF);
+	if (f->size == 1)
+		return (p[f->offs[0]] & f->mask) >> f->shift;
 
-	case VB2_NV_KERNEL_MAX_ROLLFORWARD:
-		return (p[VB2_NV_OFFS_KERNEL_MAX_ROLLFORWARD1]
-			| (p[VB2_NV_OFFS_KERNEL_MAX_ROLLFORWARD2] << 8)
-			| (p[VB2_NV_OFFS_KERNEL_MAX_ROLLFORWARD3] << 16)
-			| (p[VB2_NV_OFFS_KERNEL_MAX_ROLLFORWARD4] << 24));
+	for (i = f->size - 1; i >= 0; i--)
+		value = (value << 8) | p[f->offs[i]];
+	return value;
+}
 
-	case VB2_NV_FW_MAX_ROLLFORWARD:
-		/* Field only present in V2 */
-		if (!(ctx->flags & VB2_CONTEXT_NVDATA_V2))
-			return VB2_FW_MAX_ROLLFORWARD_V1_DEFAULT;
+uint32_t vb2_nv_get(struct vb2_context *ctx, enum vb2_nv_param param)
+{
+	const struct vb2_nv_field *f = vb2_nv_field(ctx, param);
+
+	if (!f) {
+		/* Fields only present in V2 have a default value for V1 */
+		if ((unsigned)param < VB2_NV_PARAM_COUNT &&
+		    (vb2_nv_fields[param].flags & VB2_NV_FIELD_V2))
+			return vb2_nv_fields[param].fixup;
+		return 0;
+	}
 
-		return (p[VB2_NV_OFFS_FW_MAX_ROLLFORWARD1]
-			| (p[VB2_NV_OFFS_FW_MAX_ROLLFORWARD2] << 8)
-			| (p[VB2_NV_OFFS_FW_MAX_ROLLFORWARD3] << 16)
-			| (p[VB2_NV_OFFS_FW_MAX_ROLLFORWARD4] << 24));
+	return vb2_nv_field_get(ctx->nvdata, f);
+}
 
-	case VB2_NV_ENABLE_ALT_OS_REQUEST:
-		return GETBIT(VB2_NV_OFFS_MISC, VB2_NV_MISC_ENABLE_ALT_OS);
+int vb2_nv_get_all(struct vb2_context *ctx, uint32_t *values, int count)
+{
+	int i;
 
-	case VB2_NV_DISABLE_ALT_OS_REQUEST:
-		return GETBIT(VB2_NV_OFFS_MISC, VB2_NV_MISC_DISABLE_ALT_OS);
+	if (count > VB2_NV_PARAM_COUNT)
+		count = VB2_NV_PARAM_COUNT;
 
-	case VB2_NV_POST_EC_SYNC_DELAY:
-		return GETBIT(VB2_NV_OFFS_MISC,
-			      VB2_NV_MISC_POST_EC_SYNC_DELAY);
-	}
+	for (i = 0; i < count; i++)
+		values[i] = vb2_nv_get(ctx, i);
 
-	/*
-	 * Put default return outside the switch() instead of in default:, so
-	 * that adding a new param will cause a compiler warning.
-	 */
-	return 0;
+	return count;
 }
 
-#undef GETBIT
-
-/* Macro for vb2_nv_set() single-bit settings to reduce duplicate code. */
-#define SETBIT(offs, mask)					\
-	{ if (value) p[offs] |= mask; else p[offs] &= ~mask; }
-
 void vb2_nv_set(struct vb2_context *ctx,
 		enum vb2_nv_param param,
 		uint32_t value)
 {
+	const struct vb2_nv_field *f = vb2_nv_field(ctx, param);
 	uint8_t *p = ctx->nvdata;
+	uint32_t max;
+	int i;
 
-	/* If not changing the value, don't regenerate the CRC. */
-	if (vb2_nv_get(ctx, param) == value)
+	if (!f)
 		return;
 
-	/*
-	 * TODO: We could reduce the binary size for this code by #ifdef'ing
-	 * out the params not used by firmware verification.
-	 */
-	switch (param) {
-	case VB2_NV_FIRMWARE_SETTINGS_RESET:
-		SETBIT(VB2_NV_OFFS_HEADER, VB2_NV_HEADER_FW_SETTINGS_RESET);
-		break;
-
-	case VB2_NV_KERNEL_SETTINGS_RESET:
-		SETBIT(VB2_NV_OFFS_HEADER, VB2_NV_HEADER_KERNEL_SETTINGS_RESET);
-		break;
-
-	case VB2_NV_DEBUG_RESET_MODE:
-		SETBIT(VB2_NV_OFFS_BOOT, VB2_NV_BOOT_DEBUG_RESET);
-		break;
-
-	case VB2_NV_TRY_NEXT:
-		SETBIT(VB2_NV_OFFS_BOOT2, VB2_NV_BOOT2_TRY_NEXT);
-		break;
-
-	case VB2_NV_TRY_COUNT:
-		/* Clip to valid range. */
-		if (value > VB2_NV_BOOT_TRY_COUNT_MASK)
-			value = VB2_NV_BOOT_TRY_COUNT_MASK;
-
-		p[VB2_NV_OFFS_BOOT] &= ~VB2_NV_BOOT_TRY_COUNT_MASK;
-		p[VB2_NV_OFFS_BOOT] |= (uint8_t)value;
-		break;
-
-	case VB2_NV_FW_TRIED:
-		SETBIT(VB2_NV_OFFS_BOOT2, VB2_NV_BOOT2_TRIED);
-		break;
-
-	case VB2_NV_FW_RESULT:
-		/* Map out of range values to unknown */
-		if (value > VB2_NV_BOOT2_RESULT_MASK)
-			value = VB2_FW_RESULT_UNKNOWN;
-
-		p[VB2_NV_OFFS_BOOT2] &= ~VB2_NV_BOOT2_RESULT_MASK;
-		p[VB2_NV_OFFS_BOOT2] |= (uint8_t)value;
-		break;
-
-	case VB2_NV_FW_PREV_TRIED:
-		SETBIT(VB2_NV_OFFS_BOOT2, VB2_NV_BOOT2_PREV_TRIED);
-		break;
-
-	case VB2_NV_FW_PREV_RESULT:
-		/* Map out of range values to unknown */
-		if (value > VB2_NV_BOOT2_RESULT_MASK)
-			value = VB2_FW_RESULT_UNKNOWN;
-
-		p[VB2_NV_OFFS_BOOT2] &= ~VB2_NV_BOOT2_PREV_RESULT_MASK;
-		p[VB2_NV_OFFS_BOOT2] |=
-			(uint8_t)(value << VB2_NV_BOOT2_PREV_RESULT_SHIFT);
-		break;
-
-	case VB2_NV_RECOVERY_REQUEST:
-		/*
-		 * Map values outside the valid range to the legacy reason,
-		 * since we can't determine if we're called from kernel or user
-		 * mode.
-		 */
-		if (value > 0xff)
-			value = VB2_RECOVERY_LEGACY;
-		p[VB2_NV_OFFS_RECOVERY] = (uint8_t)value;
-		break;
-
-	case VB2_NV_RECOVERY_SUBCODE:
-		p[VB2_NV_OFFS_RECOVERY_SUBCODE] = (uint8_t)value;
-		break;
-
-	case VB2_NV_LOCALIZATION_INDEX:
-		/* Map values outside the valid range to the default index. */
-		if (value > 0xFF)
-			value = 0;
-		p[VB2_NV_OFFS_LOCALIZATION] = (uint8_t)value;
-		break;
-
-	case VB2_NV_KERNEL_FIELD:
-		p[VB2_NV_OFFS_KERNEL1] = (uint8_t)(value);
-		p[VB2_NV_OFFS_KERNEL2] = (uint8_t)(value >> 8);
-		break;
-
-	case VB2_NV_DEV_BOOT_USB:
-		SETBIT(VB2_NV_OFFS_DEV, VB2_NV_DEV_FLAG_USB);
-		break;
-
-	case VB2_NV_DEV_BOOT_LEGACY:
-		SETBIT(VB2_NV_OFFS_DEV, VB2_NV_DEV_FLAG_LEGACY);
-		break;
-
-	case VB2_NV_DEV_BOOT_SIGNED_ONLY:
-		SETBIT(VB2_NV_OFFS_DEV, VB2_NV_DEV_FLAG_SIGNED_ONLY);
-		break;
-
-	case VB2_NV_DEV_BOOT_FASTBOOT_FULL_CAP:
-		SETBIT(VB2_NV_OFFS_DEV, VB2_NV_DEV_FLAG_FASTBOOT_FULL_CAP);
-		break;
-
-	case VB2_NV_DEV_DEFAULT_BOOT:
-		/* Map out of range values to disk */
-		if (value > (VB2_NV_DEV_FLAG_DEFAULT_BOOT >>
-			     VB2_NV_DEV_DEFAULT_BOOT_SHIFT))
-			value = VB2_DEV_DEFAULT_BOOT_DISK;
-
-		p[VB2_NV_OFFS_DEV] &= ~VB2_NV_DEV_FLAG_DEFAULT_BOOT;
-		p[VB2_NV_OFFS_DEV] |=
-			(uint8_t)(value << VB2_NV_DEV_DEFAULT_BOOT_SHIFT);
-		break;
-
-	case VB2_NV_DEV_ENABLE_UDC:
-		SETBIT(VB2_NV_OFFS_DEV, VB2_NV_DEV_FLAG_UDC);
-		break;
-
-	case VB2_NV_DISABLE_DEV_REQUEST:
-		SETBIT(VB2_NV_OFFS_BOOT, VB2_NV_BOOT_DISABLE_DEV);
-		break;
-
-	case VB2_NV_OPROM_NEEDED:
-		SETBIT(VB2_NV_OFFS_BOOT, VB2_NV_BOOT_OPROM_NEEDED);
-		break;
-
-	case VB2_NV_BACKUP_NVRAM_REQUEST:
-		SETBIT(VB2_NV_OFFS_BOOT, VB2_NV_BOOT_BACKUP_NVRAM);
-		break;
-
-	case VB2_NV_CLEAR_TPM_OWNER_REQUEST:
-		SETBIT(VB2_NV_OFFS_TPM, VB2_NV_TPM_CLEAR_OWNER_REQUEST);
-		break;
-
-	case VB2_NV_CLEAR_TPM_OWNER_DONE:
-		SETBIT(VB2_NV_OFFS_TPM, VB2_NV_TPM_CLEAR_OWNER_DONE);
-		break;
-
-	case VB2_NV_TPM_REQUESTED_REBOOT:
-		SETBIT(VB2_NV_OFFS_TPM, VB2_NV_TPM_REBOOTED);
-		break;
-
-	case VB2_NV_REQ_WIPEOUT:
-		SETBIT(VB2_NV_OFFS_HEADER , VB2_NV_HEADER_WIPEOUT);
-		break;
-
-	case VB2_NV_FASTBOOT_UNLOCK_IN_FW:
-		SETBIT(VB2_NV_OFFS_MISC, VB2_NV_MISC_UNLOCK_FASTBOOT);
-		break;
-
-	case VB2_NV_BOOT_ON_AC_DETECT:
-		SETBIT(VB2_NV_OFFS_MISC, VB2_NV_MISC_BOOT_ON_AC_DETECT);
-		break;
-
-	case VB2_NV_TRY_RO_SYNC:
-		SETBIT(VB2_NV_OFFS_MISC, VB2_NV_MISC_TRY_RO_SYNC);
-		break;
-
-	case VB2_NV_BATTERY_CUTOFF_REQUEST:
-		SETBIT(VB2_NV_OFFS_MISC, VB2_NV_MISC_BATTERY_CUTOFF);
-		break;
-
-	case VB2_NV_KERNEL_MAX_ROLLFORWARD:
-		p[VB2_NV_OFFS_KERNEL_MAX_ROLLFORWARD1] = (uint8_t)(value);
-		p[VB2_NV_OFFS_KERNEL_MAX_ROLLFORWARD2] = (uint8_t)(value >> 8);
-		p[VB2_NV_OFFS_KERNEL_MAX_ROLLFORWARD3] = (uint8_t)(value >> 16);
-		p[VB2_NV_OFFS_KERNEL_MAX_ROLLFORWARD4] = (uint8_t)(value >> 24);
-		break;
-
-	case VB2_NV_FW_MAX_ROLLFORWARD:
-		/* Field only present in V2 */
-		if (!(ctx->flags & VB2_CONTEXT_NVDATA_V2))
-			return;
-
-		p[VB2_NV_OFFS_FW_MAX_ROLLFORWARD1] = (uint8_t)(value);
-		p[VB2_NV_OFFS_FW_MAX_ROLLFORWARD2] = (uint8_t)(value >> 8);
-		p[VB2_NV_OFFS_FW_MAX_ROLLFORWARD3] = (uint8_t)(value >> 16);
-		p[VB2_NV_OFFS_FW_MAX_ROLLFORWARD4] = (uint8_t)(value >> 24);
-		break;
-
-	case VB2_NV_ENABLE_ALT_OS_REQUEST:
-		SETBIT(VB2_NV_OFFS_MISC, VB2_NV_MISC_ENABLE_ALT_OS);
-		break;
-
-	case VB2_NV_DISABLE_ALT_OS_REQUEST:
-		SETBIT(VB2_NV_OFFS_MISC, VB2_NV_MISC_DISABLE_ALT_OS);
-		break;
-
-	case VB2_NV_POST_EC_SYNC_DELAY:
-		SETBIT(VB2_NV_OFFS_MISC, VB2_NV_MISC_POST_EC_SYNC_DELAY);
-		break;
+	/* Deal with values too big for the field */
+	max = f->size == 1 ? f->mask >> f->shift :
+			0xffffffff >> (32 - 8 * f->size);
+	if (value > max) {
+		if (f->flags & VB2_NV_FIELD_CLIP)
+			value = max;
+		else if (f->flags & VB2_NV_FIELD_CHECK)
+			value = f->fixup;
+		else
+			value &= max;
 	}
 
-	/*
-	 * Note there is no default case.  This causes a compiler warning if
-	 * a new param is added to the enum without adding support here.
-	 */
+	/* If not changing the value, don't regenerate the CRC. */
+	if (vb2_nv_field_get(p, f) == value)
+		return;
+
+	if (f->size == 1) {
+		p[f->offs[0]] &= ~f->mask;
+		p[f->offs[0]] |= (uint8_t)(value << f->shift);
+	} else {
+		for (i = 0; i < f->size; i++, value >>= 8)
+			p[f->offs[i]] = (uint8_t)value;
+	}
 
 	/* Need to regenerate CRC, since the value changed. */
 	vb2_nv_regen_crc(ctx);
 }
-
-#undef SETBIT
@@ -27,6 +27,41 @@ int vb2_secdata_check_crc(const struct vb2_context *ctx)
 	return VB2_SUCCESS;
 }
 
+int vb2_secdata_snapshot_check(const struct vb2_secdata_snapshot *snapshot)
+{
+	const struct vb2_secdata *sec =
+		(const struct vb2_secdata *)snapshot->secdata;
+	const struct vb2_secdatak *seck =
+		(const struct vb2_secdatak *)snapshot->secdatak;
+	const uint8_t *fwmp = snapshot->fwmp;
+
+	if (snapshot->spaces & VB2_SECDATA_SPACE_FIRMWARE) {
+		if (sec->crc8 !=
+		    vb2_crc8(sec, offsetof(struct vb2_secdata, crc8)))
+			return VB2_ERROR_SECDATA_CRC;
+		if (!sec->struct_version)
+			return VB2_ERROR_SECDATA_ZERO;
+	}
+
+	if (snapshot->spaces & VB2_SECDATA_SPACE_KERNEL) {
+		if (seck->crc8 !=
+		    vb2_crc8(seck, offsetof(struct vb2_secdatak, crc8)))
+			return VB2_ERROR_SECDATAK_CRC;
+	}
+
+	if (snapshot->spaces & VB2_SECDATA_SPACE_FWMP) {
+		/* CRC is in byte 0 and covers everything after the size */
+		if (snapshot->fwmp_size < 2 ||
+		    snapshot->fwmp_size > sizeof(snapshot->fwmp) ||
+		    fwmp[1] != snapshot->fwmp_size)
+			return VB2_ERROR_SECDATA_FWMP_SIZE;
+		if (fwmp[0] != vb2_crc8(fwmp + 2, snapshot->fwmp_size - 2))
+			return VB2_ERROR_SECDATA_FWMP_CRC;
+	}
+
+	return VB2_SUCCESS;
+}
+
 int vb2_secdata_create(struct vb2_context *ctx)
 {
 	struct vb2_secdata *sec = (struct vb2_secdata *)ctx->secdata;
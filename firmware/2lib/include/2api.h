@@ -42,6 +42,43 @@
 #define VB2_SECDATA_SIZE 10
 #define VB2_SECDATAK_SIZE 14
 
+/* Largest firmware management parameters space vboot will read */
+#define VB2_SECDATA_FWMP_MAX_SIZE 128
+
+/* Secure storage spaces, for vb2_secdata_snapshot.spaces */
+enum vb2_secdata_space {
+	/* Firmware space; copied to vb2_context.secdata */
+	VB2_SECDATA_SPACE_FIRMWARE = (1 << 0),
+
+	/* Kernel version space; copied to vb2_context.secdatak */
+	VB2_SECDATA_SPACE_KERNEL = (1 << 1),
+
+	/* Firmware management parameters (FWMP) */
+	VB2_SECDATA_SPACE_FWMP = (1 << 2),
+};
+
+/*
+ * All the secure storage spaces used by vboot, as read in one pass by
+ * vb2ex_secdata_read_all().
+ */
+struct vb2_secdata_snapshot {
+	/* Spaces which exist and were read; see enum vb2_secdata_space */
+	uint32_t spaces;
+
+	/* Number of bytes of fwmp[] which were read */
+	uint32_t fwmp_size;
+
+	uint8_t secdata[VB2_SECDATA_SIZE];
+	uint8_t secdatak[VB2_SECDATAK_SIZE];
+
+	/*
+	 * FWMP.  Byte 0 is a CRC8 of bytes 2 through fwmp_size-1, and byte 1
+	 * is the struct size, which must match fwmp_size.  vboot doesn't look
+	 * at the rest.
+	 */
+	uint8_t fwmp[VB2_SECDATA_FWMP_MAX_SIZE];
+};
+
 /*
  * Recommended size of work buffer for firmware verification stage
  *
@@ -449,6 +486,39 @@ int vb2api_secdatak_check(const struct vb2_context *ctx);
  */
 int vb2api_secdatak_create(struct vb2_context *ctx);
 
+/**
+ * Read all the secure storage spaces in one pass.
+ *
+ * Calls vb2ex_secdata_read_all() and checks the CRCs of all the spaces
+ * together, reading them again if any CRC is bad.  The firmware space must be
+ * there; the kernel and FWMP spaces are optional.  On success, the firmware
+ * and kernel spaces are copied to vb2_context.secdata and .secdatak, and the
+ * snapshot is kept in the work buffer so it can be looked at with
+ * vb2api_get_secdata_snapshot() without going back to secure storage.  Once
+ * there is a snapshot, later calls return success without reading anything.
+ *
+ * vb2api_fw_phase1() calls this, and so does the kernel phase, which then
+ * takes the kernel version and FWMP from the snapshot instead of the TPM.  It
+ * may also be called earlier, after vb2_init_context().  If this returns
+ * VB2_ERROR_EX_SECDATA_READ_ALL_UNIMPLEMENTED, the caller must load the
+ * spaces one at a time as before.
+ *
+ * @param ctx		Context pointer
+ * @return VB2_SUCCESS, or non-zero error code if error.
+ */
+int vb2api_secdata_read_all(struct vb2_context *ctx);
+
+/**
+ * Get the snapshot of secure storage read by vb2api_secdata_read_all().
+ *
+ * @param ctx		Context pointer
+ * @param snapshot	Destination for a pointer to the snapshot
+ * @return VB2_SUCCESS, or VB2_ERROR_SECDATA_SNAPSHOT_MISSING if there isn't
+ * one.
+ */
+int vb2api_get_secdata_snapshot(struct vb2_context *ctx,
+				const struct vb2_secdata_snapshot **snapshot);
+
 /**
  * Report firmware failure to vboot.
  *
@@ -655,6 +725,30 @@ int vb2api_kernel_phase3(struct vb2_context *ctx);
  */
 int vb2ex_tpm_clear_owner(struct vb2_context *ctx);
 
+/**
+ * Read all of the secure storage spaces vboot uses.
+ *
+ * Implement this if secure storage can be read more cheaply in one batch than
+ * space by space, or if the caller already has the spaces in memory from an
+ * earlier boot stage.  Fill in snapshot with every space which exists, and
+ * set the matching VB2_SECDATA_SPACE_* bits in snapshot->spaces.  A missing
+ * FWMP space is not an error.  Don't check CRCs; vboot does that for all the
+ * spaces at once, and calls this again if any are bad.  vboot doesn't check
+ * the spaces' TPM attributes when it uses a snapshot, so only hand over
+ * spaces which have been checked.
+ *
+ * This is optional.  The default returns
+ * VB2_ERROR_EX_SECDATA_READ_ALL_UNIMPLEMENTED, and then the caller must load
+ * vb2_context.secdata before vb2api_fw_phase1(), and the kernel phase reads
+ * the TPM spaces one at a time.
+ *
+ * @param ctx		Vboot context
+ * @param snapshot	Destination for spaces; zeroed by the caller
+ * @return VB2_SUCCESS, or error code on error.
+ */
+int vb2ex_secdata_read_all(struct vb2_context *ctx,
+			   struct vb2_secdata_snapshot *snapshot);
+
 /**
  * Read a verified boot resource.
  *
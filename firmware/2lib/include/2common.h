@@ -159,6 +159,18 @@ void vb2_workbuf_free(struct vb2_workbuf *wb, uint32_t size);
  */
 int vb2_safe_memcmp(const void *s1, const void *s2, size_t size);
 
+/**
+ * Check that a buffer is filled with a single byte value, in constant time.
+ *
+ * Like vb2_safe_memcmp() against a buffer of size bytes all equal to c.
+ *
+ * @param s		Buffer to check
+ * @param c		Expected value of every byte
+ * @param size		Number of bytes to check
+ * @return 0 if every byte is c or size=0, non-zero otherwise.
+ */
+int vb2_safe_memcmp_fill(const void *s, uint8_t c, size_t size);
+
 /**
  * Align a buffer and check its size.
  *
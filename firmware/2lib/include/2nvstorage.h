@@ -125,6 +125,9 @@ enum vb2_nv_param {
 	 * testing Alt OS booting.
 	 */
 	VB2_NV_POST_EC_SYNC_DELAY,
+
+	/* Number of params; not a param itself */
+	VB2_NV_PARAM_COUNT,
 };
 
 /* Set default boot in developer mode */
@@ -215,6 +218,20 @@ void vb2_nv_init(struct vb2_context *ctx);
  */
 uint32_t vb2_nv_get(struct vb2_context *ctx, enum vb2_nv_param param);
 
+/**
+ * Read all the non-volatile values at once.
+ *
+ * Valid only after calling vb2_nv_init().
+ *
+ * @param ctx		Context pointer
+ * @param values	Destination; values[param] is set to the value of
+ *			each param, as vb2_nv_get() would return it
+ * @param count		Number of entries in values
+ * @return The number of entries filled in.  This is less than count if the
+ *         caller knows about more params than this library.
+ */
+int vb2_nv_get_all(struct vb2_context *ctx, uint32_t *values, int count);
+
 /**
  * Write a non-volatile value.
  *
@@ -135,6 +135,27 @@ enum vb2_return_code {
 	/* Called vb2_secdatak_set() with uninitialized secdatak */
 	VB2_ERROR_SECDATAK_SET_UNINITIALIZED,
 
+	/* Bad CRC in firmware management parameters from secdata snapshot */
+	VB2_ERROR_SECDATA_FWMP_CRC,
+
+	/* Bad size of firmware management parameters in secdata snapshot */
+	VB2_ERROR_SECDATA_FWMP_SIZE,
+
+	/* Not enough work buffer for secdata snapshot */
+	VB2_ERROR_SECDATA_SNAPSHOT_WORKBUF,
+
+	/* No secdata snapshot has been read this boot */
+	VB2_ERROR_SECDATA_SNAPSHOT_MISSING,
+
+	/* Secdata snapshot doesn't include the firmware space */
+	VB2_ERROR_SECDATA_SNAPSHOT_NO_FIRMWARE,
+
+	/* Secdata snapshot doesn't include the kernel space */
+	VB2_ERROR_SECDATA_SNAPSHOT_NO_KERNEL,
+
+	/* Incompatible version of firmware management parameters */
+	VB2_ERROR_SECDATA_FWMP_VERSION,
+
 	/**********************************************************************
 	 * Common code errors
 	 */
@@ -262,6 +283,9 @@ enum vb2_return_code {
 	/* Null public key buffer passed to vb2_unpack_key_buffer() */
 	VB2_ERROR_UNPACK_KEY_BUFFER,
 
+	/* Key n0inv doesn't match modulus in vb2_unpack_key_data() */
+	VB2_ERROR_UNPACK_KEY_N0INV,
+
 	/**********************************************************************
 	 * Keyblock verification errors (all in vb2_verify_keyblock())
 	 */
@@ -606,6 +630,12 @@ enum vb2_return_code {
 	/* Hardware crypto engine doesn't support this algorithm (non-fatal) */
 	VB2_ERROR_EX_HWCRYPTO_UNSUPPORTED,
 
+	/* Reading all secure storage spaces at once not implemented */
+	VB2_ERROR_EX_SECDATA_READ_ALL_UNIMPLEMENTED,
+
+	/* Reading all secure storage spaces at once failed */
+	VB2_ERROR_EX_SECDATA_READ_ALL,
+
 
 	/**********************************************************************
 	 * Errors generated by host library (non-firmware) start here.
@@ -51,6 +51,28 @@ uint32_t vb2_rsa_sig_size(enum vb2_signature_algorithm sig_alg);
  */
 uint32_t vb2_packed_key_size(enum vb2_signature_algorithm sig_alg);
 
+/**
+ * Unpack the RSA data fields for a public key.
+ *
+ * The key data is the same pre-processed format everywhere vboot stores an
+ * RSA public key: the array size, n0inv = -1 / n[0] mod 2^32, then n[] and
+ * R^2 mod n as little-endian uint32_t arrays.  Both constants needed by
+ * vb2_rsa_verify_digest() come from the key data, so nothing has to be
+ * recomputed at verify time.  n0inv is checked against n[] so a corrupt key
+ * is caught here rather than as a bad signature.
+ *
+ * key->sig_alg must be set before calling this.  The arrays in *key will
+ * point inside the key_data buffer.
+ *
+ * @param key		Destination key for RSA data fields
+ * @param key_data	Packed key data (from inside a packed key buffer)
+ * @param key_size	Size of packed key data in bytes
+ * @return VB2_SUCCESS, or non-zero if error.
+ */
+int vb2_unpack_key_data(struct vb2_public_key *key,
+			const uint8_t *key_data,
+			uint32_t key_size);
+
 /**
  * Check pkcs 1.5 padding bytes
  *
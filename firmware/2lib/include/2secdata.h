@@ -150,6 +150,16 @@ int vb2_secdata_set(struct vb2_context *ctx,
 		    enum vb2_secdata_param param,
 		    uint32_t value);
 
+/**
+ * Check the CRCs of all the spaces in a secure storage snapshot.
+ *
+ * Only spaces marked present in snapshot->spaces are checked.
+ *
+ * @param snapshot	Snapshot to check
+ * @return VB2_SUCCESS, or non-zero error code if error.
+ */
+int vb2_secdata_snapshot_check(const struct vb2_secdata_snapshot *snapshot);
+
 /*****************************************************************************/
 /* Kernel version space functions.
  *
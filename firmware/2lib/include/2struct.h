@@ -212,6 +212,21 @@ struct vb2_shared_data {
 	struct vb2_gbb_header *gbb;
 	uint32_t gbb_size;
 
+	/*
+	 * Offsets of the GBB root and recovery keys cached in the work buffer
+	 * by VbGbbGetRootKey() and VbGbbGetRecoveryKey().  Zero if the key
+	 * hasn't been read yet this boot.
+	 */
+	uint32_t workbuf_gbb_rootkey_offset;
+	uint32_t workbuf_gbb_recovery_key_offset;
+
+	/*
+	 * Offset of the secure storage snapshot read by
+	 * vb2api_secdata_read_all() in the work buffer.  Zero if there isn't
+	 * one yet.
+	 */
+	uint32_t workbuf_secdata_snapshot_offset;
+
 
 } __attribute__((packed));
 
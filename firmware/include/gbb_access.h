@@ -15,29 +15,45 @@ extern "C" {
 #endif  /* __cplusplus */
 
 struct vb2_context;
-struct VbPublicKey;
+struct vb2_packed_key;
+struct vb2_public_key;
 
 /**
- * Read the root key from the GBB
+ * Get the root key from the GBB
+ *
+ * The first call copies the key into the context work buffer and bumps
+ * ctx->workbuf_used past it.  Later calls during the same boot return the same
+ * copy, so there's nothing to free.  Don't call this while holding a work
+ * buffer taken from the context with vb2_workbuf_from_ctx().
+ *
+ * The copy stays in the work buffer until the context goes away; for the
+ * kernel stage that's the end of VbSelectAndLoadKernel().  Each key takes
+ * its packed size plus a small header, about 2 KB for an RSA8192 key, which
+ * is no longer available for kernel verification.
  *
  * @param ctx		Vboot context
- * @param keyp		Returns a pointer to the key. The caller must call
- *			free() on the key when finished with it.
+ * @param packedp	If non-NULL, returns a pointer to the packed key
+ * @param keyp		If non-NULL, returns a pointer to the unpacked key.
+ *			It's only unpacked the first time it's asked for.
  * @return VBERROR_... error, VBERROR_SUCCESS on success,
  */
-VbError_t VbGbbReadRootKey(struct vb2_context *ctx,
-			   struct VbPublicKey **keyp);
+VbError_t VbGbbGetRootKey(struct vb2_context *ctx,
+			  const struct vb2_packed_key **packedp,
+			  const struct vb2_public_key **keyp);
 
 /**
- * Read the recovery key from the GBB
+ * Get the recovery key from the GBB
+ *
+ * Same as VbGbbGetRootKey(), but for the recovery key.
  *
  * @param ctx		Vboot context
- * @param keyp		Returns a pointer to the key. The caller must call
- *			free() on the key when finished with it.
+ * @param packedp	If non-NULL, returns a pointer to the packed key
+ * @param keyp		If non-NULL, returns a pointer to the unpacked key
  * @return VBERROR_... error, VBERROR_SUCCESS on success,
  */
-VbError_t VbGbbReadRecoveryKey(struct vb2_context *ctx,
-			       struct VbPublicKey **keyp);
+VbError_t VbGbbGetRecoveryKey(struct vb2_context *ctx,
+			      const struct vb2_packed_key **packedp,
+			      const struct vb2_public_key **keyp);
 
 /**
  * Read the hardware ID from the GBB
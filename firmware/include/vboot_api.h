@@ -138,6 +138,8 @@ enum VbErrorPredefined_t {
 	VBERROR_PERIPHERAL_BUSY               = 0x10030,
 	/* Error reading or writing Alt OS flags to TPM */
 	VBERROR_TPM_ALT_OS                    = 0x10031,
+	/* Not enough room left in the work buffer */
+	VBERROR_OUT_OF_MEMORY                 = 0x10032,
 
 	/* VbExEcGetExpectedRWHash() may return the following codes */
 	/* Compute expected RW hash from the EC image; BIOS doesn't have it */
@@ -555,6 +557,22 @@ VbError_t VbExDiskGetInfo(VbDiskInfo **infos_ptr, uint32_t *count,
 VbError_t VbExDiskFreeInfo(VbDiskInfo *infos,
 			   VbExDiskHandle_t preserve_handle);
 
+/**
+ * Get a generation number for the disks matching disk_flags.
+ *
+ * The number must change whenever a matching disk is attached or removed, or
+ * the media in one changes, so that a disk which was already rejected isn't
+ * read and verified again until something happens to it.  A platform which
+ * can't tell should return an error; vboot then assumes the disks may have
+ * changed every time it looks.  vboot has a weak default which does that, so
+ * implementing this is optional.
+ *
+ * @param disk_flags	Disk flags, as passed to VbExDiskGetInfo()
+ * @param generation	Returns the current generation number
+ * @return VBERROR_... error, VBERROR_SUCCESS on success.
+ */
+VbError_t VbExDiskGetGeneration(uint32_t disk_flags, uint32_t *generation);
+
 /**
  * Read lba_count LBA sectors, starting at sector lba_start, from the disk,
  * into the buffer.
@@ -19,7 +19,6 @@
 #define BACKUP_NV_INDEX                 0x1009
 #define BACKUP_NV_SIZE 16
 #define FWMP_NV_INDEX			0x100a
-#define FWMP_NV_MAX_SIZE 128
 #define REC_HASH_NV_INDEX                0x100b
 #define REC_HASH_NV_SIZE                 VB2_SHA256_DIGEST_SIZE
 /* Space to hold a temporary SHA256 digest of a public key for USB autoconfig;
@@ -141,6 +140,22 @@ uint32_t RollbackKernelLock(int recovery_mode);
  */
 uint32_t RollbackFwmpRead(struct RollbackSpaceFwmp *fwmp);
 
+/* Counts of firmware and kernel space writes made and skipped this boot */
+struct RollbackWriteStats {
+	uint32_t firmware_writes;
+	uint32_t firmware_writes_avoided;
+	uint32_t kernel_writes;
+	uint32_t kernel_writes_avoided;
+};
+
+/**
+ * Get the number of TPM NV writes made and avoided so far.
+ *
+ * Writes are avoided when the space already holds the data being written, as
+ * last read back from the TPM.
+ */
+void RollbackGetWriteStats(struct RollbackWriteStats *stats);
+
 /****************************************************************************/
 
 /*
@@ -161,6 +176,12 @@ uint32_t TPMClearAndReenable(void);
  */
 uint32_t SafeWrite(uint32_t index, const void *data, uint32_t length);
 
+/**
+ * Forget the cached contents of the firmware and kernel spaces, and zero the
+ * write counters, as if the system had just booted.
+ */
+void RollbackSpaceCacheReset(void);
+
 /**
  * Utility function to turn the virtual dev-mode flag on or off. 0=off, 1=on.
  */
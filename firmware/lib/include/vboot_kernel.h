@@ -13,8 +13,11 @@
 #include "gpt_misc.h"
 #include "load_kernel_fw.h"
 #include "vboot_api.h"
+#include "vboot_struct.h"
 
 struct vb2_context;
+struct vb2_public_key;
+struct vb2_workbuf;
 
 /**
  * Attempt loading a kernel from the specified type(s) of disks.
@@ -88,4 +91,28 @@ uint32_t vb2_get_fwmp_flags(void);
  */
 void vb2_nv_commit(struct vb2_context *ctx);
 
+/**
+ * Verify the keyblock and preamble at the start of a kernel partition.
+ *
+ * Checks signatures in place, so kbuf is modified.
+ *
+ * @param kbuf		Buffer containing the vblock
+ * @param kbuf_size	Size of the buffer in bytes
+ * @param kernel_subkey	Kernel subkey to use in validating keyblock, or NULL
+ *			if it couldn't be unpacked
+ * @param params	Load kernel parameters
+ * @param min_version	Minimum kernel version
+ * @param shpart	Destination for verification results
+ * @param wb		Work buffer
+ * @return VB2_SUCCESS, or non-zero error code.
+ */
+int vb2_verify_kernel_vblock(struct vb2_context *ctx,
+			     uint8_t *kbuf,
+			     uint32_t kbuf_size,
+			     const struct vb2_public_key *kernel_subkey,
+			     const LoadKernelParams *params,
+			     uint32_t min_version,
+			     VbSharedDataKernelPart *shpart,
+			     struct vb2_workbuf *wb);
+
 #endif  /* VBOOT_REFERENCE_VBOOT_KERNEL_H_ */
@@ -57,4 +57,23 @@ void vb2_error_no_altfw(void);
  */
 void vb2_try_alt_fw(int allowed, int altfw_num);
 
+/* Removable media generation as of the last disk scan */
+struct vb2_media_generation {
+	int valid;		/* Zero if not known */
+	uint32_t generation;
+};
+
+/**
+ * Check whether the removable media may have changed since the last scan
+ *
+ * If the platform can't tell (VbExDiskGetGeneration() fails), this always
+ * says yes, so the caller keeps scanning every time it looks.
+ *
+ * @media	Generation as of the last scan
+ * @update	Non-zero to remember the current generation as scanned
+ * @return 1 if the media may have changed, 0 if not.
+ */
+int vb2_removable_media_changed(struct vb2_media_generation *media,
+				int update);
+
 #endif  /* VBOOT_REFERENCE_VBOOT_UI_COMMON_H_ */
@@ -45,3 +45,8 @@ uint32_t RollbackFwmpRead(struct RollbackSpaceFwmp *fwmp)
 	memset(fwmp, 0, sizeof(*fwmp));
 	return TPM_SUCCESS;
 }
+
+void RollbackGetWriteStats(struct RollbackWriteStats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+}
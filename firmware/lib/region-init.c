@@ -9,12 +9,14 @@
 #include "2sysincludes.h"
 #include "2common.h"
 #include "2misc.h"
+#include "2rsa.h"
 
 #include "sysincludes.h"
 #include "gbb_access.h"
 #include "gbb_header.h"
 #include "load_kernel_fw.h"
 #include "utility.h"
+#include "vb2_common.h"
 #include "vboot_api.h"
 #include "vboot_struct.h"
 
@@ -59,42 +61,103 @@ VbError_t VbGbbReadHWID(struct vb2_context *ctx, char *hwid, uint32_t max_size)
 			     sd->gbb->hwid_size, hwid);
 }
 
-static VbError_t VbGbbReadKey(struct vb2_context *ctx, uint32_t offset,
-			      VbPublicKey **keyp)
+/*
+ * GBB key cached in the work buffer.  The packed key follows this struct.
+ * It's never freed; the work buffer goes away when the boot stage ends.
+ */
+struct vb_gbb_key_cache {
+	/* Unpacked key; only valid if unpacked is non-zero */
+	struct vb2_public_key key;
+	uint32_t unpacked;
+	uint32_t packed_size;
+};
+
+static VbError_t VbGbbGetKey(struct vb2_context *ctx, uint32_t offset,
+			     uint32_t *cache_offset,
+			     const struct vb2_packed_key **packedp,
+			     const struct vb2_public_key **keyp)
 {
-	VbPublicKey hdr, *key;
-	VbError_t ret;
+	struct vb2_shared_data *sd = vb2_get_sd(ctx);
+	struct vb_gbb_key_cache *cache;
+	struct vb2_packed_key hdr, *packed;
+	struct vb2_workbuf wb;
+	uint32_t header_size = vb2_wb_round_up(sizeof(*cache));
 	uint32_t size;
+	VbError_t ret;
 
-	ret = VbGbbReadData(ctx, offset, sizeof(VbPublicKey), &hdr);
-	if (ret)
-		return ret;
-
-	/* Deal with a zero-size key (used in testing) */
-	size = hdr.key_offset + hdr.key_size;
-	if (size < sizeof(hdr))
-		size = sizeof(hdr);
-	key = malloc(size);
-	ret = VbGbbReadData(ctx, offset, size, key);
-	if (ret) {
-		free(key);
-		return ret;
+	if (!*cache_offset) {
+		ret = VbGbbReadData(ctx, offset, sizeof(hdr), &hdr);
+		if (ret)
+			return ret;
+
+		/* Deal with a zero-size key (used in testing) */
+		size = hdr.key_offset + hdr.key_size;
+		if (size < sizeof(hdr))
+			size = sizeof(hdr);
+		if (size > sd->gbb_size)
+			return VBERROR_INVALID_GBB;
+
+		vb2_workbuf_from_ctx(ctx, &wb);
+		cache = vb2_workbuf_alloc(&wb, header_size + size);
+		if (!cache)
+			return VBERROR_OUT_OF_MEMORY;
+		packed = (struct vb2_packed_key *)((uint8_t *)cache +
+						   header_size);
+		ret = VbGbbReadData(ctx, offset, size, packed);
+		if (ret)
+			return ret;
+
+		/* Keep it around for the rest of this boot */
+		cache->unpacked = 0;
+		cache->packed_size = size;
+		*cache_offset = vb2_offset_of(ctx->workbuf, cache);
+		vb2_set_workbuf_used(ctx, *cache_offset + header_size + size);
 	}
 
-	*keyp = key;
+	cache = (struct vb_gbb_key_cache *)(ctx->workbuf + *cache_offset);
+	packed = (struct vb2_packed_key *)((uint8_t *)cache + header_size);
+
+	if (keyp) {
+		if (!cache->unpacked) {
+			if (vb2_unpack_key_buffer(&cache->key,
+						  (const uint8_t *)packed,
+						  cache->packed_size))
+				return VBERROR_INVALID_GBB;
+			cache->unpacked = 1;
+		}
+		*keyp = &cache->key;
+	}
+	if (packedp)
+		*packedp = packed;
 	return VBERROR_SUCCESS;
 }
 
-VbError_t VbGbbReadRootKey(struct vb2_context *ctx, VbPublicKey **keyp)
+VbError_t VbGbbGetRootKey(struct vb2_context *ctx,
+			  const struct vb2_packed_key **packedp,
+			  const struct vb2_public_key **keyp)
 {
 	struct vb2_shared_data *sd = vb2_get_sd(ctx);
 
-	return VbGbbReadKey(ctx, sd->gbb->rootkey_offset, keyp);
+	uint32_t cache_offset = sd->workbuf_gbb_rootkey_offset;
+	VbError_t ret;
+
+	ret = VbGbbGetKey(ctx, sd->gbb->rootkey_offset, &cache_offset,
+			  packedp, keyp);
+	sd->workbuf_gbb_rootkey_offset = cache_offset;
+	return ret;
 }
 
-VbError_t VbGbbReadRecoveryKey(struct vb2_context *ctx, VbPublicKey **keyp)
+VbError_t VbGbbGetRecoveryKey(struct vb2_context *ctx,
+			      const struct vb2_packed_key **packedp,
+			      const struct vb2_public_key **keyp)
 {
 	struct vb2_shared_data *sd = vb2_get_sd(ctx);
 
-	return VbGbbReadKey(ctx, sd->gbb->recovery_key_offset, keyp);
+	uint32_t cache_offset = sd->workbuf_gbb_recovery_key_offset;
+	VbError_t ret;
+
+	ret = VbGbbGetKey(ctx, sd->gbb->recovery_key_offset, &cache_offset,
+			  packedp, keyp);
+	sd->workbuf_gbb_recovery_key_offset = cache_offset;
+	return ret;
 }
@@ -49,10 +49,37 @@ uint32_t WriteSpaceKernel(RollbackSpaceKernel *rsk);
 		}							\
 	} while (0)
 
+/*
+ * Last known contents of the firmware and kernel spaces, as read back from
+ * the TPM with a good CRC.  Lets us answer repeated reads from memory and
+ * skip writes which wouldn't change anything; NV writes are slow and the TPM
+ * only allows so many of them.
+ */
+static RollbackSpaceFirmware rsf_cache;
+static int rsf_cache_valid;
+static RollbackSpaceKernel rsk_cache;
+static int rsk_cache_valid;
+
+static struct RollbackWriteStats write_stats;
+
+void RollbackSpaceCacheReset(void)
+{
+	rsf_cache_valid = 0;
+	rsk_cache_valid = 0;
+	memset(&write_stats, 0, sizeof(write_stats));
+}
+
+void RollbackGetWriteStats(struct RollbackWriteStats *stats)
+{
+	memcpy(stats, &write_stats, sizeof(*stats));
+}
 
 uint32_t TPMClearAndReenable(void)
 {
 	VB2_DEBUG("TPM: Clear and re-enable\n");
+	/* Don't trust anything we remember about the TPM after this */
+	rsf_cache_valid = 0;
+	rsk_cache_valid = 0;
 	RETURN_ON_FAILURE(TlclForceClear());
 	RETURN_ON_FAILURE(TlclSetEnable());
 	RETURN_ON_FAILURE(TlclSetDeactivated(0));
@@ -77,6 +104,11 @@ uint32_t ReadSpaceFirmware(RollbackSpaceFirmware *rsf)
 	uint32_t r;
 	int attempts = 3;
 
+	if (rsf_cache_valid) {
+		memcpy(rsf, &rsf_cache, sizeof(*rsf));
+		return TPM_SUCCESS;
+	}
+
 	while (attempts--) {
 		r = TlclRead(FIRMWARE_NV_INDEX, rsf,
 			     sizeof(RollbackSpaceFirmware));
@@ -102,8 +134,11 @@ uint32_t ReadSpaceFirmware(RollbackSpaceFirmware *rsf)
 		 * could just be noise.
 		 */
 		if (rsf->crc8 == vb2_crc8(rsf,
-				      offsetof(RollbackSpaceFirmware, crc8)))
+				      offsetof(RollbackSpaceFirmware, crc8))) {
+			memcpy(&rsf_cache, rsf, sizeof(rsf_cache));
+			rsf_cache_valid = 1;
 			return TPM_SUCCESS;
+		}
 
 		VB2_DEBUG("TPM: bad CRC\n");
 	}
@@ -123,12 +158,23 @@ uint32_t WriteSpaceFirmware(RollbackSpaceFirmware *rsf)
 		rsf->struct_version = 2;
 	rsf->crc8 = vb2_crc8(rsf, offsetof(RollbackSpaceFirmware, crc8));
 
+	/* Nothing to do if the TPM already holds these exact bytes */
+	if (rsf_cache_valid && !memcmp(&rsf_cache, rsf, sizeof(*rsf))) {
+		VB2_DEBUG("TPM: firmware space unchanged, not writing\n");
+		write_stats.firmware_writes_avoided++;
+		return TPM_SUCCESS;
+	}
+
+	/* From here on, the read-back below is the only thing to trust */
+	rsf_cache_valid = 0;
+
 	while (attempts--) {
 		r = SafeWrite(FIRMWARE_NV_INDEX, rsf,
 			      sizeof(RollbackSpaceFirmware));
 		/* Can't write, not gonna try again */
 		if (r != TPM_SUCCESS)
 			return r;
+		write_stats.firmware_writes++;
 
 		/* Read it back to be sure it got the right values. */
 		r = ReadSpaceFirmware(&rsf2);    /* This checks the CRC */
@@ -174,6 +220,11 @@ uint32_t ReadSpaceKernel(RollbackSpaceKernel *rsk)
 	uint32_t r;
 	int attempts = 3;
 
+	if (rsk_cache_valid) {
+		memcpy(rsk, &rsk_cache, sizeof(*rsk));
+		return TPM_SUCCESS;
+	}
+
 	while (attempts--) {
 		r = TlclRead(KERNEL_NV_INDEX, rsk, sizeof(RollbackSpaceKernel));
 		if (r != TPM_SUCCESS)
@@ -198,8 +249,11 @@ uint32_t ReadSpaceKernel(RollbackSpaceKernel *rsk)
 		 * could just be noise.
 		 */
 		if (rsk->crc8 ==
-		    vb2_crc8(rsk, offsetof(RollbackSpaceKernel, crc8)))
+		    vb2_crc8(rsk, offsetof(RollbackSpaceKernel, crc8))) {
+			memcpy(&rsk_cache, rsk, sizeof(rsk_cache));
+			rsk_cache_valid = 1;
 			return TPM_SUCCESS;
+		}
 
 		VB2_DEBUG("TPM: bad CRC\n");
 	}
@@ -219,12 +273,23 @@ uint32_t WriteSpaceKernel(RollbackSpaceKernel *rsk)
 		rsk->struct_version = 2;
 	rsk->crc8 = vb2_crc8(rsk, offsetof(RollbackSpaceKernel, crc8));
 
+	/* Nothing to do if the TPM already holds these exact bytes */
+	if (rsk_cache_valid && !memcmp(&rsk_cache, rsk, sizeof(*rsk))) {
+		VB2_DEBUG("TPM: kernel space unchanged, not writing\n");
+		write_stats.kernel_writes_avoided++;
+		return TPM_SUCCESS;
+	}
+
+	/* From here on, the read-back below is the only thing to trust */
+	rsk_cache_valid = 0;
+
 	while (attempts--) {
 		r = SafeWrite(KERNEL_NV_INDEX, rsk,
 			      sizeof(RollbackSpaceKernel));
 		/* Can't write, not gonna try again */
 		if (r != TPM_SUCCESS)
 			return r;
+		write_stats.kernel_writes++;
 
 		/* Read it back to be sure it got the right values. */
 		r = ReadSpaceKernel(&rsk2);    /* This checks the CRC */
@@ -333,7 +398,7 @@ uint32_t RollbackFwmpRead(struct RollbackSpaceFwmp *fwmp)
 		 * to a bare uint8_t[] buffer.  This ensures bf will be aligned
 		 * if necesssary for the target platform.
 		 */
-		uint8_t buf[FWMP_NV_MAX_SIZE];
+		uint8_t buf[VB2_SECDATA_FWMP_MAX_SIZE];
 		struct RollbackSpaceFwmp bf;
 	} u;
 	uint32_t r;
@@ -115,6 +115,7 @@ static void unmarshal_TPM2B_MAX_NV_BUFFER(void **buffer,
 	if (nv_buffer->t.size > *size) {
 		VB2_DEBUG("size mismatch: expected %d, remaining %d\n",
 			  nv_buffer->t.size, *size);
+		*size = -1;
 		return;
 	}
 
@@ -280,13 +281,13 @@ static void unmarshal_get_random(void **buffer, int *size,
 static void marshal_blob(void **buffer, void *blob,
 			 size_t blob_size, int *buffer_space)
 {
-	if (*buffer_space < blob_size) {
+	if (*buffer_space < 0 || *buffer_space < blob_size) {
 		*buffer_space = -1;
 		return;
 	}
 
 	memcpy(*buffer, blob, blob_size);
-	buffer_space -= blob_size;
+	*buffer_space -= blob_size;
 	*buffer = (void *)((uintptr_t)(*buffer) + blob_size);
 }
 
@@ -294,7 +295,7 @@ static void marshal_u8(void **buffer, uint8_t value, int *buffer_space)
 {
 	uint8_t *bp = *buffer;
 
-	if (*buffer_space < sizeof(value)) {
+	if (*buffer_space < (int)sizeof(value)) {
 		*buffer_space = -1;
 		return;
 	}
@@ -306,7 +307,7 @@ static void marshal_u8(void **buffer, uint8_t value, int *buffer_space)
 
 static void marshal_u16(void **buffer, uint16_t value, int *buffer_space)
 {
-	if (*buffer_space < sizeof(value)) {
+	if (*buffer_space < (int)sizeof(value)) {
 		*buffer_space = -1;
 		return;
 	}
@@ -317,7 +318,7 @@ static void marshal_u16(void **buffer, uint16_t value, int *buffer_space)
 
 static void marshal_u32(void **buffer, uint32_t value, int *buffer_space)
 {
-	if (*buffer_space < sizeof(value)) {
+	if (*buffer_space < (int)sizeof(value)) {
 		*buffer_space = -1;
 		return;
 	}
@@ -328,7 +329,6 @@ static void marshal_u32(void **buffer, uint32_t value, int *buffer_space)
 }
 
 #define marshal_TPM_HANDLE(a, b, c) marshal_u32(a, b, c)
-#define marshal_TPM_SU(a, b, c) marshal_u16(a, b, c)
 #define marshal_ALG_ID(a, b, c) marshal_u16(a, b, c)
 
 /*
@@ -409,7 +409,7 @@ static void marshal_TPM2B(void **buffer,
 {
 	size_t total_size = data->size + sizeof(data->size);
 
-	if (total_size > *buffer_space) {
+	if (*buffer_space < 0 || total_size > *buffer_space) {
 		*buffer_space = -1;
 		return;
 	}
@@ -467,32 +467,6 @@ static void marshal_nv_define_space(void **buffer,
 	marshal_TPMS_NV_PUBLIC(buffer, &command_body->publicInfo, buffer_space);
 }
 
-static void marshal_nv_undefine_space(void **buffer,
-				      struct tpm2_nv_undefine_space_cmd
-				          *command_body,
-				      int *buffer_space)
-{
-	struct tpm2_session_header session_header;
-
-	/* Use platform authorization if PLATFORMCREATE is set, and owner
-	 * authorization otherwise (per TPM2 Spec. Part 2. Section 31.3.1).
-	 * Owner authorization with empty password will work only until
-	 * ownership is taken. Platform authorization will work only until
-	 * platform hierarchy is disabled (i.e. in firmware or in recovery
-	 * mode).
-	 */
-	if (command_body->use_platform_auth)
-		marshal_TPM_HANDLE(buffer, TPM_RH_PLATFORM, buffer_space);
-	else
-		marshal_TPM_HANDLE(buffer, TPM_RH_OWNER, buffer_space);
-	marshal_TPM_HANDLE(buffer, command_body->nvIndex, buffer_space);
-
-	memset(&session_header, 0, sizeof(session_header));
-	session_header.session_handle = TPM_RS_PW;
-	marshal_session_header(buffer, &session_header, buffer_space);
-	tpm_tag = TPM_ST_SESSIONS;
-}
-
 /* Determine which authorization should be used when writing or write-locking
  * an NV index.
  *
@@ -537,150 +511,217 @@ static void marshal_nv_write(void **buffer,
 	marshal_u16(buffer, command_body->offset, buffer_space);
 }
 
-static void marshal_nv_read(void **buffer,
-			    struct tpm2_nv_read_cmd *command_body,
-			    int *buffer_space)
-{
-	struct tpm2_session_header session_header;
-
-	/* Use empty password auth if platform hierarchy is disabled */
-	if (ph_disabled)
-		marshal_TPM_HANDLE(buffer, command_body->nvIndex, buffer_space);
-	else
-		marshal_TPM_HANDLE(buffer, TPM_RH_PLATFORM, buffer_space);
-	marshal_TPM_HANDLE(buffer, command_body->nvIndex, buffer_space);
-	memset(&session_header, 0, sizeof(session_header));
-	session_header.session_handle = TPM_RS_PW;
-	marshal_session_header(buffer, &session_header, buffer_space);
-	tpm_tag = TPM_ST_SESSIONS;
-	marshal_u16(buffer, command_body->size, buffer_space);
-	marshal_u16(buffer, command_body->offset, buffer_space);
+/*
+ * Commands with a fixed layout aren't marshaled field by field.  Each one has
+ * a pre-encoded image below, with its header and, if it needs one, an empty
+ * password session already in place.  The image is copied into the command
+ * buffer and the few fields which change from call to call are patched in.
+ *
+ * The images are packed back to back; the size and command code in each
+ * header are enough to walk them.
+ */
+#define BE16(v) (uint8_t)((v) >> 8), (uint8_t)(v)
+#define BE32(v) (uint8_t)((v) >> 24), (uint8_t)((v) >> 16), \
+		(uint8_t)((v) >> 8), (uint8_t)(v)
+
+/* Session size, session handle, no nonce, no attributes, empty password. */
+#define PW_SESSION BE32(9), BE32(TPM_RS_PW), BE16(0), 0, BE16(0)
+
+#define TEMPLATE(command, tag, size, ...) \
+	BE16(tag), BE32(size), BE32(command), __VA_ARGS__
+
+/* Offsets of the patched fields. */
+#define HANDLE_OFFSET sizeof(struct tpm_header)
+#define HANDLE2_OFFSET (HANDLE_OFFSET + sizeof(uint32_t))
+#define PARAM_OFFSET HANDLE_OFFSET
+/* Parameters of a command with one or two handles and a password session. */
+#define PW_PARAM_OFFSET(handles) \
+	(HANDLE_OFFSET + (handles) * sizeof(uint32_t) + 13)
+
+static const uint8_t command_templates[] = {
+	TEMPLATE(TPM2_Startup, TPM_ST_NO_SESSIONS, 12,
+		 BE16(0)),				/* startup_type */
+	TEMPLATE(TPM2_Shutdown, TPM_ST_NO_SESSIONS, 12,
+		 BE16(0)),				/* shutdown_type */
+	TEMPLATE(TPM2_SelfTest, TPM_ST_NO_SESSIONS, 11,
+		 0),					/* full_test */
+	TEMPLATE(TPM2_GetCapability, TPM_ST_NO_SESSIONS, 22,
+		 BE32(TPM_CAP_TPM_PROPERTIES),		/* capability */
+		 BE32(0),				/* property */
+		 BE32(1)),				/* property_count */
+	TEMPLATE(TPM2_GetRandom, TPM_ST_NO_SESSIONS, 12,
+		 BE16(0)),				/* bytes_requested */
+	TEMPLATE(TPM2_NV_ReadPublic, TPM_ST_NO_SESSIONS, 14,
+		 BE32(0)),				/* nvIndex */
+	TEMPLATE(TPM2_NV_Read, TPM_ST_SESSIONS, 35,
+		 BE32(TPM_RH_PLATFORM), BE32(0),	/* auth, nvIndex */
+		 PW_SESSION,
+		 BE16(0), BE16(0)),			/* size, offset */
+	TEMPLATE(TPM2_NV_ReadLock, TPM_ST_SESSIONS, 31,
+		 BE32(0), BE32(0),			/* nvIndex, nvIndex */
+		 PW_SESSION),
+	TEMPLATE(TPM2_NV_WriteLock, TPM_ST_SESSIONS, 31,
+		 BE32(TPM_RH_PLATFORM), BE32(0),	/* auth, nvIndex */
+		 PW_SESSION),
+	TEMPLATE(TPM2_NV_UndefineSpace, TPM_ST_SESSIONS, 31,
+		 BE32(TPM_RH_PLATFORM), BE32(0),	/* auth, nvIndex */
+		 PW_SESSION),
+	TEMPLATE(TPM2_Hierarchy_Control, TPM_ST_SESSIONS, 32,
+		 BE32(TPM_RH_PLATFORM),
+		 PW_SESSION,
+		 BE32(0), 0),				/* enable, state */
+	TEMPLATE(TPM2_Clear, TPM_ST_SESSIONS, 27,
+		 BE32(TPM_RH_PLATFORM),
+		 PW_SESSION),
+};
+
+static const uint8_t *find_template(TPM_CC command)
+{
+	const uint8_t *image = command_templates;
+
+	while (image < command_templates + sizeof(command_templates)) {
+		/* 6: command code (32 bit) */
+		if (read_be32(image + 6) == command)
+			return image;
+		image += tpm_get_packet_size(image);
+	}
+	return NULL;
 }
 
-static void marshal_nv_read_lock(void **buffer,
-				  struct tpm2_nv_read_lock_cmd *command_body,
-				  int *buffer_space)
+/*
+ * Copy the template into the buffer and patch in the variable fields from
+ * the command body.  Returns the size of the command, or -1 if it doesn't
+ * fit.
+ */
+static int marshal_from_template(TPM_CC command, const uint8_t *image,
+				 void *command_body,
+				 uint8_t *buffer, int buffer_size)
 {
-	struct tpm2_session_header session_header;
+	int size = tpm_get_packet_size(image);
 
-	tpm_tag = TPM_ST_SESSIONS;
-	marshal_TPM_HANDLE(buffer, command_body->nvIndex, buffer_space);
-	marshal_TPM_HANDLE(buffer, command_body->nvIndex, buffer_space);
-	memset(&session_header, 0, sizeof(session_header));
-	session_header.session_handle = TPM_RS_PW;
-	marshal_session_header(buffer, &session_header, buffer_space);
-}
+	if (buffer_size < size)
+		return -1;
 
-static void marshal_nv_write_lock(void **buffer,
-				  struct tpm2_nv_write_lock_cmd *command_body,
-				  int *buffer_space)
-{
-	struct tpm2_session_header session_header;
+	memcpy(buffer, image, size);
 
-	tpm_tag = TPM_ST_SESSIONS;
-	marshal_TPM_HANDLE(buffer,
-			   get_nv_index_write_auth(command_body->nvIndex),
-			   buffer_space);
-	marshal_TPM_HANDLE(buffer, command_body->nvIndex, buffer_space);
-	memset(&session_header, 0, sizeof(session_header));
-	session_header.session_handle = TPM_RS_PW;
-	marshal_session_header(buffer, &session_header, buffer_space);
-}
+	switch (command) {
+	case TPM2_Startup: {
+		struct tpm2_startup_cmd *cmd = command_body;
 
-static void marshal_nv_read_public(void **buffer,
-				   struct tpm2_nv_read_public_cmd *command_body,
-				   int *buffer_space)
-{
-	tpm_tag = TPM_ST_NO_SESSIONS;
+		write_be16(buffer + PARAM_OFFSET, cmd->startup_type);
+		break;
+	}
 
-	marshal_TPM_HANDLE(buffer, command_body->nvIndex, buffer_space);
-}
+	case TPM2_Shutdown: {
+		struct tpm2_shutdown_cmd *cmd = command_body;
 
-static void marshal_hierarchy_control(void **buffer,
-				      struct tpm2_hierarchy_control_cmd
-				          *command_body,
-				      int *buffer_space)
-{
-	struct tpm2_session_header session_header;
+		write_be16(buffer + PARAM_OFFSET, cmd->shutdown_type);
+		break;
+	}
 
-	tpm_tag = TPM_ST_SESSIONS;
-	marshal_TPM_HANDLE(buffer, TPM_RH_PLATFORM, buffer_space);
-	memset(&session_header, 0, sizeof(session_header));
-	session_header.session_handle = TPM_RS_PW;
-	marshal_session_header(buffer, &session_header, buffer_space);
+	case TPM2_SelfTest: {
+		struct tpm2_self_test_cmd *cmd = command_body;
 
-	marshal_TPM_HANDLE(buffer, command_body->enable, buffer_space);
-	marshal_u8(buffer, command_body->state, buffer_space);
-}
+		buffer[PARAM_OFFSET] = cmd->full_test;
+		break;
+	}
 
-static void marshal_get_capability(void **buffer,
-				   struct tpm2_get_capability_cmd
-				       *command_body,
-				   int *buffer_space)
-{
-	tpm_tag = TPM_ST_NO_SESSIONS;
+	case TPM2_GetCapability: {
+		struct tpm2_get_capability_cmd *cmd = command_body;
 
-	marshal_u32(buffer, command_body->capability, buffer_space);
-	marshal_u32(buffer, command_body->property, buffer_space);
-	marshal_u32(buffer, command_body->property_count, buffer_space);
-}
+		write_be32(buffer + PARAM_OFFSET, cmd->capability);
+		write_be32(buffer + PARAM_OFFSET + 4, cmd->property);
+		write_be32(buffer + PARAM_OFFSET + 8, cmd->property_count);
+		break;
+	}
 
-static void marshal_get_random(void **buffer, struct tpm2_get_random_cmd
-				       *command_body,
-				   int *buffer_space)
-{
-	tpm_tag = TPM_ST_NO_SESSIONS;
+	case TPM2_GetRandom: {
+		struct tpm2_get_random_cmd *cmd = command_body;
 
-	marshal_u16(buffer, command_body->bytes_requested, buffer_space);
-}
+		write_be16(buffer + PARAM_OFFSET, cmd->bytes_requested);
+		break;
+	}
 
-static void marshal_clear(void **buffer,
-			  void *command_body,
-			  int *buffer_space)
-{
-	struct tpm2_session_header session_header;
+	case TPM2_NV_ReadPublic: {
+		struct tpm2_nv_read_public_cmd *cmd = command_body;
 
-	tpm_tag = TPM_ST_SESSIONS;
-	marshal_TPM_HANDLE(buffer, TPM_RH_PLATFORM, buffer_space);
-	memset(&session_header, 0, sizeof(session_header));
-	session_header.session_handle = TPM_RS_PW;
-	marshal_session_header(buffer, &session_header, buffer_space);
-}
+		write_be32(buffer + HANDLE_OFFSET, cmd->nvIndex);
+		break;
+	}
 
-static void marshal_self_test(void **buffer,
-			      struct tpm2_self_test_cmd *command_body,
-			      int *buffer_space)
-{
-	tpm_tag = TPM_ST_NO_SESSIONS;
+	case TPM2_NV_Read: {
+		struct tpm2_nv_read_cmd *cmd = command_body;
 
-	marshal_u8(buffer, command_body->full_test, buffer_space);
-}
+		/* Use empty password auth if platform hierarchy is disabled */
+		if (ph_disabled)
+			write_be32(buffer + HANDLE_OFFSET, cmd->nvIndex);
+		write_be32(buffer + HANDLE2_OFFSET, cmd->nvIndex);
+		write_be16(buffer + PW_PARAM_OFFSET(2), cmd->size);
+		write_be16(buffer + PW_PARAM_OFFSET(2) + 2, cmd->offset);
+		break;
+	}
 
-static void marshal_startup(void **buffer,
-			    struct tpm2_startup_cmd *command_body,
-			    int *buffer_space)
-{
-	tpm_tag = TPM_ST_NO_SESSIONS;
+	case TPM2_NV_ReadLock: {
+		struct tpm2_nv_read_lock_cmd *cmd = command_body;
 
-	marshal_TPM_SU(buffer, command_body->startup_type, buffer_space);
-}
+		write_be32(buffer + HANDLE_OFFSET, cmd->nvIndex);
+		write_be32(buffer + HANDLE2_OFFSET, cmd->nvIndex);
+		break;
+	}
 
-static void marshal_shutdown(void **buffer,
-			     struct tpm2_shutdown_cmd *command_body,
-			     int *buffer_space)
-{
-	tpm_tag = TPM_ST_NO_SESSIONS;
+	case TPM2_NV_WriteLock: {
+		struct tpm2_nv_write_lock_cmd *cmd = command_body;
+
+		write_be32(buffer + HANDLE_OFFSET,
+			   get_nv_index_write_auth(cmd->nvIndex));
+		write_be32(buffer + HANDLE2_OFFSET, cmd->nvIndex);
+		break;
+	}
+
+	case TPM2_NV_UndefineSpace: {
+		struct tpm2_nv_undefine_space_cmd *cmd = command_body;
+
+		/* Use platform authorization if PLATFORMCREATE is set, and
+		 * owner authorization otherwise (per TPM2 Spec. Part 2.
+		 * Section 31.3.1).  Owner authorization with empty password
+		 * will work only until ownership is taken. Platform
+		 * authorization will work only until platform hierarchy is
+		 * disabled (i.e. in firmware or in recovery mode).
+		 */
+		if (!cmd->use_platform_auth)
+			write_be32(buffer + HANDLE_OFFSET, TPM_RH_OWNER);
+		write_be32(buffer + HANDLE2_OFFSET, cmd->nvIndex);
+		break;
+	}
+
+	case TPM2_Hierarchy_Control: {
+		struct tpm2_hierarchy_control_cmd *cmd = command_body;
+
+		write_be32(buffer + PW_PARAM_OFFSET(1), cmd->enable);
+		buffer[PW_PARAM_OFFSET(1) + 4] = cmd->state;
+		break;
+	}
 
-	marshal_TPM_SU(buffer, command_body->shutdown_type, buffer_space);
+	default:
+		/* Nothing to patch; TPM2_Clear is constant. */
+		break;
+	}
+
+	return size;
 }
 
 int tpm_marshal_command(TPM_CC command, void *tpm_command_body,
 			void *buffer, int buffer_size)
 {
+	const uint8_t *image = find_template(command);
 	void *cmd_body = (uint8_t *)buffer + sizeof(struct tpm_header);
 	int max_body_size = buffer_size - sizeof(struct tpm_header);
 	int body_size = max_body_size;
 
+	if (image)
+		return marshal_from_template(command, image, tpm_command_body,
+					     buffer, buffer_size);
+
 	/* Will be modified when marshaling some commands. */
 	tpm_tag = TPM_ST_NO_SESSIONS;
 
@@ -690,76 +731,27 @@ int tpm_marshal_command(TPM_CC command, void *tpm_command_body,
 		marshal_nv_define_space(&cmd_body, tpm_command_body, &body_size);
 		break;
 
-	case TPM2_NV_UndefineSpace:
-		marshal_nv_undefine_space(&cmd_body, tpm_command_body, &body_size);
-		break;
-
-	case TPM2_NV_Read:
-		marshal_nv_read(&cmd_body, tpm_command_body, &body_size);
-		break;
-
 	case TPM2_NV_Write:
 		marshal_nv_write(&cmd_body, tpm_command_body, &body_size);
 		break;
 
-	case TPM2_NV_ReadLock:
-		marshal_nv_read_lock(&cmd_body, tpm_command_body, &body_size);
-		break;
-
-	case TPM2_NV_WriteLock:
-		marshal_nv_write_lock(&cmd_body, tpm_command_body, &body_size);
-		break;
-
-	case TPM2_NV_ReadPublic:
-		marshal_nv_read_public(&cmd_body, tpm_command_body, &body_size);
-		break;
-
-	case TPM2_Hierarchy_Control:
-		marshal_hierarchy_control(&cmd_body,
-					  tpm_command_body, &body_size);
-		break;
-
-	case TPM2_GetCapability:
-		marshal_get_capability(&cmd_body, tpm_command_body, &body_size);
-		break;
-
-	case TPM2_GetRandom:
-		marshal_get_random(&cmd_body, tpm_command_body, &body_size);
-		break;
-
-	case TPM2_Clear:
-		marshal_clear(&cmd_body, tpm_command_body, &body_size);
-		break;
-
-	case TPM2_SelfTest:
-		marshal_self_test(&cmd_body, tpm_command_body, &body_size);
-		break;
-
-	case TPM2_Startup:
-		marshal_startup(&cmd_body, tpm_command_body, &body_size);
-		break;
-
-	case TPM2_Shutdown:
-		marshal_shutdown(&cmd_body, tpm_command_body, &body_size);
-		break;
-
 	default:
 		body_size = -1;
 		VB2_DEBUG("Request to marshal unsupported command %#x\n",
 			  command);
 	}
 
-	if (body_size > 0) {
+	if (body_size < 0)
+		return -1;  /* Didn't fit. */
 
-		/* See how much room was taken by marshaling. */
-		body_size = max_body_size - body_size;
+	/* See how much room was taken by marshaling. */
+	body_size = max_body_size - body_size;
 
-		body_size += sizeof(struct tpm_header);
+	body_size += sizeof(struct tpm_header);
 
-		marshal_u16(&buffer, tpm_tag, &max_body_size);
-		marshal_u32(&buffer, body_size, &max_body_size);
-		marshal_u32(&buffer, command, &max_body_size);
-	}
+	marshal_u16(&buffer, tpm_tag, &max_body_size);
+	marshal_u32(&buffer, body_size, &max_body_size);
+	marshal_u32(&buffer, command, &max_body_size);
 
 	return body_size;
 }
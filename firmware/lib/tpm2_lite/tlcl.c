@@ -18,6 +18,28 @@
 /* Global buffer for deserialized responses. */
 struct tpm2_response tpm2_resp;
 
+/*
+ * Authorization section of a response to a password session: nonce size,
+ * session attributes and HMAC size, with an empty nonce and HMAC.
+ */
+#define PW_SESSION_RESPONSE_SIZE (sizeof(uint16_t) + sizeof(uint8_t) + \
+				  sizeof(uint16_t))
+
+/*
+ * Most data a single NV_Read can return.  The response carries the header,
+ * the parameter size, the TPM2B size and the authorization section, and has
+ * to fit in the command/response buffer.
+ */
+#define NV_READ_MAX_CHUNK (TPM_BUFFER_SIZE - sizeof(struct tpm_header) - \
+			   sizeof(uint32_t) - sizeof(uint16_t) - \
+			   PW_SESSION_RESPONSE_SIZE)
+
+/*
+ * Largest NV_Read the TPM takes, from TPM_PT_NV_BUFFER_MAX, capped at
+ * NV_READ_MAX_CHUNK.  Zero until the first read.
+ */
+static uint32_t nv_read_chunk;
+
 /*
  * Serializes and sends the command, gets back the response and
  * parses it into the provided buffer.
@@ -38,7 +60,8 @@ static uint32_t tpm_get_response(TPM_CC command,
 {
 	/* Command/response buffer. */
 	static uint8_t cr_buffer[TPM_BUFFER_SIZE];
-	uint32_t out_size, in_size, res;
+	uint32_t in_size, res;
+	int out_size;
 
 	out_size = tpm_marshal_command(command, command_body,
 				       cr_buffer, sizeof(cr_buffer));
@@ -110,6 +133,8 @@ uint32_t TlclLibInit(void)
 {
 	uint32_t rv;
 
+	nv_read_chunk = 0;
+
 	rv = VbExTpmInit();
 	if (rv != TPM_SUCCESS)
 		return rv;
@@ -493,7 +518,11 @@ uint32_t TlclLockPhysicalPresence(void)
 	return tlcl_disable_platform_hierarchy();
 }
 
-uint32_t TlclRead(uint32_t index, void* data, uint32_t length)
+/*
+ * Read length bytes at offset from an NV index with a single NV_Read.
+ */
+static uint32_t tlcl_nv_read(uint32_t index, uint8_t *data,
+			     uint32_t offset, uint32_t length)
 {
 	struct tpm2_nv_read_cmd nv_readc;
 	struct tpm2_response *response = &tpm2_resp;
@@ -503,6 +532,7 @@ uint32_t TlclRead(uint32_t index, void* data, uint32_t length)
 
 	nv_readc.nvIndex = HR_NV_INDEX + index;
 	nv_readc.size = length;
+	nv_readc.offset = offset;
 
 	rv = tpm_send_receive(TPM2_NV_Read, &nv_readc, response);
 
@@ -529,6 +559,50 @@ uint32_t TlclRead(uint32_t index, void* data, uint32_t length)
 	return TPM_SUCCESS;
 }
 
+/*
+ * Get the largest chunk to read with one NV_Read.  The TPM is only asked
+ * once per boot, on the first read.
+ */
+static uint32_t tlcl_get_nv_read_chunk(void)
+{
+	uint32_t max;
+
+	if (nv_read_chunk)
+		return nv_read_chunk;
+
+	if (tlcl_get_tpm_property(TPM_PT_NV_BUFFER_MAX, &max) != TPM_SUCCESS ||
+	    !max) {
+		VB2_DEBUG("TPM: no NV buffer size, using %d\n",
+			  (int)NV_READ_MAX_CHUNK);
+		max = NV_READ_MAX_CHUNK;
+	}
+
+	nv_read_chunk = max < NV_READ_MAX_CHUNK ? max : NV_READ_MAX_CHUNK;
+	return nv_read_chunk;
+}
+
+uint32_t TlclRead(uint32_t index, void* data, uint32_t length)
+{
+	uint8_t *buf = data;
+	uint32_t offset = 0;
+	uint32_t chunk = tlcl_get_nv_read_chunk();
+	uint32_t rv;
+
+	do {
+		uint32_t size = length - offset;
+
+		if (size > chunk)
+			size = chunk;
+
+		rv = tlcl_nv_read(index, buf + offset, offset, size);
+		if (rv != TPM_SUCCESS)
+			return rv;
+		offset += size;
+	} while (offset < length);
+
+	return TPM_SUCCESS;
+}
+
 uint32_t TlclWrite(uint32_t index, const void *data, uint32_t length)
 {
 	struct tpm2_nv_write_cmd nv_writec;
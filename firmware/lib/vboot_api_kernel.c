@@ -12,6 +12,7 @@
 #include "2misc.h"
 #include "2nvstorage.h"
 #include "2rsa.h"
+#include "2secdata.h"
 #include "ec_sync.h"
 #include "gbb_access.h"
 #include "gbb_header.h"
@@ -221,11 +222,59 @@ VbError_t VbBootNormal(struct vb2_context *ctx)
 	return rv;
 }
 
+/* The snapshot holds the same bytes as the TPM spaces */
+BUILD_ASSERT(sizeof(RollbackSpaceFirmware) <= VB2_SECDATA_SIZE);
+BUILD_ASSERT(sizeof(RollbackSpaceKernel) <= VB2_SECDATAK_SIZE);
+BUILD_ASSERT(sizeof(struct RollbackSpaceFwmp) <= VB2_SECDATA_FWMP_MAX_SIZE);
+
+/*
+ * Get the kernel version and FWMP from the platform's snapshot of secure
+ * storage.  Returns VB2_ERROR_EX_SECDATA_READ_ALL_UNIMPLEMENTED if there is no
+ * snapshot, so they have to be read from the TPM.
+ */
+static int vb2_kernel_read_snapshot(struct vb2_context *ctx,
+				    VbSharedDataHeader *shared)
+{
+	const struct vb2_secdata_snapshot *snapshot;
+	const struct RollbackSpaceFwmp *bf;
+	uint32_t version;
+	int rv;
+
+	memset(&fwmp, 0, sizeof(fwmp));
+
+	rv = vb2api_secdata_read_all(ctx);
+	if (rv)
+		return rv;
+	vb2api_get_secdata_snapshot(ctx, &snapshot);
+
+	/* vb2api_secdata_read_all() copied the kernel space to secdatak */
+	if (!(snapshot->spaces & VB2_SECDATA_SPACE_KERNEL))
+		return VB2_ERROR_SECDATA_SNAPSHOT_NO_KERNEL;
+	rv = vb2_secdatak_init(ctx);
+	if (rv)
+		return rv;
+	vb2_secdatak_get(ctx, VB2_SECDATAK_VERSIONS, &version);
+	shared->kernel_version_tpm = version;
+
+	/* A missing FWMP means the defaults, as for RollbackFwmpRead() */
+	if (!(snapshot->spaces & VB2_SECDATA_SPACE_FWMP) ||
+	    (vb2_get_sd(ctx)->gbb_flags & VB2_GBB_FLAG_DISABLE_FWMP))
+		return VB2_SUCCESS;
+	bf = (const struct RollbackSpaceFwmp *)snapshot->fwmp;
+	if (snapshot->fwmp_size < sizeof(*bf))
+		return VB2_ERROR_SECDATA_FWMP_SIZE;
+	if ((bf->struct_version >> 4) != (ROLLBACK_SPACE_FWMP_VERSION >> 4))
+		return VB2_ERROR_SECDATA_FWMP_VERSION;
+	memcpy(&fwmp, bf, sizeof(fwmp));
+	return VB2_SUCCESS;
+}
+
 static VbError_t vb2_kernel_setup(VbCommonParams *cparams,
 				  VbSelectAndLoadKernelParams *kparams)
 {
 	VbSharedDataHeader *shared =
 		(VbSharedDataHeader *)cparams->shared_data_blob;
+	int rv;
 
 	/* Start timer */
 	shared->timer_vb_select_and_load_kernel_enter = VbExGetTimer();
@@ -327,6 +376,23 @@ static VbError_t vb2_kernel_setup(VbCommonParams *cparams,
 	sd->gbb_size = cparams->gbb_size;
 	sd->gbb_flags = sd->gbb->flags;
 
+	/*
+	 * If the platform has a snapshot of secure storage, take the kernel
+	 * version and FWMP from that rather than reading the TPM again.  In
+	 * recovery mode, fall back to the TPM if the snapshot is bad.
+	 */
+	rv = vb2_kernel_read_snapshot(&ctx, shared);
+	if (rv == VB2_SUCCESS) {
+		shared->kernel_version_tpm_start = shared->kernel_version_tpm;
+		return VBERROR_SUCCESS;
+	} else if (rv != VB2_ERROR_EX_SECDATA_READ_ALL_UNIMPLEMENTED) {
+		VB2_DEBUG("Unable to get secure storage snapshot (0x%x)\n", rv);
+		if (!(ctx.flags & VB2_CONTEXT_RECOVERY_MODE)) {
+			VbSetRecoveryRequest(&ctx, VB2_RECOVERY_RW_TPM_R_ERROR);
+			return VBERROR_TPM_READ_KERNEL;
+		}
+	}
+
 	/* Read kernel version from the TPM.  Ignore errors in recovery mode. */
 	if (RollbackKernelRead(&shared->kernel_version_tpm)) {
 		VB2_DEBUG("Unable to get kernel versions from TPM\n");
@@ -461,7 +527,6 @@ VbError_t VbVerifyMemoryBootImage(VbCommonParams *cparams,
 				  void *boot_image,
 				  size_t image_size)
 {
-	VbPublicKey* kernel_subkey = NULL;
 	uint8_t *kbuf;
 	VbKeyBlockHeader *key_block;
 	VbKernelPreambleHeader *preamble;
@@ -506,8 +571,8 @@ VbError_t VbVerifyMemoryBootImage(VbCommonParams *cparams,
 		VB2_DEBUG("Only performing integrity-check.\n");
 		hash_only = 1;
 	} else {
-		/* Get recovery key. */
-		retval = VbGbbReadRecoveryKey(&ctx, &kernel_subkey);
+		/* Get recovery key; it's unpacked below. */
+		retval = VbGbbGetRecoveryKey(&ctx, NULL, NULL);
 		if (VBERROR_SUCCESS != retval) {
 			VB2_DEBUG("Gbb Read Recovery key failed.\n");
 			goto fail;
@@ -528,15 +593,14 @@ VbError_t VbVerifyMemoryBootImage(VbCommonParams *cparams,
 		rv = vb2_verify_keyblock_hash(keyblock2, image_size, &wb);
 	} else {
 		/* Unpack kernel subkey */
-		struct vb2_public_key kernel_subkey2;
-		if (VB2_SUCCESS !=
-		    vb2_unpack_key(&kernel_subkey2,
-				   (struct vb2_packed_key *)kernel_subkey)) {
+		const struct vb2_public_key *kernel_subkey2;
+		if (VBERROR_SUCCESS !=
+		    VbGbbGetRecoveryKey(&ctx, NULL, &kernel_subkey2)) {
 			VB2_DEBUG("Unable to unpack kernel subkey\n");
 			goto fail;
 		}
 		rv = vb2_verify_keyblock(keyblock2, image_size,
-					 &kernel_subkey2, &wb);
+					 kernel_subkey2, &wb);
 	}
 
 	if (VB2_SUCCESS != rv) {
@@ -608,8 +672,6 @@ VbError_t VbVerifyMemoryBootImage(VbCommonParams *cparams,
 
  fail:
 	vb2_kernel_cleanup(&ctx, cparams);
-	if (NULL != kernel_subkey)
-		free(kernel_subkey);
 	return retval;
 }
 
@@ -105,9 +105,9 @@ static void Uint8ToString(char *buf, uint8_t val)
 	*buf = trans[val & 0xF];
 }
 
-static void FillInSha1Sum(char *outbuf, VbPublicKey *key)
+static void FillInSha1Sum(char *outbuf, const VbPublicKey *key)
 {
-	uint8_t *buf = ((uint8_t *)key) + key->key_offset;
+	const uint8_t *buf = ((const uint8_t *)key) + key->key_offset;
 	uint64_t buflen = key->key_size;
 	uint8_t digest[VB2_SHA1_DIGEST_SIZE];
 	int i;
@@ -288,7 +288,7 @@ VbError_t VbDisplayDebugInfo(struct vb2_context *ctx)
 	char sha1sum[VB2_SHA1_DIGEST_SIZE * 2 + 1];
 	char hwid[256];
 	uint32_t used = 0;
-	VbPublicKey *key;
+	const struct vb2_packed_key *key;
 	VbError_t ret;
 	uint32_t i;
 
@@ -377,20 +377,18 @@ VbError_t VbDisplayDebugInfo(struct vb2_context *ctx)
 			       sd->gbb_flags, 16, 8);
 
 	/* Add sha1sum for Root & Recovery keys */
-	ret = VbGbbReadRootKey(ctx, &key);
+	ret = VbGbbGetRootKey(ctx, &key, NULL);
 	if (!ret) {
-		FillInSha1Sum(sha1sum, key);
-		free(key);
+		FillInSha1Sum(sha1sum, (const VbPublicKey *)key);
 		used += StrnAppend(buf + used, "\ngbb.rootkey: ",
 				   DEBUG_INFO_SIZE - used);
 		used += StrnAppend(buf + used, sha1sum,
 				   DEBUG_INFO_SIZE - used);
 	}
 
-	ret = VbGbbReadRecoveryKey(ctx, &key);
+	ret = VbGbbGetRecoveryKey(ctx, &key, NULL);
 	if (!ret) {
-		FillInSha1Sum(sha1sum, key);
-		free(key);
+		FillInSha1Sum(sha1sum, (const VbPublicKey *)key);
 		used += StrnAppend(buf + used, "\ngbb.recovery_key: ",
 				   DEBUG_INFO_SIZE - used);
 		used += StrnAppend(buf + used, sha1sum,
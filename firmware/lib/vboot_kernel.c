@@ -120,7 +120,8 @@ static uint32_t get_body_offset(uint8_t *kbuf)
  *
  * @param kbuf		Buffer containing the vblock
  * @param kbuf_size	Size of the buffer in bytes
- * @param kernel_subkey	Packed kernel subkey to use in validating keyblock
+ * @param kernel_subkey	Kernel subkey to use in validating keyblock, or NULL
+ *			if it couldn't be unpacked
  * @param params	Load kernel parameters
  * @param min_version	Minimum kernel version
  * @param shpart	Destination for verification results
@@ -131,15 +132,13 @@ static uint32_t get_body_offset(uint8_t *kbuf)
 int vb2_verify_kernel_vblock(struct vb2_context *ctx,
 			     uint8_t *kbuf,
 			     uint32_t kbuf_size,
-			     const struct vb2_packed_key *kernel_subkey,
+			     const struct vb2_public_key *kernel_subkey,
 			     const LoadKernelParams *params,
 			     uint32_t min_version,
 			     VbSharedDataKernelPart *shpart,
 			     struct vb2_workbuf *wb)
 {
-	/* Unpack kernel subkey */
-	struct vb2_public_key kernel_subkey2;
-	if (VB2_SUCCESS != vb2_unpack_key(&kernel_subkey2, kernel_subkey)) {
+	if (!kernel_subkey) {
 		VB2_DEBUG("Unable to unpack kernel subkey\n");
 		return VB2_ERROR_VBLOCK_KERNEL_SUBKEY;
 	}
@@ -148,7 +147,7 @@ int vb2_verify_kernel_vblock(struct vb2_context *ctx,
 	int keyblock_valid = 1;  /* Assume valid */
 	struct vb2_keyblock *keyblock = get_keyblock(kbuf);
 	if (VB2_SUCCESS != vb2_verify_keyblock(keyblock, kbuf_size,
-					       &kernel_subkey2, wb)) {
+					       kernel_subkey, wb)) {
 		VB2_DEBUG("Verifying key block signature failed.\n");
 		shpart->check_result = VBSD_LKP_CHECK_KEY_BLOCK_SIG;
 		keyblock_valid = 0;
@@ -305,7 +304,8 @@ enum vb2_load_partition_flags {
  *
  * @param ctx		Vboot context
  * @param stream	Stream to load kernel from
- * @param kernel_subkey	Key to use to verify vblock
+ * @param kernel_subkey	Key to use to verify vblock, or NULL if it couldn't
+ *			be unpacked
  * @param flags		Flags (one or more of vb2_load_partition_flags)
  * @param params	Load-kernel parameters
  * @param min_version	Minimum kernel version from TPM
@@ -314,7 +314,7 @@ enum vb2_load_partition_flags {
  */
 int vb2_load_partition(struct vb2_context *ctx,
 		       VbExStream_t stream,
-		       const struct vb2_packed_key *kernel_subkey,
+		       const struct vb2_public_key *kernel_subkey,
 		       uint32_t flags,
 		       LoadKernelParams *params,
 		       uint32_t min_version,
@@ -432,7 +432,6 @@ VbError_t LoadKernel(struct vb2_context *ctx, LoadKernelParams *params)
 	struct vb2_shared_data *sd = vb2_get_sd(ctx);
 	VbSharedDataHeader *shared = sd->vbsd;
 	VbSharedDataKernelCall *shcall = NULL;
-	struct vb2_packed_key *recovery_key = NULL;
 	int found_partitions = 0;
 	uint32_t lowest_version = LOWEST_TPM_VERSION;
 
@@ -458,18 +457,29 @@ VbError_t LoadKernel(struct vb2_context *ctx, LoadKernelParams *params)
 	shcall->sector_count = params->streaming_lba_count;
 	shared->lk_call_count++;
 
-	/* Choose key to verify kernel */
-	struct vb2_packed_key *kernel_subkey;
+	/*
+	 * Choose key to verify kernel.  Unpack it once here rather than for
+	 * each partition; if that fails, every partition will fail to verify.
+	 */
+	const struct vb2_public_key *kernel_subkey = NULL;
+	struct vb2_public_key kernel_subkey_unpacked;
 	if (kBootRecovery == shcall->boot_mode) {
 		/* Use the recovery key to verify the kernel */
-		retval = VbGbbReadRecoveryKey(ctx,
-					      (VbPublicKey **)&recovery_key);
+		retval = VbGbbGetRecoveryKey(ctx, NULL, NULL);
 		if (VBERROR_SUCCESS != retval)
 			goto load_kernel_exit;
-		kernel_subkey = recovery_key;
-	} else {
+		/*
+		 * The key is already in the work buffer; this just unpacks
+		 * it.  If that fails, leave kernel_subkey NULL so only the
+		 * partitions it's needed for fail, as for the kernel subkey.
+		 */
+		if (VbGbbGetRecoveryKey(ctx, NULL, &kernel_subkey))
+			kernel_subkey = NULL;
+	} else if (VB2_SUCCESS == vb2_unpack_key(
+			&kernel_subkey_unpacked,
+			(struct vb2_packed_key *)&shared->kernel_subkey)) {
 		/* Use the kernel subkey passed from firmware verification */
-		kernel_subkey = (struct vb2_packed_key *)&shared->kernel_subkey;
+		kernel_subkey = &kernel_subkey_unpacked;
 	}
 
 	/* Read GPT data */
@@ -657,8 +667,6 @@ load_kernel_exit:
 		   VBERROR_SUCCESS != retval ?
 		   recovery : VB2_RECOVERY_NOT_REQUESTED);
 
-	free(recovery_key);
-
 	shcall->return_code = (uint8_t)retval;
 	return retval;
 }
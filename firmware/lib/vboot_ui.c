@@ -29,9 +29,13 @@
 /* Global variables */
 static int power_button_released;
 
+/* Removable media as of the last disk scan */
+static struct vb2_media_generation media;
+
 static void vb2_init_ui(void)
 {
 	power_button_released = 0;
+	media.valid = 0;
 }
 
 static void VbAllowUsbBoot(struct vb2_context *ctx)
@@ -522,21 +526,29 @@ static VbError_t recovery_ui(struct vb2_context *ctx)
 
 	/* Loop and wait for a recovery image */
 	VB2_DEBUG("VbBootRecovery() waiting for a recovery image\n");
+	retval = VBERROR_NO_DISK_FOUND;
 	while (1) {
-		VB2_DEBUG("VbBootRecovery() attempting to load kernel2\n");
-		retval = VbTryLoadKernel(ctx, VB_DISK_FLAG_REMOVABLE);
-
 		/*
-		 * Clear recovery requests from failed kernel loading, since
-		 * we're already in recovery mode.  Do this now, so that
-		 * powering off after inserting an invalid disk doesn't leave
-		 * us stuck in recovery mode.
+		 * Don't read and verify the same disks again if nothing has
+		 * been plugged in or pulled out since the last attempt.
 		 */
-		vb2_nv_set(ctx, VB2_NV_RECOVERY_REQUEST,
-			   VB2_RECOVERY_NOT_REQUESTED);
+		if (vb2_removable_media_changed(&media, 1)) {
+			VB2_DEBUG("VbBootRecovery() attempting to load "
+				  "kernel2\n");
+			retval = VbTryLoadKernel(ctx, VB_DISK_FLAG_REMOVABLE);
+
+			/*
+			 * Clear recovery requests from failed kernel loading,
+			 * since we're already in recovery mode.  Do this now,
+			 * so that powering off after inserting an invalid disk
+			 * doesn't leave us stuck in recovery mode.
+			 */
+			vb2_nv_set(ctx, VB2_NV_RECOVERY_REQUEST,
+				   VB2_RECOVERY_NOT_REQUESTED);
 
-		if (VBERROR_SUCCESS == retval)
-			break; /* Found a recovery kernel */
+			if (VBERROR_SUCCESS == retval)
+				break; /* Found a recovery kernel */
+		}
 
 		VbDisplayScreen(ctx, VBERROR_NO_DISK_FOUND == retval ?
 				VB_SCREEN_RECOVERY_INSERT :
@@ -612,6 +624,11 @@ static VbError_t recovery_ui(struct vb2_context *ctx)
 			if (VbWantShutdown(ctx, key))
 				return VBERROR_SHUTDOWN_REQUESTED;
 			VbExSleepMs(REC_KEY_DELAY);
+
+			/* Look at new media right away */
+			if (media.valid &&
+			    vb2_removable_media_changed(&media, 0))
+				break;
 		}
 	}
 
@@ -71,3 +71,30 @@ void vb2_try_alt_fw(int allowed, int altfw_num)
 	else
 		vb2_error_no_altfw();
 }
+
+__attribute__((weak))
+VbError_t VbExDiskGetGeneration(uint32_t disk_flags, uint32_t *generation)
+{
+	/* Can't tell, so assume the disks may change every time */
+	return VBERROR_UNKNOWN;
+}
+
+int vb2_removable_media_changed(struct vb2_media_generation *media,
+				int update)
+{
+	uint32_t generation;
+
+	if (VbExDiskGetGeneration(VB_DISK_FLAG_REMOVABLE, &generation)) {
+		media->valid = 0;
+		return 1;
+	}
+
+	if (media->valid && generation == media->generation)
+		return 0;
+
+	if (update) {
+		media->generation = generation;
+		media->valid = 1;
+	}
+	return 1;
+}
@@ -37,6 +37,7 @@ static uint32_t disable_dev_boot;
 static uint32_t altfw_allowed;
 static struct vb2_menu menus[];
 static const char no_legacy[] = "Legacy boot failed. Missing BIOS?\n";
+static struct vb2_media_generation media;
 
 /**
  * Checks GBB flags against VbExIsShutdownRequested() shutdown request to
@@ -699,6 +700,8 @@ static VbError_t vb2_init_menus(struct vb2_context *ctx)
 	menus[VB_MENU_LANGUAGES].size = count;
 	menus[VB_MENU_LANGUAGES].items = items;
 
+	media.valid = 0;
+
 	return VBERROR_SUCCESS;
 }
 
@@ -860,25 +863,34 @@ static VbError_t recovery_ui(struct vb2_context *ctx)
 	VB2_DEBUG("waiting for a recovery image\n");
 	usb_nogood = -1;
 	while (1) {
-		VB2_DEBUG("attempting to load kernel2\n");
-		ret = VbTryLoadKernel(ctx, VB_DISK_FLAG_REMOVABLE);
-
 		/*
-		 * Clear recovery requests from failed kernel loading, since
-		 * we're already in recovery mode.  Do this now, so that
-		 * powering off after inserting an invalid disk doesn't leave
-		 * us stuck in recovery mode.
+		 * Don't read and verify the same disks again if nothing has
+		 * been plugged in or pulled out since the last attempt.
 		 */
-		vb2_nv_set(ctx, VB2_NV_RECOVERY_REQUEST,
-			   VB2_RECOVERY_NOT_REQUESTED);
-
-		if (VBERROR_SUCCESS == ret)
-			return ret; /* Found a recovery kernel */
-
-		if (usb_nogood != (ret != VBERROR_NO_DISK_FOUND)) {
-			/* USB state changed, force back to base screen */
-			usb_nogood = ret != VBERROR_NO_DISK_FOUND;
-			enter_recovery_base_screen(ctx);
+		if (vb2_removable_media_changed(&media, 1)) {
+			VB2_DEBUG("attempting to load kernel2\n");
+			ret = VbTryLoadKernel(ctx, VB_DISK_FLAG_REMOVABLE);
+
+			/*
+			 * Clear recovery requests from failed kernel loading,
+			 * since we're already in recovery mode.  Do this now,
+			 * so that powering off after inserting an invalid disk
+			 * doesn't leave us stuck in recovery mode.
+			 */
+			vb2_nv_set(ctx, VB2_NV_RECOVERY_REQUEST,
+				   VB2_RECOVERY_NOT_REQUESTED);
+
+			if (VBERROR_SUCCESS == ret)
+				return ret; /* Found a recovery kernel */
+
+			if (usb_nogood != (ret != VBERROR_NO_DISK_FOUND)) {
+				/*
+				 * USB state changed, force back to base
+				 * screen
+				 */
+				usb_nogood = ret != VBERROR_NO_DISK_FOUND;
+				enter_recovery_base_screen(ctx);
+			}
 		}
 
 		/*
@@ -899,6 +911,11 @@ static VbError_t recovery_ui(struct vb2_context *ctx)
 					return ret;
 			}
 			VbExSleepMs(REC_KEY_DELAY);
+
+			/* Look at new media right away */
+			if (media.valid &&
+			    vb2_removable_media_changed(&media, 0))
+				break;
 		}
 	}
 }
@@ -30,8 +30,6 @@ int vb2_unpack_key_buffer(struct vb2_public_key *key,
 {
 	const struct vb2_packed_key *packed_key =
 		(const struct vb2_packed_key *)buf;
-	const uint32_t *buf32;
-	uint32_t expected_key_size;
 	int rv;
 
 	/* Make sure passed buffer is big enough for the packed key */
@@ -52,29 +50,8 @@ int vb2_unpack_key_buffer(struct vb2_public_key *key,
 		return VB2_ERROR_UNPACK_KEY_HASH_ALGORITHM;
 	}
 
-	expected_key_size = vb2_packed_key_size(key->sig_alg);
-	if (!expected_key_size || expected_key_size != packed_key->key_size) {
-		VB2_DEBUG("Wrong key size for algorithm\n");
-		return VB2_ERROR_UNPACK_KEY_SIZE;
-	}
-
-	/* Make sure source buffer is 32-bit aligned */
-	buf32 = (const uint32_t *)vb2_packed_key_data(packed_key);
-	if (!vb2_aligned(buf32, sizeof(uint32_t)))
-		return VB2_ERROR_UNPACK_KEY_ALIGN;
-
-	/* Sanity check key array size */
-	key->arrsize = buf32[0];
-	if (key->arrsize * sizeof(uint32_t) != vb2_rsa_sig_size(key->sig_alg))
-		return VB2_ERROR_UNPACK_KEY_ARRAY_SIZE;
-
-	key->n0inv = buf32[1];
-
-	/* Arrays point inside the key data */
-	key->n = buf32 + 2;
-	key->rr = buf32 + 2 + key->arrsize;
-
-	return VB2_SUCCESS;
+	return vb2_unpack_key_data(key, vb2_packed_key_data(packed_key),
+				   packed_key->key_size);
 }
 
 int vb2_unpack_key(struct vb2_public_key *key,
@@ -10,38 +10,6 @@
 #include "2rsa.h"
 #include "vb21_common.h"
 
-int vb2_unpack_key_data(struct vb2_public_key *key,
-			const uint8_t *key_data,
-			uint32_t key_size)
-{
-	const uint32_t *buf32 = (const uint32_t *)key_data;
-	uint32_t expected_key_size = vb2_packed_key_size(key->sig_alg);
-
-	/* Make sure buffer is the correct length */
-	if (!expected_key_size || expected_key_size != key_size) {
-		VB2_DEBUG("Wrong key size for algorithm\n");
-		return VB2_ERROR_UNPACK_KEY_SIZE;
-	}
-
-	/* Check for alignment */
-	if (!vb2_aligned(buf32, sizeof(uint32_t)))
-		return VB2_ERROR_UNPACK_KEY_ALIGN;
-
-	key->arrsize = buf32[0];
-
-	/* Sanity check key array size */
-	if (key->arrsize * sizeof(uint32_t) != vb2_rsa_sig_size(key->sig_alg))
-		return VB2_ERROR_UNPACK_KEY_ARRAY_SIZE;
-
-	key->n0inv = buf32[1];
-
-	/* Arrays point inside the key data */
-	key->n = buf32 + 2;
-	key->rr = buf32 + 2 + key->arrsize;
-
-	return VB2_SUCCESS;
-}
-
 int vb21_unpack_key(struct vb2_public_key *key,
 		    const uint8_t *buf,
 		    uint32_t size)
@@ -31,6 +31,13 @@ VbError_t VbExDiskFreeInfo(VbDiskInfo* infos_ptr,
 }
 
 
+VbError_t VbExDiskGetGeneration(uint32_t disk_flags, uint32_t* generation)
+{
+	/* Can't tell, so assume the disks may change every time */
+	return VBERROR_UNKNOWN;
+}
+
+
 VbError_t VbExDiskRead(VbExDiskHandle_t handle, uint64_t lba_start,
 		       uint64_t lba_count, void* buffer)
 {
@@ -0,0 +1,465 @@
+/*
+ * Copyright 2018 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Run futility commands on request, for callers that would otherwise start
+ * it over and over again.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "futility.h"
+
+/* Limits on a single request */
+#define MAX_REQUEST_ARGS 1024
+#define MAX_REQUEST_SIZE (1024 * 1024)
+
+static const char usage[] = "\n"
+	"Usage:  " MYNAME " %s [OPTIONS]\n"
+	"\n"
+	"Run " MYNAME " commands on request, keeping signing keys in memory\n"
+	"between them. Requests are read from stdin and answered on stdout,\n"
+	"one at a time, unless a socket is given.\n"
+	"\n"
+	"Options:\n"
+	"  --socket PATH       Listen on this Unix domain socket instead\n"
+	"  --jobs NUM          Number of requests to handle at once on the\n"
+	"                        socket (default is the number of CPUs)\n"
+	"  --keys PATH         Preload this key, or all the .vbprivk, .keyblock\n"
+	"                        and .vbpubk files in this directory. May be\n"
+	"                        given more than once.\n"
+	"\n"
+	"A request is a command line, with each argument (starting with the\n"
+	"command name) followed by a NUL byte, and one more NUL at the end:\n"
+	"\n"
+	"  printf 'sign\\0--signprivate\\0key.vbprivk\\0...\\0\\0'\n"
+	"\n"
+	"The reply is a line with the exit status of the command and the\n"
+	"number of bytes it printed, followed by that many bytes of output:\n"
+	"\n"
+	"  0 123\\n<123 bytes of stdout and stderr>\n"
+	"\n"
+	"A connection may send any number of requests. Each one runs in a new\n"
+	"process, so they can't affect each other. File names are relative to\n"
+	"the directory the server was started in.\n"
+	"\n";
+
+static void print_help(int argc, char *argv[])
+{
+	printf(usage, argv[0]);
+}
+
+/* Set by the signal handler to shut down the server */
+static volatile sig_atomic_t stopping;
+
+static void stop_handler(int sig)
+{
+	stopping = sig;
+}
+
+/*
+ * Read one request from the stream, into a NULL-terminated argv. Returns the
+ * argument count, 0 at the end of the stream, or -1 if the request is bad.
+ */
+static int read_request(FILE *in, char ***argv_ptr)
+{
+	char **argv = NULL, **new_argv;
+	char *arg = NULL;
+	size_t n = 0, total = 0;
+	ssize_t len;
+	int argc = 0;
+
+	for (;;) {
+		len = getdelim(&arg, &n, '\0', in);
+		if (len < 0) {
+			/* The stream should only end between requests */
+			if (!argc && (!ferror(in) || stopping)) {
+				free(arg);
+				return 0;
+			}
+			fprintf(stderr, "Truncated request\n");
+			break;
+		}
+
+		/* An empty argument ends the request */
+		if (len == 1 && !arg[0]) {
+			if (!argc)
+				continue;
+			free(arg);
+			*argv_ptr = argv;
+			return argc;
+		}
+
+		total += len;
+		if (argc >= MAX_REQUEST_ARGS || total > MAX_REQUEST_SIZE) {
+			fprintf(stderr, "Request is too big\n");
+			break;
+		}
+		new_argv = realloc(argv, (argc + 2) * sizeof(*argv));
+		if (!new_argv)
+			break;
+		argv = new_argv;
+		argv[argc++] = arg;
+		argv[argc] = NULL;
+		arg = NULL;
+		n = 0;
+	}
+
+	while (argc > 0)
+		free(argv[--argc]);
+	free(argv);
+	free(arg);
+	return -1;
+}
+
+/* Run the command in a child process, with its output sent to the file. */
+static int run_request(int argc, char *argv[], FILE *capture)
+{
+	const struct futil_cmd_t *cmd;
+	pid_t pid;
+	int status;
+
+	cmd = futil_find_command(argv[0]);
+	if (!cmd || !strcmp(argv[0], "serve")) {
+		fprintf(capture, "Unknown command: \"%s\"\n", argv[0]);
+		return 1;
+	}
+
+	fflush(stdout);
+	fflush(stderr);
+	pid = fork();
+	if (pid < 0) {
+		fprintf(capture, "Couldn't fork: %s\n", strerror(errno));
+		return 1;
+	}
+
+	if (!pid) {
+		signal(SIGINT, SIG_DFL);
+		signal(SIGTERM, SIG_DFL);
+		if (dup2(fileno(capture), STDOUT_FILENO) < 0 ||
+		    dup2(fileno(capture), STDERR_FILENO) < 0)
+			_exit(1);
+		/* Commands parse their options from scratch */
+		optind = 0;
+		status = !!futil_run_command(cmd, argc, argv);
+		fflush(stdout);
+		fflush(stderr);
+		_exit(status);
+	}
+
+	while (waitpid(pid, &status, 0) < 0)
+		if (errno != EINTR) {
+			fprintf(capture, "Lost track of the command: %s\n",
+				strerror(errno));
+			return 1;
+		}
+
+	if (WIFEXITED(status))
+		return WEXITSTATUS(status);
+
+	/* Same as the shell does */
+	fprintf(capture, "Command killed by signal %d\n", WTERMSIG(status));
+	return 128 + WTERMSIG(status);
+}
+
+/* Answer requests until the stream ends. Returns 0 unless it was garbled. */
+static int serve_stream(FILE *in, FILE *out)
+{
+	char buf[BUFSIZ];
+	struct stat sb;
+	FILE *capture;
+	char **argv;
+	long size;
+	size_t n;
+	int argc, i, status;
+
+	while (!stopping) {
+		argc = read_request(in, &argv);
+		if (argc <= 0)
+			return argc < 0;
+
+		Debug("%s(): request \"%s\"\n", __func__, argv[0]);
+
+		capture = tmpfile();
+		if (!capture) {
+			fprintf(stderr, "Can't create temporary file: %s\n",
+				strerror(errno));
+			status = 1;
+			size = 0;
+		} else {
+			status = run_request(argc, argv, capture);
+			/* The child wrote to the file behind our back */
+			fflush(capture);
+			size = fstat(fileno(capture), &sb) ? 0 : sb.st_size;
+			rewind(capture);
+		}
+
+		fprintf(out, "%d %ld\n", status, size);
+		while (capture && size > 0 &&
+		       (n = fread(buf, 1, sizeof(buf), capture)) > 0) {
+			fwrite(buf, 1, n, out);
+			size -= n;
+		}
+		fflush(out);
+
+		if (capture)
+			fclose(capture);
+		for (i = 0; i < argc; i++)
+			free(argv[i]);
+		free(argv);
+
+		if (ferror(out))
+			return 1;
+	}
+
+	return 0;
+}
+
+/* Accept and serve connections until told to stop. */
+static void worker(int sock)
+{
+	FILE *in, *out;
+	int fd;
+
+	while (!stopping) {
+		fd = accept(sock, NULL, NULL);
+		if (fd < 0) {
+			if (errno == EINTR)
+				continue;
+			fprintf(stderr, "Can't accept connections: %s\n",
+				strerror(errno));
+			_exit(1);
+		}
+
+		in = fdopen(fd, "r");
+		out = fdopen(dup(fd), "w");
+		if (in && out)
+			serve_stream(in, out);
+		if (out)
+			fclose(out);
+		if (in)
+			fclose(in);
+		else
+			close(fd);
+	}
+
+	_exit(0);
+}
+
+static pid_t start_worker(int sock)
+{
+	pid_t pid = fork();
+
+	if (pid < 0)
+		fprintf(stderr, "Couldn't fork: %s\n", strerror(errno));
+	else if (!pid)
+		worker(sock);
+
+	return pid;
+}
+
+static int serve_socket(const char *path, int jobs)
+{
+	struct sockaddr_un addr;
+	struct stat sb;
+	pid_t *workers, pid;
+	mode_t mask;
+	int sock, i, status, errorcnt = 0;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "Socket path is too long: %s\n", path);
+		return 1;
+	}
+	strcpy(addr.sun_path, path);
+
+	/* Clean up after a server that didn't exit nicely */
+	if (!lstat(path, &sb) && S_ISSOCK(sb.st_mode))
+		unlink(path);
+
+	sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock < 0) {
+		fprintf(stderr, "Can't create socket: %s\n", strerror(errno));
+		return 1;
+	}
+
+	/* Only we get to ask for things to be signed */
+	mask = umask(0077);
+	if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) ||
+	    listen(sock, SOMAXCONN)) {
+		fprintf(stderr, "Can't listen on %s: %s\n", path,
+			strerror(errno));
+		umask(mask);
+		close(sock);
+		return 1;
+	}
+	umask(mask);
+
+	workers = calloc(jobs, sizeof(*workers));
+	if (!workers) {
+		errorcnt++;
+		goto done;
+	}
+	for (i = 0; i < jobs; i++)
+		workers[i] = start_worker(sock);
+
+	/* Replace any workers that die, until we're told to stop */
+	while (!stopping) {
+		pid = wait(&status);
+		if (pid < 0) {
+			if (errno == EINTR)
+				continue;
+			fprintf(stderr, "Lost track of workers: %s\n",
+				strerror(errno));
+			errorcnt++;
+			break;
+		}
+		for (i = 0; i < jobs; i++)
+			if (workers[i] == pid) {
+				Debug("%s(): worker %d exited\n", __func__, pid);
+				workers[i] = start_worker(sock);
+			}
+	}
+
+	for (i = 0; i < jobs; i++)
+		if (workers[i] > 0)
+			kill(workers[i], SIGTERM);
+	while (wait(&status) > 0 || errno == EINTR)
+		;
+	free(workers);
+
+done:
+	close(sock);
+	unlink(path);
+	return !!errorcnt;
+}
+
+enum no_short_opts {
+	OPT_SOCKET = 1000,
+	OPT_JOBS,
+	OPT_KEYS,
+	OPT_HELP,
+};
+
+static const struct option long_opts[] = {
+	/* name    hasarg *flag  val */
+	{"socket",       1, NULL, OPT_SOCKET},
+	{"jobs",         1, NULL, OPT_JOBS},
+	{"keys",         1, NULL, OPT_KEYS},
+	{"help",         0, NULL, OPT_HELP},
+	{NULL,           0, NULL, 0},
+};
+static char *short_opts = ":";
+
+static int do_serve(int argc, char *argv[])
+{
+	struct sigaction sa;
+	const char *socket_path = NULL;
+	FILE *out = NULL;
+	long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	const char *keys[argc];
+	int nkeys = 0;
+	int errorcnt = 0;
+	char *e = 0;
+	int i;
+
+	opterr = 0;		/* quiet, you */
+	while ((i = getopt_long(argc, argv, short_opts, long_opts, 0)) != -1) {
+		switch (i) {
+		case OPT_SOCKET:
+			socket_path = optarg;
+			break;
+		case OPT_JOBS:
+			jobs = strtol(optarg, &e, 0);
+			if (!*optarg || (e && *e) || jobs < 1) {
+				fprintf(stderr,
+					"Invalid --jobs \"%s\"\n", optarg);
+				errorcnt++;
+			}
+			break;
+		case OPT_KEYS:
+			/* Wait until we know where our output goes */
+			keys[nkeys++] = optarg;
+			break;
+		case OPT_HELP:
+			print_help(argc, argv);
+			return !!errorcnt;
+
+		case '?':
+			if (optopt)
+				fprintf(stderr, "Unrecognized option: -%c\n",
+					optopt);
+			else
+				fprintf(stderr, "Unrecognized option: %s\n",
+					argv[optind - 1]);
+			errorcnt++;
+			break;
+		case ':':
+			fprintf(stderr, "Missing argument to -%c\n", optopt);
+			errorcnt++;
+			break;
+		default:
+			DIE;
+		}
+	}
+
+	if (argc - optind > 0) {
+		fprintf(stderr, "ERROR: too many arguments left over\n");
+		errorcnt++;
+	}
+
+	if (errorcnt) {
+		print_help(argc, argv);
+		return 1;
+	}
+
+	if (jobs < 1)
+		jobs = 1;
+
+	/* Keep replies on stdout, and anything else we print out of the way */
+	if (!socket_path) {
+		fflush(stdout);
+		out = fdopen(dup(STDOUT_FILENO), "w");
+		if (!out || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+			fprintf(stderr, "Can't set up stdout: %s\n",
+				strerror(errno));
+			return 1;
+		}
+	}
+
+	for (i = 0; i < nkeys; i++)
+		errorcnt += futil_preload_keys(keys[i]);
+	if (errorcnt)
+		return 1;
+
+	/* Stop cleanly, after finishing the requests in progress */
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = stop_handler;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	/* A client going away shouldn't take us with it */
+	signal(SIGPIPE, SIG_IGN);
+
+	if (socket_path)
+		return serve_socket(socket_path, jobs);
+
+	errorcnt = serve_stream(stdin, out);
+	fclose(out);
+	return errorcnt;
+}
+
+DECLARE_FUTIL_COMMAND(serve, do_serve, VBOOT_VERSION_ALL,
+		      "Run commands on request, keeping keys in memory");
@@ -10,6 +10,7 @@
 #include <fcntl.h>
 #include <getopt.h>
 #include <inttypes.h>
+#include <stdarg.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -17,6 +18,7 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 #include "2sysincludes.h"
@@ -54,6 +56,31 @@ void show_pubkey(const struct vb2_packed_key *pubkey, const char *sp)
 	       sp, packed_key_sha1_string(pubkey));
 }
 
+void json_pubkey(const struct vb2_packed_key *pubkey)
+{
+	json_int("algorithm", pubkey->algorithm);
+	json_string("algorithm_name",
+		    vb2_get_crypto_algorithm_name(pubkey->algorithm));
+	json_int("key_version", pubkey->key_version);
+	json_string("sha1sum", packed_key_sha1_string(pubkey));
+}
+
+/* Report a problem with a file, as text or as an "error" member in JSON */
+static void show_error(const char *format, ...)
+{
+	char msg[256];
+	va_list ap;
+
+	va_start(ap, format);
+	vsnprintf(msg, sizeof(msg), format, ap);
+	va_end(ap);
+
+	if (show_option.json)
+		json_string("error", msg);
+	else
+		printf("%s\n", msg);
+}
+
 static void show_keyblock(struct vb2_keyblock *keyblock, const char *name,
 			  int sign_key, int good_sig)
 {
@@ -83,15 +110,53 @@ static void show_keyblock(struct vb2_keyblock *keyblock, const char *name,
 	       packed_key_sha1_string(data_key));
 }
 
+static void json_keyblock(struct vb2_keyblock *keyblock,
+			  int sign_key, int good_sig)
+{
+	json_string("signature",
+		    sign_key ? (good_sig ? "valid" : "invalid") : "ignored");
+	json_int("size", keyblock->keyblock_size);
+	json_int("flags", keyblock->keyblock_flags);
+	json_begin("data_key");
+	json_pubkey(&keyblock->data_key);
+	json_end();
+}
+
+/* Show the keyblock in front of a preamble */
+static void show_preamble_keyblock(struct vb2_keyblock *keyblock,
+				   const char *name, int sign_key,
+				   int good_sig)
+{
+	if (show_option.json) {
+		json_begin("keyblock");
+		json_keyblock(keyblock, sign_key, good_sig);
+		json_end();
+	} else {
+		show_keyblock(keyblock, name, sign_key, good_sig);
+	}
+}
+
+/* Report the result of checking a preamble's body signature in JSON */
+static void json_body_signature(const char *result)
+{
+	if (show_option.json)
+		json_string("body_signature", result);
+}
+
 int ft_show_pubkey(const char *name, uint8_t *buf, uint32_t len, void *data)
 {
 	struct vb2_packed_key *pubkey = (struct vb2_packed_key *)buf;
 
 	if (!packed_key_looks_ok(pubkey, len)) {
-		printf("%s looks bogus\n", name);
+		show_error("%s looks bogus", name);
 		return 1;
 	}
 
+	if (show_option.json) {
+		json_pubkey(pubkey);
+		return 0;
+	}
+
 	printf("Public Key file:       %s\n", name);
 	show_pubkey(pubkey, "  ");
 
@@ -106,12 +171,20 @@ int ft_show_privkey(const char *name, uint8_t *buf, uint32_t len, void *data)
 	const unsigned char *start = pkey->key_data;
 
 	if (len <= sizeof(*pkey)) {
-		printf("%s looks bogus\n", name);
+		show_error("%s looks bogus", name);
 		return 1;
 	}
 	len -= sizeof(*pkey);
 	key.rsa_private_key = d2i_RSAPrivateKey(NULL, &start, len);
 
+	if (show_option.json) {
+		json_int("algorithm", pkey->algorithm);
+		json_string("algorithm_name",
+			    vb2_get_crypto_algorithm_name(pkey->algorithm));
+		json_string("sha1sum", private_key_sha1_string(&key));
+		return 0;
+	}
+
 	printf("Private Key file:      %s\n", name);
 	printf("  Vboot API:           1.0\n");
 	printf("  Algorithm:           %u %s\n", pkey->algorithm,
@@ -131,7 +204,7 @@ int ft_show_keyblock(const char *name, uint8_t *buf, uint32_t len, void *data)
 
 	/* Check the hash only first */
 	if (0 != vb2_verify_keyblock_hash(block, len, &wb)) {
-		printf("%s is invalid\n", name);
+		show_error("%s is invalid", name);
 		return 1;
 	}
 
@@ -143,7 +216,10 @@ int ft_show_keyblock(const char *name, uint8_t *buf, uint32_t len, void *data)
 	if (show_option.strict && (!sign_key || !good_sig))
 		retval = 1;
 
-	show_keyblock(block, name, !!sign_key, good_sig);
+	if (show_option.json)
+		json_keyblock(block, !!sign_key, good_sig);
+	else
+		show_keyblock(block, name, !!sign_key, good_sig);
 
 	return retval;
 }
@@ -157,12 +233,14 @@ int ft_show_fw_preamble(const char *name, uint8_t *buf, uint32_t len,
 	uint8_t *fv_data = show_option.fv;
 	uint64_t fv_size = show_option.fv_size;
 	struct bios_area_s *fw_body_area = 0;
+	struct bios_body_digest_s *body_digest = 0;
 	int good_sig = 0;
 	int retval = 0;
+	int rv;
 
 	/* Check the hash... */
 	if (VB2_SUCCESS != vb2_verify_keyblock_hash(keyblock, len, &wb)) {
-		printf("%s keyblock component is invalid\n", name);
+		show_error("%s keyblock component is invalid", name);
 		return 1;
 	}
 
@@ -188,6 +266,7 @@ int ft_show_fw_preamble(const char *name, uint8_t *buf, uint32_t len,
 			? BIOS_FMAP_FW_MAIN_A
 			: BIOS_FMAP_FW_MAIN_B;
 		fw_body_area = &state->area[body_c];
+		body_digest = &state->body_digest[state->c];
 	}
 
 	/* If we have a key, check the signature too */
@@ -195,7 +274,7 @@ int ft_show_fw_preamble(const char *name, uint8_t *buf, uint32_t len,
 	    vb2_verify_keyblock(keyblock, len, sign_key, &wb))
 		good_sig = 1;
 
-	show_keyblock(keyblock, name, !!sign_key, good_sig);
+	show_preamble_keyblock(keyblock, name, !!sign_key, good_sig);
 
 	if (show_option.strict && (!sign_key || !good_sig))
 		retval = 1;
@@ -210,7 +289,7 @@ int ft_show_fw_preamble(const char *name, uint8_t *buf, uint32_t len,
 	struct vb2_fw_preamble *pre2 = (struct vb2_fw_preamble *)(buf + more);
 	if (VB2_SUCCESS != vb2_verify_fw_preamble(pre2, len - more,
 						  &data_key, &wb)) {
-		printf("%s is invalid\n", name);
+		show_error("%s is invalid", name);
 		return 1;
 	}
 
@@ -218,27 +297,46 @@ int ft_show_fw_preamble(const char *name, uint8_t *buf, uint32_t len,
 	if (pre2->header_version_minor < 1)
 		flags = 0;  /* Old 2.0 structure didn't have flags */
 
-	printf("Firmware Preamble:\n");
-	printf("  Size:                  %d\n", pre2->preamble_size);
-	printf("  Header version:        %d.%d\n",
-	       pre2->header_version_major, pre2->header_version_minor);
-	printf("  Firmware version:      %d\n", pre2->firmware_version);
-
 	struct vb2_packed_key *kernel_subkey = &pre2->kernel_subkey;
-	printf("  Kernel key algorithm:  %d %s\n",
-	       kernel_subkey->algorithm,
-	       vb2_get_crypto_algorithm_name(kernel_subkey->algorithm));
 	if (kernel_subkey->algorithm >= VB2_ALG_COUNT)
 		retval = 1;
-	printf("  Kernel key version:    %d\n", kernel_subkey->key_version);
-	printf("  Kernel key sha1sum:    %s\n",
-	       packed_key_sha1_string(kernel_subkey));
-	printf("  Firmware body size:    %d\n", pre2->body_signature.data_size);
-	printf("  Preamble flags:        %d\n", flags);
+
+	if (show_option.json) {
+		json_begin("preamble");
+		json_int("size", pre2->preamble_size);
+		json_int("header_version_major", pre2->header_version_major);
+		json_int("header_version_minor", pre2->header_version_minor);
+		json_int("firmware_version", pre2->firmware_version);
+		json_begin("kernel_subkey");
+		json_pubkey(kernel_subkey);
+		json_end();
+		json_int("body_size", pre2->body_signature.data_size);
+		json_int("flags", flags);
+		json_end();
+	} else {
+		printf("Firmware Preamble:\n");
+		printf("  Size:                  %d\n", pre2->preamble_size);
+		printf("  Header version:        %d.%d\n",
+		       pre2->header_version_major, pre2->header_version_minor);
+		printf("  Firmware version:      %d\n", pre2->firmware_version);
+		printf("  Kernel key algorithm:  %d %s\n",
+		       kernel_subkey->algorithm,
+		       vb2_get_crypto_algorithm_name(kernel_subkey->algorithm));
+		printf("  Kernel key version:    %d\n",
+		       kernel_subkey->key_version);
+		printf("  Kernel key sha1sum:    %s\n",
+		       packed_key_sha1_string(kernel_subkey));
+		printf("  Firmware body size:    %d\n",
+		       pre2->body_signature.data_size);
+		printf("  Preamble flags:        %d\n", flags);
+	}
 
 	if (flags & VB2_FIRMWARE_PREAMBLE_USE_RO_NORMAL) {
-		printf("Preamble requests USE_RO_NORMAL;"
-		       " skipping body verification.\n");
+		if (show_option.json)
+			json_body_signature("skipped");
+		else
+			printf("Preamble requests USE_RO_NORMAL;"
+			       " skipping body verification.\n");
 		goto done;
 	}
 
@@ -249,29 +347,45 @@ int ft_show_fw_preamble(const char *name, uint8_t *buf, uint32_t len,
 	}
 
 	if (!fv_data) {
-		printf("No firmware body available to verify.\n");
+		if (show_option.json)
+			json_body_signature("missing");
+		else
+			printf("No firmware body available to verify.\n");
 		if (show_option.strict)
 			return 1;
 		return 0;
 	}
 
-	if (VB2_SUCCESS !=
-	    vb2_verify_data(fv_data, fv_size, &pre2->body_signature,
-			    &data_key, &wb)) {
+	/* The body may have been hashed already, while showing a BIOS */
+	if (body_digest && body_digest->is_valid &&
+	    fv_data == fw_body_area->buf &&
+	    body_digest->hash_alg == data_key.hash_alg &&
+	    body_digest->data_size == pre2->body_signature.data_size)
+		rv = vb2_verify_digest(&data_key, &pre2->body_signature,
+				       body_digest->digest, &wb);
+	else
+		rv = vb2_verify_data(fv_data, fv_size, &pre2->body_signature,
+				     &data_key, &wb);
+	if (VB2_SUCCESS != rv) {
 		fprintf(stderr, "Error verifying firmware body.\n");
+		json_body_signature("invalid");
 		return 1;
 	}
+	json_body_signature("valid");
 
 done:
 	/* Can't trust the BIOS unless everything is signed (in which case
 	 * we've already returned), but standalone files are okay. */
 	if (state || (sign_key && good_sig)) {
-		if (!(flags & VB2_FIRMWARE_PREAMBLE_USE_RO_NORMAL))
+		if (!(flags & VB2_FIRMWARE_PREAMBLE_USE_RO_NORMAL) &&
+		    !show_option.json)
 			printf("Body verification succeeded.\n");
 		if (state)
 			state->area[state->c].is_valid = 1;
 	} else {
-		printf("Seems legit, but the signature is unverified.\n");
+		if (!show_option.json)
+			printf("Seems legit, but the signature is "
+			       "unverified.\n");
 		if (show_option.strict)
 			retval = 1;
 	}
@@ -284,11 +398,13 @@ int ft_show_kernel_preamble(const char *name, uint8_t *buf, uint32_t len,
 {
 	struct vb2_keyblock *keyblock = (struct vb2_keyblock *)buf;
 	struct vb2_public_key *sign_key = show_option.k;
+	uint8_t *kernel_blob = 0;
+	uint64_t kernel_size = 0;
 	int retval = 0;
 
 	/* Check the hash... */
 	if (VB2_SUCCESS != vb2_verify_keyblock_hash(keyblock, len, &wb)) {
-		printf("%s keyblock component is invalid\n", name);
+		show_error("%s keyblock component is invalid", name);
 		return 1;
 	}
 
@@ -298,8 +414,9 @@ int ft_show_kernel_preamble(const char *name, uint8_t *buf, uint32_t len,
 	    vb2_verify_keyblock(keyblock, len, sign_key, &wb))
 		good_sig = 1;
 
-	printf("Kernel partition:        %s\n", name);
-	show_keyblock(keyblock, NULL, !!sign_key, good_sig);
+	if (!show_option.json)
+		printf("Kernel partition:        %s\n", name);
+	show_preamble_keyblock(keyblock, NULL, !!sign_key, good_sig);
 
 	if (show_option.strict && (!sign_key || !good_sig))
 		retval = 1;
@@ -316,10 +433,36 @@ int ft_show_kernel_preamble(const char *name, uint8_t *buf, uint32_t len,
 
 	if (VB2_SUCCESS != vb2_verify_kernel_preamble(pre2, len - more,
 						      &data_key, &wb)) {
-		printf("%s is invalid\n", name);
+		show_error("%s is invalid", name);
 		return 1;
 	}
 
+	uint64_t vmlinuz_header_address = 0;
+	uint32_t vmlinuz_header_size = 0;
+	vb2_kernel_get_vmlinuz_header(pre2,
+				      &vmlinuz_header_address,
+				      &vmlinuz_header_size);
+
+	if (show_option.json) {
+		json_begin("preamble");
+		json_int("size", pre2->preamble_size);
+		json_int("header_version_major", pre2->header_version_major);
+		json_int("header_version_minor", pre2->header_version_minor);
+		json_int("kernel_version", pre2->kernel_version);
+		json_int("body_load_address", pre2->body_load_address);
+		json_int("body_size", pre2->body_signature.data_size);
+		json_int("bootloader_address", pre2->bootloader_address);
+		json_int("bootloader_size", pre2->bootloader_size);
+		if (vmlinuz_header_size) {
+			json_int("vmlinuz_header_address",
+				 vmlinuz_header_address);
+			json_int("vmlinuz_header_size", vmlinuz_header_size);
+		}
+		json_int("flags", vb2_kernel_get_flags(pre2));
+		json_end();
+		goto verify_body;
+	}
+
 	printf("Kernel Preamble:\n");
 	printf("  Size:                  0x%x\n", pre2->preamble_size);
 	printf("  Header version:        %u.%u\n",
@@ -334,11 +477,6 @@ int ft_show_kernel_preamble(const char *name, uint8_t *buf, uint32_t len,
 	       pre2->bootloader_address);
 	printf("  Bootloader size:       0x%x\n", pre2->bootloader_size);
 
-	uint64_t vmlinuz_header_address = 0;
-	uint32_t vmlinuz_header_size = 0;
-	vb2_kernel_get_vmlinuz_header(pre2,
-				      &vmlinuz_header_address,
-				      &vmlinuz_header_size);
 	if (vmlinuz_header_size) {
 		printf("  Vmlinuz_header address:    0x%" PRIx64 "\n",
 		       vmlinuz_header_address);
@@ -348,9 +486,8 @@ int ft_show_kernel_preamble(const char *name, uint8_t *buf, uint32_t len,
 
 	printf("  Flags:                 0x%x\n", vb2_kernel_get_flags(pre2));
 
+verify_body:
 	/* Verify kernel body */
-	uint8_t *kernel_blob = 0;
-	uint64_t kernel_size = 0;
 	if (show_option.fv) {
 		/* It's in a separate file, which we've already read in */
 		kernel_blob = show_option.fv;
@@ -364,6 +501,7 @@ int ft_show_kernel_preamble(const char *name, uint8_t *buf, uint32_t len,
 	if (!kernel_blob) {
 		/* TODO: Is this always a failure? The preamble is okay. */
 		fprintf(stderr, "No kernel blob available to verify.\n");
+		json_body_signature("missing");
 		return 1;
 	}
 
@@ -371,9 +509,17 @@ int ft_show_kernel_preamble(const char *name, uint8_t *buf, uint32_t len,
 	    vb2_verify_data(kernel_blob, kernel_size, &pre2->body_signature,
 			    &data_key, &wb)) {
 		fprintf(stderr, "Error verifying kernel body.\n");
+		json_body_signature("invalid");
 		return 1;
 	}
 
+	if (show_option.json) {
+		json_body_signature("valid");
+		json_string("config", (char *)kernel_blob +
+			    kernel_cmd_line_offset(pre2));
+		return retval;
+	}
+
 	printf("Body verification succeeded.\n");
 
 	printf("Config:\n%s\n", kernel_blob + kernel_cmd_line_offset(pre2));
@@ -412,6 +558,12 @@ static const char usage[] = "\n"
 	"  --pad            NUM             Kernel vblock padding size\n"
 	"  --strict                         "
 	"Fail unless all signatures are valid\n"
+	"  -j|--jobs        NUM             "
+	"Show up to NUM files at once (0 for one per CPU)\n"
+	"  --json                           "
+	"Print a JSON object with each file's details\n"
+	"                                     (keys, keyblocks, preambles,\n"
+	"                                     GBB and BIOS images)\n"
 	"\n";
 
 static void print_help(int argc, char *argv[])
@@ -433,10 +585,12 @@ static const struct option long_opts[] = {
 	{"type",        1, NULL, OPT_TYPE},
 	{"strict",      0, &show_option.strict, 1},
 	{"pubkey",      1, NULL, OPT_PUBKEY},
+	{"jobs",        1, NULL, 'j'},
+	{"json",        0, &show_option.json, 1},
 	{"help",        0, NULL, OPT_HELP},
 	{NULL, 0, NULL, 0},
 };
-static char *short_opts = ":f:k:t";
+static char *short_opts = ":f:j:k:t";
 
 
 static int show_type(char *filename)
@@ -468,18 +622,204 @@ static int show_type(char *filename)
 	return 1;
 }
 
+/* File types which can be shown as JSON */
+static int json_supported(enum futil_file_type type)
+{
+	switch (type) {
+	case FILE_TYPE_BIOS_IMAGE:
+	case FILE_TYPE_OLD_BIOS_IMAGE:
+	case FILE_TYPE_GBB:
+	case FILE_TYPE_FW_PREAMBLE:
+	case FILE_TYPE_KERN_PREAMBLE:
+	case FILE_TYPE_KEYBLOCK:
+	case FILE_TYPE_PUBKEY:
+	case FILE_TYPE_PRIVKEY:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/*
+ * Show one file.  Returns the number of errors.
+ *
+ * In JSON mode this prints one member of the object do_show() prints, named
+ * for the file.  Other types just have their type shown.
+ */
+static int show_file(const char *infile, int type_override)
+{
+	enum futil_file_type type;
+	int errorcnt = 0;
+	uint8_t *buf;
+	uint32_t len;
+	int ifd;
+
+	if (show_option.json) {
+		json_reset(1);
+		json_begin(infile);
+	}
+
+	ifd = open(infile, O_RDONLY);
+	if (ifd < 0) {
+		const char *err = strerror(errno);
+
+		fprintf(stderr, "Can't open %s: %s\n", infile, err);
+		if (show_option.json) {
+			json_string("error", err);
+			json_end();
+		}
+		return 1;
+	}
+
+	if (0 != futil_map_file(ifd, MAP_RO, &buf, &len)) {
+		errorcnt++;
+		goto boo;
+	}
+
+	/* Allow the user to override the type */
+	if (type_override)
+		type = show_option.type;
+	else
+		type = futil_file_type_buf(buf, len);
+
+	if (!show_option.json) {
+		errorcnt += futil_file_type_show(type, infile, buf, len);
+	} else {
+		json_string("type", futil_file_type_name(type));
+		if (json_supported(type))
+			errorcnt += futil_file_type_show(type, infile,
+							 buf, len);
+	}
+
+	errorcnt += futil_unmap_file(ifd, MAP_RO, buf, len);
+boo:
+	if (close(ifd)) {
+		errorcnt++;
+		fprintf(stderr, "Error when closing %s: %s\n",
+			infile, strerror(errno));
+	}
+	if (show_option.json)
+		json_end();
+	return errorcnt;
+}
+
+/* A file being shown by a child process, which saves its output for later */
+struct show_job_s {
+	pid_t pid;
+	FILE *out;
+	FILE *err;
+};
+
+static void copy_output(FILE *from, FILE *to)
+{
+	char buf[4096];
+	size_t n;
+
+	rewind(from);
+	while ((n = fread(buf, 1, sizeof(buf), from)) > 0)
+		fwrite(buf, 1, n, to);
+	fclose(from);
+}
+
+static void start_show_job(struct show_job_s *job, const char *infile,
+			   int type_override)
+{
+	int errorcnt;
+
+	fflush(stdout);
+	fflush(stderr);
+	job->pid = -1;
+	job->out = tmpfile();
+	job->err = tmpfile();
+	if (job->out && job->err)
+		job->pid = fork();
+
+	if (job->pid == 0) {
+		dup2(fileno(job->out), STDOUT_FILENO);
+		dup2(fileno(job->err), STDERR_FILENO);
+		errorcnt = show_file(infile, type_override);
+		fflush(stdout);
+		fflush(stderr);
+		_exit(errorcnt < 255 ? errorcnt : 255);
+	}
+}
+
+/*
+ * Wait for a job, then print what it printed.  Returns the number of errors;
+ * if the job couldn't be started the file is shown here instead.
+ */
+static int finish_show_job(struct show_job_s *job, const char *infile,
+			   int type_override)
+{
+	int status;
+
+	if (job->pid < 0) {
+		if (job->out)
+			fclose(job->out);
+		if (job->err)
+			fclose(job->err);
+		return show_file(infile, type_override);
+	}
+
+	if (waitpid(job->pid, &status, 0) != job->pid)
+		status = -1;
+	fflush(stdout);
+	copy_output(job->out, stdout);
+	fflush(stdout);
+	copy_output(job->err, stderr);
+
+	if (!WIFEXITED(status)) {
+		fprintf(stderr, "Showing %s failed\n", infile);
+		return 1;
+	}
+	return WEXITSTATUS(status);
+}
+
+/*
+ * Show the files using up to jobs child processes.  The output of each file
+ * is held until the ones before it are done, so it comes out in order.
+ */
+static int show_files(char *files[], int count, int jobs, int type_override)
+{
+	struct show_job_s *job;
+	int errorcnt = 0;
+	int i;
+
+	job = calloc(count, sizeof(*job));
+	if (!job) {
+		for (i = 0; i < count; i++) {
+			if (show_option.json && i)
+				printf(",");
+			errorcnt += show_file(files[i], type_override);
+		}
+		return errorcnt;
+	}
+
+	for (i = 0; i < count && i < jobs; i++)
+		start_show_job(&job[i], files[i], type_override);
+	for (i = 0; i < count; i++) {
+		if (show_option.json && i)
+			printf(",");
+		errorcnt += finish_show_job(&job[i], files[i], type_override);
+		if (i + jobs < count)
+			start_show_job(&job[i + jobs], files[i + jobs],
+				       type_override);
+	}
+
+	free(job);
+	return errorcnt;
+}
+
 static int do_show(int argc, char *argv[])
 {
 	uint8_t *pubkbuf = NULL;
 	struct vb2_public_key pubk2;
-	char *infile = 0;
-	int ifd, i;
+	int i;
 	int errorcnt = 0;
-	uint8_t *buf;
 	uint32_t len;
 	char *e = 0;
 	int type_override = 0;
-	enum futil_file_type type;
+	int jobs = 1;
 
 	vb2_workbuf_init(&wb, workbuf, sizeof(workbuf));
 
@@ -512,6 +852,16 @@ static int do_show(int argc, char *argv[])
 
 			show_option.k = &pubk2;
 			break;
+		case 'j':
+			jobs = strtoul(optarg, &e, 0);
+			if (!*optarg || (e && *e)) {
+				fprintf(stderr,
+					"Invalid --jobs \"%s\"\n", optarg);
+				errorcnt++;
+			}
+			if (!jobs)
+				jobs = sysconf(_SC_NPROCESSORS_ONLN);
+			break;
 		case 't':
 			show_option.t_flag = 1;
 			break;
@@ -580,37 +930,19 @@ static int do_show(int argc, char *argv[])
 		goto done;
 	}
 
-	for (i = optind; i < argc; i++) {
-		infile = argv[i];
-		ifd = open(infile, O_RDONLY);
-		if (ifd < 0) {
-			errorcnt++;
-			fprintf(stderr, "Can't open %s: %s\n",
-				infile, strerror(errno));
-			continue;
-		}
-
-		if (0 != futil_map_file(ifd, MAP_RO, &buf, &len)) {
-			errorcnt++;
-			goto boo;
-		}
-
-		/* Allow the user to override the type */
-		if (type_override)
-			type = show_option.type;
-		else
-			type = futil_file_type_buf(buf, len);
-
-		errorcnt += futil_file_type_show(type, infile, buf, len);
-
-		errorcnt += futil_unmap_file(ifd, MAP_RO, buf, len);
-boo:
-		if (close(ifd)) {
-			errorcnt++;
-			fprintf(stderr, "Error when closing %s: %s\n",
-				infile, strerror(errno));
+	if (show_option.json)
+		printf("{");
+	if (jobs > 1)
+		errorcnt += show_files(argv + optind, argc - optind, jobs,
+				       type_override);
+	else
+		for (i = optind; i < argc; i++) {
+			if (show_option.json && i > optind)
+				printf(",");
+			errorcnt += show_file(argv[i], type_override);
 		}
-	}
+	if (show_option.json)
+		printf("\n}\n");
 
 done:
 	if (pubkbuf)
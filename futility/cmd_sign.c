@@ -663,21 +663,23 @@ static int do_sign(int argc, char *argv[])
 				&longindex)) != -1) {
 		switch (i) {
 		case 's':
-			sign_option.signprivate = vb2_read_private_key(optarg);
+			sign_option.signprivate =
+				futil_read_private_key(optarg);
 			if (!sign_option.signprivate) {
 				fprintf(stderr, "Error reading %s\n", optarg);
 				errorcnt++;
 			}
 			break;
 		case 'b':
-			sign_option.keyblock = vb2_read_keyblock(optarg);
+			sign_option.keyblock = futil_read_keyblock(optarg);
 			if (!sign_option.keyblock) {
 				fprintf(stderr, "Error reading %s\n", optarg);
 				errorcnt++;
 			}
 			break;
 		case 'k':
-			sign_option.kernel_subkey = vb2_read_packed_key(optarg);
+			sign_option.kernel_subkey =
+				futil_read_packed_key(optarg);
 			if (!sign_option.kernel_subkey) {
 				fprintf(stderr, "Error reading %s\n", optarg);
 				errorcnt++;
@@ -685,14 +687,14 @@ static int do_sign(int argc, char *argv[])
 			break;
 		case 'S':
 			sign_option.devsignprivate =
-				vb2_read_private_key(optarg);
+				futil_read_private_key(optarg);
 			if (!sign_option.devsignprivate) {
 				fprintf(stderr, "Error reading %s\n", optarg);
 				errorcnt++;
 			}
 			break;
 		case 'B':
-			sign_option.devkeyblock = vb2_read_keyblock(optarg);
+			sign_option.devkeyblock = futil_read_keyblock(optarg);
 			if (!sign_option.devkeyblock) {
 				fprintf(stderr, "Error reading %s\n", optarg);
 				errorcnt++;
@@ -1055,8 +1057,7 @@ done:
 			strerror(errno));
 	}
 
-	if (sign_option.signprivate)
-		free(sign_option.signprivate);
+	futil_free_private_key(sign_option.signprivate);
 	if (sign_option.keyblock)
 		free(sign_option.keyblock);
 	if (sign_option.kernel_subkey)
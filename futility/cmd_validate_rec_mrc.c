@@ -49,41 +49,47 @@ struct mrc_metadata {
 #define REGF_METADATA_BLOCK_SIZE	REGF_BLOCK_GRANULARITY
 #define REGF_UNALLOCATED_BLOCK		0xffff
 
+/*
+ * Compute an IP-style checksum, as coreboot does for the MRC cache.
+ *
+ * One's complement addition doesn't care about the order of the words, and
+ * carries out of bit 15 just wrap around to bit 0.  So this adds the data in
+ * 32-bit native-endian words into a 64-bit sum and folds the carries back in
+ * at the end.  That gives the same result as adding 16-bit words one at a
+ * time, in the same byte order.
+ */
 unsigned long compute_ip_checksum(const void *addr, unsigned long length)
 {
-	const uint8_t *ptr;
-	volatile union {
-		uint8_t  byte[2];
-		uint16_t word;
-	} value;
-	unsigned long sum;
-	unsigned long i;
-	/* In the most straight forward way possible,
-	 * compute an ip style checksum.
-	 */
-	sum = 0;
-	ptr = addr;
-	for(i = 0; i < length; i++) {
-		unsigned long v;
-		v = ptr[i];
-		if (i & 1) {
-			v <<= 8;
-		}
-		/* Add the new value */
-		sum += v;
-		/* Wrap around the carry */
-		if (sum > 0xFFFF) {
-			sum = (sum + (sum >> 16)) & 0xFFFF;
-		}
+	const uint8_t *ptr = addr;
+	uint64_t sum = 0;
+	uint32_t word;
+
+	/* This can't overflow unless length is over 2^34 bytes */
+	while (length >= sizeof(word)) {
+		memcpy(&word, ptr, sizeof(word));
+		sum += word;
+		ptr += sizeof(word);
+		length -= sizeof(word);
 	}
-	value.byte[0] = sum & 0xff;
-	value.byte[1] = (sum >> 8) & 0xff;
-	return (~value.word) & 0xFFFF;
+
+	/* An odd byte at the end is padded with zero */
+	if (length) {
+		word = 0;
+		memcpy(&word, ptr, length);
+		sum += word;
+	}
+
+	sum = (sum & 0xffffffff) + (sum >> 32);
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+	return ~sum & 0xffff;
 }
 
-static int verify_mrc_slot(struct mrc_metadata *md, unsigned long slot_len)
+static int verify_mrc_slot(const struct mrc_metadata *md,
+			   unsigned long slot_len)
 {
-	uint32_t header_checksum;
+	struct mrc_metadata header;
 
 	if (slot_len < sizeof(*md)) {
 		fprintf(stderr, "Slot too small!\n");
@@ -102,16 +108,16 @@ static int verify_mrc_slot(struct mrc_metadata *md, unsigned long slot_len)
 		return 1;
 	}
 
-	header_checksum = md->header_checksum;
-	md->header_checksum = 0;
+	/* The header checksum is computed with the checksum field zero */
+	memcpy(&header, md, sizeof(header));
+	header.header_checksum = 0;
 
-	if (header_checksum != compute_ip_checksum(md, sizeof(*md))) {
+	if (md->header_checksum !=
+	    compute_ip_checksum(&header, sizeof(header))) {
 		fprintf(stderr, "MRC metadata header checksum mismatch\n");
 		return 1;
 	}
 
-	md->header_checksum = header_checksum;
-
 	fprintf(stderr, "MRC metadata header checksum.. verified!\n");
 
 	if (md->data_checksum != compute_ip_checksum(&md[1], md->data_size)) {
@@ -128,50 +134,77 @@ static int block_offset_unallocated(uint16_t offset)
 	return offset == REGF_UNALLOCATED_BLOCK;
 }
 
-static uint8_t *get_next_mb(uint8_t *curr_mb)
-{
-	return curr_mb + REGF_METADATA_BLOCK_SIZE;
-}
-
-static int get_mrc_data_slot(uint16_t *mb, uint32_t *data_offset,
-			     uint32_t *data_size)
+/*
+ * Validate all the slots in the MRC cache, in one pass over the block offsets
+ * in its metadata blocks.
+ *
+ * The first block offset tells the number of metadata blocks, which is where
+ * the first slot starts.  Each one after that is where a slot ends and the
+ * next one starts, up to the first unallocated one.  RECOVERY_MRC_CACHE is
+ * expected to contain only one slot, but all of them are checked and
+ * reported.  Returns 0 if there's exactly one slot and it's valid.
+ */
+static int validate_mrc_slots(const uint8_t *cache, uint32_t cache_size)
 {
-	uint16_t num_metadata_blocks = *mb;
-
-	if (block_offset_unallocated(*mb)) {
+	const uint16_t *mb = (const uint16_t *)cache;
+	uint32_t num_offsets, slot_offset, slot_size, i;
+	uint16_t start, end;
+	int slots = 0;
+	int errors = 0;
+
+	if (cache_size < REGF_METADATA_BLOCK_SIZE ||
+	    block_offset_unallocated(mb[0])) {
 		fprintf(stderr, "MRC cache is empty!!\n");
 		return 1;
 	}
 
-	/*
-	 * First block offset in metadata block tells the total number of
-	 * metadata blocks.
-	 * Currently, we expect only 1 metadata block to be used.
-	 */
-	if (num_metadata_blocks != 1) {
-		uint16_t *next_mb = (uint16_t *)get_next_mb((uint8_t *)mb);
-		if (!block_offset_unallocated(*next_mb)) {
-			fprintf(stderr, "More than 1 valid metadata block!!");
-			return 1;
+	start = mb[0];
+	if (!start || (uint32_t)start << REGF_BLOCK_SHIFT > cache_size) {
+		fprintf(stderr, "Bad number of metadata blocks: %d\n", start);
+		return 1;
+	}
+	num_offsets = ((uint32_t)start << REGF_BLOCK_SHIFT) / sizeof(*mb);
+
+	for (i = 1; i < num_offsets && !block_offset_unallocated(mb[i]);
+	     i++, start = end) {
+		end = mb[i];
+		if (end <= start) {
+			fprintf(stderr, "Slot %d ends before it starts\n",
+				slots);
+			errors++;
+			break;
+		}
+
+		slot_offset = (uint32_t)start << REGF_BLOCK_SHIFT;
+		slot_size = (uint32_t)(end - start) << REGF_BLOCK_SHIFT;
+		fprintf(stderr, "Slot %d: offset=0x%x, size=0x%x\n",
+			slots, slot_offset, slot_size);
+		slots++;
+
+		if (slot_offset > cache_size ||
+		    cache_size - slot_offset < slot_size) {
+			fprintf(stderr, "Offset or data size greater than "
+				"cache size: offset=0x%x, cache size=0x%x, "
+				"data_size=0x%x\n",
+				slot_offset, cache_size, slot_size);
+			errors++;
+			continue;
 		}
+
+		errors += verify_mrc_slot((const struct mrc_metadata *)
+					  (cache + slot_offset), slot_size);
 	}
 
-	/*
-	 * RECOVERY_MRC_CACHE is expected to contain only one slot. Thus, there
-	 * should be only one block offset present, indicating size of the MRC
-	 * cache slot.
-	 */
-	mb++;
-	*data_offset = (1 << REGF_BLOCK_SHIFT) * num_metadata_blocks;
-	*data_size = (*mb - num_metadata_blocks) << REGF_BLOCK_SHIFT;
-
-	mb++;
-	if (!block_offset_unallocated(*mb)) {
-		fprintf(stderr, "More than 1 slot in recovery mrc cache.\n");
+	if (!slots) {
+		fprintf(stderr, "MRC cache is empty!!\n");
 		return 1;
 	}
+	if (slots > 1) {
+		fprintf(stderr, "More than 1 slot in recovery mrc cache.\n");
+		errors++;
+	}
 
-	return 0;
+	return !!errors;
 }
 
 static int do_validate_rec_mrc(int argc, char *argv[])
@@ -182,8 +215,6 @@ static int do_validate_rec_mrc(int argc, char *argv[])
 	uint32_t file_size;
 	uint8_t *buff;
 	uint32_t offset = 0;
-	uint32_t data_offset;
-	uint32_t data_size;
 	char *e;
 
 	while (((i = getopt_long(argc, argv, ":", long_opts, NULL)) != -1) &&
@@ -243,22 +274,7 @@ static int do_validate_rec_mrc(int argc, char *argv[])
 		return 1;
 	}
 
-	if (get_mrc_data_slot((uint16_t *)(buff + offset), &data_offset,
-			      &data_size)) {
-		fprintf(stderr, "Metadata block error\n");
-		futil_unmap_file(fd, MAP_RO, buff, file_size);
-		close(fd);
-		return 1;
-	}
-	offset += data_offset;
-
-	if ((file_size > offset) && ((file_size - offset) >= data_size))
-		ret = verify_mrc_slot((struct mrc_metadata *)(buff + offset),
-				      data_size);
-	else
-		fprintf(stderr, "Offset or data size greater than file size: "
-			"offset=0x%x, file size=0x%x, data_size=0x%x\n",
-			offset, file_size, data_size);
+	ret = validate_mrc_slots(buff + offset, file_size - offset);
 
 	if (futil_unmap_file(fd, MAP_RO, buff, file_size) != FILE_ERR_NONE) {
 		fprintf(stderr, "Failed to unmap file %s\n", infile);
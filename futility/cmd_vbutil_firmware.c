@@ -110,19 +110,19 @@ static int do_vblock(const char *outfile, const char *keyblock_file,
 	}
 
 	/* Read the key block and keys */
-	keyblock = vb2_read_keyblock(keyblock_file);
+	keyblock = futil_read_keyblock(keyblock_file);
 	if (!keyblock) {
 		VbExError("Error reading key block.\n");
 		goto vblock_cleanup;
 	}
 
-	signing_key = vb2_read_private_key(signprivate);
+	signing_key = futil_read_private_key(signprivate);
 	if (!signing_key) {
 		VbExError("Error reading signing key.\n");
 		goto vblock_cleanup;
 	}
 
-	kernel_subkey = vb2_read_packed_key(kernelkey_file);
+	kernel_subkey = futil_read_packed_key(kernelkey_file);
 	if (!kernel_subkey) {
 		VbExError("Error reading kernel subkey.\n");
 		goto vblock_cleanup;
@@ -171,8 +171,7 @@ static int do_vblock(const char *outfile, const char *keyblock_file,
 vblock_cleanup:
 	if (keyblock)
 		free(keyblock);
-	if (signing_key)
-		free(signing_key);
+	futil_free_private_key(signing_key);
 	if (kernel_subkey)
 		free(kernel_subkey);
 	if (fv_data)
@@ -10,13 +10,9 @@
 #include <fcntl.h>
 #include <getopt.h>
 #include <inttypes.h>		/* For PRIu64 */
-#ifndef HAVE_MACOS
-#include <linux/fs.h>		/* For BLKGETSIZE64 */
-#endif
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
-#include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -159,64 +155,118 @@ static void print_help(int argc, char *argv[])
 }
 
 
-/* Return an explanation when fread() fails. */
-static const char *error_fread(FILE *fp)
-{
-	const char *retval = "beats me why";
-	if (feof(fp))
-		retval = "EOF";
-	else if (ferror(fp))
-		retval = strerror(errno);
-	clearerr(fp);
-	return retval;
-}
-
-
-/* This reads a complete kernel partition into a buffer */
+/*
+ * This maps a complete kernel partition into memory.  The mapping is private,
+ * so changes to it (such as a new config) aren't written back to the file,
+ * and only the pages which are changed get copied.
+ */
 static uint8_t *ReadOldKPartFromFileOrDie(const char *filename,
 					 uint32_t *size_ptr)
 {
-	FILE *fp = NULL;
-	struct stat statbuf;
 	uint8_t *buf;
 	uint32_t file_size = 0;
-
-	if (0 != stat(filename, &statbuf))
-		Fatal("Unable to stat %s: %s\n", filename, strerror(errno));
-
-	if (S_ISBLK(statbuf.st_mode)) {
-#ifndef HAVE_MACOS
-		int fd = open(filename, O_RDONLY);
-		if (fd >= 0) {
-			ioctl(fd, BLKGETSIZE64, &file_size);
-			close(fd);
-		}
-#endif
-	} else {
-		file_size = statbuf.st_size;
-	}
-	Debug("%s size is 0x%x\n", filename, file_size);
-	if (file_size < opt_pad)
-		Fatal("%s is too small to be a valid kernel blob\n", filename);
+	int fd;
 
 	Debug("Reading %s\n", filename);
-	fp = fopen(filename, "rb");
-	if (!fp)
+	fd = open(filename, O_RDONLY);
+	if (fd < 0)
 		Fatal("Unable to open file %s: %s\n", filename,
 		      strerror(errno));
 
-	buf = malloc(file_size);
-	if (1 != fread(buf, file_size, 1, fp))
-		Fatal("Unable to read entirety of %s: %s\n", filename,
-		      error_fread(fp));
+	if (FILE_ERR_NONE != futil_map_file(fd, MAP_RO, &buf, &file_size))
+		Fatal("Unable to map %s\n", filename);
+	close(fd);
+
+	Debug("%s size is 0x%x\n", filename, file_size);
+	if (file_size < opt_pad)
+		Fatal("%s is too small to be a valid kernel blob\n", filename);
 
 	if (size_ptr)
 		*size_ptr = file_size;
 
-	fclose(fp);
 	return buf;
 }
 
+/* Return non-zero if both names refer to the same file or device. */
+static int IsSameFile(const char *name1, const char *name2)
+{
+	struct stat sb1, sb2;
+
+	if (0 != stat(name1, &sb1) || 0 != stat(name2, &sb2))
+		return 0;
+	return sb1.st_dev == sb2.st_dev && sb1.st_ino == sb2.st_ino;
+}
+
+static int WriteAt(int fd, const uint8_t *data, uint32_t size, off_t offset)
+{
+	if (size != pwrite(fd, data, size, offset)) {
+		fprintf(stderr, "Unable to write at 0x%llx: %s\n",
+			(unsigned long long)offset, strerror(errno));
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * Write a repacked kernel partition back over the one it was read from.
+ *
+ * A repack only changes the vblock and the config, so if the new vblock is
+ * the size of the old one, the blob doesn't move and only those two regions
+ * are written.  config_data points at the config in the blob, or is NULL if
+ * it didn't change.  If the blob has to move, it's copied out of the old
+ * partition first, since that is about to be overwritten.
+ */
+static int WriteKPartInPlace(const char *filename,
+			     uint8_t *kpart_data,
+			     uint8_t *kblob_data, uint32_t kblob_size,
+			     uint8_t *vblock_data, uint32_t vblock_size,
+			     uint8_t *config_data)
+{
+	uint32_t kblob_offset = kblob_data - kpart_data;
+	struct stat sb;
+	uint8_t *copy;
+	int fd, rv;
+
+	if (vblock_size != kblob_offset) {
+		copy = malloc(kblob_size);
+		if (!copy)
+			Fatal("Unable to allocate 0x%x bytes\n", kblob_size);
+		memcpy(copy, kblob_data, kblob_size);
+		rv = WriteSomeParts(filename, vblock_data, vblock_size,
+				    copy, kblob_size);
+		free(copy);
+		return rv;
+	}
+
+	Debug("Updating %s in place\n", filename);
+	fd = open(filename, O_WRONLY);
+	if (fd < 0) {
+		fprintf(stderr, "Unable to open %s for writing: %s\n",
+			filename, strerror(errno));
+		return 1;
+	}
+
+	rv = WriteAt(fd, vblock_data, vblock_size, 0);
+	if (!rv && config_data)
+		rv = WriteAt(fd, config_data, CROS_CONFIG_SIZE,
+			     config_data - kpart_data);
+
+	/* Rewriting a file would have dropped anything after the blob */
+	if (!rv && 0 == fstat(fd, &sb) && S_ISREG(sb.st_mode) &&
+	    0 != ftruncate(fd, kblob_offset + kblob_size)) {
+		fprintf(stderr, "Unable to truncate %s: %s\n",
+			filename, strerror(errno));
+		rv = 1;
+	}
+
+	if (0 != close(fd)) {
+		fprintf(stderr, "Unable to close %s: %s\n",
+			filename, strerror(errno));
+		rv = 1;
+	}
+	return rv;
+}
+
 /****************************************************************************/
 
 static int do_vbutil_kernel(int argc, char *argv[])
@@ -408,7 +458,7 @@ static int do_vbutil_kernel(int argc, char *argv[])
 		if (!signprivkey_file)
 			Fatal("Missing required signprivate file.\n");
 
-		signpriv_key = vb2_read_private_key(signprivkey_file);
+		signpriv_key = futil_read_private_key(signprivkey_file);
 		if (!signpriv_key)
 			Fatal("Error reading signing key.\n");
 
@@ -477,7 +527,7 @@ static int do_vbutil_kernel(int argc, char *argv[])
 		free(t_config_data);
 		free(t_bootloader_data);
 		free(vblock_data);
-		vb2_free_private_key(signpriv_key);
+		futil_free_private_key(signpriv_key);
 		return rv;
 
 	case OPT_MODE_REPACK:
@@ -487,7 +537,7 @@ static int do_vbutil_kernel(int argc, char *argv[])
 		if (!signprivkey_file)
 			Fatal("Missing required signprivate file.\n");
 
-		signpriv_key = vb2_read_private_key(signprivkey_file);
+		signpriv_key = futil_read_private_key(signprivkey_file);
 		if (!signpriv_key)
 			Fatal("Error reading signing key.\n");
 
@@ -549,6 +599,13 @@ static int do_vbutil_kernel(int argc, char *argv[])
 			rv = WriteSomeParts(filename,
 					    vblock_data, vblock_size,
 					    NULL, 0);
+		else if (IsSameFile(filename, oldfile))
+			rv = WriteKPartInPlace(filename, kpart_data,
+					       kblob_data, kblob_size,
+					       vblock_data, vblock_size,
+					       config_file ? kblob_data +
+					       kernel_cmd_line_offset(preamble)
+					       : NULL);
 		else
 			rv = WriteSomeParts(filename,
 					    vblock_data, vblock_size,
@@ -560,7 +617,7 @@ static int do_vbutil_kernel(int argc, char *argv[])
 		/* Optional */
 
 		if (signpubkey_file) {
-			signpub_key = vb2_read_packed_key(signpubkey_file);
+			signpub_key = futil_read_packed_key(signpubkey_file);
 			if (!signpub_key)
 				Fatal("Error reading public key.\n");
 		}
@@ -103,7 +103,7 @@ static int Pack(const char *outfile, const char *datapubkey,
 		return 1;
 	}
 
-	struct vb2_packed_key *data_key = vb2_read_packed_key(datapubkey);
+	struct vb2_packed_key *data_key = futil_read_packed_key(datapubkey);
 	if (!data_key) {
 		fprintf(stderr, "vbutil_keyblock: Error reading data key.\n");
 		return 1;
@@ -137,7 +137,7 @@ static int Pack(const char *outfile, const char *datapubkey,
 		}
 	} else {
 		if (signprivate) {
-			signing_key = vb2_read_private_key(signprivate);
+			signing_key = futil_read_private_key(signprivate);
 			if (!signing_key) {
 				fprintf(stderr, "vbutil_keyblock:"
 					" Error reading signing key.\n");
@@ -148,8 +148,7 @@ static int Pack(const char *outfile, const char *datapubkey,
 	}
 
 	free(data_key);
-	if (signing_key)
-		free(signing_key);
+	futil_free_private_key(signing_key);
 
 	if (VB2_SUCCESS != vb2_write_keyblock(outfile, block)) {
 		fprintf(stderr, "vbutil_keyblock: Error writing key block.\n");
@@ -189,7 +188,7 @@ static int Unpack(const char *infile, const char *datapubkey,
 
 		vb2_workbuf_init(&wb, workbuf, sizeof(workbuf));
 
-		sign_key = vb2_read_packed_key(signpubkey);
+		sign_key = futil_read_packed_key(signpubkey);
 		if (!sign_key) {
 			fprintf(stderr,
 				"vbutil_keyblock: Error reading signpubkey.\n");
@@ -28,13 +28,29 @@
 
 typedef ssize_t (*ReadFullyFn)(void *ctx, void *buf, size_t count);
 
+/* Skip count bytes of the stream.  Return 0 on success. */
+typedef int (*SkipFn)(void *ctx, ReadFullyFn read_fn, size_t count);
+
+/* A file or device, read with pread() if it can seek */
+struct FdStream {
+	int fd;
+	int seekable;
+	off_t offset;		/* Of the next read, if seekable */
+	off_t size;		/* Skips can't go past this, if seekable */
+};
+
 static ssize_t ReadFullyWithRead(void *ctx, void *buf, size_t count)
 {
+	struct FdStream *stream = ctx;
 	ssize_t nr_read = 0;
-	int fd = *((int*)ctx);
 	while (nr_read < count) {
 		ssize_t to_read = count - nr_read;
-		ssize_t chunk = read(fd, buf + nr_read, to_read);
+		ssize_t chunk;
+		if (stream->seekable)
+			chunk = pread(stream->fd, buf + nr_read, to_read,
+				      stream->offset + nr_read);
+		else
+			chunk = read(stream->fd, buf + nr_read, to_read);
 		if (chunk < 0) {
 			return -1;
 		} else if (chunk == 0) {
@@ -42,6 +58,7 @@ static ssize_t ReadFullyWithRead(void *ctx, void *buf, size_t count)
 		}
 		nr_read += chunk;
 	}
+	stream->offset += nr_read;
 	return nr_read;
 }
 
@@ -71,7 +88,21 @@ static int SkipWithRead(void *ctx, ReadFullyFn read_fn, size_t count)
 	return 0;
 }
 
+/* Skip a file or device by moving the offset, if it can seek. */
+static int SkipWithSeek(void *ctx, ReadFullyFn read_fn, size_t count)
+{
+	struct FdStream *stream = ctx;
+
+	if (!stream->seekable)
+		return SkipWithRead(ctx, read_fn, count);
+	if (count > stream->size - stream->offset)
+		return -1;
+	stream->offset += count;
+	return 0;
+}
+
 static char *FindKernelConfigFromStream(void *ctx, ReadFullyFn read_fn,
+					SkipFn skip_fn,
 					uint64_t kernel_body_load_address)
 {
 	struct vb2_keyblock keyblock;
@@ -85,7 +116,7 @@ static char *FindKernelConfigFromStream(void *ctx, ReadFullyFn read_fn,
 		return NULL;
 	}
 	ssize_t to_skip = keyblock.keyblock_size - sizeof(keyblock);
-	if (to_skip < 0 || SkipWithRead(ctx, read_fn, to_skip)) {
+	if (to_skip < 0 || skip_fn(ctx, read_fn, to_skip)) {
 		VbExError("keyblock_size advances past the end of the blob\n");
 		return NULL;
 	}
@@ -97,7 +128,7 @@ static char *FindKernelConfigFromStream(void *ctx, ReadFullyFn read_fn,
 		return NULL;
 	}
 	to_skip = preamble.preamble_size - sizeof(preamble);
-	if (to_skip < 0 || SkipWithRead(ctx, read_fn, to_skip)) {
+	if (to_skip < 0 || skip_fn(ctx, read_fn, to_skip)) {
 		VbExError("preamble_size advances past the end of the blob\n");
 		return NULL;
 	}
@@ -115,7 +146,7 @@ static char *FindKernelConfigFromStream(void *ctx, ReadFullyFn read_fn,
 	    (kernel_body_load_address + CROS_PARAMS_SIZE +
 	     CROS_CONFIG_SIZE) + now;
 	to_skip = offset - now;
-	if (to_skip < 0 || SkipWithRead(ctx, read_fn, to_skip)) {
+	if (to_skip < 0 || skip_fn(ctx, read_fn, to_skip)) {
 		VbExError("params are outside of the memory blob: %x\n",
 			  offset);
 		return NULL;
@@ -143,8 +174,14 @@ char *FindKernelConfig(const char *infile, uint64_t kernel_body_load_address)
 		return NULL;
 	}
 
-	void *ctx = &fd;
+	/* Pipes can't seek, so they're skipped by reading */
+	struct FdStream stream = { .fd = fd };
+	stream.size = lseek(fd, 0, SEEK_END);
+	stream.seekable = stream.size >= 0 && lseek(fd, 0, SEEK_SET) == 0;
+
+	void *ctx = &stream;
 	ReadFullyFn read_fn = ReadFullyWithRead;
+	SkipFn skip_fn = SkipWithSeek;
 
 #ifdef USE_MTD
 	struct stat stat_buf;
@@ -161,10 +198,11 @@ char *FindKernelConfig(const char *infile, uint64_t kernel_body_load_address)
 			return NULL;
 		}
 		read_fn = ReadFullyWithMtdRead;
+		skip_fn = SkipWithRead;
 	}
 #endif
 
-	newstr = FindKernelConfigFromStream(ctx, read_fn,
+	newstr = FindKernelConfigFromStream(ctx, read_fn, skip_fn,
 					    kernel_body_load_address);
 
 #ifdef USE_MTD
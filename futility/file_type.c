@@ -15,6 +15,7 @@
 #include <unistd.h>
 
 #include "file_type.h"
+#include "fmap.h"
 #include "futility.h"
 #include "gbb_header.h"
 
@@ -81,18 +82,128 @@ void print_file_types_and_exit(int retval)
 	exit(retval);
 }
 
+/*
+ * Many file types start with a magic number. Checking for those first lets us
+ * skip the recognizers that have to scan the whole buffer (looking for an
+ * FMAP, for example) when the answer is right there at the front.
+ */
+static const struct {
+	const char *magic;
+	uint32_t size;
+	/* Type whose recognizer to try first if the magic matches */
+	enum futil_file_type type;
+} magic_hints[] = {
+	{GBB_SIGNATURE,   GBB_SIGNATURE_SIZE,   FILE_TYPE_GBB},
+	{KEY_BLOCK_MAGIC, KEY_BLOCK_MAGIC_SIZE, FILE_TYPE_KEYBLOCK},
+	{FMAP_SIGNATURE,  FMAP_SIGNATURE_SIZE,  FILE_TYPE_BIOS_IMAGE},
+	{"Vb2P",          4,                    FILE_TYPE_VB2_PUBKEY},
+	{"Vb2I",          4,                    FILE_TYPE_VB2_PRIVKEY},
+	{"BdB0",          4,                    FILE_TYPE_BDB},
+	{"-----BEGIN",    10,                   FILE_TYPE_PEM},
+};
+
+/*
+ * Where the FMAP was found in the last buffer we looked at, so the show and
+ * sign handlers don't have to scan big images for it again. It's only used
+ * for the same buffer, and forgotten when that buffer is unmapped, since
+ * another file may be mapped at the same address next.
+ */
+static struct {
+	const uint8_t *buf;
+	uint32_t len;
+	int64_t offset;				/* -1 if none found */
+	struct fmap_index *index;		/* Built when first needed */
+} fmap_cache = { NULL, 0, -1, NULL };
+
+static void fmap_cache_reset(const uint8_t *buf, uint32_t len, int64_t offset)
+{
+	fmap_index_free(fmap_cache.index);
+	fmap_cache.index = NULL;
+	fmap_cache.buf = buf;
+	fmap_cache.len = len;
+	fmap_cache.offset = offset;
+}
+
+FmapHeader *futil_file_type_fmap(uint8_t *buf, uint32_t len)
+{
+	FmapHeader *fmap;
+
+	if (fmap_cache.buf == buf && fmap_cache.len == len)
+		return fmap_cache.offset >= 0 ?
+			(FmapHeader *)(buf + fmap_cache.offset) : NULL;
+
+	fmap = fmap_find(buf, len);
+	fmap_cache_reset(buf, len, fmap ? (uint8_t *)fmap - buf : -1);
+	return fmap;
+}
+
+void futil_file_type_forget(const uint8_t *buf)
+{
+	if (fmap_cache.buf == buf)
+		fmap_cache_reset(NULL, 0, -1);
+}
+
+const struct fmap_index *futil_file_type_fmap_index(uint8_t *buf,
+						    uint32_t len)
+{
+	FmapHeader *fmap = futil_file_type_fmap(buf, len);
+
+	if (fmap && !fmap_cache.index)
+		fmap_cache.index = fmap_index_create(buf, len, fmap);
+	return fmap_cache.index;
+}
+
+typedef enum futil_file_type (*recognizer_t)(uint8_t *buf, uint32_t len);
+
+/*
+ * Several types share a recognizer, which gives the same answer every time,
+ * so there's no point in calling it more than once for the same buffer.
+ */
+static enum futil_file_type try_recognizer(recognizer_t recognize,
+					   recognizer_t *tried, int *num_tried,
+					   uint8_t *buf, uint32_t len)
+{
+	int i;
+
+	if (!recognize)
+		return FILE_TYPE_UNKNOWN;
+	for (i = 0; i < *num_tried; i++)
+		if (tried[i] == recognize)
+			return FILE_TYPE_UNKNOWN;
+	tried[(*num_tried)++] = recognize;
+
+	return recognize(buf, len);
+}
+
 /* Try to figure out what we're looking at */
 enum futil_file_type futil_file_type_buf(uint8_t *buf, uint32_t len)
 {
+	recognizer_t tried[NUM_FILE_TYPES];
+	int num_tried = 0;
 	enum futil_file_type type;
 	int i;
 
+	/* Forget about the last buffer */
+	fmap_cache_reset(NULL, 0, -1);
+
+	/* Cheap candidates first */
+	for (i = 0; i < ARRAY_SIZE(magic_hints); i++) {
+		if (len < magic_hints[i].size ||
+		    memcmp(buf, magic_hints[i].magic, magic_hints[i].size))
+			continue;
+		type = try_recognizer(
+			futil_file_types[magic_hints[i].type].recognize,
+			tried, &num_tried, buf, len);
+		if (type != FILE_TYPE_UNKNOWN)
+			return type;
+	}
+
+	/* Then everything else, in order */
 	for (i = 0; i < NUM_FILE_TYPES; i++) {
-		if (futil_file_types[i].recognize) {
-			type = futil_file_types[i].recognize(buf, len);
-			if (type != FILE_TYPE_UNKNOWN)
-				return type;
-		}
+		type = try_recognizer(futil_file_types[i].recognize,
+				      tried, &num_tried, buf, len);
+		if (type != FILE_TYPE_UNKNOWN)
+			return type;
 	}
 
 	return FILE_TYPE_UNKNOWN;
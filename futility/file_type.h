@@ -32,6 +32,23 @@ int futil_str_to_file_type(const char *str, enum futil_file_type *type);
  */
 enum futil_file_type futil_file_type_buf(uint8_t *buf, uint32_t len);
 
+/*
+ * Find the FMAP in a buffer. If it was already found in the same buffer (for
+ * instance by futil_file_type_buf()), this reuses the location found then
+ * instead of scanning the whole buffer again. Returns NULL if there isn't one.
+ */
+struct _FmapHeader *futil_file_type_fmap(uint8_t *buf, uint32_t len);
+
+/* Forget what was found in a buffer, which is about to be unmapped. */
+void futil_file_type_forget(const uint8_t *buf);
+
+/*
+ * Same, but return an index of the FMAP areas, built once per buffer. The
+ * index is owned by this module. Returns NULL if there isn't an FMAP.
+ */
+const struct fmap_index *futil_file_type_fmap_index(uint8_t *buf,
+						    uint32_t len);
+
 /*
  * This opens a file and tries to match it to one of the known file types.
  * It's not an error if it returns FILE_TYPE_UKNOWN.
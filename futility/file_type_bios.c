@@ -5,6 +5,7 @@
  */
 #include <errno.h>
 #include <limits.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
@@ -38,6 +39,15 @@ static const char * const fmap_oldname[] = {
 };
 BUILD_ASSERT(ARRAY_SIZE(fmap_oldname) == NUM_BIOS_COMPONENTS);
 
+/* Find a BIOS component's FMAP area, by either its current or old name */
+static const FmapAreaHeader *find_bios_area(const struct fmap_index *index,
+					    enum bios_component c)
+{
+	const FmapAreaHeader *ah = fmap_index_find(index, fmap_name[c]);
+
+	return ah ? ah : fmap_index_find(index, fmap_oldname[c]);
+}
+
 static void fmap_limit_area(FmapAreaHeader *ah, uint32_t len)
 {
 	uint32_t sum = ah->area_offset + ah->area_size;
@@ -50,92 +60,208 @@ static void fmap_limit_area(FmapAreaHeader *ah, uint32_t len)
 	}
 }
 
-/** Show functions **/
+/* The FW_MAIN area signed by a VBLOCK */
+static enum bios_component fw_main_for(enum bios_component vblock)
+{
+	return vblock == BIOS_FMAP_VBLOCK_A ? BIOS_FMAP_FW_MAIN_A
+		: BIOS_FMAP_FW_MAIN_B;
+}
 
-int ft_show_gbb(const char *name, uint8_t *buf, uint32_t len, void *data)
+struct body_hash_job_s {
+	struct bios_state_s *state;
+	enum bios_component c;
+	pthread_t thread;
+	int started;
+};
+
+/*
+ * Hash the body that a VBLOCK says it signs.  Nothing is verified here; the
+ * digest is just kept with the size and algorithm it was made with, so it can
+ * be used once the keyblock and preamble have been checked.
+ */
+static void *hash_fw_body(void *arg)
 {
-	GoogleBinaryBlockHeader *gbb = (GoogleBinaryBlockHeader *)buf;
-	struct bios_state_s *state = (struct bios_state_s *)data;
-	BmpBlockHeader *bmp;
-	int retval = 0;
-	uint32_t maxlen = 0;
+	struct body_hash_job_s *job = arg;
+	struct bios_area_s *vblock = &job->state->area[job->c];
+	struct bios_area_s *body = &job->state->area[fw_main_for(job->c)];
+	struct bios_body_digest_s *d = &job->state->body_digest[job->c];
+	const struct vb2_keyblock *keyblock =
+		(const struct vb2_keyblock *)vblock->buf;
+	const struct vb2_fw_preamble *pre2;
+	uint32_t digest_size;
+
+	if (!body->len || vblock->len < sizeof(*keyblock) ||
+	    keyblock->keyblock_size > vblock->len ||
+	    vblock->len - keyblock->keyblock_size < sizeof(*pre2))
+		return NULL;
+
+	pre2 = (const struct vb2_fw_preamble *)
+		(vblock->buf + keyblock->keyblock_size);
+	if (pre2->header_version_minor >= 1 &&
+	    (pre2->flags & VB2_FIRMWARE_PREAMBLE_USE_RO_NORMAL))
+		return NULL;
+
+	d->hash_alg = vb2_crypto_to_hash(keyblock->data_key.algorithm);
+	d->data_size = pre2->body_signature.data_size;
+	digest_size = vb2_digest_size(d->hash_alg);
+	if (!digest_size || d->data_size > body->len)
+		return NULL;
+
+	if (VB2_SUCCESS == vb2_digest_buffer(body->buf, d->data_size,
+					     d->hash_alg, d->digest,
+					     digest_size))
+		d->is_valid = 1;
+	return NULL;
+}
 
-	if (!len) {
-		printf("GBB header:              %s <invalid>\n", name);
-		return 1;
+/*
+ * Hash the bodies for both VBLOCKs at once.  The slots don't depend on each
+ * other and hashing the bodies is the slow part, so they get a thread each;
+ * the signatures are checked in order afterwards.
+ */
+static void hash_fw_bodies(struct bios_state_s *state)
+{
+	struct body_hash_job_s jobs[] = {
+		{ .state = state, .c = BIOS_FMAP_VBLOCK_A },
+		{ .state = state, .c = BIOS_FMAP_VBLOCK_B },
+	};
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(jobs); i++)
+		jobs[i].started = !pthread_create(&jobs[i].thread, NULL,
+						  hash_fw_body, &jobs[i]);
+
+	for (i = 0; i < ARRAY_SIZE(jobs); i++) {
+		if (jobs[i].started)
+			pthread_join(jobs[i].thread, NULL);
+		else
+			hash_fw_body(&jobs[i]);
 	}
+}
 
-	/* It looks like a GBB or we wouldn't be called. */
-	if (!futil_valid_gbb_header(gbb, len, &maxlen))
-		retval = 1;
+/** Show functions **/
 
-	printf("GBB header:              %s\n", name);
-	printf("  Version:               %d.%d\n",
-	       gbb->major_version, gbb->minor_version);
-	printf("  Flags:                 0x%08x\n", gbb->flags);
-	printf("  Regions:                 offset       size\n");
-	printf("    hwid                 0x%08x   0x%08x\n",
-	       gbb->hwid_offset, gbb->hwid_size);
-	printf("    bmpvf                0x%08x   0x%08x\n",
-	       gbb->bmpfv_offset, gbb->bmpfv_size);
-	printf("    rootkey              0x%08x   0x%08x\n",
-	       gbb->rootkey_offset, gbb->rootkey_size);
-	printf("    recovery_key         0x%08x   0x%08x\n",
-	       gbb->recovery_key_offset, gbb->recovery_key_size);
+/*
+ * Get a key from the GBB, if it looks ok.  While showing a BIOS, remember
+ * where it is in the state too.
+ */
+static struct vb2_packed_key *get_gbb_key(uint8_t *buf, uint32_t offset,
+					  uint32_t size,
+					  struct bios_state_s *state,
+					  struct bios_area_s *key)
+{
+	struct vb2_packed_key *pubkey = (struct vb2_packed_key *)(buf + offset);
 
-	printf("  Size:                  0x%08x / 0x%08x%s\n",
-	       maxlen, len, maxlen > len ? "  (not enough)" : "");
+	if (!packed_key_looks_ok(pubkey, size))
+		return NULL;
 
-	if (retval) {
-		printf("GBB header is invalid, ignoring content\n");
-		return 1;
+	if (state) {
+		key->offset = state->area[BIOS_FMAP_GBB].offset + offset;
+		key->buf = buf + offset;
+		key->len = size;
+		key->is_valid = 1;
 	}
+	return pubkey;
+}
 
-	printf("GBB content:\n");
-	printf("  HWID:                  %s\n", buf + gbb->hwid_offset);
-	print_hwid_digest(gbb, "     digest:             ", "\n");
+static void json_gbb_region(const char *name, uint32_t offset, uint32_t size)
+{
+	json_begin(name);
+	json_int("offset", offset);
+	json_int("size", size);
+	json_end();
+}
 
+static void json_hwid_digest(GoogleBinaryBlockHeader *gbb)
+{
+	char hex[VB2_SHA256_DIGEST_SIZE * 2 + 1];
+	int i;
+
+	/* There isn't one for v1.1 and earlier */
+	if (gbb->minor_version < 2) {
+		json_null("hwid_digest");
+		return;
+	}
+
+	for (i = 0; i < VB2_SHA256_DIGEST_SIZE; i++)
+		sprintf(hex + i * 2, "%02x", gbb->hwid_digest[i]);
+
+	json_begin("hwid_digest");
+	json_string("digest", hex);
+	json_bool("valid", hwid_digest_is_valid(gbb));
+	json_end();
+}
+
+/*
+ * Show a key from the GBB, as json_name or as name in text.  Return non-zero
+ * if it doesn't look ok.
+ */
+static int show_gbb_key(const char *json_name, const char *name,
+			uint8_t *buf, uint32_t offset, uint32_t size,
+			struct bios_state_s *state, struct bios_area_s *key)
+{
 	struct vb2_packed_key *pubkey =
-		(struct vb2_packed_key *)(buf + gbb->rootkey_offset);
-	if (packed_key_looks_ok(pubkey, gbb->rootkey_size)) {
-		if (state) {
-			state->rootkey.offset =
-				state->area[BIOS_FMAP_GBB].offset +
-				gbb->rootkey_offset;
-			state->rootkey.buf = buf + gbb->rootkey_offset;
-			state->rootkey.len = gbb->rootkey_size;
-			state->rootkey.is_valid = 1;
+		get_gbb_key(buf, offset, size, state, key);
+
+	if (show_option.json) {
+		if (pubkey) {
+			json_begin(json_name);
+			json_pubkey(pubkey);
+			json_end();
+		} else {
+			json_null(json_name);
 		}
-		printf("  Root Key:\n");
+	} else if (pubkey) {
+		printf("  %s:\n", name);
 		show_pubkey(pubkey, "    ");
 	} else {
-		retval = 1;
-		printf("  Root Key:              <invalid>\n");
+		printf("  %s:%*s<invalid>\n", name,
+		       (int)(22 - strlen(name)), "");
 	}
 
-	pubkey = (struct vb2_packed_key *)(buf + gbb->recovery_key_offset);
-	if (packed_key_looks_ok(pubkey, gbb->recovery_key_size)) {
-		if (state) {
-			state->recovery_key.offset =
-				state->area[BIOS_FMAP_GBB].offset +
-				gbb->recovery_key_offset;
-			state->recovery_key.buf = buf +
-				gbb->recovery_key_offset;
-			state->recovery_key.len = gbb->recovery_key_size;
-			state->recovery_key.is_valid = 1;
-		}
-		printf("  Recovery Key:\n");
-		show_pubkey(pubkey, "    ");
+	return !pubkey;
+}
+
+/* Show what's in the GBB, once the header has been checked */
+static int show_gbb_content(uint8_t *buf, struct bios_state_s *state)
+{
+	GoogleBinaryBlockHeader *gbb = (GoogleBinaryBlockHeader *)buf;
+	const char *hwid = (const char *)buf + gbb->hwid_offset;
+	BmpBlockHeader *bmp;
+	int retval = 0;
+
+	if (show_option.json) {
+		json_string("hwid", hwid);
+		json_hwid_digest(gbb);
 	} else {
-		retval = 1;
-		printf("  Recovery Key:          <invalid>\n");
+		printf("GBB content:\n");
+		printf("  HWID:                  %s\n", hwid);
+		print_hwid_digest(gbb, "     digest:             ", "\n");
 	}
 
+	retval |= show_gbb_key("rootkey", "Root Key", buf,
+			       gbb->rootkey_offset, gbb->rootkey_size,
+			       state, state ? &state->rootkey : NULL);
+	retval |= show_gbb_key("recovery_key", "Recovery Key", buf,
+			       gbb->recovery_key_offset, gbb->recovery_key_size,
+			       state, state ? &state->recovery_key : NULL);
+
 	bmp = (BmpBlockHeader *)(buf + gbb->bmpfv_offset);
 	if (0 != memcmp(bmp, BMPBLOCK_SIGNATURE, BMPBLOCK_SIGNATURE_SIZE)) {
-		printf("  BmpBlock:              <invalid>\n");
 		/* We don't support older BmpBlock formats, so we can't
 		 * be strict about this. */
+		if (show_option.json)
+			json_null("bmpblock");
+		else
+			printf("  BmpBlock:              <invalid>\n");
+	} else if (show_option.json) {
+		json_begin("bmpblock");
+		json_int("major_version", bmp->major_version);
+		json_int("minor_version", bmp->minor_version);
+		json_int("localizations", bmp->number_of_localizations);
+		json_int("screen_layouts", bmp->number_of_screenlayouts);
+		json_int("image_infos", bmp->number_of_imageinfos);
+		json_end();
 	} else {
 		printf("  BmpBlock:\n");
 		printf("    Version:             %d.%d\n",
@@ -154,6 +280,75 @@ int ft_show_gbb(const char *name, uint8_t *buf, uint32_t len, void *data)
 	return retval;
 }
 
+static void json_show_gbb_header(GoogleBinaryBlockHeader *gbb,
+				 uint32_t maxlen)
+{
+	json_int("major_version", gbb->major_version);
+	json_int("minor_version", gbb->minor_version);
+	json_int("flags", gbb->flags);
+	json_begin("regions");
+	json_gbb_region("hwid", gbb->hwid_offset, gbb->hwid_size);
+	json_gbb_region("bmpfv", gbb->bmpfv_offset, gbb->bmpfv_size);
+	json_gbb_region("rootkey", gbb->rootkey_offset, gbb->rootkey_size);
+	json_gbb_region("recovery_key", gbb->recovery_key_offset,
+			gbb->recovery_key_size);
+	json_end();
+	json_int("size", maxlen);
+}
+
+int ft_show_gbb(const char *name, uint8_t *buf, uint32_t len, void *data)
+{
+	GoogleBinaryBlockHeader *gbb = (GoogleBinaryBlockHeader *)buf;
+	struct bios_state_s *state = (struct bios_state_s *)data;
+	int retval = 0;
+	uint32_t maxlen = 0;
+
+	if (!len) {
+		if (show_option.json)
+			json_string("error", "GBB header is invalid");
+		else
+			printf("GBB header:              %s <invalid>\n", name);
+		return 1;
+	}
+
+	/* It looks like a GBB or we wouldn't be called. */
+	if (!futil_valid_gbb_header(gbb, len, &maxlen))
+		retval = 1;
+
+	if (show_option.json) {
+		json_show_gbb_header(gbb, maxlen);
+		if (retval) {
+			json_string("error", "GBB header is invalid");
+			return 1;
+		}
+		return show_gbb_content(buf, state);
+	}
+
+	printf("GBB header:              %s\n", name);
+	printf("  Version:               %d.%d\n",
+	       gbb->major_version, gbb->minor_version);
+	printf("  Flags:                 0x%08x\n", gbb->flags);
+	printf("  Regions:                 offset       size\n");
+	printf("    hwid                 0x%08x   0x%08x\n",
+	       gbb->hwid_offset, gbb->hwid_size);
+	printf("    bmpvf                0x%08x   0x%08x\n",
+	       gbb->bmpfv_offset, gbb->bmpfv_size);
+	printf("    rootkey              0x%08x   0x%08x\n",
+	       gbb->rootkey_offset, gbb->rootkey_size);
+	printf("    recovery_key         0x%08x   0x%08x\n",
+	       gbb->recovery_key_offset, gbb->recovery_key_size);
+
+	printf("  Size:                  0x%08x / 0x%08x%s\n",
+	       maxlen, len, maxlen > len ? "  (not enough)" : "");
+
+	if (retval) {
+		printf("GBB header is invalid, ignoring content\n");
+		return 1;
+	}
+
+	return show_gbb_content(buf, state);
+}
+
 /*
  * This handles FW_MAIN_A and FW_MAIN_B while processing a BIOS image.
  *
@@ -167,14 +362,22 @@ static int fmap_show_fw_main(const char *name, uint8_t *buf, uint32_t len,
 	struct bios_state_s *state = (struct bios_state_s *)data;
 
 	if (!len) {
-		printf("Firmware body:           %s <invalid>\n", name);
+		if (show_option.json)
+			json_string("error", "Firmware body is invalid");
+		else
+			printf("Firmware body:           %s <invalid>\n", name);
 		return 1;
 	}
 
-	printf("Firmware body:           %s\n", name);
-	printf("  Offset:                0x%08x\n",
-	       state->area[state->c].offset);
-	printf("  Size:                  0x%08x\n", len);
+	if (show_option.json) {
+		json_int("offset", state->area[state->c].offset);
+		json_int("size", len);
+	} else {
+		printf("Firmware body:           %s\n", name);
+		printf("  Offset:                0x%08x\n",
+		       state->area[state->c].offset);
+		printf("  Size:                  0x%08x\n", len);
+	}
 
 	state->area[state->c].is_valid = 1;
 
@@ -194,46 +397,64 @@ BUILD_ASSERT(ARRAY_SIZE(fmap_show_fn) == NUM_BIOS_COMPONENTS);
 
 int ft_show_bios(const char *name, uint8_t *buf, uint32_t len, void *data)
 {
-	FmapHeader *fmap;
-	FmapAreaHeader *ah = 0;
-	char ah_name[FMAP_NAMELEN + 1];
+	const struct fmap_index *index;
+	const FmapAreaHeader *found;
+	FmapAreaHeader area, *ah = &area;
+	char ah_name[NUM_BIOS_COMPONENTS][FMAP_NAMELEN + 1];
+	int present[NUM_BIOS_COMPONENTS];
 	enum bios_component c;
 	int retval = 0;
 	struct bios_state_s state;
 
 	memset(&state, 0, sizeof(state));
 
-	printf("BIOS:                    %s\n", name);
+	if (!show_option.json)
+		printf("BIOS:                    %s\n", name);
 
 	/* We've already checked, so we know this will work. */
-	fmap = fmap_find(buf, len);
+	index = futil_file_type_fmap_index(buf, len);
 	for (c = 0; c < NUM_BIOS_COMPONENTS; c++) {
 		/* We know one of these will work, too */
-		if (fmap_find_by_name(buf, len, fmap, fmap_name[c], &ah) ||
-		    fmap_find_by_name(buf, len, fmap, fmap_oldname[c], &ah)) {
+		found = find_bios_area(index, c);
+		present[c] = !!found;
+		if (found) {
 			/* But the file might be truncated */
+			area = *found;
 			fmap_limit_area(ah, len);
 			/* The name is not necessarily null-terminated */
-			snprintf(ah_name, sizeof(ah_name), "%s", ah->area_name);
+			snprintf(ah_name[c], sizeof(ah_name[c]), "%.*s",
+				 FMAP_NAMELEN, ah->area_name);
 
 			/* Update the state we're passing around */
-			state.c = c;
 			state.area[c].offset = ah->area_offset;
 			state.area[c].buf = buf + ah->area_offset;
 			state.area[c].len = ah->area_size;
+		}
+	}
 
-			Debug("%s() showing FMAP area %d (%s),"
-			      " offset=0x%08x len=0x%08x\n",
-			      __func__, c, ah_name,
-			      ah->area_offset, ah->area_size);
+	hash_fw_bodies(&state);
 
-			/* Go look at it. */
-			if (fmap_show_fn[c])
-				retval += fmap_show_fn[c](ah_name,
-							  state.area[c].buf,
-							  state.area[c].len,
-							  &state);
-		}
+	for (c = 0; c < NUM_BIOS_COMPONENTS; c++) {
+		if (!present[c])
+			continue;
+
+		state.c = c;
+
+		Debug("%s() showing FMAP area %d (%s),"
+		      " offset=0x%08x len=0x%08x\n",
+		      __func__, c, ah_name[c],
+		      state.area[c].offset, state.area[c].len);
+
+		/* Go look at it, as a member named for the area in JSON */
+		if (show_option.json)
+			json_begin(ah_name[c]);
+		if (fmap_show_fn[c])
+			retval += fmap_show_fn[c](ah_name[c],
+						  state.area[c].buf,
+						  state.area[c].len,
+						  &state);
+		if (show_option.json)
+			json_end();
 	}
 
 	return retval;
@@ -326,19 +547,12 @@ whatever:
 }
 
 static int write_new_preamble(struct bios_area_s *vblock,
-			      struct bios_area_s *fw_body,
+			      struct vb2_signature *body_sig,
 			      struct vb2_private_key *signkey,
 			      struct vb2_keyblock *keyblock)
 {
-	struct vb2_signature *body_sig;
 	struct vb2_fw_preamble *preamble;
 
-	body_sig = vb2_calculate_signature(fw_body->buf, fw_body->len, signkey);
-	if (!body_sig) {
-		fprintf(stderr, "Error calculating body signature\n");
-		return 1;
-	}
-
 	preamble = vb2_create_fw_preamble(sign_option.version,
 			(struct vb2_packed_key *)sign_option.kernel_subkey,
 			body_sig,
@@ -346,7 +560,6 @@ static int write_new_preamble(struct bios_area_s *vblock,
 			sign_option.flags);
 	if (!preamble) {
 		fprintf(stderr, "Error creating firmware preamble.\n");
-		free(body_sig);
 		return 1;
 	}
 
@@ -357,11 +570,49 @@ static int write_new_preamble(struct bios_area_s *vblock,
 	memcpy(vblock->buf + more, preamble, preamble->preamble_size);
 
 	free(preamble);
-	free(body_sig);
 
 	return 0;
 }
 
+struct body_sign_job_s {
+	struct bios_area_s *fw_body;
+	struct vb2_private_key *signkey;
+	struct vb2_signature *body_sig;
+	pthread_t thread;
+	int started;
+};
+
+static void *sign_fw_body(void *arg)
+{
+	struct body_sign_job_s *job = arg;
+
+	job->body_sig = vb2_calculate_signature(job->fw_body->buf,
+						job->fw_body->len,
+						job->signkey);
+	return NULL;
+}
+
+/*
+ * Sign the A and B bodies at once.  Hashing them is most of the work of
+ * signing an image, and they use different keys and don't depend on each
+ * other, so they get a thread each.
+ */
+static void sign_fw_bodies(struct body_sign_job_s *jobs, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		jobs[i].started = !pthread_create(&jobs[i].thread, NULL,
+						  sign_fw_body, &jobs[i]);
+
+	for (i = 0; i < count; i++) {
+		if (jobs[i].started)
+			pthread_join(jobs[i].thread, NULL);
+		else
+			sign_fw_body(&jobs[i]);
+	}
+}
+
 static int write_loem(const char *ab, struct bios_area_s *vblock)
 {
 	char filename[PATH_MAX];
@@ -403,6 +654,12 @@ static int sign_bios_at_end(struct bios_state_s *state)
 	struct bios_area_s *vblock_b = &state->area[BIOS_FMAP_VBLOCK_B];
 	struct bios_area_s *fw_a = &state->area[BIOS_FMAP_FW_MAIN_A];
 	struct bios_area_s *fw_b = &state->area[BIOS_FMAP_FW_MAIN_B];
+	struct vb2_keyblock *keyblock_a = sign_option.keyblock;
+	/* FW B is always normal keys */
+	struct body_sign_job_s job[] = {
+		{ .fw_body = fw_a, .signkey = sign_option.signprivate },
+		{ .fw_body = fw_b, .signkey = sign_option.signprivate },
+	};
 	int retval = 0;
 
 	if (!vblock_a->is_valid || !vblock_b->is_valid ||
@@ -420,22 +677,29 @@ static int sign_bios_at_end(struct bios_state_s *state)
 				"FW A & B differ. DEV keys are required.\n");
 			return 1;
 		}
-		retval |= write_new_preamble(vblock_a, fw_a,
-					     sign_option.devsignprivate,
-					     sign_option.devkeyblock);
+		job[0].signkey = sign_option.devsignprivate;
+		keyblock_a = sign_option.devkeyblock;
+		sign_fw_bodies(job, ARRAY_SIZE(job));
 	} else {
-		retval |= write_new_preamble(vblock_a, fw_a,
-					     sign_option.signprivate,
-					     sign_option.keyblock);
+		/* Same data and key, so the same body signature will do */
+		sign_fw_body(&job[1]);
+		job[0].body_sig = job[1].body_sig;
 	}
 
-	/* FW B is always normal keys */
-	retval |= write_new_preamble(vblock_b, fw_b,
-				     sign_option.signprivate,
-				     sign_option.keyblock);
-
-
+	if (!job[0].body_sig || !job[1].body_sig) {
+		fprintf(stderr, "Error calculating body signature\n");
+		retval = 1;
+	} else {
+		retval |= write_new_preamble(vblock_a, job[0].body_sig,
+					     job[0].signkey, keyblock_a);
+		retval |= write_new_preamble(vblock_b, job[1].body_sig,
+					     job[1].signkey,
+					     sign_option.keyblock);
+	}
 
+	if (job[0].body_sig != job[1].body_sig)
+		free(job[0].body_sig);
+	free(job[1].body_sig);
 
 	if (sign_option.loemid) {
 		retval |= write_loem("A", vblock_a);
@@ -458,8 +722,9 @@ BUILD_ASSERT(ARRAY_SIZE(fmap_sign_fn) == NUM_BIOS_COMPONENTS);
 
 int ft_sign_bios(const char *name, uint8_t *buf, uint32_t len, void *data)
 {
-	FmapHeader *fmap;
-	FmapAreaHeader *ah = 0;
+	const struct fmap_index *index;
+	const FmapAreaHeader *found;
+	FmapAreaHeader area, *ah = &area;
 	char ah_name[FMAP_NAMELEN + 1];
 	enum bios_component c;
 	int retval = 0;
@@ -468,15 +733,17 @@ int ft_sign_bios(const char *name, uint8_t *buf, uint32_t len, void *data)
 	memset(&state, 0, sizeof(state));
 
 	/* We've already checked, so we know this will work. */
-	fmap = fmap_find(buf, len);
+	index = futil_file_type_fmap_index(buf, len);
 	for (c = 0; c < NUM_BIOS_COMPONENTS; c++) {
 		/* We know one of these will work, too */
-		if (fmap_find_by_name(buf, len, fmap, fmap_name[c], &ah) ||
-		    fmap_find_by_name(buf, len, fmap, fmap_oldname[c], &ah)) {
+		found = find_bios_area(index, c);
+		if (found) {
 			/* But the file might be truncated */
+			area = *found;
 			fmap_limit_area(ah, len);
 			/* The name is not necessarily null-terminated */
-			snprintf(ah_name, sizeof(ah_name), "%s", ah->area_name);
+			snprintf(ah_name, sizeof(ah_name), "%.*s", FMAP_NAMELEN,
+				 ah->area_name);
 
 			/* Update the state we're passing around */
 			state.c = c;
@@ -504,21 +771,21 @@ int ft_sign_bios(const char *name, uint8_t *buf, uint32_t len, void *data)
 
 enum futil_file_type ft_recognize_bios_image(uint8_t *buf, uint32_t len)
 {
-	FmapHeader *fmap;
+	const struct fmap_index *index;
 	enum bios_component c;
 
-	fmap = fmap_find(buf, len);
-	if (!fmap)
+	index = futil_file_type_fmap_index(buf, len);
+	if (!index)
 		return FILE_TYPE_UNKNOWN;
 
 	for (c = 0; c < NUM_BIOS_COMPONENTS; c++)
-		if (!fmap_find_by_name(buf, len, fmap, fmap_name[c], 0))
+		if (!fmap_index_find(index, fmap_name[c]))
 			break;
 	if (c == NUM_BIOS_COMPONENTS)
 		return FILE_TYPE_BIOS_IMAGE;
 
 	for (c = 0; c < NUM_BIOS_COMPONENTS; c++)
-		if (!fmap_find_by_name(buf, len, fmap, fmap_oldname[c], 0))
+		if (!fmap_index_find(index, fmap_oldname[c]))
 			break;
 	if (c == NUM_BIOS_COMPONENTS)
 		return FILE_TYPE_OLD_BIOS_IMAGE;
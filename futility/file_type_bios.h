@@ -7,6 +7,9 @@
 #define VBOOT_REFERENCE_FUTILITY_FILE_TYPE_BIOS_H_
 #include <stdint.h>
 
+#include "2sysincludes.h"
+#include "2sha.h"
+
 /*
  * The Chrome OS BIOS must contain specific FMAP areas, which we want to look
  * at in a certain order.
@@ -29,6 +32,14 @@ struct bios_area_s {
 	uint32_t is_valid;
 };
 
+/* Digest of the firmware body a VBLOCK signs, worked out ahead of time */
+struct bios_body_digest_s {
+	enum vb2_hash_algorithm hash_alg;
+	uint32_t data_size;
+	uint8_t digest[VB2_MAX_DIGEST_SIZE];
+	uint32_t is_valid;
+};
+
 /* State to track as we visit all components */
 struct bios_state_s {
 	/* Current component */
@@ -37,6 +48,8 @@ struct bios_state_s {
 	struct bios_area_s area[NUM_BIOS_COMPONENTS];
 	struct bios_area_s recovery_key;
 	struct bios_area_s rootkey;
+	/* Indexed by VBLOCK component */
+	struct bios_body_digest_s body_digest[NUM_BIOS_COMPONENTS];
 };
 
 #endif	/* VBOOT_REFERENCE_FUTILITY_FILE_TYPE_BIOS_H_ */
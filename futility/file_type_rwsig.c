@@ -90,7 +90,7 @@ int ft_show_rwsig(const char *name, uint8_t *buf, uint32_t len, void *nuthin)
 		data = show_option.fv;
 		data_size = show_option.fv_size;
 		total_data_size = show_option.fv_size;
-	} else if ((fmap = fmap_find(buf, len))) {
+	} else if ((fmap = futil_file_type_fmap(buf, len))) {
 		/* This looks like a full image. */
 		FmapAreaHeader *fmaparea;
 
@@ -224,7 +224,7 @@ int ft_sign_rwsig(const char *name, uint8_t *buf, uint32_t len, void *nuthin)
 
 	/* If we don't have a distinct OUTFILE, look for an existing sig */
 	if (sign_option.inout_file_count < 2) {
-		fmap = fmap_find(buf, len);
+		fmap = futil_file_type_fmap(buf, len);
 
 		if (fmap) {
 			/* This looks like a full image. */
@@ -421,7 +421,7 @@ enum futil_file_type ft_recognize_rwsig(uint8_t *buf, uint32_t len)
 	if (!vb21_verify_signature((const struct vb21_signature *)buf, len))
 		return FILE_TYPE_RWSIG;
 
-	fmap = fmap_find(buf, len);
+	fmap = futil_file_type_fmap(buf, len);
 	if (fmap) {
 		/* This looks like a full image. */
 		FmapAreaHeader *fmaparea;
@@ -288,6 +288,16 @@ static uint32_t usbpd1_packed_key_size(enum vb2_signature_algorithm sig_alg)
 		return 0;
 	}
 }
+static int usbpd1_key_looks_ok(enum vb2_signature_algorithm sig_alg,
+			       const uint8_t *o_pubkey)
+{
+	uint32_t arrsize = vb2_rsa_sig_size(sig_alg) / sizeof(uint32_t);
+	const uint32_t *n = (const uint32_t *)o_pubkey;
+	uint32_t n0inv = n[2 * arrsize];
+
+	return (uint32_t)(n0inv * n[0]) == 0xffffffff;
+}
+
 static void vb2_pubkey_from_usbpd1(struct vb2_public_key *key,
 				   enum vb2_signature_algorithm sig_alg,
 				   enum vb2_hash_algorithm hash_alg,
@@ -417,6 +427,13 @@ static int check_self_consistency(const uint8_t *buf,
 	if (sig_size > rw_size || pubkey_size > ro_size)
 		return VB2_ERROR_UNKNOWN;
 
+	/*
+	 * The key includes n0inv = -1 / n[0] mod 2^32, which is much cheaper
+	 * to check than hashing the whole RW image.
+	 */
+	if (!usbpd1_key_looks_ok(sig_alg, buf + pubkey_offset))
+		return VB2_ERROR_UNKNOWN;
+
 	rv = try_our_own(sig_alg, hash_alg,		   /* algs */
 			 buf + pubkey_offset, pubkey_size, /* pubkey blob */
 			 buf + sig_offset, sig_size,	   /* sig blob */
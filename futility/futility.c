@@ -195,7 +195,7 @@ static const char *const options =
 "  --debug      Be noisy about what's going on\n"
 "\n";
 
-static const struct futil_cmd_t *find_command(const char *name)
+const struct futil_cmd_t *futil_find_command(const char *name)
 {
 	const struct futil_cmd_t *const *cmd;
 
@@ -217,7 +217,7 @@ static void list_commands(void)
 			       (*cmd)->name, (*cmd)->shorthelp);
 }
 
-static int run_command(const struct futil_cmd_t *cmd, int argc, char *argv[])
+int futil_run_command(const struct futil_cmd_t *cmd, int argc, char *argv[])
 {
 	int i;
 	Debug("%s(\"%s\") ...\n", __func__, cmd->name);
@@ -234,12 +234,12 @@ static int do_help(int argc, char *argv[])
 
 	/* Help about a known command? */
 	if (argc > 1) {
-		cmd = find_command(argv[1]);
+		cmd = futil_find_command(argv[1]);
 		if (cmd) {
 			/* Let the command provide its own help */
 			argv[0] = argv[1];
 			argv[1] = "--help";
-			return run_command(cmd, argc, argv);
+			return futil_run_command(cmd, argc, argv);
 		}
 	}
 
@@ -316,10 +316,10 @@ int main(int argc, char *argv[], char *envp[])
 	progname = simple_basename(argv[0]);
 
 	/* See if the program name is a command we recognize */
-	cmd = find_command(progname);
+	cmd = futil_find_command(progname);
 	if (cmd) {
 		/* Yep, just do that */
-		return !!run_command(cmd, argc, argv);
+		return !!futil_run_command(cmd, argc, argv);
 	}
 
 	/* Parse the global options, stopping at the first non-option. */
@@ -375,13 +375,13 @@ int main(int argc, char *argv[], char *envp[])
 	argv[optind] = simple_basename(argv[optind]);
 
 	/* Do we recognize the command? */
-	cmd = find_command(argv[optind]);
+	cmd = futil_find_command(argv[optind]);
 	if (cmd) {
 		/* Reset so commands can parse their own options */
 		argc -= optind;
 		argv += optind;
 		optind = 0;
-		return !!run_command(cmd, argc, argv);
+		return !!futil_run_command(cmd, argc, argv);
 	}
 
 	/* Nope. We've no clue what we're being asked to do. */
@@ -68,6 +68,12 @@ struct futil_cmd_t {
 /* This is the list of pointers to all commands. */
 extern const struct futil_cmd_t *const futil_cmds[];
 
+/* Returns the command with the given name, or NULL if there isn't one. */
+const struct futil_cmd_t *futil_find_command(const char *name);
+
+/* Runs a command. Called with argv[0] == the command name. */
+int futil_run_command(const struct futil_cmd_t *cmd, int argc, char *argv[]);
+
 /* Size of an array */
 #ifndef ARRAY_SIZE
 #define ARRAY_SIZE(array) (sizeof(array)/sizeof(array[0]))
@@ -114,11 +120,32 @@ int futil_set_gbb_hwid(struct vb2_gbb_header *gbb, const char *hwid);
 /* For GBB v1.2 and later, update the hwid_digest */
 void update_hwid_digest(GoogleBinaryBlockHeader *gbb);
 
+/* For GBB v1.2 and later, check the stored digest of the HWID. Return true
+ * if it is correct, or if there isn't one. */
+int hwid_digest_is_valid(GoogleBinaryBlockHeader *gbb);
+
 /* For GBB v1.2 and later, print the stored digest of the HWID (and whether
  * it's correct). Return true if it is correct. */
 int print_hwid_digest(GoogleBinaryBlockHeader *gbb,
 		      const char *banner, const char *footer);
 
+/*
+ * Minimal JSON output, for "futility show --json".  Objects are nested with
+ * json_begin() and json_end(), and the functions below print their members,
+ * taking care of commas and indentation.  A NULL name prints a value without
+ * a name, as at the top level.  json_reset() starts a new object at the given
+ * depth, for callers printing the outermost braces themselves.
+ */
+void json_reset(int depth);
+/* Invalid UTF-8 bytes are escaped as \u00XX */
+void json_print_string(const char *str);
+void json_begin(const char *name);
+void json_end(void);
+void json_string(const char *name, const char *value);
+void json_int(const char *name, uint64_t value);
+void json_bool(const char *name, int value);
+void json_null(const char *name);
+
 /* Copies a file or dies with an error message */
 void futil_copy_file_or_die(const char *infile, const char *outfile);
 
@@ -130,6 +157,9 @@ int fill_ryu_root_header(uint8_t *ptr, size_t size,
 int verify_ryu_root_header(uint8_t *ptr, size_t size,
 			   const GoogleBinaryBlockHeader *gbb);
 
+/* IP-style checksum of a buffer, as used for coreboot's MRC cache */
+unsigned long compute_ip_checksum(const void *addr, unsigned long length);
+
 /* Possible file operation errors */
 enum futil_file_err {
 	FILE_ERR_NONE,
@@ -154,6 +184,28 @@ enum futil_file_err futil_map_file(int fd, int writeable,
 enum futil_file_err futil_unmap_file(int fd, int writeable,
 				     uint8_t *buf, uint32_t len);
 
+/*
+ * Keep the keys in the given file, or all the .vbprivk, .keyblock and .vbpubk
+ * files in the given directory, in memory so futil_read_*() below doesn't
+ * have to read them again. Returns 0 on success.
+ */
+int futil_preload_keys(const char *path);
+
+/*
+ * Same as vb2_read_keyblock() and vb2_read_packed_key(), but return a copy of
+ * the preloaded key if there is one. The caller owns the result either way.
+ */
+struct vb2_keyblock *futil_read_keyblock(const char *filename);
+struct vb2_packed_key *futil_read_packed_key(const char *filename);
+
+/*
+ * Same as vb2_read_private_key(), but return the preloaded key itself if
+ * there is one, so it's only parsed once. Release the result with
+ * futil_free_private_key(), which leaves preloaded keys alone.
+ */
+struct vb2_private_key *futil_read_private_key(const char *filename);
+void futil_free_private_key(struct vb2_private_key *key);
+
 /* The CPU architecture is occasionally important */
 enum arch_t {
 	ARCH_UNSPECIFIED,
@@ -26,6 +26,7 @@ struct show_option_s {
 	uint32_t padding;
 	int strict;
 	int t_flag;
+	int json;
 	enum futil_file_type type;
 	struct vb21_packed_key *pkey;
 	uint32_t sig_size;
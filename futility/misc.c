@@ -5,7 +5,10 @@
  */
 
 #include <assert.h>
+#include <dirent.h>
 #include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
 #ifndef HAVE_MACOS
 #include <linux/fs.h>		/* For BLKGETSIZE64 */
 #endif
@@ -29,6 +32,8 @@
 #include "file_type.h"
 #include "futility.h"
 #include "gbb_header.h"
+#include "host_keyblock.h"
+#include "host_misc.h"
 
 /* Default is to support everything we can */
 enum vboot_version vboot_version = VBOOT_VERSION_ALL;
@@ -131,42 +136,185 @@ int futil_valid_gbb_header(GoogleBinaryBlockHeader *gbb, uint32_t len,
 	return 1;
 }
 
+/* For GBB v1.2 and later, check the stored digest of the HWID. Return true
+ * if it is correct. */
+int hwid_digest_is_valid(GoogleBinaryBlockHeader *gbb)
+{
+	/* There isn't one for v1.1 and earlier, so assume it's good. */
+	if (gbb->minor_version < 2)
+		return 1;
+
+	uint8_t *buf = (uint8_t *)gbb;
+	char *hwid_str = (char *)(buf + gbb->hwid_offset);
+	uint8_t digest[VB2_SHA256_DIGEST_SIZE];
+
+	if (VB2_SUCCESS != vb2_digest_buffer(buf + gbb->hwid_offset,
+					     strlen(hwid_str), VB2_HASH_SHA256,
+					     digest, sizeof(digest)))
+		return 0;
+
+	return !memcmp(gbb->hwid_digest, digest, sizeof(digest));
+}
+
 /* For GBB v1.2 and later, print the stored digest of the HWID (and whether
  * it's correct). Return true if it is correct. */
 int print_hwid_digest(GoogleBinaryBlockHeader *gbb,
 		      const char *banner, const char *footer)
 {
+	int is_valid = hwid_digest_is_valid(gbb);
+	int i;
+
 	printf("%s", banner);
 
-	/* There isn't one for v1.1 and earlier, so assume it's good. */
 	if (gbb->minor_version < 2) {
 		printf("<none>%s", footer);
-		return 1;
+		return is_valid;
 	}
 
-	uint8_t *buf = (uint8_t *)gbb;
-	char *hwid_str = (char *)(buf + gbb->hwid_offset);
-	int is_valid = 0;
-	uint8_t digest[VB2_SHA256_DIGEST_SIZE];
-
-	if (VB2_SUCCESS == vb2_digest_buffer(buf + gbb->hwid_offset,
-					     strlen(hwid_str), VB2_HASH_SHA256,
-					     digest, sizeof(digest))) {
-		int i;
-		is_valid = 1;
-		/* print it, comparing as we go */
-		for (i = 0; i < VB2_SHA256_DIGEST_SIZE; i++) {
-			printf("%02x", gbb->hwid_digest[i]);
-			if (gbb->hwid_digest[i] != digest[i])
-				is_valid = 0;
-		}
-	}
+	for (i = 0; i < VB2_SHA256_DIGEST_SIZE; i++)
+		printf("%02x", gbb->hwid_digest[i]);
 
 	printf("   %s", is_valid ? "valid" : "<invalid>");
 	printf("%s", footer);
 	return is_valid;
 }
 
+/* JSON output state; each member after the first at a depth needs a comma */
+#define JSON_MAX_DEPTH 8
+static int json_depth;
+static int json_started[JSON_MAX_DEPTH];
+
+void json_reset(int depth)
+{
+	assert(depth >= 0 && depth < JSON_MAX_DEPTH);
+	json_depth = depth;
+	json_started[depth] = 0;
+}
+
+/* Start a new member, with its separator, indentation and name */
+static void json_member(const char *name)
+{
+	printf("%s\n%*s", json_started[json_depth] ? "," : "",
+	       json_depth * 2, "");
+	json_started[json_depth] = 1;
+	if (name) {
+		json_print_string(name);
+		printf(": ");
+	}
+}
+
+/*
+ * Return the length of the well-formed UTF-8 sequence starting with a byte
+ * >= 0x80 at s, or 0 if it isn't one.  Overlong encodings, surrogates and
+ * code points past U+10FFFF aren't well-formed.
+ */
+static int utf8_sequence_length(const unsigned char *s)
+{
+	unsigned char lo = 0x80, hi = 0xbf;
+	int len, i;
+
+	if (*s < 0xc2 || *s > 0xf4)
+		return 0;
+
+	if (*s < 0xe0) {
+		len = 2;
+	} else if (*s < 0xf0) {
+		len = 3;
+		if (*s == 0xe0)
+			lo = 0xa0;
+		else if (*s == 0xed)
+			hi = 0x9f;
+	} else {
+		len = 4;
+		if (*s == 0xf0)
+			lo = 0x90;
+		else if (*s == 0xf4)
+			hi = 0x8f;
+	}
+
+	/* This stops at the terminating NUL, too */
+	if (s[1] < lo || s[1] > hi)
+		return 0;
+	for (i = 2; i < len; i++)
+		if ((s[i] & 0xc0) != 0x80)
+			return 0;
+	return len;
+}
+
+void json_print_string(const char *str)
+{
+	const unsigned char *s = (const unsigned char *)str;
+	int len;
+
+	putchar('"');
+	while (*s) {
+		if (*s == '"' || *s == '\\') {
+			printf("\\%c", *s);
+		} else if (*s == '\n') {
+			printf("\\n");
+		} else if (*s < 0x20 || *s == 0x7f) {
+			printf("\\u%04x", *s);
+		} else if (*s >= 0x80) {
+			/*
+			 * JSON has to be UTF-8.  Pass well-formed sequences
+			 * through, and escape any other byte as the code
+			 * point with the same value.
+			 */
+			len = utf8_sequence_length(s);
+			if (len) {
+				fwrite(s, 1, len, stdout);
+				s += len;
+				continue;
+			}
+			printf("\\u%04x", *s);
+		} else {
+			putchar(*s);
+		}
+		s++;
+	}
+	putchar('"');
+}
+
+void json_begin(const char *name)
+{
+	json_member(name);
+	printf("{");
+	json_reset(json_depth + 1);
+}
+
+void json_end(void)
+{
+	assert(json_depth > 0);
+	json_depth--;
+	if (json_started[json_depth + 1])
+		printf("\n%*s", json_depth * 2, "");
+	printf("}");
+}
+
+void json_string(const char *name, const char *value)
+{
+	json_member(name);
+	json_print_string(value);
+}
+
+void json_int(const char *name, uint64_t value)
+{
+	json_member(name);
+	printf("%" PRIu64, value);
+}
+
+void json_bool(const char *name, int value)
+{
+	json_member(name);
+	printf("%s", value ? "true" : "false");
+}
+
+void json_null(const char *name)
+{
+	json_member(name);
+	printf("null");
+}
+
 /* Deprecated. Use futil_set_gbb_hwid in future. */
 /* For GBB v1.2 and later, update the hwid_digest field. */
 void update_hwid_digest(GoogleBinaryBlockHeader *gbb)
@@ -311,6 +459,8 @@ enum futil_file_err futil_unmap_file(int fd, int writeable,
 	void *mmap_ptr = buf;
 	enum futil_file_err err = FILE_ERR_NONE;
 
+	futil_file_type_forget(buf);
+
 	if (writeable &&
 	    (0 != msync(mmap_ptr, len, MS_SYNC|MS_INVALIDATE))) {
 		fprintf(stderr, "msync failed: %s\n", strerror(errno));
@@ -354,3 +504,204 @@ enum futil_file_type ft_recognize_gpt(uint8_t *buf, uint32_t len)
 
 	return FILE_TYPE_CHROMIUMOS_DISK;
 }
+
+/*
+ * Keys preloaded by "futility serve", so that each request doesn't have to
+ * read them again. Private keys are kept parsed, the others as file contents.
+ * Entries are matched by device and inode, and ignored if the file has
+ * changed since it was loaded.
+ */
+enum key_kind {
+	KEY_KIND_PRIVATE,
+	KEY_KIND_KEYBLOCK,
+	KEY_KIND_PACKED,
+};
+
+static const struct {
+	const char *ext;
+	enum key_kind kind;
+} key_exts[] = {
+	{".vbprivk", KEY_KIND_PRIVATE},
+	{".keyblock", KEY_KIND_KEYBLOCK},
+	{".vbpubk", KEY_KIND_PACKED},
+};
+
+struct key_cache_entry {
+	struct key_cache_entry *next;
+	enum key_kind kind;
+	struct stat sb;
+	struct vb2_private_key *private_key;	/* KEY_KIND_PRIVATE */
+	uint8_t *data;				/* File contents, otherwise */
+	uint32_t size;
+};
+
+static struct key_cache_entry *key_cache;
+
+static const struct key_cache_entry *key_cache_find(const char *filename,
+						    enum key_kind kind)
+{
+	const struct key_cache_entry *e;
+	struct stat sb;
+
+	if (!key_cache || stat(filename, &sb))
+		return NULL;
+
+	for (e = key_cache; e; e = e->next)
+		if (e->kind == kind && e->sb.st_dev == sb.st_dev &&
+		    e->sb.st_ino == sb.st_ino)
+			break;
+
+	if (!e || e->sb.st_size != sb.st_size ||
+	    e->sb.st_mtime != sb.st_mtime)
+		return NULL;
+
+	Debug("%s(): using preloaded %s\n", __func__, filename);
+	return e;
+}
+
+static int key_kind_of(const char *filename, enum key_kind *kind)
+{
+	size_t len = strlen(filename), extlen;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(key_exts); i++) {
+		extlen = strlen(key_exts[i].ext);
+		if (len > extlen &&
+		    !strcmp(filename + len - extlen, key_exts[i].ext)) {
+			*kind = key_exts[i].kind;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int preload_key_file(const char *filename, enum key_kind kind)
+{
+	struct key_cache_entry *e;
+	void *key = NULL;
+
+	e = calloc(1, sizeof(*e));
+	if (!e)
+		return 1;
+	if (stat(filename, &e->sb)) {
+		fprintf(stderr, "Can't stat %s: %s\n", filename,
+			strerror(errno));
+		free(e);
+		return 1;
+	}
+
+	/* Make sure it's really a key before we remember it */
+	switch (kind) {
+	case KEY_KIND_PRIVATE:
+		key = e->private_key = vb2_read_private_key(filename);
+		break;
+	case KEY_KIND_KEYBLOCK:
+		key = vb2_read_keyblock(filename);
+		free(key);
+		break;
+	case KEY_KIND_PACKED:
+		key = vb2_read_packed_key(filename);
+		free(key);
+		break;
+	}
+	if (!key || (kind != KEY_KIND_PRIVATE &&
+		     VB2_SUCCESS != vb2_read_file(filename, &e->data,
+						  &e->size))) {
+		fprintf(stderr, "Error reading %s\n", filename);
+		free(e);
+		return 1;
+	}
+
+	Debug("%s(): preloaded %s\n", __func__, filename);
+	e->kind = kind;
+	e->next = key_cache;
+	key_cache = e;
+	return 0;
+}
+
+int futil_preload_keys(const char *path)
+{
+	char filename[PATH_MAX];
+	enum key_kind kind;
+	struct dirent *de;
+	struct stat sb;
+	DIR *dir;
+	int errorcnt = 0;
+
+	if (stat(path, &sb)) {
+		fprintf(stderr, "Can't stat %s: %s\n", path, strerror(errno));
+		return 1;
+	}
+
+	if (!S_ISDIR(sb.st_mode)) {
+		if (!key_kind_of(path, &kind)) {
+			fprintf(stderr, "Don't know what kind of key %s is\n",
+				path);
+			return 1;
+		}
+		return preload_key_file(path, kind);
+	}
+
+	dir = opendir(path);
+	if (!dir) {
+		fprintf(stderr, "Can't open %s: %s\n", path, strerror(errno));
+		return 1;
+	}
+	while ((de = readdir(dir))) {
+		if (!key_kind_of(de->d_name, &kind))
+			continue;
+		snprintf(filename, sizeof(filename), "%s/%s", path,
+			 de->d_name);
+		errorcnt += preload_key_file(filename, kind);
+	}
+	closedir(dir);
+
+	return !!errorcnt;
+}
+
+/* Returns a copy of the preloaded file contents, or NULL if there aren't any */
+static void *key_cache_copy(const char *filename, enum key_kind kind)
+{
+	const struct key_cache_entry *e = key_cache_find(filename, kind);
+	void *copy;
+
+	if (!e)
+		return NULL;
+
+	copy = malloc(e->size);
+	if (copy)
+		memcpy(copy, e->data, e->size);
+	return copy;
+}
+
+struct vb2_private_key *futil_read_private_key(const char *filename)
+{
+	const struct key_cache_entry *e =
+		key_cache_find(filename, KEY_KIND_PRIVATE);
+
+	return e ? e->private_key : vb2_read_private_key(filename);
+}
+
+void futil_free_private_key(struct vb2_private_key *key)
+{
+	const struct key_cache_entry *e;
+
+	for (e = key_cache; e; e = e->next)
+		if (e->private_key == key)
+			return;
+	vb2_free_private_key(key);
+}
+
+struct vb2_keyblock *futil_read_keyblock(const char *filename)
+{
+	struct vb2_keyblock *key = key_cache_copy(filename, KEY_KIND_KEYBLOCK);
+
+	return key ? key : vb2_read_keyblock(filename);
+}
+
+struct vb2_packed_key *futil_read_packed_key(const char *filename)
+{
+	struct vb2_packed_key *key = key_cache_copy(filename, KEY_KIND_PACKED);
+
+	return key ? key : vb2_read_packed_key(filename);
+}
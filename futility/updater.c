@@ -14,6 +14,7 @@
 #include <unistd.h>
 
 #include "2rsa.h"
+#include "cbfs.h"
 #include "crossystem.h"
 #include "futility.h"
 #include "host_misc.h"
@@ -26,6 +27,7 @@
 #define COMMAND_BUFFER_SIZE 256
 #define RETURN_ON_FAILURE(x) do {int r = (x); if (r) return r;} while (0);
 #define FLASHROM_OUTPUT_WP_PATTERN "write protect is "
+#define FLASH_ERASE_BLOCK_SIZE 0x1000
 
 /* System environment values. */
 static const char * const FWACT_A = "A",
@@ -536,17 +538,21 @@ int find_firmware_section(struct firmware_section *section,
 			  const struct firmware_image *image,
 			  const char *section_name)
 {
-	FmapAreaHeader *fah = NULL;
-	uint8_t *ptr;
+	const FmapAreaHeader *fah = NULL;
 
 	section->data = NULL;
 	section->size = 0;
-	ptr = fmap_find_by_name(
-			image->data, image->size, image->fmap_header,
-			section_name, &fah);
-	if (!ptr)
+	if (image->fmap_index) {
+		fah = fmap_index_find(image->fmap_index, section_name);
+	} else {
+		FmapAreaHeader *ah = NULL;
+		fmap_find_by_name(image->data, image->size, image->fmap_header,
+				  section_name, &ah);
+		fah = ah;
+	}
+	if (!fah)
 		return -1;
-	section->data = (uint8_t *)ptr;
+	section->data = image->data + fah->area_offset;
 	section->size = fah->area_size;
 	return 0;
 }
@@ -570,13 +576,10 @@ static int firmware_section_exists(const struct firmware_image *image,
 static int section_is_filled_with(const struct firmware_section *section,
 				  uint8_t c)
 {
-	uint32_t i;
 	if (!section->size)
 		return 0;
-	for (i = 0; i < section->size; i++)
-		if (section->data[i] != c)
-			return 0;
-	return 1;
+	return vb2_find_unfilled_block(section->data, c, section->size, 0) ==
+			section->size;
 }
 
 /*
@@ -620,7 +623,7 @@ int load_firmware_image(struct firmware_image *image, const char *file_name,
 		ERROR("Does not exist: %s", file_name);
 		return -1;
 	}
-	if (archive_read_file(archive, file_name, &image->data, &image->size) !=
+	if (archive_map_file(archive, file_name, &image->data, &image->size) !=
 	    VB2_SUCCESS) {
 		ERROR("Failed to load %s", file_name);
 		return -1;
@@ -635,6 +638,8 @@ int load_firmware_image(struct firmware_image *image, const char *file_name,
 		ERROR("Invalid image file (missing FMAP): %s", file_name);
 		return -1;
 	}
+	image->fmap_index = fmap_index_create(image->data, image->size,
+					      image->fmap_header);
 
 	if (!firmware_section_exists(image, FMAP_RO_FRID)) {
 		ERROR("Does not look like VBoot firmware image: %s", file_name);
@@ -684,11 +689,12 @@ void free_firmware_image(struct firmware_image *image)
 	 */
 	const char *programmer = image->programmer;
 
-	free(image->data);
+	archive_unmap_file(image->data, image->size);
 	free(image->file_name);
 	free(image->ro_version);
 	free(image->rw_version_a);
 	free(image->rw_version_b);
+	fmap_index_free(image->fmap_index);
 	memset(image, 0, sizeof(*image));
 	image->programmer = programmer;
 }
@@ -1050,6 +1056,21 @@ static int preserve_images(struct updater_config *cfg)
 	return errcnt;
 }
 
+/*
+ * Compares two buffers of the same size, logging the first erase block which
+ * differs.
+ * Returns 0 if given buffers are the same, otherwise non-zero.
+ */
+static int compare_data(const uint8_t *a, const uint8_t *b, size_t size)
+{
+	size_t offset = vb2_find_diff_block(a, b, size, FLASH_ERASE_BLOCK_SIZE);
+
+	if (offset == size)
+		return 0;
+	DEBUG("First difference in the block at offset %#zx.", offset);
+	return 1;
+}
+
 /*
  * Compares if two sections have same size and data.
  * Returns 0 if given sections are the same, otherwise non-zero.
@@ -1059,7 +1080,7 @@ static int compare_section(const struct firmware_section *a,
 {
 	if (a->size != b->size)
 		return a->size - b->size;
-	return memcmp(a->data, b->data, a->size);
+	return compare_data(a->data, b->data, a->size);
 }
 
 /*
@@ -1078,7 +1099,8 @@ static int section_needs_update(const struct firmware_image *image_from,
 	if (!section_name) {
 		if (image_from->size != image_to->size)
 			return -1;
-		return memcmp(image_from->data, image_to->data, image_to->size);
+		return compare_data(image_from->data, image_to->data,
+				    image_to->size);
 	}
 
 	find_firmware_section(&from, image_from, section_name);
@@ -1302,21 +1324,19 @@ static enum rootkey_compat_result check_compatible_root_key(
 
 /*
  * Returns 1 if a given file (cbfs_entry_name) exists inside a particular CBFS
- * section of an image file, otherwise 0.
+ * section of an image, otherwise 0.
  */
-static int cbfs_file_exists(const char *image_file,
+static int cbfs_file_exists(const struct firmware_image *image,
 			    const char *section_name,
 			    const char *cbfs_entry_name)
 {
-	char *cmd;
-	int r;
+	struct firmware_section section;
 
-	ASPRINTF(&cmd,
-		 "cbfstool '%s' print -r %s 2>/dev/null | grep -q '^%s '",
-		 image_file, section_name, cbfs_entry_name);
-	r = system(cmd);
-	free(cmd);
-	return !r;
+	find_firmware_section(&section, image, section_name);
+	if (!section.data)
+		return 0;
+	return !cbfs_find_file(section.data, section.size, cbfs_entry_name,
+			       NULL);
 }
 
 /*
@@ -1327,17 +1347,11 @@ static int legacy_needs_update(struct updater_config *cfg)
 	int has_from, has_to;
 	const char * const tag = "cros_allow_auto_update";
 	const char *section = FMAP_RW_LEGACY;
-	const char *tmp_path = updater_create_temp_file(cfg);
 
 	DEBUG("Checking %s contents...", FMAP_RW_LEGACY);
-	if (!tmp_path ||
-	    vb2_write_file(tmp_path, cfg->image.data, cfg->image.size)) {
-		ERROR("Failed to create temporary file for image contents.");
-		return 0;
-	}
 
-	has_to = cbfs_file_exists(tmp_path, section, tag);
-	has_from = cbfs_file_exists(tmp_path, section, tag);
+	has_to = cbfs_file_exists(&cfg->image, section, tag);
+	has_from = cbfs_file_exists(&cfg->image_current, section, tag);
 
 	if (!has_from || !has_to) {
 		DEBUG("Current legacy firmware has%s updater tag (%s) "
@@ -1785,6 +1799,11 @@ static int updater_output_image(const struct firmware_image *image,
 		return 0;
 
 	ASPRINTF(&fpath, "%s/%s", root, fname);
+	/*
+	 * Replace rather than truncate the file, which may be where the image
+	 * is mapped from (when the output is the archive directory).
+	 */
+	unlink(fpath);
 	r = vb2_write_file(fpath, image->data, image->size);
 	if (r)
 		ERROR("Failed writing firmware image to: %s", fpath);
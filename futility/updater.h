@@ -9,6 +9,7 @@
 #define VBOOT_REFERENCE_FUTILITY_UPDATER_H_
 
 #include <stdio.h>
+#include <sys/types.h>
 
 #include "fmap.h"
 
@@ -54,6 +55,7 @@ struct firmware_image {
 	char *file_name;
 	char *ro_version, *rw_version_a, *rw_version_b;
 	FmapHeader *fmap_header;
+	struct fmap_index *fmap_index;
 };
 
 struct firmware_section {
@@ -307,6 +309,26 @@ int archive_has_entry(struct archive *ar, const char *name);
 int archive_read_file(struct archive *ar, const char *fname,
 		      uint8_t **data, uint32_t *size);
 
+/*
+ * Maps a file from archive into memory, reading it into anonymous memory only
+ * when it can't be mapped (or is outside the archive). Pages are private to
+ * the caller.
+ * Returns 0 on success (data and size reflects the file content),
+ * otherwise non-zero as failure.
+ */
+int archive_map_file(struct archive *ar, const char *fname,
+		     uint8_t **data, uint32_t *size);
+
+/* Releases data returned by archive_map_file. */
+void archive_unmap_file(uint8_t *data, uint32_t size);
+
+/*
+ * Finds the data of a stored entry in the ZIP file open as fd, if its size and
+ * CRC match. Returns the offset of the data in the file, otherwise -1.
+ */
+off_t zip_find_stored_data(int fd, const char *fname, uint32_t size,
+			   uint32_t crc);
+
 /*
  * Writes a file into archive.
  * If entry name (fname) is an absolute path (/file), always write into real
@@ -8,10 +8,12 @@
 
 #include <assert.h>
 #include <ctype.h>
+#include <fcntl.h>
 #include <fts.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -82,10 +84,69 @@ struct archive {
 	int (*has_entry)(void *handle, const char *name);
 	int (*read_file)(void *handle, const char *fname,
 			 uint8_t **data, uint32_t *size);
+	int (*map_file)(void *handle, const char *fname,
+			uint8_t **data, uint32_t *size);
 	int (*write_file)(void *handle, const char *fname,
 			  uint8_t *data, uint32_t size);
 };
 
+/*
+ * Maps size bytes of a file from offset, which needn't be page aligned.
+ * The mapping is private: pages come from the page cache until they are
+ * written, then they are copied, and changes never reach the file.
+ * Returns the address of the data, or NULL on failure.
+ */
+static uint8_t *map_file_range(int fd, off_t offset, uint32_t size)
+{
+	off_t start = offset - offset % sysconf(_SC_PAGESIZE);
+	uint8_t *ptr;
+
+	ptr = mmap(NULL, size + (offset - start), PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE, fd, start);
+	if (ptr == MAP_FAILED)
+		return NULL;
+	return ptr + (offset - start);
+}
+
+/* Allocates anonymous memory which archive_unmap_file() can release. */
+static uint8_t *map_anonymous(uint32_t size)
+{
+	void *ptr = mmap(NULL, size ? size : 1, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	return ptr == MAP_FAILED ? NULL : ptr;
+}
+
+/*
+ * Reads a whole regular file straight into memory from map_anonymous().
+ * Returns 0 on success, otherwise non-zero as failure.
+ */
+static int read_anonymous(int fd, uint8_t **data, uint32_t *size)
+{
+	struct stat st;
+	uint8_t *buf;
+	uint32_t done;
+	ssize_t r;
+
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_size > UINT32_MAX)
+		return 1;
+	buf = map_anonymous(st.st_size);
+	if (!buf) {
+		ERROR("Internal error: cannot allocate memory.");
+		return 1;
+	}
+	for (done = 0; done < st.st_size; done += r) {
+		r = pread(fd, buf + done, st.st_size - done, done);
+		if (r <= 0) {
+			munmap(buf, st.st_size ? st.st_size : 1);
+			return 1;
+		}
+	}
+	*data = buf;
+	*size = st.st_size;
+	return 0;
+}
+
 /*
  * -- Begin of archive implementations --
  */
@@ -179,6 +240,48 @@ static int archive_fallback_read_file(void *handle, const char *fname,
 	return r;
 }
 
+/*
+ * Opens a file for archive_fallback_map_file, and maps it if map is set.
+ * Otherwise, or if it can't be mapped, it is read into anonymous memory.
+ */
+static int archive_fallback_load_file(const char *path, int map,
+				      uint8_t **data, uint32_t *size)
+{
+	struct stat st;
+	int fd, r = 0;
+
+	*data = NULL;
+	*size = 0;
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return 1;
+	/* Empty files can't be mapped, and special files may not be either */
+	if (map && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) &&
+	    st.st_size > 0 && st.st_size <= UINT32_MAX) {
+		*data = map_file_range(fd, 0, st.st_size);
+		if (*data)
+			*size = st.st_size;
+	}
+	if (!*data)
+		r = read_anonymous(fd, data, size);
+	close(fd);
+	return r;
+}
+
+/* Callback for archive_map_file on a general file system. */
+static int archive_fallback_map_file(void *handle, const char *fname,
+				     uint8_t **data, uint32_t *size)
+{
+	char *temp_path = NULL;
+	const char *path = archive_fallback_get_path(handle, fname, &temp_path);
+	int r;
+
+	DEBUG("Mapping %s", path);
+	r = archive_fallback_load_file(path, 1, data, size);
+	free(temp_path);
+	return r;
+}
+
 /* Callback for archive_write_file on a general file system. */
 static int archive_fallback_write_file(void *handle, const char *fname,
 				       uint8_t *data, uint32_t size)
@@ -205,28 +308,130 @@ static int archive_fallback_write_file(void *handle, const char *fname,
 	return r;
 }
 
+static uint32_t get_le16(const uint8_t *p)
+{
+	return p[0] | p[1] << 8;
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/*
+ * Finds the data of a stored (uncompressed, unencrypted) entry in a ZIP file,
+ * from its central directory, which libzip doesn't expose.  The size and
+ * CRC must match what libzip reports, so an entry which has been replaced
+ * since the file was opened is never found.  ZIP64 isn't supported.
+ * This doesn't need libzip, so it is built (and tested) without it.
+ * Returns the offset of the data in the file, or -1 if it can't be mapped.
+ */
+off_t zip_find_stored_data(int fd, const char *fname, uint32_t size,
+			   uint32_t crc)
+{
+	/* End of central directory record, and the longest comment */
+	const uint32_t eocd_size = 22, max_tail = 22 + 0xffff;
+	uint8_t tail[22 + 0xffff], local[30];
+	uint32_t tail_size, cd_size, cd_offset, name_len = strlen(fname);
+	uint8_t *cd = NULL, *p, *end;
+	off_t result = -1;
+	struct stat st;
+	int i;
+
+	if (fstat(fd, &st) || st.st_size < eocd_size)
+		return -1;
+	tail_size = st.st_size < max_tail ? st.st_size : max_tail;
+	if (pread(fd, tail, tail_size, st.st_size - tail_size) != tail_size)
+		return -1;
+	for (i = tail_size - eocd_size; i >= 0; i--)
+		if (get_le32(tail + i) == 0x06054b50)
+			break;
+	if (i < 0)
+		return -1;
+	cd_size = get_le32(tail + i + 12);
+	cd_offset = get_le32(tail + i + 16);
+	if (cd_offset == 0xffffffff || cd_offset > st.st_size ||
+	    cd_size > st.st_size - cd_offset)
+		return -1;
+
+	cd = malloc(cd_size);
+	if (!cd || pread(fd, cd, cd_size, cd_offset) != cd_size)
+		goto done;
+
+	/* Each central directory header is 46 bytes, then variable fields */
+	for (p = cd, end = cd + cd_size; end - p >= 46 &&
+	     get_le32(p) == 0x02014b50;
+	     p += 46 + get_le16(p + 28) + get_le16(p + 30) +
+		  get_le16(p + 32)) {
+		uint32_t local_offset = get_le32(p + 42);
+
+		if (get_le16(p + 28) != name_len || end - p < 46 + name_len ||
+		    memcmp(p + 46, fname, name_len))
+			continue;
+		/* Not encrypted, stored, and what libzip says it is */
+		if ((get_le16(p + 8) & 1) || get_le16(p + 10) != 0 ||
+		    get_le32(p + 16) != crc || get_le32(p + 20) != size ||
+		    get_le32(p + 24) != size)
+			break;
+		if (pread(fd, local, sizeof(local), local_offset) !=
+		    sizeof(local) || get_le32(local) != 0x04034b50)
+			break;
+		result = (off_t)local_offset + sizeof(local) +
+			get_le16(local + 26) + get_le16(local + 28);
+		if (result + size > st.st_size)
+			result = -1;
+		break;
+	}
+done:
+	free(cd);
+	return result;
+}
+
 #ifdef HAVE_LIBZIP
 
+/* An open ZIP file, and a descriptor to map its stored entries from. */
+struct archive_zip {
+	struct zip *zip;
+	int fd;
+};
+
 /* Callback for archive_open on a ZIP file. */
 static void *archive_zip_open(const char *name)
 {
-	return zip_open(name, 0, NULL);
+	struct archive_zip *az = calloc(1, sizeof(*az));
+
+	if (!az)
+		return NULL;
+	az->zip = zip_open(name, 0, NULL);
+	if (!az->zip) {
+		free(az);
+		return NULL;
+	}
+	/* Without this, entries are just read instead of mapped. */
+	az->fd = open(name, O_RDONLY | O_CLOEXEC);
+	return az;
 }
 
 /* Callback for archive_close on a ZIP file. */
 static int archive_zip_close(void *handle)
 {
-	struct zip *zip = (struct zip *)handle;
+	struct archive_zip *az = (struct archive_zip *)handle;
+	int r = 0;
 
-	if (zip)
-		return zip_close(zip);
-	return 0;
+	if (!az)
+		return 0;
+	if (az->zip)
+		r = zip_close(az->zip);
+	if (az->fd >= 0)
+		close(az->fd);
+	free(az);
+	return r;
 }
 
 /* Callback for archive_has_entry on a ZIP file. */
 static int archive_zip_has_entry(void *handle, const char *fname)
 {
-	struct zip *zip = (struct zip *)handle;
+	struct zip *zip = ((struct archive_zip *)handle)->zip;
 	assert(zip);
 	return zip_name_locate(zip, fname, 0) != -1;
 }
@@ -237,7 +442,7 @@ static int archive_zip_walk(
 		int (*callback)(const char *name, void *arg))
 {
 	zip_int64_t num, i;
-	struct zip *zip = (struct zip *)handle;
+	struct zip *zip = ((struct archive_zip *)handle)->zip;
 	assert(zip);
 
 	num = zip_get_num_entries(zip, 0);
@@ -253,11 +458,13 @@ static int archive_zip_walk(
 	return 0;
 }
 
-/* Callback for archive_zip_read_file on a ZIP file. */
-static int archive_zip_read_file(void *handle, const char *fname,
-			     uint8_t **data, uint32_t *size)
+/*
+ * Reads an entry from a ZIP file, into memory from malloc(), or from
+ * map_anonymous() if anonymous is set.
+ */
+static int archive_zip_load_file(struct zip *zip, const char *fname,
+				 int anonymous, uint8_t **data, uint32_t *size)
 {
-	struct zip *zip = (struct zip *)handle;
 	struct zip_file *fp;
 	struct zip_stat stat;
 
@@ -269,18 +476,26 @@ static int archive_zip_read_file(void *handle, const char *fname,
 		ERROR("Fail to stat entry in ZIP: %s", fname);
 		return 1;
 	}
+	if (anonymous && stat.size > UINT32_MAX)
+		return 1;
 	fp = zip_fopen(zip, fname, 0);
 	if (!fp) {
 		ERROR("Failed to open entry in ZIP: %s", fname);
 		return 1;
 	}
-	*data = (uint8_t *)malloc(stat.size);
+	if (anonymous)
+		*data = map_anonymous(stat.size);
+	else
+		*data = (uint8_t *)malloc(stat.size);
 	if (*data) {
 		if (zip_fread(fp, *data, stat.size) == stat.size) {
 			*size = stat.size;
 		} else {
 			ERROR("Failed to read entry in zip: %s", fname);
-			free(*data);
+			if (anonymous)
+				archive_unmap_file(*data, stat.size);
+			else
+				free(*data);
 			*data = NULL;
 		}
 	}
@@ -288,11 +503,51 @@ static int archive_zip_read_file(void *handle, const char *fname,
 	return *data == NULL;
 }
 
+/* Callback for archive_zip_read_file on a ZIP file. */
+static int archive_zip_read_file(void *handle, const char *fname,
+			     uint8_t **data, uint32_t *size)
+{
+	return archive_zip_load_file(((struct archive_zip *)handle)->zip,
+				     fname, 0, data, size);
+}
+
+/* Callback for archive_map_file on a ZIP file. */
+static int archive_zip_map_file(void *handle, const char *fname,
+				uint8_t **data, uint32_t *size)
+{
+	struct archive_zip *az = (struct archive_zip *)handle;
+	const zip_uint64_t need = ZIP_STAT_SIZE | ZIP_STAT_CRC |
+		ZIP_STAT_COMP_METHOD | ZIP_STAT_ENCRYPTION_METHOD;
+	struct zip_stat stat;
+	off_t offset;
+
+	assert(az->zip);
+	*data = NULL;
+	*size = 0;
+	zip_stat_init(&stat);
+	if (az->fd < 0 || zip_stat(az->zip, fname, 0, &stat))
+		return archive_zip_load_file(az->zip, fname, 1, data, size);
+	/* Compressed entries have to be read */
+	if ((stat.valid & need) != need || stat.comp_method != ZIP_CM_STORE ||
+	    stat.encryption_method != ZIP_EM_NONE || !stat.size ||
+	    stat.size > UINT32_MAX)
+		return archive_zip_load_file(az->zip, fname, 1, data, size);
+
+	offset = zip_find_stored_data(az->fd, fname, stat.size, stat.crc);
+	if (offset >= 0)
+		*data = map_file_range(az->fd, offset, stat.size);
+	if (!*data)
+		return archive_zip_load_file(az->zip, fname, 1, data, size);
+	*size = stat.size;
+	DEBUG("Mapped %s from offset %jd", fname, (intmax_t)offset);
+	return 0;
+}
+
 /* Callback for archive_zip_write_file on a ZIP file. */
 static int archive_zip_write_file(void *handle, const char *fname,
 				  uint8_t *data, uint32_t size)
 {
-	struct zip *zip = (struct zip *)handle;
+	struct zip *zip = ((struct archive_zip *)handle)->zip;
 	struct zip_source *src;
 
 	DEBUG("Writing %s", fname);
@@ -346,6 +601,7 @@ struct archive *archive_open(const char *path)
 		ar->walk = archive_fallback_walk;
 		ar->has_entry = archive_fallback_has_entry;
 		ar->read_file = archive_fallback_read_file;
+		ar->map_file = archive_fallback_map_file;
 		ar->write_file = archive_fallback_write_file;
 	} else {
 #ifdef HAVE_LIBZIP
@@ -355,6 +611,7 @@ struct archive *archive_open(const char *path)
 		ar->walk = archive_zip_walk;
 		ar->has_entry = archive_zip_has_entry;
 		ar->read_file = archive_zip_read_file;
+		ar->map_file = archive_zip_map_file;
 		ar->write_file = archive_zip_write_file;
 #else
 		ERROR("Found file, but no drivers were enabled: %s", path);
@@ -426,6 +683,38 @@ int archive_read_file(struct archive *ar, const char *fname,
 	return ar->read_file(ar->handle, fname, data, size);
 }
 
+/*
+ * Maps a file from archive into memory, avoiding a copy when possible.
+ * Files in a directory and stored (uncompressed) files in a ZIP are mapped
+ * privately: pages are only copied when they are written, for example when
+ * an image is patched, and changes never reach the archive. Other files are
+ * read straight into anonymous memory, without a temporary buffer. Files
+ * outside an archive (no archive, or an absolute path) are always read, since
+ * the updater may rewrite them.
+ * Returns 0 on success (data and size reflects the file content; release with
+ * archive_unmap_file), otherwise non-zero as failure.
+ */
+int archive_map_file(struct archive *ar, const char *fname,
+		     uint8_t **data, uint32_t *size)
+{
+	if (!ar || *fname == '/')
+		return archive_fallback_load_file(fname, 0, data, size);
+	return ar->map_file(ar->handle, fname, data, size);
+}
+
+/* Releases data from archive_map_file. */
+void archive_unmap_file(uint8_t *data, uint32_t size)
+{
+	uintptr_t start;
+
+	if (!data)
+		return;
+	/* Mappings from a file start at a page boundary before the data. */
+	start = (uintptr_t)data - (uintptr_t)data % sysconf(_SC_PAGESIZE);
+	size += (uintptr_t)data - start;
+	munmap((void *)start, size ? size : 1);
+}
+
 /*
  * Writes a file into archive.
  * If entry name (fname) is an absolute path (/file), always write into real
@@ -453,13 +742,13 @@ static int archive_copy_callback(const char *path, void *_arg)
 	int r;
 
 	INFO("Copying: %s", path);
-	if (archive_read_file(arg->from, path, &data, &size)) {
+	if (archive_map_file(arg->from, path, &data, &size)) {
 		ERROR("Failed reading: %s", path);
 		return 1;
 	}
 	r = archive_write_file(arg->to, path, data, size);
 	DEBUG("result=%d", r);
-	free(data);
+	archive_unmap_file(data, size);
 	return r;
 }
 
@@ -12,6 +12,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 
+#include "cbfs.h"
 #include "futility.h"
 #include "host_misc.h"
 #include "updater.h"
@@ -239,61 +240,45 @@ static int quirk_daisy_snow_dual_model(struct updater_config *cfg)
 	return 0;
 }
 
-/*
- * Extracts files from a CBFS on given region (section) of image_file.
- * Returns the path to a temporary file on success, otherwise NULL.
- */
-static const char *extract_cbfs_file(struct updater_config *cfg,
-				     const char *image_file,
-				     const char *cbfs_region,
-				     const char *cbfs_name)
-{
-	const char *output = updater_create_temp_file(cfg);
-	char *command, *result;
-
-	ASPRINTF(&command, "cbfstool \"%s\" extract -r %s -n \"%s\" "
-		 "-f \"%s\" 2>&1", image_file, cbfs_region,
-		 cbfs_name, output);
-
-	result = host_shell(command);
-	free(command);
-
-	if (!*result)
-		output = NULL;
-
-	free(result);
-	return output;
-}
-
 /*
  * Quirk to help preserving SMM store on devices without a dedicated "SMMSTORE"
  * FMAP section. These devices will store "smm_store" file in same CBFS where
  * the legacy boot loader lives (i.e, FMAP RW_LEGACY).
- * Note this currently has dependency on external program "cbstool".
+ * The store is copied in place if the new image has an "smm_store" of the same
+ * size; otherwise the external program "cbfstool" is needed to add it.
  * Returns 0 if the SMM store is properly preserved, or if the system is not
- * available to do that (problem in cbfstool, or no "smm_store" in current
- * system firmware). Otherwise non-zero as failure.
+ * available to do that (no "smm_store" in current system firmware).
+ * Otherwise non-zero as failure.
  */
 static int quirk_eve_smm_store(struct updater_config *cfg)
 {
 	const char *smm_store_name = "smm_store";
-	const char *temp_image = updater_create_temp_file(cfg);
-	const char *old_store;
+	const char *temp_image, *temp_store;
+	struct firmware_section from, to;
+	struct cbfs_entry old_store;
 	char *command;
 
-	if (write_image(temp_image, &cfg->image_current) != VBERROR_SUCCESS)
-		return -1;
-
-	old_store = extract_cbfs_file(cfg, temp_image, FMAP_RW_LEGACY,
-				      smm_store_name);
-	if (!old_store) {
-		DEBUG("cbfstool failure or SMM store not available. "
-		      "Don't preserve.");
+	find_firmware_section(&from, &cfg->image_current, FMAP_RW_LEGACY);
+	if (!from.data ||
+	    cbfs_find_file(from.data, from.size, smm_store_name, &old_store) ||
+	    old_store.compression) {
+		DEBUG("SMM store not available. Don't preserve.");
 		return 0;
 	}
 
-	/* Reuse temp_image. */
-	if (write_image(temp_image, &cfg->image) != VBERROR_SUCCESS)
+	find_firmware_section(&to, &cfg->image, FMAP_RW_LEGACY);
+	if (to.data && !cbfs_replace_file(to.data, to.size, smm_store_name,
+					  from.data + old_store.data_offset,
+					  old_store.size))
+		return 0;
+
+	DEBUG("No room for %s in place, using cbfstool.", smm_store_name);
+	temp_image = updater_create_temp_file(cfg);
+	temp_store = updater_create_temp_file(cfg);
+	if (!temp_image || !temp_store ||
+	    vb2_write_file(temp_store, from.data + old_store.data_offset,
+			   old_store.size) ||
+	    write_image(temp_image, &cfg->image) != VBERROR_SUCCESS)
 		return -1;
 
 	/* crosreview.com/1165109: The offset is fixed at 0x1bf000. */
@@ -302,7 +287,7 @@ static int quirk_eve_smm_store(struct updater_config *cfg)
 		 "cbfstool \"%s\" add -r %s -n \"%s\" -f \"%s\" "
 		 " -t raw -b 0x1bf000", temp_image, FMAP_RW_LEGACY,
 		 smm_store_name, temp_image, FMAP_RW_LEGACY,
-		 smm_store_name, old_store);
+		 smm_store_name, temp_store);
 	host_shell(command);
 	free(command);
 
@@ -737,6 +737,11 @@ enum futil_file_type ft_recognize_vblock1(uint8_t *buf, uint32_t len)
 	struct vb2_workbuf wb;
 	vb2_workbuf_init(&wb, workbuf, sizeof(workbuf));
 
+	/* Don't bother copying big buffers that can't be keyblocks */
+	if (len < sizeof(struct vb2_keyblock) ||
+	    memcmp(buf, KEY_BLOCK_MAGIC, KEY_BLOCK_MAGIC_SIZE))
+		return FILE_TYPE_UNKNOWN;
+
 	/* Vboot 2.0 signature checks destroy the buffer, so make a copy */
 	uint8_t *buf2 = malloc(len);
 	memcpy(buf2, buf, len);
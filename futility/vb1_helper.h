@@ -13,6 +13,9 @@ struct vb2_packed_key;
 /* Display a public key with variable indentation */
 void show_pubkey(const struct vb2_packed_key *pubkey, const char *sp);
 
+/* Display a public key as members of a JSON object */
+void json_pubkey(const struct vb2_packed_key *pubkey);
+
 /* Other random functions needed for backward compatibility */
 
 uint8_t *ReadConfigFile(const char *config_file, uint32_t *config_size);
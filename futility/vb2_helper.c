@@ -191,7 +191,13 @@ static RSA *rsa_from_buffer(uint8_t *buf, uint32_t len)
 
 enum futil_file_type ft_recognize_pem(uint8_t *buf, uint32_t len)
 {
-	RSA *rsa_key = rsa_from_buffer(buf, len);
+	RSA *rsa_key;
+
+	/* Don't make OpenSSL parse big binaries line by line */
+	if (!memmem(buf, len, "-----BEGIN", 10))
+		return FILE_TYPE_UNKNOWN;
+
+	rsa_key = rsa_from_buffer(buf, len);
 
 	if (rsa_key) {
 		RSA_free(rsa_key);
@@ -495,8 +495,13 @@ int vb2_read_nv_storage(struct vb2_context *ctx)
 	media = ReadFdtString(FDT_NVSTORAGE_TYPE_PROP);
 	if (!strcmp(media, "disk"))
 		return vb2_read_nv_storage_disk(ctx);
-	if (!strcmp(media, "cros-ec") || !strcmp(media, "mkbp") ||
-	    !strcmp(media, "flash"))
+	if (!strcmp(media, "cros-ec") || !strcmp(media, "mkbp")) {
+		/* Talk to the EC directly; fall back to mosys if that fails */
+		if (!vb2_read_nv_storage_cros_ec(ctx))
+			return 0;
+		return vb2_read_nv_storage_mosys(ctx);
+	}
+	if (!strcmp(media, "flash"))
 		return vb2_read_nv_storage_mosys(ctx);
 	return -1;
 }
@@ -511,8 +516,13 @@ int vb2_write_nv_storage(struct vb2_context *ctx)
 	media = ReadFdtString(FDT_NVSTORAGE_TYPE_PROP);
 	if (!strcmp(media, "disk"))
 		return vb2_write_nv_storage_disk(ctx);
-	if (!strcmp(media, "cros-ec") || !strcmp(media, "mkbp") ||
-	    !strcmp(media, "flash"))
+	if (!strcmp(media, "cros-ec") || !strcmp(media, "mkbp")) {
+		/* Talk to the EC directly; fall back to mosys if that fails */
+		if (!vb2_write_nv_storage_cros_ec(ctx))
+			return 0;
+		return vb2_write_nv_storage_mosys(ctx);
+	}
+	if (!strcmp(media, "flash"))
 		return vb2_write_nv_storage_mosys(ctx);
 	return -1;
 }
@@ -28,6 +28,50 @@ int vb2_read_nv_storage_mosys(struct vb2_context *ctx);
  */
 int vb2_write_nv_storage_mosys(struct vb2_context* ctx);
 
+/**
+ * Attempt to read non-volatile storage directly from the EC.
+ *
+ * This talks to the cros_ec character device in-process, so it avoids the
+ * cost of spawning mosys.  Only the 16-byte (V1) nvdata layout can be stored
+ * in the EC.
+ *
+ * Returns 0 if success, non-zero if error.
+ */
+int vb2_read_nv_storage_cros_ec(struct vb2_context *ctx);
+
+/**
+ * Attempt to write non-volatile storage directly to the EC.
+ *
+ * Returns 0 if success, non-zero if error.
+ */
+int vb2_write_nv_storage_cros_ec(struct vb2_context *ctx);
+
+/**
+ * Read non-volatile storage from a file holding the raw nvdata bytes.
+ *
+ * A missing file reads as all zeroes, so that vb2_nv_init() regenerates the
+ * defaults the same way it would for blank NV storage.
+ *
+ * Returns 0 if success, non-zero if error.
+ */
+int vb2_read_nv_storage_file(struct vb2_context *ctx, const char *filename);
+
+/**
+ * Write non-volatile storage to a file as raw nvdata bytes.
+ *
+ * Returns 0 if success, non-zero if error.
+ */
+int vb2_write_nv_storage_file(struct vb2_context *ctx, const char *filename);
+
+/**
+ * Emulate non-volatile storage with a file instead of the platform backend.
+ *
+ * All subsequent NV accesses made through crossystem use the file at
+ * |filename|.  Pass NULL to go back to the platform backend.  This lets
+ * crossystem NV access be exercised on hosts without real NV storage.
+ */
+void vb2_nv_storage_emulate(const char *filename);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,147 @@
+/* Copyright 2018 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Minimal CBFS (coreboot filesystem) access for firmware images in memory.
+ */
+
+#include <string.h>
+
+#include "cbfs.h"
+
+static uint32_t read_be32(const void *p)
+{
+	const uint8_t *b = p;
+
+	return (uint32_t)b[0] << 24 | (uint32_t)b[1] << 16 |
+		(uint32_t)b[2] << 8 | b[3];
+}
+
+/* Returns the compression algorithm from the file attributes, or 0 */
+static uint32_t get_compression(const uint8_t *header, uint32_t attr_offset,
+				uint32_t data_offset)
+{
+	while (attr_offset &&
+	       attr_offset + sizeof(struct cbfs_file_attribute) <= data_offset) {
+		const uint8_t *attr = header + attr_offset;
+		uint32_t tag = read_be32(attr);
+		uint32_t len = read_be32(attr + 4);
+
+		if (tag == CBFS_FILE_ATTR_TAG_UNUSED ||
+		    tag == CBFS_FILE_ATTR_TAG_UNUSED2 ||
+		    len < sizeof(struct cbfs_file_attribute) ||
+		    len > data_offset - attr_offset)
+			break;
+		if (tag == CBFS_FILE_ATTR_TAG_COMPRESSION &&
+		    len >= sizeof(struct cbfs_file_attr_compression))
+			return read_be32(attr + 8);
+		attr_offset += len;
+	}
+	return 0;
+}
+
+/*
+ * Parse the file header at offset.  Returns 0 and fills entry if it's a sane
+ * header which fits in the CBFS, otherwise non-zero.
+ */
+static int parse_header(const uint8_t *cbfs, uint32_t size, uint32_t offset,
+			struct cbfs_entry *entry)
+{
+	const uint8_t *h = cbfs + offset;
+	uint32_t room = size - offset;
+	uint32_t len, type, attr_offset, data_offset, name_end;
+
+	if (room < sizeof(struct cbfs_file_header) ||
+	    memcmp(h, CBFS_FILE_MAGIC, CBFS_FILE_MAGIC_SIZE))
+		return 1;
+
+	len = read_be32(h + 8);
+	type = read_be32(h + 12);
+	attr_offset = read_be32(h + 16);
+	data_offset = read_be32(h + 20);
+
+	if (data_offset <= sizeof(struct cbfs_file_header) ||
+	    data_offset > room || len > room - data_offset)
+		return 1;
+	if (attr_offset && (attr_offset <= sizeof(struct cbfs_file_header) ||
+			    attr_offset > data_offset))
+		return 1;
+
+	/* The name runs up to the attributes, if any, else to the data */
+	name_end = attr_offset ? attr_offset : data_offset;
+	if (!memchr(h + sizeof(struct cbfs_file_header), 0,
+		    name_end - sizeof(struct cbfs_file_header)))
+		return 1;
+
+	entry->name = (const char *)h + sizeof(struct cbfs_file_header);
+	entry->header_offset = offset;
+	entry->data_offset = offset + data_offset;
+	entry->size = len;
+	entry->type = type;
+	entry->compression = get_compression(h, attr_offset, data_offset);
+	return 0;
+}
+
+static uint32_t cbfs_align(uint32_t offset)
+{
+	return (offset + CBFS_ALIGNMENT - 1) & ~(CBFS_ALIGNMENT - 1);
+}
+
+int cbfs_next_file(const uint8_t *cbfs, uint32_t size, uint32_t *offset,
+		   struct cbfs_entry *entry)
+{
+	uint32_t pos = cbfs_align(*offset);
+	uint32_t next;
+
+	while (pos < size) {
+		/*
+		 * Like coreboot, step over anything which isn't a file header
+		 * one alignment unit at a time.
+		 */
+		if (parse_header(cbfs, size, pos, entry)) {
+			pos += CBFS_ALIGNMENT;
+			continue;
+		}
+
+		/* The next header is aligned after the data */
+		next = cbfs_align(entry->data_offset + entry->size);
+		if (entry->type == CBFS_TYPE_DELETED ||
+		    entry->type == CBFS_TYPE_NULL) {
+			pos = next;
+			continue;
+		}
+		*offset = next;
+		return 0;
+	}
+	*offset = size;
+	return 1;
+}
+
+int cbfs_find_file(const uint8_t *cbfs, uint32_t size, const char *name,
+		   struct cbfs_entry *entry)
+{
+	struct cbfs_entry e;
+	uint32_t offset = 0;
+
+	while (!cbfs_next_file(cbfs, size, &offset, &e)) {
+		if (strcmp(e.name, name))
+			continue;
+		if (entry)
+			*entry = e;
+		return 0;
+	}
+	return 1;
+}
+
+int cbfs_replace_file(uint8_t *cbfs, uint32_t size, const char *name,
+		      const uint8_t *data, uint32_t data_size)
+{
+	struct cbfs_entry e;
+
+	if (cbfs_find_file(cbfs, size, name, &e))
+		return 1;
+	if (e.compression || e.size != data_size)
+		return 1;
+	memcpy(cbfs + e.data_offset, data, data_size);
+	return 0;
+}
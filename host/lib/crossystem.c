@@ -10,6 +10,8 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <ctype.h>
+#include <errno.h>
+#include <sys/ioctl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
@@ -35,6 +37,32 @@
 #define MOSYS_CROS_PATH "/usr/sbin/mosys"
 #define MOSYS_ANDROID_PATH "/system/bin/mosys"
 
+/* Character device for talking to the EC */
+#define CROS_EC_DEV_PATH "/dev/cros_ec"
+
+/* cros_ec character device ioctl interface (linux/mfd/cros_ec_dev.h) */
+struct cros_ec_command_v2 {
+	uint32_t version;
+	uint32_t command;
+	uint32_t outsize;
+	uint32_t insize;
+	uint32_t result;
+	uint8_t data[0];
+};
+#define CROS_EC_DEV_IOCXCMD_V2 _IOWR(0xEC, 0, struct cros_ec_command_v2)
+
+/* EC host command for the vboot nvdata block (ec_commands.h) */
+#define EC_CMD_VBNV_CONTEXT 0x0017
+#define EC_VER_VBNV_CONTEXT 1
+#define EC_VBNV_BLOCK_SIZE 16
+#define EC_VBNV_CONTEXT_OP_READ 0
+#define EC_VBNV_CONTEXT_OP_WRITE 1
+
+struct ec_params_vbnvcontext {
+	uint32_t op;
+	uint8_t block[EC_VBNV_BLOCK_SIZE];
+} __attribute__((packed));
+
 /* Fields that GetVdatString() can get */
 typedef enum VdatStringField {
 	VDAT_STRING_TIMERS = 0,           /* Timer values */
@@ -97,6 +125,29 @@ int FwidStartsWith(const char *start)
 
 static int vnc_read;
 
+/* File used to emulate NV storage, or NULL to use the platform backend */
+static const char *nv_emulation_file;
+
+void vb2_nv_storage_emulate(const char *filename)
+{
+	nv_emulation_file = filename;
+	vnc_read = 0;
+}
+
+static int read_nv_storage(struct vb2_context *ctx)
+{
+	if (nv_emulation_file)
+		return vb2_read_nv_storage_file(ctx, nv_emulation_file);
+	return vb2_read_nv_storage(ctx);
+}
+
+static int write_nv_storage(struct vb2_context *ctx)
+{
+	if (nv_emulation_file)
+		return vb2_write_nv_storage_file(ctx, nv_emulation_file);
+	return vb2_write_nv_storage(ctx);
+}
+
 int vb2_get_nv_storage(enum vb2_nv_param param)
 {
 	VbSharedDataHeader* sh = VbSharedDataRead();
@@ -107,7 +158,7 @@ int vb2_get_nv_storage(enum vb2_nv_param param)
 		memset(&cached_ctx, 0, sizeof(cached_ctx));
 		if (sh && sh->flags & VBSD_NVDATA_V2)
 			cached_ctx.flags |= VB2_CONTEXT_NVDATA_V2;
-		if (0 != vb2_read_nv_storage(&cached_ctx))
+		if (0 != read_nv_storage(&cached_ctx))
 			return -1;
 		vb2_nv_init(&cached_ctx);
 
@@ -129,14 +180,14 @@ int vb2_set_nv_storage(enum vb2_nv_param param, int value)
 	memset(&ctx, 0, sizeof(ctx));
 	if (sh && sh->flags & VBSD_NVDATA_V2)
 		ctx.flags |= VB2_CONTEXT_NVDATA_V2;
-	if (0 != vb2_read_nv_storage(&ctx))
+	if (0 != read_nv_storage(&ctx))
 		return -1;
 	vb2_nv_init(&ctx);
 	vb2_nv_set(&ctx, param, (uint32_t)value);
 
 	if (ctx.flags & VB2_CONTEXT_NVDATA_CHANGED) {
 		vnc_read = 0;
-		if (0 != vb2_write_nv_storage(&ctx))
+		if (0 != write_nv_storage(&ctx))
 			return -1;
 	}
 
@@ -920,3 +971,105 @@ int vb2_write_nv_storage_mosys(struct vb2_context *ctx)
 		return -1;
 	return 0;
 }
+
+/*
+ * Send an EC_CMD_VBNV_CONTEXT request to the EC.  For a read, the block
+ * returned by the EC is copied into |block|.
+ */
+static int cros_ec_vbnv_context(uint32_t op, uint8_t *block)
+{
+	uint8_t buf[sizeof(struct cros_ec_command_v2) +
+		    sizeof(struct ec_params_vbnvcontext)]
+		__attribute__((aligned(4)));
+	struct cros_ec_command_v2 *cmd = (struct cros_ec_command_v2 *)buf;
+	struct ec_params_vbnvcontext params;
+	int fd, rv;
+
+	memset(buf, 0, sizeof(buf));
+	cmd->version = EC_VER_VBNV_CONTEXT;
+	cmd->command = EC_CMD_VBNV_CONTEXT;
+	cmd->outsize = sizeof(params);
+	cmd->insize = (op == EC_VBNV_CONTEXT_OP_READ) ? EC_VBNV_BLOCK_SIZE : 0;
+
+	memset(&params, 0, sizeof(params));
+	params.op = op;
+	if (op == EC_VBNV_CONTEXT_OP_WRITE)
+		memcpy(params.block, block, EC_VBNV_BLOCK_SIZE);
+	memcpy(cmd->data, &params, sizeof(params));
+
+	fd = open(CROS_EC_DEV_PATH, O_RDWR);
+	if (fd < 0)
+		return -1;
+	rv = ioctl(fd, CROS_EC_DEV_IOCXCMD_V2, buf);
+	close(fd);
+
+	if (rv < 0 || cmd->result != 0) {
+		fprintf(stderr, "%s: EC_CMD_VBNV_CONTEXT failed (%d, %d)\n",
+			__FUNCTION__, rv, cmd->result);
+		return -1;
+	}
+
+	if (op == EC_VBNV_CONTEXT_OP_READ)
+		memcpy(block, cmd->data, EC_VBNV_BLOCK_SIZE);
+	return 0;
+}
+
+int vb2_read_nv_storage_cros_ec(struct vb2_context *ctx)
+{
+	if (vb2_nv_get_size(ctx) != EC_VBNV_BLOCK_SIZE)
+		return -1;
+	return cros_ec_vbnv_context(EC_VBNV_CONTEXT_OP_READ, ctx->nvdata);
+}
+
+int vb2_write_nv_storage_cros_ec(struct vb2_context *ctx)
+{
+	if (vb2_nv_get_size(ctx) != EC_VBNV_BLOCK_SIZE)
+		return -1;
+	return cros_ec_vbnv_context(EC_VBNV_CONTEXT_OP_WRITE, ctx->nvdata);
+}
+
+int vb2_read_nv_storage_file(struct vb2_context *ctx, const char *filename)
+{
+	const int nvsize = vb2_nv_get_size(ctx);
+	int fd;
+	ssize_t n;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		if (errno != ENOENT)
+			return -1;
+		/* Blank NV storage; vb2_nv_init() will regenerate it */
+		memset(ctx->nvdata, 0, nvsize);
+		return 0;
+	}
+	n = read(fd, ctx->nvdata, nvsize);
+	close(fd);
+
+	if (n != nvsize) {
+		fprintf(stderr, "%s: short nvdata in %s (%d, need %d)\n",
+			__FUNCTION__, filename, (int)n, nvsize);
+		return -1;
+	}
+	return 0;
+}
+
+int vb2_write_nv_storage_file(struct vb2_context *ctx, const char *filename)
+{
+	const int nvsize = vb2_nv_get_size(ctx);
+	int fd;
+	ssize_t n;
+
+	fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "%s: failed to open %s\n", __FUNCTION__,
+			filename);
+		return -1;
+	}
+	n = write(fd, ctx->nvdata, nvsize);
+	if (close(fd) < 0 || n != nvsize) {
+		fprintf(stderr, "%s: failed to write %s\n", __FUNCTION__,
+			filename);
+		return -1;
+	}
+	return 0;
+}
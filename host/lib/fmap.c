@@ -5,6 +5,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
 
@@ -25,23 +26,60 @@ static int is_fmap(uint8_t *ptr)
 	return 0;
 }
 
-/* Find and point to the FMAP header within the buffer */
+/*
+ * Below this alignment, look for the signature with memmem() instead of
+ * probing every aligned offset.
+ */
+#define FMAP_PROBE_MIN_ALIGN 0x1000
+
+/*
+ * Find and point to the FMAP header within the buffer.
+ *
+ * The FMAP signature may also show up elsewhere in the image (in code that
+ * looks for the FMAP, for example), so we want the candidate with the largest
+ * alignment, and the lowest offset among those.  FMAPs are normally well
+ * aligned, so probe the large alignments first and stop at the first valid
+ * header.  If there's none there, let memmem() find each remaining occurrence
+ * and keep the best one, rather than comparing at every small stride.
+ */
 FmapHeader *fmap_find(uint8_t *ptr, size_t size)
 {
 	ssize_t offset, align;
 	ssize_t lim = size - sizeof(FmapHeader);
+	uint8_t *p = ptr, *end = ptr + size;
+	FmapHeader *best = NULL;
+	size_t best_align = 0;
 
-	if (lim >= 0 && is_fmap(ptr))
+	if (lim < 0)
+		return NULL;
+	if (is_fmap(ptr))
 		return (FmapHeader *)ptr;
 
 	/* Search large alignments before small ones to find "right" FMAP. */
-	for (align = FMAP_SEARCH_STRIDE; align <= lim; align *= 2);
-	for (; align >= FMAP_SEARCH_STRIDE; align /= 2)
+	for (align = FMAP_PROBE_MIN_ALIGN; align <= lim; align *= 2);
+	for (; align >= FMAP_PROBE_MIN_ALIGN; align /= 2)
 		for (offset = align; offset <= lim; offset += align * 2)
 			if (is_fmap(ptr + offset))
 				return (FmapHeader *)(ptr + offset);
 
-	return NULL;
+	while ((p = memmem(p, end - p, FMAP_SIGNATURE, FMAP_SIGNATURE_SIZE))) {
+		offset = p - ptr;
+		if (offset > lim)
+			break;
+
+		/* Largest power of two that divides the offset */
+		align = offset & -offset;
+		/* Larger alignments were probed already */
+		if (align >= FMAP_SEARCH_STRIDE &&
+		    align < FMAP_PROBE_MIN_ALIGN && align > best_align &&
+		    is_fmap(p)) {
+			best = (FmapHeader *)p;
+			best_align = align;
+		}
+		p++;
+	}
+
+	return best;
 }
 
 /* Search for an area by name, return pointer to its beginning */
@@ -66,3 +104,88 @@ uint8_t *fmap_find_by_name(uint8_t *ptr, size_t size, FmapHeader *fmap,
 
 	return NULL;
 }
+
+/* FNV-1a hash of an area name */
+static uint32_t fmap_name_hash(const char *name)
+{
+	uint32_t hash = 2166136261U;
+	int i;
+
+	for (i = 0; i < FMAP_NAMELEN && name[i]; i++)
+		hash = (hash ^ (uint8_t)name[i]) * 16777619U;
+	return hash;
+}
+
+struct fmap_index *fmap_index_create(uint8_t *ptr, size_t size,
+				     FmapHeader *fmap)
+{
+	struct fmap_index *index;
+	FmapAreaHeader *ah;
+	uint32_t nareas, nslots, i, slot;
+
+	if (!fmap)
+		fmap = fmap_find(ptr, size);
+	if (!fmap)
+		return NULL;
+
+	/* Don't trust the area count to stay inside the buffer */
+	ah = (FmapAreaHeader *)((uint8_t *)fmap + sizeof(FmapHeader));
+	nareas = fmap->fmap_nareas;
+	if ((uint8_t *)(ah + nareas) > ptr + size)
+		nareas = (ptr + size - (uint8_t *)ah) / sizeof(*ah);
+
+	/* Keep the table at most half full */
+	for (nslots = 4; nslots < 2 * nareas; nslots *= 2)
+		;
+
+	index = malloc(sizeof(*index) + nareas * sizeof(*ah) +
+		       nslots * sizeof(*index->slots));
+	if (!index)
+		return NULL;
+	index->nareas = nareas;
+	index->nslots = nslots;
+	index->areas = (FmapAreaHeader *)(index + 1);
+	index->slots = (int32_t *)(index->areas + nareas);
+	memcpy(index->areas, ah, nareas * sizeof(*ah));
+	for (slot = 0; slot < nslots; slot++)
+		index->slots[slot] = -1;
+
+	for (i = 0; i < nareas; i++) {
+		slot = fmap_name_hash(ah[i].area_name) & (nslots - 1);
+		while (index->slots[slot] >= 0) {
+			/* Like fmap_find_by_name(), the first one wins */
+			if (!strncmp(index->areas[index->slots[slot]].area_name,
+				     ah[i].area_name, FMAP_NAMELEN))
+				break;
+			slot = (slot + 1) & (nslots - 1);
+		}
+		if (index->slots[slot] < 0)
+			index->slots[slot] = i;
+	}
+
+	return index;
+}
+
+void fmap_index_free(struct fmap_index *index)
+{
+	free(index);
+}
+
+const FmapAreaHeader *fmap_index_find(const struct fmap_index *index,
+				      const char *name)
+{
+	uint32_t slot;
+	int32_t i;
+
+	if (!index)
+		return NULL;
+
+	slot = fmap_name_hash(name) & (index->nslots - 1);
+	while ((i = index->slots[slot]) >= 0) {
+		if (!strncmp(index->areas[i].area_name, name, FMAP_NAMELEN))
+			return index->areas + i;
+		slot = (slot + 1) & (index->nslots - 1);
+	}
+
+	return NULL;
+}
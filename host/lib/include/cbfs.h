@@ -0,0 +1,103 @@
+/* Copyright 2018 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Minimal CBFS (coreboot filesystem) access for firmware images in memory.
+ */
+
+#ifndef VBOOT_REFERENCE_CBFS_H_
+#define VBOOT_REFERENCE_CBFS_H_
+
+#include <stdint.h>
+
+/* CBFS structs, from coreboot's cbfs_serialized.h; fields are big-endian */
+#define CBFS_FILE_MAGIC "LARCHIVE"
+#define CBFS_FILE_MAGIC_SIZE 8
+#define CBFS_ALIGNMENT 64
+
+/* File types for empty space; these aren't reported as files */
+#define CBFS_TYPE_DELETED 0x00000000
+#define CBFS_TYPE_NULL 0xffffffff
+
+#define CBFS_TYPE_RAW 0x50
+
+#define CBFS_FILE_ATTR_TAG_UNUSED 0x00000000
+#define CBFS_FILE_ATTR_TAG_UNUSED2 0xffffffff
+#define CBFS_FILE_ATTR_TAG_COMPRESSION 0x42435a4c
+
+struct cbfs_file_header {
+	char magic[CBFS_FILE_MAGIC_SIZE];
+	uint32_t len;			/* Size of file data */
+	uint32_t type;
+	uint32_t attributes_offset;	/* From start of header, or 0 */
+	uint32_t offset;		/* Of file data, from start of header */
+	/* Followed by the null-terminated file name */
+} __attribute__((packed));
+
+struct cbfs_file_attribute {
+	uint32_t tag;
+	uint32_t len;			/* Including tag and len */
+} __attribute__((packed));
+
+struct cbfs_file_attr_compression {
+	uint32_t tag;
+	uint32_t len;
+	uint32_t compression;
+	uint32_t decompressed_size;
+} __attribute__((packed));
+
+/* A file found in a CBFS, with offsets relative to the start of the CBFS */
+struct cbfs_entry {
+	const char *name;		/* Points into the CBFS */
+	uint32_t header_offset;
+	uint32_t data_offset;
+	uint32_t size;
+	uint32_t type;
+	uint32_t compression;		/* 0 if the data isn't compressed */
+};
+
+/**
+ * Get the next file in a CBFS.
+ *
+ * Empty space and deleted files are skipped, as are headers which don't fit
+ * in the CBFS.
+ *
+ * @param cbfs		CBFS contents, such as an FMAP section
+ * @param size		Size of the CBFS in bytes
+ * @param offset	Where to start looking; start with 0.  On success, this
+ *			is moved past the file returned.
+ * @param entry		Destination for the file found
+ * @return 0 if a file was found, non-zero at the end of the CBFS.
+ */
+int cbfs_next_file(const uint8_t *cbfs, uint32_t size, uint32_t *offset,
+		   struct cbfs_entry *entry);
+
+/**
+ * Find a file by name.
+ *
+ * @param cbfs		CBFS contents
+ * @param size		Size of the CBFS in bytes
+ * @param name		File name to look for
+ * @param entry		Destination for the file found, or NULL
+ * @return 0 if the file was found, non-zero if not.
+ */
+int cbfs_find_file(const uint8_t *cbfs, uint32_t size, const char *name,
+		   struct cbfs_entry *entry);
+
+/**
+ * Replace the contents of a file in place.
+ *
+ * The new contents must be exactly the size of the old ones, so no other
+ * file moves.  Compressed files can't be replaced.
+ *
+ * @param cbfs		CBFS contents
+ * @param size		Size of the CBFS in bytes
+ * @param name		File to replace
+ * @param data		New file contents
+ * @param data_size	Size of new contents in bytes
+ * @return 0 if success, non-zero if error.
+ */
+int cbfs_replace_file(uint8_t *cbfs, uint32_t size, const char *name,
+		      const uint8_t *data, uint32_t data_size);
+
+#endif  /* VBOOT_REFERENCE_CBFS_H_ */
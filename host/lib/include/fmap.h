@@ -47,4 +47,34 @@ uint8_t *fmap_find_by_name(uint8_t *ptr, size_t size,
 			   /* optional, return pointer to entry if not NULL */
 			   FmapAreaHeader **ah);
 
+/*
+ * Index of the areas in an FMAP, for callers that look up many areas by name.
+ * It holds copies of the area headers, so it stays valid if the image buffer
+ * is moved; the area data is at the area_offset within the image.
+ */
+struct fmap_index {
+	uint32_t nareas;
+	uint32_t nslots;		/* Hash table size, a power of two */
+	FmapAreaHeader *areas;		/* Area headers, in FMAP order */
+	int32_t *slots;			/* Index into areas, or -1 if empty */
+};
+
+/*
+ * Build an index of the areas in the FMAP.  If fmap is NULL, this calls
+ * fmap_find() to locate it.  Returns NULL if there's no FMAP or if out of
+ * memory.  Free with fmap_index_free().
+ */
+struct fmap_index *fmap_index_create(uint8_t *ptr, size_t size,
+				     FmapHeader *fmap);
+
+/* Free an index created by fmap_index_create().  NULL is allowed. */
+void fmap_index_free(struct fmap_index *index);
+
+/*
+ * Look up an area by name.  Returns the area header, or NULL if there's no
+ * such area (or index is NULL).
+ */
+const FmapAreaHeader *fmap_index_find(const struct fmap_index *index,
+				      const char *name);
+
 #endif  /* __FMAP_H__ */
@@ -96,4 +96,34 @@ static __inline const uint32_t roundup32(uint32_t v)
  */
 uint32_t vb2_desc_size(const char *desc);
 
+/**
+ * Find the first block which differs between two buffers.
+ *
+ * The buffers are compared block_size bytes at a time (the last block may be
+ * shorter), stopping at the first difference.  This is not constant-time; use
+ * vb2_safe_memcmp() when the contents are secret.
+ *
+ * @param a		First buffer
+ * @param b		Second buffer
+ * @param size		Number of bytes to compare
+ * @param block_size	Block size, such as the flash erase size; 0 treats
+ *			the whole buffer as one block
+ * @return Offset of the first differing block, or size if the buffers match.
+ */
+size_t vb2_find_diff_block(const void *a, const void *b, size_t size,
+			   size_t block_size);
+
+/**
+ * Find the first block which is not entirely filled with one byte value.
+ *
+ * @param buf		Buffer to check
+ * @param c		Expected value of every byte
+ * @param size		Number of bytes to check
+ * @param block_size	Block size, or 0 to treat the buffer as one block
+ * @return Offset of the first block containing a byte other than c, or size
+ * if every byte is c.
+ */
+size_t vb2_find_unfilled_block(const void *buf, uint8_t c, size_t size,
+			       size_t block_size);
+
 #endif  /* VBOOT_REFERENCE_HOST_MISC_H_ */
@@ -96,6 +96,44 @@ uint32_t vb2_desc_size(const char *desc)
 	return roundup32(strlen(desc) + 1);
 }
 
+size_t vb2_find_diff_block(const void *a, const void *b, size_t size,
+			   size_t block_size)
+{
+	const uint8_t *pa = a, *pb = b;
+	size_t offset, len;
+
+	if (!block_size)
+		block_size = size;
+
+	for (offset = 0; offset < size; offset += len) {
+		len = size - offset < block_size ? size - offset : block_size;
+		if (memcmp(pa + offset, pb + offset, len))
+			return offset;
+	}
+	return size;
+}
+
+size_t vb2_find_unfilled_block(const void *buf, uint8_t c, size_t size,
+			       size_t block_size)
+{
+	const uint8_t *p = buf;
+	size_t offset, len;
+
+	if (!block_size)
+		block_size = size;
+
+	/*
+	 * A block is filled with c if its first byte is c and every byte
+	 * equals the one after it, which lets memcmp() do the scanning.
+	 */
+	for (offset = 0; offset < size; offset += len) {
+		len = size - offset < block_size ? size - offset : block_size;
+		if (p[offset] != c || memcmp(p + offset, p + offset + 1, len - 1))
+			return offset;
+	}
+	return size;
+}
+
 static const char *onedigit(const char *str, uint8_t *vptr)
 {
 	uint8_t val = 0;
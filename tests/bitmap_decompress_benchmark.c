@@ -0,0 +1,281 @@
+/* Copyright 2018 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Compare EFI and LZMA decompression of the test bitmaps, the way the
+ * firmware screens are packed by bmpblk_utility.
+ */
+
+#include <dirent.h>
+#include <limits.h>
+#include <lzma.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "eficompress.h"
+#include "timer_utils.h"
+
+/* Piece size for the streaming decoder, like one line of a large bitmap */
+#define STREAM_CHUNK 4096
+
+static uint64_t total_efi_usecs, total_stream_usecs, total_lzma_usecs;
+static uint64_t total_raw, total_efi, total_lzma;
+static int num_files;
+static int errors;
+
+static uint8_t *read_file(const char *filename, uint32_t *size)
+{
+	FILE *f = fopen(filename, "rb");
+	uint8_t *buf;
+	long len;
+
+	if (!f)
+		return NULL;
+	fseek(f, 0, SEEK_END);
+	len = ftell(f);
+	rewind(f);
+	buf = malloc(len > 0 ? len : 1);
+	if (buf && len > 0 && fread(buf, len, 1, f) != 1) {
+		free(buf);
+		buf = NULL;
+	}
+	fclose(f);
+	*size = len;
+	return buf;
+}
+
+/* Compress the same way bmpblk_utility does */
+static uint8_t *compress_efi(const uint8_t *raw, uint32_t size, uint32_t *out)
+{
+	uint8_t *buf;
+
+	*out = size * 2 + 64;
+	buf = malloc(*out);
+	if (EFI_SUCCESS != EfiCompress((uint8_t *)raw, size, buf, out)) {
+		free(buf);
+		return NULL;
+	}
+	return buf;
+}
+
+static uint8_t *compress_lzma(const uint8_t *raw, uint32_t size, uint32_t *out)
+{
+	lzma_stream stream = LZMA_STREAM_INIT;
+	lzma_options_lzma options;
+	uint32_t bound = lzma_stream_buffer_bound(size);
+	uint8_t *buf = malloc(bound);
+
+	lzma_lzma_preset(&options, 9);
+	if (lzma_alone_encoder(&stream, &options) != LZMA_OK) {
+		free(buf);
+		return NULL;
+	}
+	stream.next_in = raw;
+	stream.avail_in = size;
+	stream.next_out = buf;
+	stream.avail_out = bound;
+	if (lzma_code(&stream, LZMA_FINISH) != LZMA_STREAM_END) {
+		lzma_end(&stream);
+		free(buf);
+		return NULL;
+	}
+	*out = bound - stream.avail_out;
+	lzma_end(&stream);
+	return buf;
+}
+
+static int decompress_efi(uint8_t *comp, uint32_t comp_size,
+			  uint8_t *out, uint32_t out_size)
+{
+	static uint8_t scratch[65536];
+	uint32_t dst_size, scratch_size;
+
+	if (EfiGetInfo(comp, comp_size, &dst_size, &scratch_size) ||
+	    dst_size != out_size || scratch_size > sizeof(scratch))
+		return -1;
+	return EfiDecompress(comp, comp_size, out, out_size,
+			     scratch, scratch_size);
+}
+
+static int decompress_stream(uint8_t *comp, uint32_t comp_size,
+			     uint8_t *out, uint32_t out_size, uint32_t chunk)
+{
+	EFI_DECOMPRESS_STREAM *stream;
+	uint32_t done = 0, produced;
+	int rv = 0;
+
+	stream = EfiDecompressStreamNew(comp, comp_size, 1);
+	if (!stream)
+		return -1;
+	do {
+		if (EfiDecompressStreamRead(stream, out + done,
+					    chunk < out_size - done ?
+					    chunk : out_size - done,
+					    &produced)) {
+			rv = -1;
+			break;
+		}
+		done += produced;
+	} while (produced && done < out_size);
+	EfiDecompressStreamFree(stream);
+	return (rv || done != out_size) ? -1 : 0;
+}
+
+static int decompress_lzma(uint8_t *comp, uint32_t comp_size,
+			   uint8_t *out, uint32_t out_size)
+{
+	lzma_stream stream = LZMA_STREAM_INIT;
+	int rv = 0;
+
+	if (lzma_alone_decoder(&stream, UINT64_MAX) != LZMA_OK)
+		return -1;
+	stream.next_in = comp;
+	stream.avail_in = comp_size;
+	stream.next_out = out;
+	stream.avail_out = out_size;
+	if (lzma_code(&stream, LZMA_FINISH) != LZMA_STREAM_END ||
+	    stream.avail_out)
+		rv = -1;
+	lzma_end(&stream);
+	return rv;
+}
+
+/* Make sure every decoder gets the original back */
+static int check_file(const char *name, const uint8_t *raw, uint32_t size,
+		      uint8_t *efi, uint32_t efi_size,
+		      uint8_t *lzma, uint32_t lzma_size, uint8_t *out)
+{
+	static const uint32_t chunks[] = {1, 7, 512, STREAM_CHUNK, UINT32_MAX};
+	int i;
+
+	memset(out, 0xa5, size);
+	if (decompress_efi(efi, efi_size, out, size) || memcmp(out, raw, size)) {
+		fprintf(stderr, "%s: EFI decompression mismatch\n", name);
+		return -1;
+	}
+	for (i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+		memset(out, 0xa5, size);
+		if (decompress_stream(efi, efi_size, out, size, chunks[i]) ||
+		    memcmp(out, raw, size)) {
+			fprintf(stderr, "%s: EFI stream mismatch at chunk %u\n",
+				name, chunks[i]);
+			return -1;
+		}
+	}
+	memset(out, 0xa5, size);
+	if (decompress_lzma(lzma, lzma_size, out, size) ||
+	    memcmp(out, raw, size)) {
+		fprintf(stderr, "%s: LZMA decompression mismatch\n", name);
+		return -1;
+	}
+	return 0;
+}
+
+static void benchmark_file(const char *filename, const char *shortname)
+{
+	uint8_t *raw, *efi = NULL, *lzma = NULL, *out = NULL;
+	uint32_t size, efi_size = 0, lzma_size = 0;
+	uint64_t efi_usecs, stream_usecs, lzma_usecs;
+	uint64_t nsecs;
+
+	raw = read_file(filename, &size);
+	if (!raw || !size)
+		goto done;
+
+	efi = compress_efi(raw, size, &efi_size);
+	lzma = compress_lzma(raw, size, &lzma_size);
+	out = malloc(size);
+	if (!efi || !lzma || !out) {
+		fprintf(stderr, "%s: can't compress\n", shortname);
+		errors++;
+		goto done;
+	}
+
+	if (check_file(shortname, raw, size, efi, efi_size, lzma, lzma_size,
+		       out)) {
+		errors++;
+		goto done;
+	}
+
+	TIME_LOOP(nsecs, decompress_efi(efi, efi_size, out, size));
+	efi_usecs = nsecs / 1000;
+	TIME_LOOP(nsecs, decompress_stream(efi, efi_size, out, size,
+					   STREAM_CHUNK));
+	stream_usecs = nsecs / 1000;
+	TIME_LOOP(nsecs, decompress_lzma(lzma, lzma_size, out, size));
+	lzma_usecs = nsecs / 1000;
+
+	fprintf(stderr, "# %-20s %8u bytes  efi %7u %6u us  stream %6u us"
+		"  lzma %7u %6u us\n", shortname, size,
+		efi_size, (uint32_t)efi_usecs, (uint32_t)stream_usecs,
+		lzma_size, (uint32_t)lzma_usecs);
+	fprintf(stdout, "usecs_efi_%s:%u\n", shortname, (uint32_t)efi_usecs);
+	fprintf(stdout, "usecs_efi_stream_%s:%u\n", shortname,
+		(uint32_t)stream_usecs);
+	fprintf(stdout, "usecs_lzma_%s:%u\n", shortname, (uint32_t)lzma_usecs);
+
+	total_efi_usecs += efi_usecs;
+	total_stream_usecs += stream_usecs;
+	total_lzma_usecs += lzma_usecs;
+	total_raw += size;
+	total_efi += efi_size;
+	total_lzma += lzma_size;
+	num_files++;
+
+ done:
+	free(raw);
+	free(efi);
+	free(lzma);
+	free(out);
+}
+
+int main(int argc, char *argv[])
+{
+	char filename[PATH_MAX];
+	struct dirent *de;
+	const char *srcdir;
+	const char *ext;
+	DIR *dir;
+
+	/* Where's the source directory? */
+	srcdir = getenv("SRCDIR");
+	if (argc > 1)
+		srcdir = argv[1];
+	if (!srcdir)
+		srcdir = ".";
+
+	snprintf(filename, sizeof(filename), "%s/tests/bitmaps", srcdir);
+	dir = opendir(filename);
+	if (!dir) {
+		fprintf(stderr, "Can't open %s\n", filename);
+		return 1;
+	}
+	while ((de = readdir(dir))) {
+		/* Just the images; skip the YAML and scripts */
+		ext = strrchr(de->d_name, '.');
+		if (!ext || (strcmp(ext, ".bmp") && strcmp(ext, ".bin")))
+			continue;
+		snprintf(filename, sizeof(filename), "%s/tests/bitmaps/%s",
+			 srcdir, de->d_name);
+		benchmark_file(filename, de->d_name);
+	}
+	closedir(dir);
+
+	if (!num_files) {
+		fprintf(stderr, "No bitmaps found under %s\n", srcdir);
+		return 1;
+	}
+
+	fprintf(stderr, "# %d files, %u bytes: efi %u bytes %u us, "
+		"stream %u us, lzma %u bytes %u us\n", num_files,
+		(uint32_t)total_raw, (uint32_t)total_efi,
+		(uint32_t)total_efi_usecs, (uint32_t)total_stream_usecs,
+		(uint32_t)total_lzma, (uint32_t)total_lzma_usecs);
+	fprintf(stdout, "usecs_efi_total:%u\n", (uint32_t)total_efi_usecs);
+	fprintf(stdout, "usecs_efi_stream_total:%u\n",
+		(uint32_t)total_stream_usecs);
+	fprintf(stdout, "usecs_lzma_total:%u\n", (uint32_t)total_lzma_usecs);
+	return errors ? 1 : 0;
+}
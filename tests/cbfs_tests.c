@@ -0,0 +1,197 @@
+/* Copyright 2018 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for CBFS library functions
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "2sysincludes.h"
+#include "2common.h"
+#include "cbfs.h"
+
+#include "test_common.h"
+
+#define CBFS_SIZE 0x2000
+
+static uint8_t cbfs[CBFS_SIZE];
+
+static void put_be32(uint8_t *p, uint32_t v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+/*
+ * Put a file header at the given offset, followed by len bytes of data
+ * filled with fill.  Returns the offset of the data.
+ */
+static uint32_t put_file(uint32_t offset, const char *name, uint32_t type,
+			 uint32_t len, uint8_t fill, uint32_t compression)
+{
+	uint8_t *h = cbfs + offset;
+	uint32_t name_size = (strlen(name) + 1 + 15) & ~15;
+	uint32_t attr_offset = 0;
+	uint32_t data_offset = sizeof(struct cbfs_file_header) + name_size;
+
+	memset(h, 0, data_offset);
+	memcpy(h, CBFS_FILE_MAGIC, CBFS_FILE_MAGIC_SIZE);
+	strcpy((char *)h + sizeof(struct cbfs_file_header), name);
+	if (compression) {
+		attr_offset = data_offset;
+		put_be32(h + attr_offset, CBFS_FILE_ATTR_TAG_COMPRESSION);
+		put_be32(h + attr_offset + 4,
+			 sizeof(struct cbfs_file_attr_compression));
+		put_be32(h + attr_offset + 8, compression);
+		put_be32(h + attr_offset + 12, len * 2);
+		data_offset += sizeof(struct cbfs_file_attr_compression);
+	}
+	put_be32(h + 8, len);
+	put_be32(h + 12, type);
+	put_be32(h + 16, attr_offset);
+	put_be32(h + 20, data_offset);
+	memset(h + data_offset, fill, len);
+	return offset + data_offset;
+}
+
+static void build_cbfs(void)
+{
+	memset(cbfs, 0xff, sizeof(cbfs));
+	put_file(0x000, "fallback/romstage", CBFS_TYPE_RAW, 0x90, 0x11, 0);
+	put_file(0x100, "", CBFS_TYPE_NULL, 0xc0, 0xff, 0);
+	put_file(0x200, "deleted", CBFS_TYPE_DELETED, 0x10, 0x22, 0);
+	/* 0x280 is left as junk which isn't a header */
+	memset(cbfs + 0x280, 0x5a, 0x40);
+	put_file(0x2c0, "payload", 0x20, 0x100, 0x33, 1);
+	put_file(0x440, "smm_store", CBFS_TYPE_RAW, 0x400, 0x44, 0);
+	put_file(0x880, "cros_allow_auto_update", CBFS_TYPE_RAW, 0, 0, 0);
+}
+
+static void next_file_tests(void)
+{
+	const char * const names[] = {
+		"fallback/romstage", "payload", "smm_store",
+		"cros_allow_auto_update",
+	};
+	struct cbfs_entry e;
+	uint32_t offset = 0;
+	int i, ok = 1;
+
+	build_cbfs();
+	for (i = 0; i < ARRAY_SIZE(names); i++) {
+		if (cbfs_next_file(cbfs, sizeof(cbfs), &offset, &e) ||
+		    strcmp(e.name, names[i]))
+			ok = 0;
+	}
+	TEST_TRUE(ok, "Files in order, skipping empty and deleted");
+	TEST_NEQ(cbfs_next_file(cbfs, sizeof(cbfs), &offset, &e), 0,
+		 "End of CBFS");
+	TEST_EQ(offset, sizeof(cbfs), "  offset at end");
+	TEST_NEQ(cbfs_next_file(cbfs, sizeof(cbfs), &offset, &e), 0,
+		 "  still at end");
+
+	TEST_SUCC(cbfs_find_file(cbfs, sizeof(cbfs), "payload", &e),
+		  "Find payload");
+	TEST_EQ(e.header_offset, 0x2c0, "  header offset");
+	/* Header, name padded to 16 bytes, compression attribute */
+	TEST_EQ(e.data_offset, 0x2c0 + 0x18 + 0x10 + 0x10, "  data offset");
+	TEST_EQ(e.size, 0x100, "  size");
+	TEST_EQ(e.type, 0x20, "  type");
+	TEST_EQ(e.compression, 1, "  compression");
+	TEST_EQ(cbfs[e.data_offset], 0x33, "  data");
+
+	TEST_SUCC(cbfs_find_file(cbfs, sizeof(cbfs), "smm_store", &e),
+		  "Find smm_store");
+	TEST_EQ(e.compression, 0, "  not compressed");
+	TEST_EQ(e.size, 0x400, "  size");
+	TEST_SUCC(cbfs_find_file(cbfs, sizeof(cbfs), "cros_allow_auto_update",
+				 NULL), "Find empty file");
+
+	TEST_NEQ(cbfs_find_file(cbfs, sizeof(cbfs), "deleted", NULL), 0,
+		 "Deleted file");
+	TEST_NEQ(cbfs_find_file(cbfs, sizeof(cbfs), "", NULL), 0,
+		 "Empty space");
+	TEST_NEQ(cbfs_find_file(cbfs, sizeof(cbfs), "smm", NULL), 0,
+		 "Prefix");
+	TEST_NEQ(cbfs_find_file(cbfs, 0, "payload", NULL), 0, "Empty CBFS");
+	TEST_NEQ(cbfs_find_file(cbfs, 0x2c0 + 0x100, "payload", NULL), 0,
+		 "File data past the end");
+}
+
+static void bad_header_tests(void)
+{
+	struct cbfs_entry e;
+
+	/* Name which isn't terminated is skipped */
+	build_cbfs();
+	memset(cbfs + 0x2c0 + sizeof(struct cbfs_file_header), 'x', 16);
+	TEST_NEQ(cbfs_find_file(cbfs, sizeof(cbfs), "payload", NULL), 0,
+		 "Unterminated name");
+	TEST_SUCC(cbfs_find_file(cbfs, sizeof(cbfs), "smm_store", NULL),
+		  "  later files still found");
+
+	/* Data offset inside the header */
+	build_cbfs();
+	put_be32(cbfs + 0x2c0 + 20, 8);
+	TEST_NEQ(cbfs_find_file(cbfs, sizeof(cbfs), "payload", NULL), 0,
+		 "Bad data offset");
+
+	/* Huge length */
+	build_cbfs();
+	put_be32(cbfs + 0x2c0 + 8, 0xfffffff0);
+	TEST_NEQ(cbfs_find_file(cbfs, sizeof(cbfs), "payload", NULL), 0,
+		 "Bad length");
+	TEST_SUCC(cbfs_find_file(cbfs, sizeof(cbfs), "smm_store", NULL),
+		  "  later files still found");
+
+	/* Attributes past the data */
+	build_cbfs();
+	put_be32(cbfs + 0x2c0 + 16, 0x100);
+	TEST_NEQ(cbfs_find_file(cbfs, sizeof(cbfs), "payload", NULL), 0,
+		 "Bad attributes offset");
+
+	/* Bad attribute length stops the attribute walk */
+	build_cbfs();
+	put_be32(cbfs + 0x2c0 + 0x18 + 0x10 + 4, 2);
+	TEST_SUCC(cbfs_find_file(cbfs, sizeof(cbfs), "payload", &e),
+		  "Bad attribute length");
+	TEST_EQ(e.compression, 0, "  no compression found");
+}
+
+static void replace_tests(void)
+{
+	uint8_t data[0x400];
+	struct cbfs_entry e;
+
+	build_cbfs();
+	memset(data, 0x99, sizeof(data));
+	TEST_SUCC(cbfs_replace_file(cbfs, sizeof(cbfs), "smm_store", data,
+				    sizeof(data)), "Replace smm_store");
+	cbfs_find_file(cbfs, sizeof(cbfs), "smm_store", &e);
+	TEST_SUCC(memcmp(cbfs + e.data_offset, data, sizeof(data)),
+		  "  data replaced");
+	TEST_EQ(cbfs[e.data_offset + sizeof(data)], 0xff, "  nothing after");
+	TEST_SUCC(cbfs_find_file(cbfs, sizeof(cbfs), "cros_allow_auto_update",
+				 NULL), "  next file intact");
+
+	TEST_NEQ(cbfs_replace_file(cbfs, sizeof(cbfs), "smm_store", data,
+				   sizeof(data) - 1), 0, "Replace wrong size");
+	TEST_NEQ(cbfs_replace_file(cbfs, sizeof(cbfs), "payload", data, 0x100),
+		 0, "Replace compressed");
+	TEST_NEQ(cbfs_replace_file(cbfs, sizeof(cbfs), "missing", data, 0), 0,
+		 "Replace missing");
+}
+
+int main(int argc, char *argv[])
+{
+	next_file_tests();
+	bad_header_tests();
+	replace_tests();
+
+	return gTestSuccess ? 0 : 255;
+}
@@ -0,0 +1,113 @@
+/* Copyright 2018 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for crossystem non-volatile storage backends
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "2sysincludes.h"
+#include "2api.h"
+#include "2nvstorage.h"
+#include "crossystem_arch.h"
+#include "crossystem_vbnv.h"
+#include "host_common.h"
+
+#include "test_common.h"
+
+static void file_backend_tests(const char *temp_dir, uint32_t ctxflags)
+{
+	struct vb2_context c, r;
+	char *nvfile;
+	int i;
+
+	xasprintf(&nvfile, "%s/crossystem_nvdata.bin", temp_dir);
+	unlink(nvfile);
+
+	memset(&c, 0, sizeof(c));
+	c.flags = ctxflags;
+	memset(&r, 0, sizeof(r));
+	r.flags = ctxflags;
+
+	/* Missing file reads as blank storage */
+	memset(r.nvdata, 0xa5, sizeof(r.nvdata));
+	TEST_SUCC(vb2_read_nv_storage_file(&r, nvfile), "Read missing file");
+	for (i = 0; i < vb2_nv_get_size(&r); i++)
+		if (r.nvdata[i])
+			break;
+	TEST_EQ(i, vb2_nv_get_size(&r), "  nvdata cleared");
+
+	/* Round trip */
+	for (i = 0; i < vb2_nv_get_size(&c); i++)
+		c.nvdata[i] = i * 7 + 1;
+	TEST_SUCC(vb2_write_nv_storage_file(&c, nvfile), "Write file");
+	TEST_SUCC(vb2_read_nv_storage_file(&r, nvfile), "Read file");
+	TEST_EQ(memcmp(r.nvdata, c.nvdata, vb2_nv_get_size(&c)), 0,
+		"  nvdata matches");
+
+	/* Short file */
+	TEST_SUCC(WriteFile(nvfile, c.nvdata, vb2_nv_get_size(&c) - 1),
+		  "Write short file");
+	TEST_NEQ(vb2_read_nv_storage_file(&r, nvfile), 0, "Read short file");
+
+	TEST_NEQ(vb2_write_nv_storage_file(&c, "no/such/dir"), 0,
+		 "Write bad path");
+
+	unlink(nvfile);
+	free(nvfile);
+}
+
+static void cros_ec_backend_tests(void)
+{
+	struct vb2_context c;
+
+	/* The EC only holds V1 records */
+	memset(&c, 0, sizeof(c));
+	c.flags = VB2_CONTEXT_NVDATA_V2;
+	TEST_NEQ(vb2_read_nv_storage_cros_ec(&c), 0, "EC read V2 size");
+	TEST_NEQ(vb2_write_nv_storage_cros_ec(&c), 0, "EC write V2 size");
+}
+
+static void emulation_tests(const char *temp_dir)
+{
+	struct vb2_context c;
+	char *nvfile;
+
+	xasprintf(&nvfile, "%s/crossystem_nvemul.bin", temp_dir);
+	unlink(nvfile);
+
+	vb2_nv_storage_emulate(nvfile);
+	TEST_EQ(vb2_get_nv_storage(VB2_NV_RECOVERY_REQUEST), 0,
+		"Emulated recovery_request default");
+	TEST_SUCC(vb2_set_nv_storage(VB2_NV_RECOVERY_REQUEST, 0x42),
+		  "Set emulated recovery_request");
+	TEST_EQ(vb2_get_nv_storage(VB2_NV_RECOVERY_REQUEST), 0x42,
+		"  value read back");
+
+	/* The backing file holds a valid record */
+	memset(&c, 0, sizeof(c));
+	TEST_SUCC(vb2_read_nv_storage_file(&c, nvfile), "Read backing file");
+	TEST_SUCC(vb2_nv_check_crc(&c), "  CRC valid");
+
+	vb2_nv_storage_emulate(NULL);
+	unlink(nvfile);
+	free(nvfile);
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s <temp_dir>\n", argv[0]);
+		return -1;
+	}
+	const char *temp_dir = argv[1];
+
+	file_backend_tests(temp_dir, 0);
+	file_backend_tests(temp_dir, VB2_CONTEXT_NVDATA_V2);
+	cros_ec_backend_tests();
+	emulation_tests(temp_dir);
+
+	return gTestSuccess ? 0 : 255;
+}
@@ -0,0 +1,169 @@
+/* Copyright 2018 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for FMAP library functions
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "2sysincludes.h"
+#include "2common.h"
+#include "fmap.h"
+
+#include "test_common.h"
+
+#define IMAGE_SIZE 0x40000
+
+static uint8_t image[IMAGE_SIZE];
+
+static const char * const area_names[] = {
+	"RO_SECTION", "GBB", "RW_SECTION_A", "RW_SECTION_B", "VBLOCK_A",
+	"VBLOCK_B", "FW_MAIN_A", "FW_MAIN_B", "RW_NVRAM", "RW_LEGACY",
+	/* Exactly FMAP_NAMELEN characters, so not null-terminated */
+	"AN_AREA_NAME_THAT_IS_32_CHARS_XX",
+	/* Duplicate name; the first one should win */
+	"GBB",
+};
+#define NUM_AREAS ARRAY_SIZE(area_names)
+
+/*
+ * Put an FMAP with the test areas at the given offset.  Areas which would run
+ * off the end of the image are left out, but still counted in fmap_nareas.
+ */
+static FmapHeader *put_fmap(uint32_t offset)
+{
+	FmapHeader *fmap = (FmapHeader *)(image + offset);
+	FmapAreaHeader *ah = (FmapAreaHeader *)(fmap + 1);
+	int room = (IMAGE_SIZE - offset - sizeof(*fmap)) / sizeof(*ah);
+	int i;
+
+	if (room > NUM_AREAS)
+		room = NUM_AREAS;
+	memset(fmap, 0, sizeof(*fmap) + room * sizeof(*ah));
+	memcpy(fmap->fmap_signature, FMAP_SIGNATURE, FMAP_SIGNATURE_SIZE);
+	fmap->fmap_ver_major = FMAP_VER_MAJOR;
+	fmap->fmap_size = IMAGE_SIZE;
+	fmap->fmap_nareas = NUM_AREAS;
+	for (i = 0; i < room; i++) {
+		ah[i].area_offset = 0x1000 * i;
+		ah[i].area_size = 0x100 + i;
+		memcpy(ah[i].area_name, area_names[i],
+		       strnlen(area_names[i], FMAP_NAMELEN));
+	}
+	return fmap;
+}
+
+static void fmap_find_tests(void)
+{
+	memset(image, 0, sizeof(image));
+	TEST_PTR_EQ(fmap_find(image, sizeof(image)), NULL, "No FMAP");
+	TEST_PTR_EQ(fmap_find(image, 4), NULL, "Tiny buffer");
+
+	put_fmap(0x3000);
+	TEST_PTR_EQ(fmap_find(image, sizeof(image)), image + 0x3000,
+		    "FMAP at 0x3000");
+
+	/* Larger alignment wins, even at a higher offset */
+	put_fmap(0x20000);
+	TEST_PTR_EQ(fmap_find(image, sizeof(image)), image + 0x20000,
+		    "Prefer larger alignment");
+
+	/* Lowest offset wins for the same alignment */
+	put_fmap(0x38000);
+	put_fmap(0x28000);
+	memset(image + 0x20000, 0, FMAP_SIGNATURE_SIZE);
+	TEST_PTR_EQ(fmap_find(image, sizeof(image)), image + 0x28000,
+		    "Prefer lower offset");
+
+	/* Misaligned signatures don't count */
+	memset(image, 0, sizeof(image));
+	put_fmap(0x1002);
+	TEST_PTR_EQ(fmap_find(image, sizeof(image)), NULL, "Misaligned");
+
+	/* Wrong version doesn't count */
+	put_fmap(0x4000)->fmap_ver_major = FMAP_VER_MAJOR + 1;
+	put_fmap(0x1004);
+	TEST_PTR_EQ(fmap_find(image, sizeof(image)), image + 0x1004,
+		    "Skip bad version");
+
+	/* Below the probed alignments, larger alignment still wins */
+	memset(image, 0, sizeof(image));
+	put_fmap(0x804);
+	put_fmap(0x2010);
+	TEST_PTR_EQ(fmap_find(image, sizeof(image)), image + 0x2010,
+		    "Prefer larger small alignment");
+
+	/* Offset zero is always first */
+	put_fmap(0);
+	TEST_PTR_EQ(fmap_find(image, sizeof(image)), image, "FMAP at 0");
+
+	/* Header must fit in the buffer */
+	memset(image, 0, sizeof(image));
+	put_fmap(IMAGE_SIZE - 0x100);
+	TEST_PTR_EQ(fmap_find(image, IMAGE_SIZE - 0x100 + 8), NULL,
+		    "Truncated header");
+}
+
+static void fmap_index_tests(void)
+{
+	struct fmap_index *index;
+	const FmapAreaHeader *ah;
+	FmapAreaHeader *ah2;
+	uint8_t *data;
+	int i;
+
+	memset(image, 0, sizeof(image));
+	TEST_PTR_EQ(fmap_index_create(image, sizeof(image), NULL), NULL,
+		    "Index without FMAP");
+	TEST_PTR_EQ(fmap_index_find(NULL, "GBB"), NULL, "Find in NULL index");
+	fmap_index_free(NULL);
+
+	put_fmap(0x10000);
+	index = fmap_index_create(image, sizeof(image), NULL);
+	TEST_PTR_NEQ(index, NULL, "Index created");
+	TEST_EQ(index->nareas, NUM_AREAS, "  nareas");
+
+	/* Every area agrees with fmap_find_by_name() */
+	for (i = 0; i < NUM_AREAS; i++) {
+		ah = fmap_index_find(index, area_names[i]);
+		data = fmap_find_by_name(image, sizeof(image), NULL,
+					 area_names[i], &ah2);
+		TEST_PTR_NEQ(ah, NULL, area_names[i]);
+		TEST_PTR_EQ(image + ah->area_offset, data, "  offset");
+		TEST_EQ(ah->area_size, ah2->area_size, "  size");
+	}
+	TEST_EQ(fmap_index_find(index, "GBB")->area_size, 0x101,
+		"First duplicate wins");
+	TEST_PTR_EQ(fmap_index_find(index, "NOT_THERE"), NULL, "Missing area");
+	TEST_PTR_EQ(fmap_index_find(index, "GB"), NULL, "Prefix");
+	TEST_PTR_EQ(fmap_index_find(index, "GBBX"), NULL, "Longer name");
+
+	/* The index doesn't point into the image */
+	memset(image, 0, sizeof(image));
+	ah = fmap_index_find(index, "FW_MAIN_A");
+	TEST_PTR_NEQ(ah, NULL, "Index outlives image contents");
+	TEST_EQ(ah->area_offset, 0x6000, "  offset");
+	fmap_index_free(index);
+
+	/* Area count that runs off the end of the buffer is clamped */
+	put_fmap(IMAGE_SIZE - 0x100);
+	index = fmap_index_create(image, sizeof(image), NULL);
+	TEST_PTR_NEQ(index, NULL, "Truncated area list");
+	TEST_EQ(index->nareas, 4, "  nareas clamped");
+	TEST_PTR_NEQ(fmap_index_find(index, "RW_SECTION_B"), NULL,
+		     "  last area");
+	TEST_PTR_EQ(fmap_index_find(index, "VBLOCK_A"), NULL,
+		    "  area past the end");
+	fmap_index_free(index);
+}
+
+int main(int argc, char *argv[])
+{
+	fmap_find_tests();
+	fmap_index_tests();
+
+	return gTestSuccess ? 0 : 255;
+}
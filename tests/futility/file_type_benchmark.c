@@ -0,0 +1,143 @@
+/*
+ * Copyright 2018 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Benchmark futility file type detection over the test data set.
+ */
+#include <dirent.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "file_type.h"
+#include "futility.h"
+#include "timer_utils.h"
+
+/* Directories holding the data set, relative to the source directory */
+static const char * const data_dirs[] = {
+	"tests/futility/data",
+	"tests/devkeys",
+	"tests/testkeys",
+};
+
+/* Spend at least this long on each file */
+static uint32_t min_msecs = 200;
+
+static uint64_t total_usecs;
+static int num_files;
+
+static void benchmark_file(const char *filename, const char *shortname)
+{
+	enum futil_file_type type = FILE_TYPE_UNKNOWN;
+	ClockTimerState ct;
+	struct stat sb;
+	uint8_t *buf;
+	uint32_t len;
+	uint32_t iterations = 0;
+	uint64_t usecs;
+	int fd;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return;
+	if (fstat(fd, &sb) || !S_ISREG(sb.st_mode) || !sb.st_size ||
+	    futil_map_file(fd, MAP_RO, &buf, &len)) {
+		close(fd);
+		return;
+	}
+
+	StartTimer(&ct);
+	do {
+		type = futil_file_type_buf(buf, len);
+		/* What the show and sign handlers will look for next */
+		futil_file_type_fmap(buf, len);
+		iterations++;
+		StopTimer(&ct);
+	} while (GetDurationMsecs(&ct) < min_msecs);
+	usecs = GetDurationUsecs(&ct) / iterations;
+
+	futil_unmap_file(fd, MAP_RO, buf, len);
+	close(fd);
+
+	fprintf(stderr, "# %-40s %10u bytes %-10s %8u usecs\n", shortname,
+		len, futil_file_type_name(type), (uint32_t)usecs);
+	fprintf(stdout, "usecs_file_type_%s:%u\n", shortname,
+		(uint32_t)usecs);
+
+	total_usecs += usecs;
+	num_files++;
+}
+
+static void print_help(const char *progname)
+{
+	fprintf(stderr, "\nUsage: %s [-t min_msecs] [srcdir]\n\n", progname);
+}
+
+int main(int argc, char *argv[])
+{
+	char filename[PATH_MAX];
+	char shortname[PATH_MAX];
+	struct dirent *de;
+	const char *srcdir;
+	DIR *dir;
+	int i, c;
+
+	while ((c = getopt(argc, argv, "t:")) != -1) {
+		switch (c) {
+		case 't':
+			min_msecs = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			print_help(argv[0]);
+			return 1;
+		}
+	}
+
+	/* Where's the source directory? */
+	srcdir = getenv("SRCDIR");
+	if (optind < argc)
+		srcdir = argv[optind++];
+	if (optind != argc) {
+		print_help(argv[0]);
+		return 1;
+	}
+	if (!srcdir)
+		srcdir = ".";
+
+	for (i = 0; i < ARRAY_SIZE(data_dirs); i++) {
+		snprintf(filename, sizeof(filename), "%s/%s",
+			 srcdir, data_dirs[i]);
+		dir = opendir(filename);
+		if (!dir) {
+			fprintf(stderr, "Can't open %s\n", filename);
+			continue;
+		}
+		while ((de = readdir(dir))) {
+			if (de->d_name[0] == '.')
+				continue;
+			snprintf(filename, sizeof(filename), "%s/%s/%s",
+				 srcdir, data_dirs[i], de->d_name);
+			snprintf(shortname, sizeof(shortname), "%s/%s",
+				 strrchr(data_dirs[i], '/') + 1, de->d_name);
+			benchmark_file(filename, shortname);
+		}
+		closedir(dir);
+	}
+
+	if (!num_files) {
+		fprintf(stderr, "No files found under %s\n", srcdir);
+		return 1;
+	}
+
+	fprintf(stderr, "# %d files, total %u usecs\n", num_files,
+		(uint32_t)total_usecs);
+	fprintf(stdout, "usecs_file_type_total:%u\n", (uint32_t)total_usecs);
+	return 0;
+}
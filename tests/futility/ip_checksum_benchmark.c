@@ -0,0 +1,111 @@
+/*
+ * Copyright 2018 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Benchmark the IP checksum validate_rec_mrc uses for the MRC cache, against
+ * the byte-at-a-time version it replaced.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "futility.h"
+#include "timer_utils.h"
+
+/* The byte-at-a-time checksum */
+static unsigned long ref_ip_checksum(const void *addr, unsigned long length)
+{
+	const uint8_t *ptr = addr;
+	volatile union {
+		uint8_t byte[2];
+		uint16_t word;
+	} value;
+	unsigned long sum = 0;
+	unsigned long i;
+
+	for (i = 0; i < length; i++) {
+		unsigned long v = ptr[i];
+		if (i & 1)
+			v <<= 8;
+		sum += v;
+		if (sum > 0xFFFF)
+			sum = (sum + (sum >> 16)) & 0xFFFF;
+	}
+	value.byte[0] = sum & 0xff;
+	value.byte[1] = (sum >> 8) & 0xff;
+	return (~value.word) & 0xFFFF;
+}
+
+/* Keep the compiler from dropping the checksums */
+static volatile unsigned long result;
+
+static int benchmark(const uint8_t *buf, uint32_t size)
+{
+	uint64_t ref_usecs, usecs, nsecs;
+
+	if (compute_ip_checksum(buf, size) != ref_ip_checksum(buf, size)) {
+		fprintf(stderr, "Checksum of %u bytes doesn't match\n", size);
+		return 1;
+	}
+
+	TIME_LOOP(nsecs, result = ref_ip_checksum(buf, size));
+	ref_usecs = nsecs / 1000;
+	TIME_LOOP(nsecs, result = compute_ip_checksum(buf, size));
+	usecs = nsecs / 1000;
+
+	fprintf(stderr, "#   %8u bytes  %8u usecs byte loop  %8u usecs\n",
+		size, (uint32_t)ref_usecs, (uint32_t)usecs);
+	fprintf(stdout, "usecs_ip_checksum_bytes_%u:%u\n", size,
+		(uint32_t)ref_usecs);
+	fprintf(stdout, "usecs_ip_checksum_%u:%u\n", size, (uint32_t)usecs);
+	return 0;
+}
+
+static void print_help(const char *progname)
+{
+	fprintf(stderr, "\nUsage: %s [-s max_kbytes]\n\n", progname);
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t max_kbytes = 1024;
+	uint32_t size;
+	uint8_t *buf;
+	int errors = 0;
+	int c;
+
+	while ((c = getopt(argc, argv, "s:")) != -1) {
+		switch (c) {
+		case 's':
+			max_kbytes = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			print_help(argv[0]);
+			return 1;
+		}
+	}
+	if (optind != argc || !max_kbytes) {
+		print_help(argv[0]);
+		return 1;
+	}
+
+	buf = malloc(max_kbytes * 1024);
+	if (!buf)
+		return 1;
+	srand(0);
+	for (size = 0; size < max_kbytes * 1024; size++)
+		buf[size] = rand();
+
+	fprintf(stderr, "# IP checksum, up to %u KB\n", max_kbytes);
+	/* Odd sizes and offsets as well as whole regions */
+	errors += benchmark(buf, 4096);
+	errors += benchmark(buf + 1, 4095);
+	for (size = 64 * 1024; size <= max_kbytes * 1024; size *= 4)
+		errors += benchmark(buf, size);
+
+	free(buf);
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,232 @@
+/*
+ * Copyright 2018 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Benchmark finding the kernel command line in a kernel partition, from a
+ * file or device which can seek and from a pipe which can't.
+ *
+ * By default a kernel partition is made in a temporary file.  Give the name
+ * of a real one (such as a loop device over an image) to measure that
+ * instead; use vmlinuz images with the default body load address.
+ */
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "2sysincludes.h"
+#include "2common.h"
+#include "kernel_blob.h"
+#include "timer_utils.h"
+#include "vb2_struct.h"
+#include "vboot_host.h"
+
+#define KEYBLOCK_SIZE 0x8b8
+#define VBLOCK_SIZE 0x10000
+#define BOOTLOADER_SIZE 0x1000
+
+#define TEST_CMDLINE "cros_secure console= loglevel=7 root=/dev/dm-0"
+
+/* Bytes this process has read so far, from /proc/self/io */
+static uint64_t bytes_read(void)
+{
+	unsigned long long rchar = 0;
+	char line[64];
+	FILE *fp;
+
+	fp = fopen("/proc/self/io", "r");
+	if (!fp)
+		return 0;
+	while (fgets(line, sizeof(line), fp))
+		if (1 == sscanf(line, "rchar: %llu", &rchar))
+			break;
+	fclose(fp);
+	return rchar;
+}
+
+/* Make a kernel partition with a body of body_size bytes. */
+static int make_image(const char *filename, uint32_t body_size)
+{
+	struct vb2_keyblock keyblock;
+	struct vb2_kernel_preamble preamble;
+	char config[CROS_CONFIG_SIZE];
+	uint32_t config_offset;
+	int fd, rv = 0;
+
+	memset(&keyblock, 0, sizeof(keyblock));
+	memcpy(keyblock.magic, KEY_BLOCK_MAGIC, KEY_BLOCK_MAGIC_SIZE);
+	keyblock.keyblock_size = KEYBLOCK_SIZE;
+
+	memset(&preamble, 0, sizeof(preamble));
+	preamble.preamble_size = VBLOCK_SIZE - KEYBLOCK_SIZE;
+	preamble.body_load_address = CROS_32BIT_ENTRY_ADDR;
+	preamble.bootloader_address = CROS_32BIT_ENTRY_ADDR + body_size -
+		BOOTLOADER_SIZE;
+	preamble.bootloader_size = BOOTLOADER_SIZE;
+
+	memset(config, 0, sizeof(config));
+	strcpy(config, TEST_CMDLINE);
+	config_offset = VBLOCK_SIZE + body_size - BOOTLOADER_SIZE -
+		CROS_PARAMS_SIZE - CROS_CONFIG_SIZE;
+
+	fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0)
+		return 1;
+	/* The rest of the body doesn't matter, so leave it sparse */
+	if (sizeof(keyblock) != pwrite(fd, &keyblock, sizeof(keyblock), 0) ||
+	    sizeof(preamble) != pwrite(fd, &preamble, sizeof(preamble),
+				       KEYBLOCK_SIZE) ||
+	    sizeof(config) != pwrite(fd, config, sizeof(config),
+				     config_offset) ||
+	    0 != ftruncate(fd, VBLOCK_SIZE + body_size))
+		rv = 1;
+	close(fd);
+	return rv;
+}
+
+/* Bytes read by the last FindKernelConfig() */
+static uint64_t last_bytes;
+
+static char *find_config_counted(const char *filename)
+{
+	uint64_t before = bytes_read();
+	char *config = FindKernelConfig(filename, USE_PREAMBLE_LOAD_ADDR);
+
+	last_bytes = bytes_read() - before;
+	return config;
+}
+
+/* Find the config from a file or device. */
+static char *find_config_file(const char *filename)
+{
+	return find_config_counted(filename);
+}
+
+/* Find the config while another process feeds the file through a pipe. */
+static char *find_config_pipe(const char *filename)
+{
+	char pipename[32];
+	char *config = NULL;
+	int fds[2];
+	pid_t pid;
+
+	if (pipe(fds))
+		return NULL;
+
+	pid = fork();
+	if (pid == 0) {
+		char buf[65536];
+		ssize_t len;
+		int fd = open(filename, O_RDONLY);
+
+		close(fds[0]);
+		while (fd >= 0 && (len = read(fd, buf, sizeof(buf))) > 0)
+			if (len != write(fds[1], buf, len))
+				break;
+		_exit(0);
+	}
+
+	close(fds[1]);
+	if (pid > 0) {
+		snprintf(pipename, sizeof(pipename), "/dev/fd/%d", fds[0]);
+		config = find_config_counted(pipename);
+	}
+	/* The writer gets SIGPIPE if the config came before the end */
+	close(fds[0]);
+	if (pid > 0)
+		waitpid(pid, NULL, 0);
+	return config;
+}
+
+static int benchmark(const char *name, const char *filename,
+		     char *(*find_config)(const char *filename),
+		     const char *expect)
+{
+	uint64_t bytes, nsecs, usecs;
+	char *config;
+
+	config = find_config(filename);
+	bytes = last_bytes;
+	if (!config || (expect && strcmp(config, expect))) {
+		fprintf(stderr, "Finding config from %s failed\n", name);
+		free(config);
+		return 1;
+	}
+	free(config);
+
+	TIME_LOOP(nsecs, free(find_config(filename)));
+	usecs = nsecs / 1000;
+
+	fprintf(stderr, "#   %-6s %10u bytes read %8u usecs\n", name,
+		(uint32_t)bytes, (uint32_t)usecs);
+	fprintf(stdout, "bytes_read_kernel_config_%s:%u\n", name,
+		(uint32_t)bytes);
+	fprintf(stdout, "usecs_kernel_config_%s:%u\n", name,
+		(uint32_t)usecs);
+	return 0;
+}
+
+static void print_help(const char *progname)
+{
+	fprintf(stderr, "\nUsage: %s [-s body_mbytes] [kernel_partition]\n\n",
+		progname);
+}
+
+int main(int argc, char *argv[])
+{
+	char tmpname[] = "/tmp/kernel_config_benchmark.XXXXXX";
+	const char *filename = NULL;
+	const char *expect = NULL;
+	uint32_t body_mbytes = 16;
+	int errors = 0;
+	int c, fd;
+
+	while ((c = getopt(argc, argv, "s:")) != -1) {
+		switch (c) {
+		case 's':
+			body_mbytes = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			print_help(argv[0]);
+			return 1;
+		}
+	}
+	if (optind < argc)
+		filename = argv[optind++];
+	if (optind != argc || !body_mbytes) {
+		print_help(argv[0]);
+		return 1;
+	}
+
+	if (!filename) {
+		fd = mkstemp(tmpname);
+		if (fd < 0) {
+			fprintf(stderr, "Unable to create %s\n", tmpname);
+			return 1;
+		}
+		close(fd);
+		filename = tmpname;
+		expect = TEST_CMDLINE;
+		if (make_image(filename, body_mbytes << 20)) {
+			fprintf(stderr, "Unable to write %s\n", filename);
+			unlink(tmpname);
+			return 1;
+		}
+		fprintf(stderr, "# Kernel partition with %u MB body\n",
+			body_mbytes);
+	} else {
+		fprintf(stderr, "# Kernel partition %s\n", filename);
+	}
+
+	errors += benchmark("file", filename, find_config_file, expect);
+	errors += benchmark("pipe", filename, find_config_pipe, expect);
+
+	if (filename == tmpname)
+		unlink(tmpname);
+	return errors ? 1 : 0;
+}
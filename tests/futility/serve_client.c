@@ -0,0 +1,82 @@
+/*
+ * Copyright 2018 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * A very simple client for "futility serve --socket", used for testing. It
+ * connects to the given Unix domain socket, waiting a few seconds for the
+ * server to start listening, sends stdin, and copies the replies to stdout.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* How long to wait for the server, in tenths of a second */
+#define CONNECT_TRIES 50
+
+static int copy(int from, int to)
+{
+	char buf[4096];
+	ssize_t len, done, n;
+
+	while ((len = read(from, buf, sizeof(buf))) != 0) {
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			return 1;
+		}
+		for (done = 0; done < len; done += n) {
+			n = write(to, buf + done, len - done);
+			if (n < 0)
+				return 1;
+		}
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct sockaddr_un addr;
+	int sock, i;
+
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s SOCKET\n", argv[0]);
+		return 1;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(argv[1]) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "Socket path is too long: %s\n", argv[1]);
+		return 1;
+	}
+	strcpy(addr.sun_path, argv[1]);
+
+	for (i = 0; i < CONNECT_TRIES; i++) {
+		sock = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (sock < 0)
+			break;
+		if (!connect(sock, (struct sockaddr *)&addr, sizeof(addr)))
+			break;
+		close(sock);
+		sock = -1;
+		usleep(100000);
+	}
+	if (sock < 0) {
+		fprintf(stderr, "Can't connect to %s: %s\n", argv[1],
+			strerror(errno));
+		return 1;
+	}
+
+	if (copy(0, sock) || shutdown(sock, SHUT_WR) || copy(sock, 1)) {
+		fprintf(stderr, "Lost connection: %s\n", strerror(errno));
+		return 1;
+	}
+
+	close(sock);
+	return 0;
+}
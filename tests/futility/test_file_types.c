@@ -7,8 +7,10 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "file_type.h"
+#include "fmap.h"
 #include "futility.h"
 #include "test_common.h"
 
@@ -42,6 +44,43 @@ static struct {
 };
 BUILD_ASSERT(ARRAY_SIZE(test_case) == NUM_FILE_TYPES);
 
+#define FMAP_BUF_SIZE 0x10000
+
+static void put_fmap(uint8_t *buf, uint32_t offset)
+{
+	FmapHeader *fmap = (FmapHeader *)(buf + offset);
+
+	memset(buf, 0, FMAP_BUF_SIZE);
+	memcpy(fmap->fmap_signature, FMAP_SIGNATURE, FMAP_SIGNATURE_SIZE);
+	fmap->fmap_ver_major = FMAP_VER_MAJOR;
+	fmap->fmap_size = FMAP_BUF_SIZE;
+}
+
+/* The FMAP location is only reused for the same buffer */
+static void fmap_cache_tests(void)
+{
+	static uint8_t buf1[FMAP_BUF_SIZE], buf2[FMAP_BUF_SIZE];
+
+	put_fmap(buf1, 0);
+	put_fmap(buf2, 0x8000);
+	TEST_PTR_EQ(futil_file_type_fmap(buf1, sizeof(buf1)), buf1,
+		    "FMAP in first buffer");
+	TEST_PTR_EQ(futil_file_type_fmap(buf2, sizeof(buf2)), buf2 + 0x8000,
+		    "FMAP in second buffer of the same size");
+	TEST_PTR_EQ(futil_file_type_fmap(buf2, sizeof(buf2)), buf2 + 0x8000,
+		    "FMAP in second buffer again");
+
+	/* As if another file were mapped at the same address */
+	futil_file_type_forget(buf2);
+	put_fmap(buf2, 0x4000);
+	TEST_PTR_EQ(futil_file_type_fmap(buf2, sizeof(buf2)), buf2 + 0x4000,
+		    "FMAP in reused buffer");
+	futil_file_type_forget(buf2);
+	memset(buf2, 0, sizeof(buf2));
+	TEST_PTR_EQ(futil_file_type_fmap(buf2, sizeof(buf2)), NULL,
+		    "No FMAP in reused buffer");
+}
+
 int main(int argc, char *argv[])
 {
 	char filename[PATH_MAX];
@@ -94,5 +133,7 @@ int main(int argc, char *argv[])
 		TEST_EQ(type, test_case[i].type, status);
 	}
 
+	fmap_cache_tests();
+
 	return !gTestSuccess;
 }
@@ -0,0 +1,110 @@
+#!/bin/bash -eux
+# Copyright 2018 The Chromium OS Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+me=${0##*/}
+TMP="$me.tmp"
+
+# Work in scratch directory
+cd "$OUTDIR"
+
+KEYDIR=${SRCDIR}/tests/devkeys
+
+# Write one request for futility serve
+request() {
+  printf '%s\0' "$@"
+  printf '\0'
+}
+
+# create a firmware blob
+dd bs=1024 count=16 if=/dev/urandom of=${TMP}.fw_main
+
+KEY_ARGS="--keyblock ${KEYDIR}/firmware.keyblock
+  --kernelkey ${KEYDIR}/kernel_subkey.vbpubk
+  --version 12
+  --fv ${TMP}.fw_main
+  --flags 42"
+SIGN_ARGS="--signprivate ${KEYDIR}/firmware_data_key.vbprivk ${KEY_ARGS}"
+
+# sign it the usual way
+${FUTILITY} sign ${SIGN_ARGS} ${TMP}.vblock.old
+
+# and by request, twice, with the keys preloaded
+{
+  request sign ${SIGN_ARGS} ${TMP}.vblock.new
+  request show ${TMP}.vblock.new
+  request no_such_command
+  request sign ${SIGN_ARGS} ${TMP}.vblock.new2
+} | ${FUTILITY} serve --keys ${KEYDIR} > ${TMP}.replies
+
+# They should match
+cmp ${TMP}.vblock.old ${TMP}.vblock.new
+cmp ${TMP}.vblock.old ${TMP}.vblock.new2
+
+# Check the replies
+exec 4< ${TMP}.replies
+read -r status size <&4
+[ "$status" = "0" ]
+head -c "$size" <&4 > /dev/null
+read -r status size <&4
+[ "$status" = "0" ]
+head -c "$size" <&4 > ${TMP}.show
+grep -q "Firmware version:      12" ${TMP}.show
+read -r status size <&4
+[ "$status" = "1" ]
+head -c "$size" <&4 | grep -q "Unknown command"
+read -r status size <&4
+[ "$status" = "0" ]
+exec 4<&-
+
+# The same over a socket, from two clients at once
+CLIENT="${BUILD_RUN}/tests/futility/serve_client"
+${FUTILITY} serve --keys ${KEYDIR} --socket ${TMP}.sock --jobs 2 &
+SERVER_PID=$!
+CLIENT_PIDS=
+for i in 1 2; do
+  {
+    request sign ${SIGN_ARGS} ${TMP}.vblock.sock$i
+    request show ${TMP}.vblock.sock$i
+  } | ${CLIENT} ${TMP}.sock > ${TMP}.replies.sock$i &
+  CLIENT_PIDS="${CLIENT_PIDS} $!"
+done
+for pid in ${CLIENT_PIDS}; do wait ${pid}; done
+kill ${SERVER_PID}
+wait ${SERVER_PID}
+[ ! -e ${TMP}.sock ]
+
+for i in 1 2; do
+  cmp ${TMP}.vblock.old ${TMP}.vblock.sock$i
+  exec 4< ${TMP}.replies.sock$i
+  read -r status size <&4
+  [ "$status" = "0" ]
+  head -c "$size" <&4 > /dev/null
+  read -r status size <&4
+  [ "$status" = "0" ]
+  head -c "$size" <&4 | grep -q "Firmware version:      12"
+  exec 4<&-
+done
+
+# Keys that change after they're loaded are read again
+cp ${KEYDIR}/firmware_data_key.vbprivk ${TMP}.signkey.vbprivk
+coproc SERVER { ${FUTILITY} serve --keys ${TMP}.signkey.vbprivk; }
+request sign --signprivate ${TMP}.signkey.vbprivk ${KEY_ARGS} \
+  ${TMP}.vblock.new3 >&${SERVER[1]}
+read -r status size <&${SERVER[0]}
+[ "$status" = "0" ]
+head -c "$size" <&${SERVER[0]} > /dev/null
+cmp ${TMP}.vblock.old ${TMP}.vblock.new3
+
+echo "not a key" > ${TMP}.signkey.vbprivk
+request sign --signprivate ${TMP}.signkey.vbprivk ${KEY_ARGS} \
+  ${TMP}.vblock.new4 >&${SERVER[1]}
+read -r status size <&${SERVER[0]}
+[ "$status" = "1" ]
+eval "exec ${SERVER[1]}>&-"
+wait
+
+# cleanup
+rm -rf ${TMP}*
+exit 0
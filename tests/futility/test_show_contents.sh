@@ -37,6 +37,47 @@ for file in $SHOW_FILES; do
     diff ${wantfile} ${gotfile}
 done
 
+# Showing them all at once should give the same output, in the same order
+seqfile="${OUTDIR}/show.sequential"
+rm -f "${seqfile}"
+paths=
+for file in $SHOW_FILES; do
+    cat "${OUTDIR}/show.${file//\//_}" >> "${seqfile}"
+    paths="${paths} ${SRCDIR}/${file}"
+done
+${FUTILITY} show -j 4 ${paths} | diff "${seqfile}" -
+
+# Test 'futility show --json' against expected output, in one invocation
+JSON_FILES="
+  tests/devkeys/root_key.vbpubk
+  tests/devkeys/root_key.vbprivk
+  tests/devkeys/kernel.keyblock
+  tests/futility/data/fw_vblock.bin
+  tests/futility/data/fw_gbb.bin
+  tests/futility/data/kern_preamble.bin
+  tests/futility/data/sample.vbpubk2
+"
+outfile="show.json"
+gotfile="${OUTDIR}/${outfile}"
+wantfile="${SRCDIR}/tests/futility/expect_output/${outfile}"
+(cd "${SRCDIR}" && ${FUTILITY} show --json ${JSON_FILES}) | tee "${gotfile}"
+
+# Uncomment this to update the expected output
+#cp ${gotfile} ${wantfile}
+
+diff ${wantfile} ${gotfile}
+(cd "${SRCDIR}" && ${FUTILITY} show --json -j 4 ${JSON_FILES}) | \
+    diff "${gotfile}" -
+
+# Bytes in the HWID which aren't UTF-8 are escaped, and the digest is shown
+${FUTILITY} gbb -c 0x100,0x1000,0x1000,0x1000 ${TMP}.gbb
+${FUTILITY} gbb -s --hwid=$'TEST \xff\xc3\xa9' \
+  -k "${SRCDIR}/tests/devkeys/root_key.vbpubk" \
+  -r "${SRCDIR}/tests/devkeys/recovery_key.vbpubk" ${TMP}.gbb
+${FUTILITY} show --json ${TMP}.gbb > ${TMP}.gbb.json
+grep -qF $'"hwid": "TEST \\u00ff\xc3\xa9"' ${TMP}.gbb.json
+grep -qF '"valid": true' ${TMP}.gbb.json
+
 
 # Test 'futility vbutil_key' against expected output
 VBUTIL_KEY_FILES="
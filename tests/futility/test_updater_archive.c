@@ -0,0 +1,201 @@
+/*
+ * Copyright 2018 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for mapping files from firmware updater archives.
+ */
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "futility.h"
+#include "test_common.h"
+#include "updater.h"
+
+/*
+ * tests/futility/data/archive.zip has a deflated entry, then a stored one,
+ * and a comment after the central directory.
+ */
+#define ZIP_FILE "tests/futility/data/archive.zip"
+#define STORED_NAME "stored.bin"
+#define STORED_SIZE 5000
+#define STORED_CRC 0x1abd04d4
+#define STORED_OFFSET 568
+#define COMPRESSED_NAME "compressed.txt"
+#define COMPRESSED_SIZE 6800
+#define COMPRESSED_CRC 0x81146b44
+
+static uint8_t stored[STORED_SIZE];
+static uint8_t compressed[COMPRESSED_SIZE];
+static char tmpdir[] = "/tmp/test_updater_archive.XXXXXX";
+
+/* Fills the buffers with what the entries should hold */
+static void init_expected(void)
+{
+	char line[40];
+	int i;
+
+	for (i = 0; i < STORED_SIZE; i++)
+		stored[i] = i * 7 + 3;
+	for (i = 0; i < 200; i++) {
+		snprintf(line, sizeof(line),
+			 "line %04d of a compressible entry\n", i);
+		memcpy(compressed + i * 34, line, 34);
+	}
+}
+
+static void zip_find_stored_data_tests(const char *srcdir)
+{
+	char path[PATH_MAX];
+	uint8_t buf[STORED_SIZE];
+	int fd;
+
+	snprintf(path, sizeof(path), "%s/%s", srcdir, ZIP_FILE);
+	fd = open(path, O_RDONLY);
+	TEST_TRUE(fd >= 0, "Open test ZIP");
+	if (fd < 0)
+		return;
+
+	TEST_EQ(zip_find_stored_data(fd, STORED_NAME, STORED_SIZE, STORED_CRC),
+		STORED_OFFSET, "Stored entry found");
+	TEST_EQ(pread(fd, buf, sizeof(buf), STORED_OFFSET), sizeof(buf),
+		"Read stored entry");
+	TEST_SUCC(memcmp(buf, stored, sizeof(buf)), "Stored entry content");
+
+	TEST_EQ(zip_find_stored_data(fd, COMPRESSED_NAME, COMPRESSED_SIZE,
+				     COMPRESSED_CRC),
+		-1, "Compressed entry is not mapped");
+	TEST_EQ(zip_find_stored_data(fd, STORED_NAME, STORED_SIZE,
+				     STORED_CRC + 1),
+		-1, "Wrong CRC");
+	TEST_EQ(zip_find_stored_data(fd, STORED_NAME, STORED_SIZE - 1,
+				     STORED_CRC),
+		-1, "Wrong size");
+	TEST_EQ(zip_find_stored_data(fd, "stored", STORED_SIZE, STORED_CRC),
+		-1, "Prefix of a name");
+	TEST_EQ(zip_find_stored_data(fd, "missing.bin", STORED_SIZE,
+				     STORED_CRC),
+		-1, "Missing entry");
+	close(fd);
+
+	snprintf(path, sizeof(path), "%s/tests/futility/data/README", srcdir);
+	fd = open(path, O_RDONLY);
+	TEST_EQ(zip_find_stored_data(fd, STORED_NAME, STORED_SIZE, STORED_CRC),
+		-1, "Not a ZIP file");
+	close(fd);
+}
+
+/* Maps fname from ar, and checks it has the expected content */
+static void check_map_file(struct archive *ar, const char *fname,
+			   const uint8_t *expect, uint32_t expect_size,
+			   const char *desc)
+{
+	uint8_t *data = NULL;
+	uint32_t size = 0;
+
+	printf("%s\n", desc);
+	TEST_SUCC(archive_map_file(ar, fname, &data, &size), "  mapped");
+	if (!data)
+		return;
+	TEST_EQ(size, expect_size, "  size");
+	if (size && size == expect_size)
+		TEST_SUCC(memcmp(data, expect, size), "  content");
+	/* The pages are private to the caller */
+	if (size)
+		data[0] ^= 0xff;
+	archive_unmap_file(data, size);
+}
+
+static void archive_map_file_tests(const char *srcdir)
+{
+	char path[PATH_MAX], dir[PATH_MAX], abs_path[PATH_MAX];
+	struct archive *ar;
+	uint8_t *data;
+	uint32_t size;
+	FILE *fp;
+
+	/* A directory, and a file outside any archive */
+	snprintf(dir, sizeof(dir), "%s/tests/futility/data", srcdir);
+	ar = archive_open(dir);
+	TEST_PTR_NEQ(ar, NULL, "Open directory archive");
+	if (!ar)
+		return;
+	snprintf(path, sizeof(path), "%s/%s", srcdir, ZIP_FILE);
+	fp = fopen(path, "rb");
+	TEST_PTR_NEQ(fp, NULL, "Open test ZIP");
+	if (fp) {
+		uint8_t zip_data[8192];
+		uint32_t zip_size = fread(zip_data, 1, sizeof(zip_data), fp);
+
+		fclose(fp);
+		check_map_file(ar, "archive.zip", zip_data, zip_size,
+			       "Map file from a directory");
+		TEST_PTR_NEQ(realpath(path, abs_path), NULL, "Absolute path");
+		check_map_file(ar, abs_path, zip_data, zip_size,
+			       "Map file from an absolute path");
+		check_map_file(NULL, path, zip_data, zip_size,
+			       "Map file without an archive");
+	}
+	TEST_NEQ(archive_map_file(ar, "missing.bin", &data, &size), 0,
+		 "Map missing file");
+	archive_close(ar);
+
+	/* Empty files can't be mapped, so they are read */
+	TEST_PTR_NEQ(mkdtemp(tmpdir), NULL, "Make temporary directory");
+	snprintf(path, sizeof(path), "%s/empty", tmpdir);
+	fp = fopen(path, "wb");
+	if (fp)
+		fclose(fp);
+	ar = archive_open(tmpdir);
+	TEST_PTR_NEQ(ar, NULL, "Open temporary directory");
+	if (ar) {
+		check_map_file(ar, "empty", NULL, 0, "Map empty file");
+		archive_close(ar);
+	}
+	check_map_file(NULL, path, NULL, 0, "Map empty absolute path");
+	unlink(path);
+	rmdir(tmpdir);
+
+#ifdef HAVE_LIBZIP
+	/* The stored entry is mapped, and the compressed one read */
+	snprintf(path, sizeof(path), "%s/%s", srcdir, ZIP_FILE);
+	ar = archive_open(path);
+	TEST_PTR_NEQ(ar, NULL, "Open ZIP archive");
+	if (!ar)
+		return;
+	check_map_file(ar, STORED_NAME, stored, STORED_SIZE,
+		       "Map stored entry");
+	check_map_file(ar, COMPRESSED_NAME, compressed, COMPRESSED_SIZE,
+		       "Map compressed entry");
+	/* Mapped pages are private, so the archive still has the original */
+	check_map_file(ar, STORED_NAME, stored, STORED_SIZE,
+		       "Map stored entry again");
+	TEST_NEQ(archive_map_file(ar, "missing.bin", &data, &size), 0,
+		 "Map missing entry");
+	archive_close(ar);
+#endif
+}
+
+int main(int argc, char *argv[])
+{
+	char *srcdir;
+
+	/* Where's the source directory? */
+	srcdir = getenv("SRCDIR");
+	if (argc > 1)
+		srcdir = argv[1];
+	if (!srcdir)
+		srcdir = ".";
+
+	init_expected();
+	zip_find_stored_data_tests(srcdir);
+	archive_map_file_tests(srcdir);
+
+	return !gTestSuccess;
+}
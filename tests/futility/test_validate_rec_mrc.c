@@ -0,0 +1,197 @@
+/*
+ * Copyright 2018 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for the MRC cache checksum and futility validate_rec_mrc.
+ */
+
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "futility.h"
+#include "test_common.h"
+
+extern const struct futil_cmd_t __cmd_validate_rec_mrc;
+
+struct mrc_metadata {
+	uint32_t signature;
+	uint32_t data_size;
+	uint16_t data_checksum;
+	uint16_t header_checksum;
+	uint32_t version;
+} __attribute__((packed));
+
+#define MRC_DATA_SIGNATURE (('M'<<0)|('R'<<8)|('C'<<16)|('D'<<24))
+#define CACHE_SIZE 0x10000
+
+static uint8_t cache[CACHE_SIZE];
+static char tmpname[] = "/tmp/test_validate_rec_mrc.XXXXXX";
+
+/* The byte-at-a-time checksum, as futility and coreboot originally had it */
+static unsigned long ref_ip_checksum(const void *addr, unsigned long length)
+{
+	const uint8_t *ptr = addr;
+	union {
+		uint8_t byte[2];
+		uint16_t word;
+	} value;
+	unsigned long sum = 0;
+	unsigned long i;
+
+	for (i = 0; i < length; i++) {
+		unsigned long v = ptr[i];
+		if (i & 1)
+			v <<= 8;
+		sum += v;
+		if (sum > 0xFFFF)
+			sum = (sum + (sum >> 16)) & 0xFFFF;
+	}
+	value.byte[0] = sum & 0xff;
+	value.byte[1] = (sum >> 8) & 0xff;
+	return (~value.word) & 0xFFFF;
+}
+
+static void checksum_tests(void)
+{
+	/* Example from RFC 1071 section 3 */
+	static const uint8_t rfc1071[] = {
+		0x00, 0x01, 0xf2, 0x03, 0xf4, 0xf5, 0xf6, 0xf7
+	};
+	static uint8_t buf[4096 + 8];
+	unsigned long offset, len;
+	uint16_t sum;
+	int ok;
+
+	sum = compute_ip_checksum(rfc1071, sizeof(rfc1071));
+	TEST_EQ(((uint8_t *)&sum)[0], 0x22, "RFC 1071 example, first byte");
+	TEST_EQ(((uint8_t *)&sum)[1], 0x0d, "RFC 1071 example, second byte");
+
+	TEST_EQ(compute_ip_checksum(buf, 0), 0xffff, "Empty buffer");
+
+	srand(0x1071);
+	for (len = 0; len < sizeof(buf); len++)
+		buf[len] = rand();
+	ok = 1;
+	for (offset = 0; offset < 8; offset++)
+		for (len = 0; len < 300; len++)
+			if (compute_ip_checksum(buf + offset, len) !=
+			    ref_ip_checksum(buf + offset, len))
+				ok = 0;
+	TEST_TRUE(ok, "Random data, all alignments and short lengths");
+	TEST_EQ(compute_ip_checksum(buf + 1, 4095),
+		ref_ip_checksum(buf + 1, 4095), "Random data, 4095 bytes");
+
+	/* Every word carries */
+	memset(buf, 0xff, sizeof(buf));
+	ok = 1;
+	for (len = 0; len < sizeof(buf); len += 511)
+		if (compute_ip_checksum(buf, len) != ref_ip_checksum(buf, len))
+			ok = 0;
+	TEST_TRUE(ok, "All ones");
+}
+
+/* Put a slot from block start to block end, with a valid header and data */
+static void put_slot(uint16_t start, uint16_t end, uint8_t fill)
+{
+	struct mrc_metadata *md = (struct mrc_metadata *)(cache + start * 16);
+	uint32_t data_size = (end - start) * 16 - sizeof(*md);
+
+	memset(md, 0, sizeof(*md));
+	md->signature = MRC_DATA_SIGNATURE;
+	md->data_size = data_size;
+	memset(&md[1], fill, data_size);
+	md->data_checksum = compute_ip_checksum(&md[1], data_size);
+	md->header_checksum = compute_ip_checksum(md, sizeof(*md));
+}
+
+/* Build a cache whose block offsets are given, ending with 0xffff */
+static void build_cache(const uint16_t *offsets, int count)
+{
+	uint16_t *mb = (uint16_t *)cache;
+	int i;
+
+	memset(cache, 0xff, sizeof(cache));
+	for (i = 0; i < count; i++)
+		mb[i] = offsets[i];
+	for (i = 1; i < count; i++)
+		put_slot(offsets[i - 1], offsets[i], i);
+}
+
+static int validate(void)
+{
+	char *argv[] = {"validate_rec_mrc", tmpname, NULL};
+	FILE *fp;
+
+	fp = fopen(tmpname, "wb");
+	if (!fp || 1 != fwrite(cache, sizeof(cache), 1, fp)) {
+		fprintf(stderr, "Unable to write %s\n", tmpname);
+		exit(1);
+	}
+	fclose(fp);
+
+	optind = 0;
+	return __cmd_validate_rec_mrc.handler(2, argv);
+}
+
+static void slot_tests(void)
+{
+	static const uint16_t one_slot[] = {1, 0x101};
+	static const uint16_t two_slots[] = {1, 0x101, 0x201};
+	static const uint16_t two_blocks[] = {2, 0x102};
+	static const uint16_t past_end[] = {1, 0x1001};
+	uint16_t *mb = (uint16_t *)cache;
+
+	build_cache(one_slot, ARRAY_SIZE(one_slot));
+	TEST_SUCC(validate(), "One slot");
+
+	build_cache(two_blocks, ARRAY_SIZE(two_blocks));
+	TEST_SUCC(validate(), "Two metadata blocks");
+
+	build_cache(one_slot, ARRAY_SIZE(one_slot));
+	cache[0x10 + 12] ^= 1;
+	TEST_NEQ(validate(), 0, "Bad header checksum");
+
+	build_cache(one_slot, ARRAY_SIZE(one_slot));
+	cache[0x10 + 0x100] ^= 1;
+	TEST_NEQ(validate(), 0, "Bad data");
+
+	build_cache(two_slots, ARRAY_SIZE(two_slots));
+	TEST_NEQ(validate(), 0, "Two slots");
+
+	build_cache(one_slot, ARRAY_SIZE(one_slot));
+	mb[2] = 0x80;
+	TEST_NEQ(validate(), 0, "Slot ends before it starts");
+
+	build_cache(past_end, ARRAY_SIZE(past_end));
+	TEST_NEQ(validate(), 0, "Slot past the end");
+
+	build_cache(one_slot, 0);
+	TEST_NEQ(validate(), 0, "Empty cache");
+
+	build_cache(one_slot, ARRAY_SIZE(one_slot));
+	mb[0] = 0;
+	TEST_NEQ(validate(), 0, "No metadata blocks");
+}
+
+int main(int argc, char *argv[])
+{
+	int fd;
+
+	checksum_tests();
+
+	fd = mkstemp(tmpname);
+	if (fd < 0) {
+		fprintf(stderr, "Unable to create %s\n", tmpname);
+		return 1;
+	}
+	close(fd);
+	slot_tests();
+	unlink(tmpname);
+
+	return gTestSuccess ? 0 : 255;
+}
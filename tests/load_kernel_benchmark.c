@@ -0,0 +1,461 @@
+/* Copyright 2018 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Measure LoadKernel() as kernel size and the number of kernel partitions
+ * grow, on a simulated disk with per-read latency and limited bandwidth.
+ *
+ * The simulated disk answers at once and adds what each read would have
+ * cost to a counter.  The disk time and read count of one LoadKernel() call
+ * are reported beside the CPU time of LoadKernel() and of its GPT, vblock
+ * and body steps.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "2sysincludes.h"
+#include "2api.h"
+#include "2common.h"
+#include "2misc.h"
+#include "2nvstorage.h"
+#include "2rsa.h"
+#include "crc32.h"
+#include "gpt.h"
+#include "gpt_misc.h"
+#include "host_common.h"
+#include "host_key.h"
+#include "host_keyblock.h"
+#include "host_signature.h"
+#include "load_kernel_fw.h"
+#include "timer_utils.h"
+#include "vb2_common.h"
+#include "vboot_api.h"
+#include "vboot_common.h"
+#include "vboot_kernel.h"
+
+#define SECTOR_SIZE 512
+#define GPT_ENTRIES_SECTORS 32
+#define FIRST_PART_LBA 64
+/* Size of the vblock at the start of each kernel partition */
+#define VBLOCK_SIZE 0x10000
+/* Combined key and kernel version of every kernel on the disk */
+#define KERNEL_VERSION 0x10001
+
+/* Simulated disk */
+static struct {
+	uint8_t *data;
+	uint64_t lba_count;
+	uint32_t latency_usecs;	 /* Cost of each read or write call */
+	uint32_t mbytes_per_sec;  /* Transfer rate */
+	uint64_t nsecs;		 /* Accumulated simulated time */
+	uint32_t reads;
+	uint64_t read_bytes;
+	/* GPT sectors, restored before each LoadKernel() */
+	uint8_t primary_gpt[(1 + GPT_ENTRIES_SECTORS + 1) * SECTOR_SIZE];
+	uint8_t secondary_gpt[(GPT_ENTRIES_SECTORS + 1) * SECTOR_SIZE];
+} disk = {
+	.latency_usecs = 100,
+	.mbytes_per_sec = 200,
+};
+
+static void disk_account(uint64_t lba_count)
+{
+	uint64_t bytes = lba_count * SECTOR_SIZE;
+
+	/* 1 MB/s moves about one byte per microsecond */
+	disk.nsecs += disk.latency_usecs * 1000ULL +
+		bytes * 1000 / disk.mbytes_per_sec;
+}
+
+VbError_t VbExDiskRead(VbExDiskHandle_t handle, uint64_t lba_start,
+		       uint64_t lba_count, void *buffer)
+{
+	if (handle != (VbExDiskHandle_t)1 ||
+	    lba_start + lba_count > disk.lba_count)
+		return VBERROR_UNKNOWN;
+
+	memcpy(buffer, disk.data + lba_start * SECTOR_SIZE,
+	       lba_count * SECTOR_SIZE);
+	disk_account(lba_count);
+	disk.reads++;
+	disk.read_bytes += lba_count * SECTOR_SIZE;
+	return VBERROR_SUCCESS;
+}
+
+VbError_t VbExDiskWrite(VbExDiskHandle_t handle, uint64_t lba_start,
+			uint64_t lba_count, const void *buffer)
+{
+	if (handle != (VbExDiskHandle_t)1 ||
+	    lba_start + lba_count > disk.lba_count)
+		return VBERROR_UNKNOWN;
+
+	memcpy(disk.data + lba_start * SECTOR_SIZE, buffer,
+	       lba_count * SECTOR_SIZE);
+	disk_account(lba_count);
+	return VBERROR_SUCCESS;
+}
+
+static void disk_reset_counters(void)
+{
+	disk.nsecs = 0;
+	disk.reads = 0;
+	disk.read_bytes = 0;
+}
+
+/* LoadKernel() marks bad partitions in the GPT; put it back */
+static void disk_restore_gpt(void)
+{
+	memcpy(disk.data, disk.primary_gpt, sizeof(disk.primary_gpt));
+	memcpy(disk.data + (disk.lba_count - GPT_ENTRIES_SECTORS - 1) *
+	       SECTOR_SIZE, disk.secondary_gpt, sizeof(disk.secondary_gpt));
+}
+
+/* Keys and a signed kernel to put on the disk */
+static struct vb2_packed_key *subkey;
+static struct vb2_private_key *subkey_private;
+static struct vb2_packed_key *data_key;
+static struct vb2_private_key *data_key_private;
+static uint8_t vblock[VBLOCK_SIZE];
+static uint8_t *body;
+
+static int read_keys(const char *keys_dir)
+{
+	char filename[1024];
+
+	snprintf(filename, sizeof(filename), "%s/key_rsa4096.sha256.vbpubk",
+		 keys_dir);
+	subkey = vb2_read_packed_key(filename);
+	snprintf(filename, sizeof(filename), "%s/key_rsa4096.sha256.vbprivk",
+		 keys_dir);
+	subkey_private = vb2_read_private_key(filename);
+	snprintf(filename, sizeof(filename), "%s/key_rsa2048.sha256.vbpubk",
+		 keys_dir);
+	data_key = vb2_read_packed_key(filename);
+	snprintf(filename, sizeof(filename), "%s/key_rsa2048.sha256.vbprivk",
+		 keys_dir);
+	data_key_private = vb2_read_private_key(filename);
+
+	if (!subkey || !subkey_private || !data_key || !data_key_private) {
+		fprintf(stderr, "Can't read keys from %s\n", keys_dir);
+		return 1;
+	}
+	return 0;
+}
+
+/* Sign a kernel body of the given size, the way vbutil_kernel packs it */
+static int sign_kernel(uint32_t kernel_size)
+{
+	struct vb2_keyblock *keyblock = NULL;
+	struct vb2_kernel_preamble *preamble = NULL;
+	struct vb2_signature *body_sig = NULL;
+	uint32_t seed = kernel_size;
+	uint32_t i;
+	int rv = 1;
+
+	free(body);
+	body = malloc(kernel_size);
+	if (!body)
+		return 1;
+	for (i = 0; i < kernel_size; i++) {
+		seed = seed * 1103515245 + 12345;
+		body[i] = seed >> 16;
+	}
+
+	keyblock = vb2_create_keyblock(data_key, subkey_private,
+				       VB2_KEY_BLOCK_FLAG_DEVELOPER_0 |
+				       VB2_KEY_BLOCK_FLAG_DEVELOPER_1 |
+				       VB2_KEY_BLOCK_FLAG_RECOVERY_0);
+	body_sig = vb2_calculate_signature(body, kernel_size, data_key_private);
+	if (!keyblock || !body_sig)
+		goto done;
+	preamble = vb2_create_kernel_preamble(
+			KERNEL_VERSION & 0xffff, 0x100000, 0x100000, 0,
+			body_sig, 0, 0, 0,
+			VBLOCK_SIZE - keyblock->keyblock_size,
+			data_key_private);
+	if (!preamble ||
+	    keyblock->keyblock_size + preamble->preamble_size != VBLOCK_SIZE)
+		goto done;
+
+	memcpy(vblock, keyblock, keyblock->keyblock_size);
+	memcpy(vblock + keyblock->keyblock_size, preamble,
+	       preamble->preamble_size);
+	rv = 0;
+
+ done:
+	free(keyblock);
+	free(preamble);
+	free(body_sig);
+	return rv;
+}
+
+static void put_gpt_header(GptHeader *h, GptEntry *entries, uint64_t my_lba,
+			   uint64_t alternate_lba, uint64_t entries_lba,
+			   uint64_t last_usable_lba)
+{
+	memcpy(h->signature, GPT_HEADER_SIGNATURE, GPT_HEADER_SIGNATURE_SIZE);
+	h->revision = GPT_HEADER_REVISION;
+	h->size = sizeof(GptHeader);
+	h->my_lba = my_lba;
+	h->alternate_lba = alternate_lba;
+	h->first_usable_lba = 1 + 1 + GPT_ENTRIES_SECTORS;
+	h->last_usable_lba = last_usable_lba;
+	h->entries_lba = entries_lba;
+	h->number_of_entries = GPT_ENTRIES_SECTORS * SECTOR_SIZE /
+			sizeof(GptEntry);
+	h->size_of_entry = sizeof(GptEntry);
+	h->entries_crc32 = Crc32(entries, GPT_ENTRIES_SECTORS * SECTOR_SIZE);
+	h->header_crc32 = 0;
+	h->header_crc32 = Crc32(h, h->size);
+}
+
+/*
+ * Build a disk with nparts kernel partitions.  Only the last one tried (the
+ * lowest priority) is good; the others have a keyblock signature which
+ * doesn't verify, so LoadKernel() has to look at each vblock first.
+ */
+static int build_disk(uint32_t kernel_size, int nparts)
+{
+	Guid kernel_type = GPT_ENT_TYPE_CHROMEOS_KERNEL;
+	uint64_t part_sectors = (VBLOCK_SIZE + kernel_size + SECTOR_SIZE - 1) /
+			SECTOR_SIZE;
+	uint64_t secondary_lba;
+	GptHeader *h;
+	GptEntry *entries;
+	int i;
+
+	free(disk.data);
+	disk.lba_count = FIRST_PART_LBA + part_sectors * nparts +
+			GPT_ENTRIES_SECTORS + 1;
+	disk.data = calloc(disk.lba_count, SECTOR_SIZE);
+	if (!disk.data)
+		return 1;
+	secondary_lba = disk.lba_count - 1 - GPT_ENTRIES_SECTORS;
+
+	h = (GptHeader *)(disk.data + SECTOR_SIZE);
+	entries = (GptEntry *)(disk.data + 2 * SECTOR_SIZE);
+	for (i = 0; i < nparts; i++) {
+		GptEntry *e = entries + i;
+		uint8_t *part;
+
+		memcpy(&e->type, &kernel_type, sizeof(kernel_type));
+		memset(&e->unique, i + 1, sizeof(e->unique));
+		e->starting_lba = FIRST_PART_LBA + part_sectors * i;
+		e->ending_lba = e->starting_lba + part_sectors - 1;
+		SetEntryPriority(e, nparts - i);
+		SetEntrySuccessful(e, 1);
+
+		part = disk.data + e->starting_lba * SECTOR_SIZE;
+		memcpy(part, vblock, VBLOCK_SIZE);
+		memcpy(part + VBLOCK_SIZE, body, kernel_size);
+		if (i < nparts - 1) {
+			struct vb2_keyblock *kb = (struct vb2_keyblock *)part;
+			vb2_signature_data(&kb->keyblock_signature)[0] ^= 0x55;
+		}
+	}
+	put_gpt_header(h, entries, 1, disk.lba_count - 1, 2,
+		       secondary_lba - 1);
+
+	/* Secondary GPT */
+	memcpy(disk.data + secondary_lba * SECTOR_SIZE, entries,
+	       GPT_ENTRIES_SECTORS * SECTOR_SIZE);
+	put_gpt_header((GptHeader *)(disk.data + (disk.lba_count - 1) *
+				     SECTOR_SIZE),
+		       entries, disk.lba_count - 1, 1, secondary_lba,
+		       secondary_lba - 1);
+
+	memcpy(disk.primary_gpt, disk.data, sizeof(disk.primary_gpt));
+	memcpy(disk.secondary_gpt, disk.data + secondary_lba * SECTOR_SIZE,
+	       sizeof(disk.secondary_gpt));
+	return 0;
+}
+
+static uint8_t shared_data[VB_SHARED_DATA_MIN_SIZE];
+static VbSharedDataHeader *shared = (VbSharedDataHeader *)shared_data;
+static uint8_t workbuf[VB2_KERNEL_WORKBUF_RECOMMENDED_SIZE]
+	__attribute__ ((aligned (VB2_WORKBUF_ALIGN)));
+static struct vb2_context ctx;
+static LoadKernelParams params;
+
+static int setup_context(uint32_t kernel_size)
+{
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.workbuf = workbuf;
+	ctx.workbuf_size = sizeof(workbuf);
+	if (vb2_init_context(&ctx))
+		return 1;
+	vb2_nv_init(&ctx);
+
+	VbSharedDataInit(shared, sizeof(shared_data));
+	VbSharedDataSetKernelKey(shared, (VbPublicKey *)subkey);
+	/* Matching the TPM lets LoadKernel() stop at the first good kernel */
+	shared->kernel_version_tpm = KERNEL_VERSION;
+	vb2_get_sd(&ctx)->vbsd = shared;
+
+	free(params.kernel_buffer);
+	memset(&params, 0, sizeof(params));
+	params.disk_handle = (VbExDiskHandle_t)1;
+	params.bytes_per_lba = SECTOR_SIZE;
+	params.streaming_lba_count = disk.lba_count;
+	params.gpt_lba_count = disk.lba_count;
+	params.kernel_buffer_size = kernel_size;
+	params.kernel_buffer = malloc(kernel_size);
+	return params.kernel_buffer ? 0 : 1;
+}
+
+static VbError_t load_kernel(void)
+{
+	disk_restore_gpt();
+	return LoadKernel(&ctx, &params);
+}
+
+static void read_gpt(void)
+{
+	GptData gpt;
+
+	memset(&gpt, 0, sizeof(gpt));
+	gpt.sector_bytes = SECTOR_SIZE;
+	gpt.streaming_drive_sectors = disk.lba_count;
+	gpt.gpt_drive_sectors = disk.lba_count;
+	if (!AllocAndReadGptData(params.disk_handle, &gpt))
+		GptInit(&gpt);
+	WriteAndFreeGptData(params.disk_handle, &gpt);
+}
+
+/* vb2_verify_kernel_vblock() checks signatures in place, so use a copy */
+static uint8_t vblock_work[VBLOCK_SIZE];
+
+static int verify_vblock(const struct vb2_public_key *key)
+{
+	VbSharedDataKernelPart shpart;
+	struct vb2_workbuf wb;
+
+	memcpy(vblock_work, vblock, VBLOCK_SIZE);
+	memset(&shpart, 0, sizeof(shpart));
+	vb2_workbuf_from_ctx(&ctx, &wb);
+	return vb2_verify_kernel_vblock(&ctx, vblock_work, VBLOCK_SIZE, key,
+					&params, KERNEL_VERSION, &shpart, &wb);
+}
+
+static int verify_body(const struct vb2_public_key *key, uint32_t kernel_size)
+{
+	const struct vb2_kernel_preamble *preamble =
+		(const struct vb2_kernel_preamble *)
+		(vblock + ((struct vb2_keyblock *)vblock)->keyblock_size);
+	const struct vb2_signature *sig = &preamble->body_signature;
+	struct vb2_workbuf wb;
+
+	memcpy(vblock_work, sig, sig->sig_offset + sig->sig_size);
+	vb2_workbuf_from_ctx(&ctx, &wb);
+	return vb2_verify_data(body, kernel_size,
+			       (struct vb2_signature *)vblock_work, key, &wb);
+}
+
+static int benchmark(uint32_t kernel_mb, int nparts)
+{
+	uint32_t kernel_size = kernel_mb << 20;
+	struct vb2_public_key subkey_unpacked, data_key_unpacked;
+	uint64_t lk_usecs, gpt_usecs, vblock_usecs, body_usecs;
+	uint64_t nsecs;
+	uint64_t disk_usecs;
+	uint32_t reads;
+	uint64_t read_bytes;
+	char name[32];
+
+	if (sign_kernel(kernel_size) || build_disk(kernel_size, nparts) ||
+	    setup_context(kernel_size)) {
+		fprintf(stderr, "Can't set up %u MB kernel disk\n", kernel_mb);
+		return 1;
+	}
+	if (vb2_unpack_key(&subkey_unpacked, subkey) ||
+	    vb2_unpack_key(&data_key_unpacked, data_key)) {
+		fprintf(stderr, "Can't unpack keys\n");
+		return 1;
+	}
+
+	/* Make sure the disk boots, and see what one boot costs on disk */
+	disk_reset_counters();
+	if (load_kernel() != VBERROR_SUCCESS ||
+	    params.partition_number != nparts ||
+	    memcmp(params.kernel_buffer, body, kernel_size)) {
+		fprintf(stderr, "LoadKernel() didn't find the good kernel\n");
+		return 1;
+	}
+	disk_usecs = disk.nsecs / 1000;
+	reads = disk.reads;
+	read_bytes = disk.read_bytes;
+
+	if (verify_vblock(&subkey_unpacked) ||
+	    verify_body(&data_key_unpacked, kernel_size)) {
+		fprintf(stderr, "Kernel doesn't verify\n");
+		return 1;
+	}
+
+	TIME_LOOP(nsecs, load_kernel());
+	lk_usecs = nsecs / 1000;
+	TIME_LOOP(nsecs, read_gpt());
+	gpt_usecs = nsecs / 1000;
+	TIME_LOOP(nsecs, verify_vblock(&subkey_unpacked));
+	vblock_usecs = nsecs / 1000;
+	TIME_LOOP(nsecs, verify_body(&data_key_unpacked, kernel_size));
+	body_usecs = nsecs / 1000;
+
+	snprintf(name, sizeof(name), "%uMB_%dpart", kernel_mb, nparts);
+	fprintf(stderr, "# %-12s load_kernel %6u us (+%6u us disk, %u reads, "
+		"%u KB)  gpt %4u us  vblock %5u us  body %6u us\n",
+		name, (uint32_t)lk_usecs, (uint32_t)disk_usecs, reads,
+		(uint32_t)(read_bytes >> 10), (uint32_t)gpt_usecs,
+		(uint32_t)vblock_usecs, (uint32_t)body_usecs);
+	fprintf(stdout, "usecs_load_kernel_%s:%u\n", name, (uint32_t)lk_usecs);
+	fprintf(stdout, "usecs_disk_%s:%u\n", name, (uint32_t)disk_usecs);
+	fprintf(stdout, "disk_reads_%s:%u\n", name, reads);
+	fprintf(stdout, "usecs_gpt_%s:%u\n", name, (uint32_t)gpt_usecs);
+	fprintf(stdout, "usecs_vblock_%s:%u\n", name, (uint32_t)vblock_usecs);
+	fprintf(stdout, "usecs_body_%s:%u\n", name, (uint32_t)body_usecs);
+	return 0;
+}
+
+static void print_help(const char *progname)
+{
+	fprintf(stderr, "\nUsage: %s [-l latency_usecs] [-b mbytes_per_sec] "
+		"<keys_dir>\n\n", progname);
+}
+
+int main(int argc, char *argv[])
+{
+	static const uint32_t kernel_mbs[] = {4, 8, 16};
+	static const int part_counts[] = {1, 2, 4};
+	int errors = 0;
+	int i, j, c;
+
+	while ((c = getopt(argc, argv, "l:b:")) != -1) {
+		switch (c) {
+		case 'l':
+			disk.latency_usecs = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			disk.mbytes_per_sec = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			print_help(argv[0]);
+			return 1;
+		}
+	}
+	if (optind != argc - 1 || !disk.mbytes_per_sec) {
+		print_help(argv[0]);
+		return 1;
+	}
+	if (read_keys(argv[optind]))
+		return 1;
+
+	fprintf(stderr, "# disk: %u us per read, %u MB/s\n",
+		disk.latency_usecs, disk.mbytes_per_sec);
+	for (i = 0; i < ARRAY_SIZE(kernel_mbs); i++)
+		for (j = 0; j < ARRAY_SIZE(part_counts); j++)
+			errors += benchmark(kernel_mbs[i], part_counts[j]);
+
+	return errors ? 1 : 0;
+}
@@ -10,6 +10,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "2sysincludes.h"
+#include "2api.h"
 #include "2crc8.h"
 #include "rollback_index.h"
 #include "test_common.h"
@@ -54,7 +56,7 @@ static RollbackSpaceKernel mock_rsk;
 
 static union {
 	struct RollbackSpaceFwmp fwmp;
-	uint8_t buf[FWMP_NV_MAX_SIZE];
+	uint8_t buf[VB2_SECDATA_FWMP_MAX_SIZE];
 } mock_fwmp;
 
 static uint32_t mock_permissions;
@@ -76,6 +78,7 @@ static void ResetMocks(int fail_on_call, uint32_t fail_with_err)
 	fail_with_error = fail_with_err;
 	noise_count = 0;
 	memset(&noise_on, 0, sizeof(noise_on));
+	RollbackSpaceCacheReset();
 
 	memset(&mock_pflags, 0, sizeof(mock_pflags));
 	memset(&mock_rsf, 0, sizeof(mock_rsf));
@@ -577,6 +580,135 @@ static void RollbackKernelTest(void)
 		    "tlcl calls");
 }
 
+/****************************************************************************/
+/* Tests for skipping reads and writes of unchanged spaces */
+
+static void SetupGoodKernelSpace(uint32_t version)
+{
+	mock_rsk.struct_version = 2;
+	mock_rsk.uid = ROLLBACK_SPACE_KERNEL_UID;
+	mock_rsk.kernel_versions = version;
+	mock_rsk.crc8 = vb2_crc8(&mock_rsk,
+				 offsetof(RollbackSpaceKernel, crc8));
+	mock_permissions = TPM_NV_PER_PPWRITE;
+}
+
+static void WriteAvoidanceTest(void)
+{
+	struct RollbackWriteStats stats;
+	RollbackSpaceFirmware rsf;
+	uint32_t version = 0;
+
+	/* Kernel version read, then written back unchanged */
+	ResetMocks(0, 0);
+	SetupGoodKernelSpace(0x10001);
+	TEST_EQ(RollbackKernelRead(&version), 0, "RollbackKernelRead()");
+	TEST_EQ(RollbackKernelWrite(0x10001), 0, "Write unchanged version");
+	TEST_STR_EQ(mock_calls,
+		    "TlclRead(0x1008, 13)\n"
+		    "TlclGetPermissions(0x1008)\n",
+		    "  tlcl calls");
+
+	/* A new version is written once, and only once */
+	ResetMocks(0, 0);
+	SetupGoodKernelSpace(0x10001);
+	TEST_EQ(RollbackKernelWrite(0x10002), 0, "Write new version");
+	TEST_EQ(RollbackKernelWrite(0x10002), 0, "Write it again");
+	TEST_EQ(RollbackKernelRead(&version), 0, "Read it back");
+	TEST_EQ(version, 0x10002, "  version");
+	TEST_EQ(mock_rsk.kernel_versions, 0x10002, "  in TPM");
+	TEST_STR_EQ(mock_calls,
+		    "TlclRead(0x1008, 13)\n"
+		    "TlclWrite(0x1008, 13)\n"
+		    "TlclRead(0x1008, 13)\n"
+		    "TlclGetPermissions(0x1008)\n",
+		    "  tlcl calls");
+	RollbackGetWriteStats(&stats);
+	TEST_EQ(stats.kernel_writes, 1, "  kernel writes");
+	TEST_EQ(stats.kernel_writes_avoided, 1, "  kernel writes avoided");
+	TEST_EQ(stats.firmware_writes, 0, "  firmware writes");
+	TEST_EQ(stats.firmware_writes_avoided, 0,
+		"  firmware writes avoided");
+
+	/* Same for the firmware space */
+	ResetMocks(0, 0);
+	TEST_EQ(SetVirtualDevMode(1), 0, "SetVirtualDevMode(1)");
+	TEST_EQ(SetVirtualDevMode(1), 0, "SetVirtualDevMode(1) again");
+	TEST_EQ(mock_rsf.flags, FLAG_VIRTUAL_DEV_MODE_ON, "  flags");
+	TEST_STR_EQ(mock_calls,
+		    "TlclRead(0x1007, 10)\n"
+		    "TlclWrite(0x1007, 10)\n"
+		    "TlclRead(0x1007, 10)\n",
+		    "  tlcl calls");
+	RollbackGetWriteStats(&stats);
+	TEST_EQ(stats.firmware_writes, 1, "  firmware writes");
+	TEST_EQ(stats.firmware_writes_avoided, 1,
+		"  firmware writes avoided");
+
+	/* After a skipped write, a changed one still reaches the TPM */
+	ResetMocks(0, 0);
+	SetupGoodKernelSpace(0x10001);
+	TEST_EQ(RollbackKernelRead(&version), 0, "Read to fill the cache");
+	TEST_EQ(RollbackKernelWrite(0x10001), 0, "  skipped write");
+	TEST_EQ(RollbackKernelWrite(0x20001), 0, "  changed write");
+	TEST_EQ(mock_rsk.kernel_versions, 0x20001, "  in TPM");
+	TEST_STR_EQ(mock_calls,
+		    "TlclRead(0x1008, 13)\n"
+		    "TlclGetPermissions(0x1008)\n"
+		    "TlclWrite(0x1008, 13)\n"
+		    "TlclRead(0x1008, 13)\n",
+		    "  tlcl calls");
+	RollbackGetWriteStats(&stats);
+	TEST_EQ(stats.kernel_writes, 1, "  kernel writes");
+	TEST_EQ(stats.kernel_writes_avoided, 1, "  kernel writes avoided");
+
+	ResetMocks(0, 0);
+	mock_rsf.struct_version = 2;
+	mock_rsf.crc8 = vb2_crc8(&mock_rsf,
+				 offsetof(RollbackSpaceFirmware, crc8));
+	TEST_EQ(ReadSpaceFirmware(&rsf), 0, "Read to fill the cache");
+	TEST_EQ(WriteSpaceFirmware(&rsf), 0, "  skipped write");
+	rsf.fw_versions = 0x20001;
+	TEST_EQ(WriteSpaceFirmware(&rsf), 0, "  changed write");
+	TEST_EQ(mock_rsf.fw_versions, 0x20001, "  in TPM");
+	TEST_STR_EQ(mock_calls,
+		    "TlclRead(0x1007, 10)\n"
+		    "TlclWrite(0x1007, 10)\n"
+		    "TlclRead(0x1007, 10)\n",
+		    "  tlcl calls");
+	RollbackGetWriteStats(&stats);
+	TEST_EQ(stats.firmware_writes, 1, "  firmware writes");
+	TEST_EQ(stats.firmware_writes_avoided, 1,
+		"  firmware writes avoided");
+
+	/* Clearing the TPM forgets what's in it */
+	TEST_EQ(TPMClearAndReenable(), 0, "TPMClearAndReenable()");
+	ResetMocks(0, 0);
+	mock_rsf.struct_version = 2;
+	mock_rsf.crc8 = vb2_crc8(&mock_rsf,
+				 offsetof(RollbackSpaceFirmware, crc8));
+	TEST_EQ(ReadSpaceFirmware(&rsf), 0, "Read after clear");
+	TEST_EQ(rsf.flags, 0, "  flags");
+	TEST_STR_EQ(mock_calls,
+		    "TlclRead(0x1007, 10)\n",
+		    "  tlcl calls");
+
+	/* A write that can't be read back isn't remembered */
+	ResetMocks(0, 0);
+	memset(&rsf, 0, sizeof(rsf));
+	memset(noise_on, 1, sizeof(noise_on));
+	TEST_EQ(WriteSpaceFirmware(&rsf), TPM_E_CORRUPTED_STATE,
+		"Write fails");
+	memset(noise_on, 0, sizeof(noise_on));
+	*mock_calls = 0;
+	mock_cnext = mock_calls;
+	TEST_EQ(WriteSpaceFirmware(&rsf), 0, "  write again");
+	TEST_STR_EQ(mock_calls,
+		    "TlclWrite(0x1007, 10)\n"
+		    "TlclRead(0x1007, 10)\n",
+		    "  tlcl calls");
+}
+
 /****************************************************************************/
 /* Tests for RollbackFwmpRead() calls */
 
@@ -676,6 +808,7 @@ int main(int argc, char* argv[])
 	CrcTestKernel();
 	MiscTest();
 	RollbackKernelTest();
+	WriteAvoidanceTest();
 	RollbackFwmpTest();
 
 	return gTestSuccess ? 0 : 255;
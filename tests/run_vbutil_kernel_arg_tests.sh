@@ -191,6 +191,39 @@ else
   echo -e "${COL_GREEN}PASSED${COL_STOP}"
 fi
 
+# Repacking over the old blob should only rewrite the vblock and config, and
+# give the same result as repacking to a new file.
+NEW_CONFIG="${TMPDIR}/new_config.txt"
+echo "console=ttyS0 repacked" > "${NEW_CONFIG}"
+inplace="${TMPDIR}/inplace.bin"
+outofplace="${TMPDIR}/outofplace.bin"
+cp "${USB_KERN}" "${inplace}"
+echo -n "repack in place ... "
+: $(( tests++ ))
+if "${FUTILITY}" vbutil_kernel \
+  --repack "${outofplace}" \
+  --keyblock "${SSD_KEYBLOCK}" \
+  --signprivate "${SSD_SIGNPRIVATE}" \
+  --config "${NEW_CONFIG}" \
+  --oldblob "${USB_KERN}" >/dev/null &&
+"${FUTILITY}" vbutil_kernel \
+  --repack "${inplace}" \
+  --keyblock "${SSD_KEYBLOCK}" \
+  --signprivate "${SSD_SIGNPRIVATE}" \
+  --config "${NEW_CONFIG}" \
+  --oldblob "${inplace}" >/dev/null &&
+cmp "${inplace}" "${outofplace}" &&
+"${FUTILITY}" vbutil_kernel \
+  --verify "${inplace}" \
+  --signpubkey "${SSD_SIGNPUBKEY}" >/dev/null &&
+[ "$("${FUTILITY}" dump_kernel_config "${inplace}")" = \
+  "$(tr '\012' ' ' < "${NEW_CONFIG}")" ]; then
+  echo -e "${COL_GREEN}PASSED${COL_STOP}"
+else
+  echo -e "${COL_RED}FAILED${COL_STOP}"
+  : $(( errs++ ))
+fi
+
 # Summary
 ME=$(basename "$0")
 if [ "$errs" -ne 0 ]; then
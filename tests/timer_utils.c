@@ -22,3 +22,11 @@ uint32_t GetDurationMsecs(ClockTimerState* ct) {
 							      * Milliseconds. */
 	return (uint32_t) duration_msecs;
 }
+
+uint64_t GetDurationUsecs(ClockTimerState* ct) {
+	uint64_t start = ((uint64_t) ct->start_time.tv_sec * 1000000000 +
+			  (uint64_t) ct->start_time.tv_nsec);
+	uint64_t end = ((uint64_t) ct->end_time.tv_sec * 1000000000 +
+			(uint64_t) ct->end_time.tv_nsec);
+	return (end - start) / 1000U;  /* Nanoseconds -> Microseconds. */
+}
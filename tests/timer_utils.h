@@ -24,4 +24,26 @@ void StopTimer(ClockTimerState* ct);
 /* Get duration in milliseconds. */
 uint32_t GetDurationMsecs(ClockTimerState* ct);
 
+/* Get duration in microseconds. */
+uint64_t GetDurationUsecs(ClockTimerState* ct);
+
+/* Spend at least this long on each TIME_LOOP() measurement */
+#define TIME_LOOP_MIN_MSECS 200
+
+/*
+ * Run [expr] over and over for at least TIME_LOOP_MIN_MSECS, and set [nsecs]
+ * to the average time for one run, in nanoseconds.
+ */
+#define TIME_LOOP(nsecs, expr) do {					\
+		ClockTimerState _ct;					\
+		uint64_t _iterations = 0;				\
+		StartTimer(&_ct);					\
+		do {							\
+			expr;						\
+			_iterations++;					\
+			StopTimer(&_ct);				\
+		} while (GetDurationMsecs(&_ct) < TIME_LOOP_MIN_MSECS);	\
+		nsecs = GetDurationUsecs(&_ct) * 1000 / _iterations;	\
+	} while (0)
+
 #endif  /* VBOOT_REFERENCE_TIMER_UTILS_H_ */
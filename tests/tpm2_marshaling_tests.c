@@ -0,0 +1,258 @@
+/* Copyright 2018 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for TPM2 command marshaling and response unmarshaling
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "2sysincludes.h"
+#include "tpm2_marshaling.h"
+
+#include "test_common.h"
+
+#define TEST_INDEX 0x01001007
+
+static uint8_t buffer[TPM_BUFFER_SIZE];
+
+/* Marshal a command and compare it against the expected bytes. */
+static void check_command(TPM_CC command, void *body,
+			  const uint8_t *expect, int expect_size,
+			  const char *desc)
+{
+	int size;
+
+	memset(buffer, 0xaa, sizeof(buffer));
+	size = tpm_marshal_command(command, body, buffer, sizeof(buffer));
+	TEST_EQ(size, expect_size, desc);
+	TEST_SUCC(memcmp(buffer, expect, expect_size), "  contents");
+	TEST_EQ(buffer[expect_size], 0xaa, "  nothing after");
+
+	memset(buffer, 0xaa, sizeof(buffer));
+	TEST_EQ(tpm_marshal_command(command, body, buffer, expect_size - 1),
+		-1, "  buffer too small");
+	TEST_EQ(buffer[expect_size - 1], 0xaa, "  nothing past the buffer");
+	TEST_EQ(tpm_marshal_command(command, body, buffer, expect_size),
+		expect_size, "  exact fit");
+}
+
+#define CHECK_COMMAND(command, body, expect, desc) \
+	check_command(command, body, expect, sizeof(expect), desc)
+
+static void startup_tests(void)
+{
+	const uint8_t startup[] = {
+		0x80, 0x01, 0x00, 0x00, 0x00, 0x0c, 0x00, 0x00, 0x01, 0x44,
+		0x00, 0x01,
+	};
+	const uint8_t shutdown[] = {
+		0x80, 0x01, 0x00, 0x00, 0x00, 0x0c, 0x00, 0x00, 0x01, 0x45,
+		0x00, 0x01,
+	};
+	const uint8_t self_test[] = {
+		0x80, 0x01, 0x00, 0x00, 0x00, 0x0b, 0x00, 0x00, 0x01, 0x43,
+		0x01,
+	};
+	const uint8_t clear[] = {
+		0x80, 0x02, 0x00, 0x00, 0x00, 0x1b, 0x00, 0x00, 0x01, 0x26,
+		0x40, 0x00, 0x00, 0x0c,
+		0x00, 0x00, 0x00, 0x09, 0x40, 0x00, 0x00, 0x09,
+		0x00, 0x00, 0x00, 0x00, 0x00,
+	};
+	struct tpm2_startup_cmd startup_cmd = { .startup_type = 0x0001 };
+	struct tpm2_shutdown_cmd shutdown_cmd = { .shutdown_type = 0x0001 };
+	struct tpm2_self_test_cmd self_test_cmd = { .full_test = 1 };
+
+	CHECK_COMMAND(TPM2_Startup, &startup_cmd, startup, "Startup");
+	CHECK_COMMAND(TPM2_Shutdown, &shutdown_cmd, shutdown, "Shutdown");
+	CHECK_COMMAND(TPM2_SelfTest, &self_test_cmd, self_test, "SelfTest");
+	CHECK_COMMAND(TPM2_Clear, NULL, clear, "Clear");
+}
+
+static void get_tests(void)
+{
+	const uint8_t get_capability[] = {
+		0x80, 0x01, 0x00, 0x00, 0x00, 0x16, 0x00, 0x00, 0x01, 0x7a,
+		0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x02, 0x00,
+		0x00, 0x00, 0x00, 0x01,
+	};
+	const uint8_t get_random[] = {
+		0x80, 0x01, 0x00, 0x00, 0x00, 0x0c, 0x00, 0x00, 0x01, 0x7b,
+		0x00, 0x20,
+	};
+	const uint8_t hierarchy_control[] = {
+		0x80, 0x02, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x01, 0x21,
+		0x40, 0x00, 0x00, 0x0c,
+		0x00, 0x00, 0x00, 0x09, 0x40, 0x00, 0x00, 0x09,
+		0x00, 0x00, 0x00, 0x00, 0x00,
+		0x40, 0x00, 0x00, 0x0c, 0x00,
+	};
+	struct tpm2_get_capability_cmd get_capability_cmd = {
+		.capability = TPM_CAP_TPM_PROPERTIES,
+		.property = TPM_PT_PERMANENT,
+		.property_count = 1,
+	};
+	struct tpm2_get_random_cmd get_random_cmd = { .bytes_requested = 32 };
+	struct tpm2_hierarchy_control_cmd hierarchy_control_cmd = {
+		.enable = TPM_RH_PLATFORM,
+		.state = 0,
+	};
+
+	CHECK_COMMAND(TPM2_GetCapability, &get_capability_cmd, get_capability,
+		      "GetCapability");
+	CHECK_COMMAND(TPM2_GetRandom, &get_random_cmd, get_random,
+		      "GetRandom");
+	CHECK_COMMAND(TPM2_Hierarchy_Control, &hierarchy_control_cmd,
+		      hierarchy_control, "Hierarchy_Control");
+}
+
+static void nv_tests(void)
+{
+	uint8_t nv_read[] = {
+		0x80, 0x02, 0x00, 0x00, 0x00, 0x23, 0x00, 0x00, 0x01, 0x4e,
+		0x40, 0x00, 0x00, 0x0c, 0x01, 0x00, 0x10, 0x07,
+		0x00, 0x00, 0x00, 0x09, 0x40, 0x00, 0x00, 0x09,
+		0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x0d, 0x00, 0x02,
+	};
+	uint8_t write_lock[] = {
+		0x80, 0x02, 0x00, 0x00, 0x00, 0x1f, 0x00, 0x00, 0x01, 0x38,
+		0x40, 0x00, 0x00, 0x0c, 0x01, 0x00, 0x10, 0x07,
+		0x00, 0x00, 0x00, 0x09, 0x40, 0x00, 0x00, 0x09,
+		0x00, 0x00, 0x00, 0x00, 0x00,
+	};
+	uint8_t undefine_space[] = {
+		0x80, 0x02, 0x00, 0x00, 0x00, 0x1f, 0x00, 0x00, 0x01, 0x22,
+		0x40, 0x00, 0x00, 0x0c, 0x01, 0x00, 0x10, 0x07,
+		0x00, 0x00, 0x00, 0x09, 0x40, 0x00, 0x00, 0x09,
+		0x00, 0x00, 0x00, 0x00, 0x00,
+	};
+	const uint8_t read_lock[] = {
+		0x80, 0x02, 0x00, 0x00, 0x00, 0x1f, 0x00, 0x00, 0x01, 0x4f,
+		0x01, 0x00, 0x10, 0x07, 0x01, 0x00, 0x10, 0x07,
+		0x00, 0x00, 0x00, 0x09, 0x40, 0x00, 0x00, 0x09,
+		0x00, 0x00, 0x00, 0x00, 0x00,
+	};
+	const uint8_t read_public[] = {
+		0x80, 0x01, 0x00, 0x00, 0x00, 0x0e, 0x00, 0x00, 0x01, 0x69,
+		0x01, 0x00, 0x10, 0x07,
+	};
+	const uint8_t nv_write[] = {
+		0x80, 0x02, 0x00, 0x00, 0x00, 0x27, 0x00, 0x00, 0x01, 0x37,
+		0x40, 0x00, 0x00, 0x0c, 0x01, 0x00, 0x10, 0x07,
+		0x00, 0x00, 0x00, 0x09, 0x40, 0x00, 0x00, 0x09,
+		0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x04, 0x01, 0x02, 0x03, 0x04, 0x00, 0x01,
+	};
+	uint8_t data[4] = { 1, 2, 3, 4 };
+	struct tpm2_nv_read_cmd nv_read_cmd = {
+		.nvIndex = TEST_INDEX,
+		.size = 13,
+		.offset = 2,
+	};
+	struct tpm2_nv_write_lock_cmd write_lock_cmd = { .nvIndex = TEST_INDEX };
+	struct tpm2_nv_read_lock_cmd read_lock_cmd = { .nvIndex = TEST_INDEX };
+	struct tpm2_nv_read_public_cmd read_public_cmd = {
+		.nvIndex = TEST_INDEX,
+	};
+	struct tpm2_nv_undefine_space_cmd undefine_space_cmd = {
+		.nvIndex = TEST_INDEX,
+		.use_platform_auth = 1,
+	};
+	struct tpm2_nv_write_cmd nv_write_cmd;
+
+	tpm_set_ph_disabled(0);
+	CHECK_COMMAND(TPM2_NV_Read, &nv_read_cmd, nv_read,
+		      "NV_Read with platform auth");
+	/* Index auth once the platform hierarchy is disabled */
+	tpm_set_ph_disabled(1);
+	memcpy(nv_read + 10, nv_read + 14, 4);
+	CHECK_COMMAND(TPM2_NV_Read, &nv_read_cmd, nv_read,
+		      "NV_Read with index auth");
+	tpm_set_ph_disabled(0);
+
+	CHECK_COMMAND(TPM2_NV_ReadLock, &read_lock_cmd, read_lock,
+		      "NV_ReadLock");
+	CHECK_COMMAND(TPM2_NV_ReadPublic, &read_public_cmd, read_public,
+		      "NV_ReadPublic");
+
+	CHECK_COMMAND(TPM2_NV_WriteLock, &write_lock_cmd, write_lock,
+		      "NV_WriteLock platform index");
+	/* Owner indexes use their own auth */
+	write_lock_cmd.nvIndex = TPMI_RH_NV_INDEX_OWNER_START;
+	memcpy(write_lock + 10, "\x01\x80\x00\x00\x01\x80\x00\x00", 8);
+	CHECK_COMMAND(TPM2_NV_WriteLock, &write_lock_cmd, write_lock,
+		      "NV_WriteLock owner index");
+
+	CHECK_COMMAND(TPM2_NV_UndefineSpace, &undefine_space_cmd,
+		      undefine_space, "NV_UndefineSpace platform auth");
+	undefine_space_cmd.use_platform_auth = 0;
+	memcpy(undefine_space + 10, "\x40\x00\x00\x01", 4);
+	CHECK_COMMAND(TPM2_NV_UndefineSpace, &undefine_space_cmd,
+		      undefine_space, "NV_UndefineSpace owner auth");
+
+	/* NV_Write has a variable size, so is marshaled field by field */
+	memset(&nv_write_cmd, 0, sizeof(nv_write_cmd));
+	nv_write_cmd.nvIndex = TEST_INDEX;
+	nv_write_cmd.data.t.size = sizeof(data);
+	nv_write_cmd.data.t.buffer = data;
+	nv_write_cmd.offset = 1;
+	CHECK_COMMAND(TPM2_NV_Write, &nv_write_cmd, nv_write, "NV_Write");
+	TEST_EQ(tpm_marshal_command(TPM2_NV_Write, &nv_write_cmd, buffer,
+				    sizeof(struct tpm_header) - 1), -1,
+		"  no room for the header");
+
+	TEST_EQ(tpm_marshal_command(0x1234, NULL, buffer, sizeof(buffer)), -1,
+		"Unknown command");
+}
+
+static void response_tests(void)
+{
+	uint8_t nv_read[] = {
+		0x80, 0x02, 0x00, 0x00, 0x00, 0x19, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x06, 0x00, 0x04, 0x11, 0x22, 0x33, 0x44,
+		0x00, 0x00, 0x01, 0x00, 0x00,
+	};
+	uint8_t get_capability[] = {
+		0x80, 0x01, 0x00, 0x00, 0x00, 0x1b, 0x00, 0x00, 0x00, 0x00,
+		0x00,
+		0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x01,
+		0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x01, 0x02,
+	};
+	struct tpm2_response resp;
+
+	TEST_SUCC(tpm_unmarshal_response(TPM2_NV_Read, nv_read,
+					 sizeof(nv_read), &resp),
+		  "NV_Read response");
+	TEST_EQ(resp.nvr.buffer.t.size, 4, "  size");
+	TEST_PTR_EQ(resp.nvr.buffer.t.buffer, nv_read + 16,
+		    "  data points into the response");
+
+	TEST_NEQ(tpm_unmarshal_response(TPM2_NV_Read, nv_read, 18, &resp), 0,
+		 "NV_Read response truncated");
+
+	TEST_SUCC(tpm_unmarshal_response(TPM2_GetCapability, get_capability,
+					 sizeof(get_capability), &resp),
+		  "GetCapability response");
+	TEST_EQ(resp.cap.capability_data.data.tpm_properties.tpm_property[0].
+		value, 0x102, "  property value");
+
+	TEST_SUCC(tpm_unmarshal_response(TPM2_Startup, nv_read, 10, &resp),
+		  "Header only response");
+	TEST_EQ(resp.hdr.tpm_code, 0, "  code");
+	TEST_NEQ(tpm_unmarshal_response(TPM2_Startup, nv_read, 9, &resp), 0,
+		 "Short header");
+}
+
+int main(int argc, char *argv[])
+{
+	startup_tests();
+	get_tests();
+	nv_tests();
+	response_tests();
+
+	return gTestSuccess ? 0 : 255;
+}
@@ -0,0 +1,348 @@
+/* Copyright 2018 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Measure reading the vboot NV spaces from a TPM2, using a software TPM2
+ * with per-command latency and a limited bus rate.
+ *
+ * The software TPM answers each command at once and adds its latency and
+ * bus time to a counter.  For each kind of read, the report gives the number
+ * of TPM commands and the TPM time they would take, and the CPU time spent
+ * in the TPM library.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "2sysincludes.h"
+#include "2api.h"
+#include "2common.h"
+#include "rollback_index.h"
+#include "timer_utils.h"
+#include "tlcl.h"
+#include "tpm2_marshaling.h"
+#include "vboot_api.h"
+
+/* Index of a large space, to exercise reads of more than one chunk */
+#define LARGE_NV_INDEX 0x1100
+#define LARGE_NV_SIZE 2048
+
+/* Fits in one NV_Read command, but not in the smaller TPM NV buffers */
+#define SMALL_READ_SIZE 200
+
+/* TPM2 response codes the software TPM returns */
+#define TPM_RC_NV_RANGE 0x146
+#define TPM_RC_HANDLE_2 0x28b
+#define TPM_RC_VALUE_P1 0x1c4
+
+/* Software TPM2 */
+static struct {
+	uint32_t latency_usecs;	 /* Cost of each command */
+	uint32_t kbytes_per_sec;  /* Bus transfer rate */
+	uint32_t nv_buffer_max;	 /* TPM_PT_NV_BUFFER_MAX */
+	uint64_t nsecs;		 /* Accumulated simulated time */
+	uint32_t commands;
+	uint32_t nv_reads;
+} tpm = {
+	.latency_usecs = 1000,
+	.kbytes_per_sec = 1000,
+	.nv_buffer_max = 1024,
+};
+
+struct nv_space {
+	uint32_t index;
+	uint32_t size;
+	uint8_t data[LARGE_NV_SIZE];
+};
+
+static struct nv_space nv_spaces[] = {
+	{ .index = FIRMWARE_NV_INDEX, .size = sizeof(RollbackSpaceFirmware) },
+	{ .index = KERNEL_NV_INDEX, .size = sizeof(RollbackSpaceKernel) },
+	{ .index = FWMP_NV_INDEX, .size = sizeof(struct RollbackSpaceFwmp) },
+	{ .index = REC_HASH_NV_INDEX, .size = REC_HASH_NV_SIZE },
+	{ .index = LARGE_NV_INDEX, .size = LARGE_NV_SIZE },
+};
+
+static void put_be16(uint8_t *p, uint16_t v)
+{
+	p[0] = v >> 8;
+	p[1] = v;
+}
+
+static void put_be32(uint8_t *p, uint32_t v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+static uint32_t get_be16(const uint8_t *p)
+{
+	return p[0] << 8 | p[1];
+}
+
+static uint32_t get_be32(const uint8_t *p)
+{
+	return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+static struct nv_space *find_space(uint32_t nv_index)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(nv_spaces); i++)
+		if (HR_NV_INDEX + nv_spaces[i].index == nv_index)
+			return nv_spaces + i;
+	return NULL;
+}
+
+/* Respond to NV_Read; returns the response size. */
+static uint32_t nv_read(const uint8_t *request, uint8_t *response)
+{
+	/* Two handles and a password session come before the parameters */
+	const uint8_t *params = request + 10 + 8 + 13;
+	struct nv_space *space = find_space(get_be32(request + 14));
+	uint32_t size = get_be16(params);
+	uint32_t offset = get_be16(params + 2);
+	uint8_t *p = response + 10;
+
+	tpm.nv_reads++;
+	if (!space) {
+		put_be32(response + 6, TPM_RC_HANDLE_2);
+		return 10;
+	}
+	if (size > tpm.nv_buffer_max) {
+		put_be32(response + 6, TPM_RC_VALUE_P1);
+		return 10;
+	}
+	if (offset + size > space->size) {
+		put_be32(response + 6, TPM_RC_NV_RANGE);
+		return 10;
+	}
+
+	put_be32(p, size + 2);
+	put_be16(p + 4, size);
+	memcpy(p + 6, space->data + offset, size);
+	p += 6 + size;
+	/* Empty nonce, continueSession, empty HMAC */
+	memcpy(p, "\x00\x00\x01\x00\x00", 5);
+	return p + 5 - response;
+}
+
+/* Respond to GetCapability for one TPM property; returns the size. */
+static uint32_t get_capability(const uint8_t *request, uint8_t *response)
+{
+	uint32_t property = get_be32(request + 14);
+	uint32_t value = 0;
+	uint8_t *p = response + 10;
+
+	switch (property) {
+	case TPM_PT_STARTUP_CLEAR:
+		value = 1;  /* phEnable */
+		break;
+	case TPM_PT_NV_BUFFER_MAX:
+		value = tpm.nv_buffer_max;
+		break;
+	}
+
+	p[0] = 0;  /* moreData */
+	put_be32(p + 1, TPM_CAP_TPM_PROPERTIES);
+	put_be32(p + 5, 1);
+	put_be32(p + 9, property);
+	put_be32(p + 13, value);
+	return 10 + 17;
+}
+
+VbError_t VbExTpmInit(void)
+{
+	return VBERROR_SUCCESS;
+}
+
+VbError_t VbExTpmClose(void)
+{
+	return VBERROR_SUCCESS;
+}
+
+VbError_t VbExTpmSendReceive(const uint8_t *request, uint32_t request_length,
+			     uint8_t *response, uint32_t *response_length)
+{
+	uint8_t out[TPM_BUFFER_SIZE];
+	uint32_t size = 10;
+
+	memset(out, 0, 10);
+	put_be16(out, get_be16(request));
+
+	switch (get_be32(request + 6)) {
+	case TPM2_NV_Read:
+		size = nv_read(request, out);
+		break;
+	case TPM2_GetCapability:
+		size = get_capability(request, out);
+		break;
+	}
+
+	if (size > *response_length)
+		return VBERROR_UNKNOWN;
+	put_be32(out + 2, size);
+	memcpy(response, out, size);
+	*response_length = size;
+
+	/* 1 KB/s moves about one byte per millisecond */
+	tpm.nsecs += tpm.latency_usecs * 1000ULL +
+		(request_length + size) * 1000000ULL / tpm.kbytes_per_sec;
+	tpm.commands++;
+	return VBERROR_SUCCESS;
+}
+
+static void tpm_reset_counters(void)
+{
+	tpm.nsecs = 0;
+	tpm.commands = 0;
+	tpm.nv_reads = 0;
+}
+
+static void fill_spaces(void)
+{
+	int i, j;
+
+	for (i = 0; i < ARRAY_SIZE(nv_spaces); i++)
+		for (j = 0; j < nv_spaces[i].size; j++)
+			nv_spaces[i].data[j] = i * 0x10 + j;
+}
+
+/* Print the TPM counters, and the CPU time if it was measured */
+static void print_result(const char *name, uint64_t cpu_nsecs)
+{
+	fprintf(stderr, "#   %-18s %3u commands %3u NV_Read  %6u us TPM",
+		name, tpm.commands, tpm.nv_reads,
+		(uint32_t)(tpm.nsecs / 1000));
+	fprintf(stdout, "tpm_commands_%s:%u\n", name, tpm.commands);
+	fprintf(stdout, "usecs_tpm_%s:%u\n", name,
+		(uint32_t)(tpm.nsecs / 1000));
+	if (cpu_nsecs) {
+		fprintf(stderr, "  %6u ns CPU", (uint32_t)cpu_nsecs);
+		fprintf(stdout, "nsecs_cpu_%s:%u\n", name,
+			(uint32_t)cpu_nsecs);
+	}
+	fprintf(stderr, "\n");
+}
+
+/* What a boot reads: all the vboot spaces, plus the recovery hash */
+static uint32_t read_vboot_spaces(void)
+{
+	static uint8_t buf[LARGE_NV_SIZE];
+	uint32_t rv;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(nv_spaces); i++) {
+		if (nv_spaces[i].index == LARGE_NV_INDEX)
+			continue;
+		rv = TlclRead(nv_spaces[i].index, buf, nv_spaces[i].size);
+		if (rv)
+			return rv;
+	}
+	return TPM_SUCCESS;
+}
+
+static int benchmark_vboot_spaces(void)
+{
+	uint64_t nsecs;
+
+	if (TlclLibInit() || read_vboot_spaces()) {
+		fprintf(stderr, "Reading vboot spaces failed\n");
+		return 1;
+	}
+
+	TIME_LOOP(nsecs, read_vboot_spaces());
+	tpm_reset_counters();
+	read_vboot_spaces();
+	print_result("vboot_spaces", nsecs);
+	return 0;
+}
+
+static int benchmark_large_read(uint32_t nv_buffer_max)
+{
+	static uint8_t buf[LARGE_NV_SIZE];
+	struct nv_space *space = find_space(HR_NV_INDEX + LARGE_NV_INDEX);
+	char name[32];
+	uint64_t nsecs;
+
+	tpm.nv_buffer_max = nv_buffer_max;
+
+	/* Even a read which fits in one command is split to suit the TPM */
+	TlclLibInit();
+	memset(buf, 0, sizeof(buf));
+	if (TlclRead(LARGE_NV_INDEX, buf, SMALL_READ_SIZE) ||
+	    memcmp(buf, space->data, SMALL_READ_SIZE)) {
+		fprintf(stderr, "Reading %u bytes with %u byte NV buffer "
+			"failed\n", SMALL_READ_SIZE, nv_buffer_max);
+		return 1;
+	}
+
+	/* The first read asks the TPM for its NV buffer size */
+	TlclLibInit();
+	tpm_reset_counters();
+	memset(buf, 0, sizeof(buf));
+	if (TlclRead(LARGE_NV_INDEX, buf, sizeof(buf)) ||
+	    memcmp(buf, space->data, sizeof(buf))) {
+		fprintf(stderr, "Reading %u bytes with %u byte NV buffer "
+			"failed\n", (uint32_t)sizeof(buf), nv_buffer_max);
+		return 1;
+	}
+	snprintf(name, sizeof(name), "first_%uk_nv%u",
+		 (uint32_t)sizeof(buf) / 1024, nv_buffer_max);
+	print_result(name, 0);
+
+	/* Later reads use the cached size */
+	TIME_LOOP(nsecs, TlclRead(LARGE_NV_INDEX, buf, sizeof(buf)));
+	tpm_reset_counters();
+	TlclRead(LARGE_NV_INDEX, buf, sizeof(buf));
+	snprintf(name, sizeof(name), "read_%uk_nv%u",
+		 (uint32_t)sizeof(buf) / 1024, nv_buffer_max);
+	print_result(name, nsecs);
+	return 0;
+}
+
+static void print_help(const char *progname)
+{
+	fprintf(stderr, "\nUsage: %s [-l latency_usecs] [-b kbytes_per_sec]\n\n",
+		progname);
+}
+
+int main(int argc, char *argv[])
+{
+	static const uint32_t nv_buffer_maxes[] = {64, 128, 512, 1024};
+	int errors = 0;
+	int i, c;
+
+	while ((c = getopt(argc, argv, "l:b:")) != -1) {
+		switch (c) {
+		case 'l':
+			tpm.latency_usecs = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			tpm.kbytes_per_sec = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			print_help(argv[0]);
+			return 1;
+		}
+	}
+	if (optind != argc || !tpm.kbytes_per_sec) {
+		print_help(argv[0]);
+		return 1;
+	}
+
+	fill_spaces();
+
+	fprintf(stderr, "# TPM: %u us per command, %u KB/s\n",
+		tpm.latency_usecs, tpm.kbytes_per_sec);
+	errors += benchmark_vboot_spaces();
+	for (i = 0; i < ARRAY_SIZE(nv_buffer_maxes); i++)
+		errors += benchmark_large_read(nv_buffer_maxes[i]);
+
+	return errors ? 1 : 0;
+}
@@ -68,6 +68,12 @@ static void test_unpack_key(const struct vb2_packed_key *key1)
 		VB2_ERROR_UNPACK_KEY_ARRAY_SIZE,
 		"vb2_unpack_key_buffer() invalid key array size");
 
+	memcpy(key, key1, size);
+	((uint32_t *)(buf + key->key_offset))[1] ^= 0x10;
+	TEST_EQ(vb2_unpack_key_buffer(&pubk, buf, size),
+		VB2_ERROR_UNPACK_KEY_N0INV,
+		"vb2_unpack_key_buffer() n0inv doesn't match modulus");
+
 	memcpy(key, key1, size);
 	TEST_EQ(vb2_unpack_key_buffer(&pubk, buf, size - 1),
 		VB2_ERROR_INSIDE_DATA_OUTSIDE,
@@ -0,0 +1,115 @@
+/* Copyright 2018 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Measure RSA key unpacking and signature verification for each key size.
+ */
+
+#include <stdio.h>
+
+#include "2sysincludes.h"
+#include "2common.h"
+#include "2rsa.h"
+#include "2sha.h"
+
+#include "host_common.h"
+#include "host_key.h"
+#include "host_signature.h"
+#include "timer_utils.h"
+#include "vb2_common.h"
+
+static const struct {
+	const char *file;
+	enum vb2_crypto_algorithm alg;
+} keys[] = {
+	{"rsa1024", VB2_ALG_RSA1024_SHA256},
+	{"rsa2048", VB2_ALG_RSA2048_SHA256},
+	{"rsa2048_exp3", VB2_ALG_RSA2048_EXP3_SHA256},
+	{"rsa3072_exp3", VB2_ALG_RSA3072_EXP3_SHA256},
+	{"rsa4096", VB2_ALG_RSA4096_SHA256},
+	{"rsa8192", VB2_ALG_RSA8192_SHA256},
+};
+
+static uint8_t workbuf[VB2_VERIFY_RSA_DIGEST_WORKBUF_BYTES]
+	__attribute__ ((aligned (VB2_WORKBUF_ALIGN)));
+
+static int benchmark_key(const char *keys_dir, const char *name,
+			 enum vb2_crypto_algorithm alg)
+{
+	struct vb2_private_key *private_key = NULL;
+	struct vb2_packed_key *packed_key = NULL;
+	struct vb2_signature *sig = NULL;
+	struct vb2_public_key key;
+	struct vb2_workbuf wb;
+	uint8_t digest[VB2_SHA256_DIGEST_SIZE];
+	uint8_t sig_work[8192 / 8];
+	uint64_t unpack_nsecs, verify_nsecs;
+	char filename[1024];
+	int rv = 1;
+
+	snprintf(filename, sizeof(filename), "%s/key_%s.pem", keys_dir, name);
+	private_key = vb2_read_private_key_pem(filename, alg);
+	snprintf(filename, sizeof(filename), "%s/key_%s.keyb", keys_dir, name);
+	packed_key = vb2_read_packed_keyb(filename, alg, 1);
+	if (!private_key || !packed_key) {
+		fprintf(stderr, "Can't read key_%s\n", name);
+		goto done;
+	}
+
+	memset(workbuf, 0, sizeof(workbuf));
+	vb2_workbuf_init(&wb, workbuf, sizeof(workbuf));
+
+	if (vb2_digest_buffer((const uint8_t *)name, strlen(name),
+			      VB2_HASH_SHA256, digest, sizeof(digest)) ||
+	    !(sig = vb2_calculate_signature((const uint8_t *)name,
+					    strlen(name), private_key)) ||
+	    vb2_unpack_key(&key, packed_key)) {
+		fprintf(stderr, "Can't set up key_%s\n", name);
+		goto done;
+	}
+
+	/* Make sure what we time actually succeeds */
+	memcpy(sig_work, vb2_signature_data(sig), sig->sig_size);
+	if (vb2_rsa_verify_digest(&key, sig_work, digest, &wb)) {
+		fprintf(stderr, "key_%s: signature doesn't verify\n", name);
+		goto done;
+	}
+
+	TIME_LOOP(unpack_nsecs, vb2_unpack_key(&key, packed_key));
+	TIME_LOOP(verify_nsecs, {
+			memcpy(sig_work, vb2_signature_data(sig),
+			       sig->sig_size);
+			vb2_rsa_verify_digest(&key, sig_work, digest, &wb);
+		});
+
+	fprintf(stderr, "# %-14s unpack %8u ns  verify %8u us  %8u/s\n",
+		name, (uint32_t)unpack_nsecs, (uint32_t)(verify_nsecs / 1000),
+		(uint32_t)(1000000000ULL / verify_nsecs));
+	fprintf(stdout, "nsecs_unpack_%s:%u\n", name, (uint32_t)unpack_nsecs);
+	fprintf(stdout, "verifies_per_sec_%s:%u\n", name,
+		(uint32_t)(1000000000ULL / verify_nsecs));
+	rv = 0;
+
+ done:
+	if (private_key)
+		vb2_free_private_key(private_key);
+	free(packed_key);
+	free(sig);
+	return rv;
+}
+
+int main(int argc, char *argv[])
+{
+	int errors = 0;
+	int i;
+
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s <keys_dir>\n", argv[0]);
+		return -1;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(keys); i++)
+		errors += benchmark_key(argv[1], keys[i].file, keys[i].alg);
+
+	return errors ? 1 : 0;
+}
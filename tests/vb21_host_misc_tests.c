@@ -28,6 +28,48 @@ static void misc_tests(void)
 	TEST_EQ(vb2_desc_size("foob"), 8, "desc size 'foob'");
 }
 
+static void block_tests(void)
+{
+	static uint8_t a[0x5000], b[0x5000];
+
+	memset(a, 0xff, sizeof(a));
+	memset(b, 0xff, sizeof(b));
+	TEST_EQ(vb2_find_diff_block(a, b, sizeof(a), 0x1000), sizeof(a),
+		"diff block same");
+	TEST_EQ(vb2_find_diff_block(a, b, 0, 0x1000), 0, "diff block empty");
+	TEST_EQ(vb2_find_unfilled_block(a, 0xff, sizeof(a), 0x1000), sizeof(a),
+		"unfilled block filled");
+	TEST_EQ(vb2_find_unfilled_block(a, 0x00, sizeof(a), 0x1000), 0,
+		"unfilled block wrong value");
+	TEST_EQ(vb2_find_unfilled_block(a, 0xff, 0, 0), 0,
+		"unfilled block empty");
+	TEST_EQ(vb2_find_unfilled_block(a, 0xff, 1, 0x1000), 1,
+		"unfilled block one byte");
+
+	b[0x2345] = 0;
+	b[0x4fff] = 0;
+	TEST_EQ(vb2_find_diff_block(a, b, sizeof(a), 0x1000), 0x2000,
+		"diff block first difference");
+	TEST_EQ(vb2_find_diff_block(a, b, sizeof(a), 0), 0,
+		"diff block whole buffer");
+	TEST_EQ(vb2_find_diff_block(a, b, 0x2345, 0x1000), 0x2345,
+		"diff block stops at size");
+	TEST_EQ(vb2_find_diff_block(a + 0x3000, b + 0x3000, 0x2000, 0x1000),
+		0x1000, "diff block last byte");
+	TEST_EQ(vb2_find_unfilled_block(b, 0xff, sizeof(b), 0x1000), 0x2000,
+		"unfilled block first difference");
+	TEST_EQ(vb2_find_unfilled_block(b + 0x3000, 0xff, 0x2000, 0x800),
+		0x1800, "unfilled block last byte");
+	TEST_EQ(vb2_find_unfilled_block(b + 0x2345, 0xff, 0x100, 0x1000), 0,
+		"unfilled block first byte");
+
+	/* Odd block sizes leave a short last block */
+	TEST_EQ(vb2_find_diff_block(a, b, sizeof(b), 0x1001), 0x2002,
+		"diff block odd size");
+	TEST_EQ(vb2_find_unfilled_block(b + 0x3000, 0xff, 0x2000, 0xffd),
+		0x1ffa, "unfilled block short last block");
+}
+
 static void file_tests(const char *temp_dir)
 {
 	char *testfile;
@@ -80,6 +122,7 @@ int main(int argc, char* argv[])
 	const char *temp_dir = argv[1];
 
 	misc_tests();
+	block_tests();
 	file_tests(temp_dir);
 
 	return gTestSuccess ? 0 : 255;
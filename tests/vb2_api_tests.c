@@ -10,6 +10,7 @@
 #include "2sysincludes.h"
 #include "2api.h"
 #include "2common.h"
+#include "2crc8.h"
 #include "2misc.h"
 #include "2nvstorage.h"
 #include "2rsa.h"
@@ -40,6 +41,11 @@ static int retval_vb2_check_dev_switch;
 static int retval_vb2_check_tpm_clear;
 static int retval_vb2_select_fw_slot;
 
+static struct vb2_secdata_snapshot mock_snapshot;
+static int mock_read_all_calls;
+static int mock_read_all_bad_crcs;
+static int retval_vb2ex_secdata_read_all;
+
 /* Type of test to reset for */
 enum reset_type {
 	FOR_MISC,
@@ -66,6 +72,28 @@ static void reset_common_data(enum reset_type t)
 	retval_vb2_check_tpm_clear = VB2_SUCCESS;
 	retval_vb2_select_fw_slot = VB2_SUCCESS;
 
+	/* All three spaces, with good CRCs */
+	memset(&mock_snapshot, 0, sizeof(mock_snapshot));
+	mock_snapshot.spaces = VB2_SECDATA_SPACE_FIRMWARE |
+		VB2_SECDATA_SPACE_KERNEL | VB2_SECDATA_SPACE_FWMP;
+	memcpy(mock_snapshot.secdata, cc.secdata, sizeof(cc.secdata));
+	((struct vb2_secdata *)mock_snapshot.secdata)->fw_versions = 0x10002;
+	((struct vb2_secdata *)mock_snapshot.secdata)->crc8 =
+		vb2_crc8(mock_snapshot.secdata,
+			 offsetof(struct vb2_secdata, crc8));
+	memcpy(mock_snapshot.secdatak, cc.secdatak, sizeof(cc.secdatak));
+	vb2_secdatak_create(&cc);
+	memcpy(mock_snapshot.secdatak, cc.secdatak, sizeof(cc.secdatak));
+	memset(cc.secdatak, 0, sizeof(cc.secdatak));
+	mock_snapshot.fwmp_size = 40;
+	mock_snapshot.fwmp[1] = 40;
+	mock_snapshot.fwmp[4] = 0x24;
+	mock_snapshot.fwmp[0] = vb2_crc8(mock_snapshot.fwmp + 2, 38);
+	mock_read_all_calls = 0;
+	mock_read_all_bad_crcs = 0;
+	retval_vb2ex_secdata_read_all =
+		VB2_ERROR_EX_SECDATA_READ_ALL_UNIMPLEMENTED;
+
 	memcpy(sd->gbb_hwid_digest, mock_hwid_digest,
 	       sizeof(sd->gbb_hwid_digest));
 };
@@ -92,6 +120,18 @@ int vb2_select_fw_slot(struct vb2_context *ctx)
 	return retval_vb2_select_fw_slot;
 }
 
+int vb2ex_secdata_read_all(struct vb2_context *ctx,
+			   struct vb2_secdata_snapshot *snapshot)
+{
+	mock_read_all_calls++;
+	memcpy(snapshot, &mock_snapshot, sizeof(*snapshot));
+	if (mock_read_all_bad_crcs) {
+		mock_read_all_bad_crcs--;
+		snapshot->fwmp[2] ^= 0x01;
+	}
+	return retval_vb2ex_secdata_read_all;
+}
+
 /* Tests */
 
 static void misc_tests(void)
@@ -114,6 +154,118 @@ static void misc_tests(void)
 		34, "vb2api_fail subcode");
 }
 
+static void secdata_read_all_tests(void)
+{
+	const struct vb2_secdata_snapshot *snapshot;
+
+	reset_common_data(FOR_MISC);
+	retval_vb2ex_secdata_read_all = VB2_SUCCESS;
+	TEST_EQ(vb2api_get_secdata_snapshot(&cc, &snapshot),
+		VB2_ERROR_SECDATA_SNAPSHOT_MISSING, "No snapshot yet");
+	TEST_PTR_EQ(snapshot, NULL, "  NULL");
+	TEST_SUCC(vb2api_secdata_read_all(&cc), "Read all");
+	TEST_EQ(mock_read_all_calls, 1, "  one read");
+	TEST_SUCC(memcmp(cc.secdata, mock_snapshot.secdata,
+			 sizeof(cc.secdata)), "  secdata");
+	TEST_SUCC(memcmp(cc.secdatak, mock_snapshot.secdatak,
+			 sizeof(cc.secdatak)), "  secdatak");
+	TEST_SUCC(vb2api_get_secdata_snapshot(&cc, &snapshot), "  snapshot");
+	TEST_SUCC(memcmp(snapshot, &mock_snapshot, sizeof(*snapshot)),
+		  "  snapshot contents");
+	TEST_TRUE(vb2_offset_of(cc.workbuf, snapshot) + sizeof(*snapshot) <=
+		  cc.workbuf_used, "  snapshot kept in workbuf");
+	TEST_SUCC(vb2_secdata_init(&cc), "  secdata init");
+	TEST_EQ(sd->fw_version_secdata, 0x10002, "  secdata versions");
+	TEST_SUCC(vb2_secdatak_init(&cc), "  secdatak init");
+
+	/* Second call uses the same snapshot */
+	mock_snapshot.secdata[1] ^= 0x01;
+	TEST_SUCC(vb2api_secdata_read_all(&cc), "Read all again");
+	TEST_EQ(mock_read_all_calls, 1, "  no more reads");
+	TEST_EQ(snapshot->secdata[1], cc.secdata[1], "  same data");
+
+	/* Bad CRCs are retried */
+	reset_common_data(FOR_MISC);
+	retval_vb2ex_secdata_read_all = VB2_SUCCESS;
+	mock_read_all_bad_crcs = 2;
+	TEST_SUCC(vb2api_secdata_read_all(&cc), "Retry bad CRC");
+	TEST_EQ(mock_read_all_calls, 3, "  three reads");
+
+	reset_common_data(FOR_MISC);
+	retval_vb2ex_secdata_read_all = VB2_SUCCESS;
+	mock_read_all_bad_crcs = 3;
+	TEST_EQ(vb2api_secdata_read_all(&cc), VB2_ERROR_SECDATA_FWMP_CRC,
+		"Too many bad CRCs");
+	TEST_EQ(mock_read_all_calls, 3, "  three reads");
+	TEST_EQ(vb2api_get_secdata_snapshot(&cc, &snapshot),
+		VB2_ERROR_SECDATA_SNAPSHOT_MISSING, "  no snapshot");
+
+	reset_common_data(FOR_MISC);
+	retval_vb2ex_secdata_read_all = VB2_SUCCESS;
+	mock_snapshot.secdata[2] ^= 0x01;
+	TEST_EQ(vb2api_secdata_read_all(&cc), VB2_ERROR_SECDATA_CRC,
+		"Bad secdata CRC");
+	reset_common_data(FOR_MISC);
+	retval_vb2ex_secdata_read_all = VB2_SUCCESS;
+	mock_snapshot.secdatak[2] ^= 0x01;
+	TEST_EQ(vb2api_secdata_read_all(&cc), VB2_ERROR_SECDATAK_CRC,
+		"Bad secdatak CRC");
+	reset_common_data(FOR_MISC);
+	retval_vb2ex_secdata_read_all = VB2_SUCCESS;
+	memset(mock_snapshot.secdata, 0, sizeof(mock_snapshot.secdata));
+	TEST_EQ(vb2api_secdata_read_all(&cc), VB2_ERROR_SECDATA_ZERO,
+		"Zero secdata");
+
+	/* Bad FWMP size isn't going to get better */
+	reset_common_data(FOR_MISC);
+	retval_vb2ex_secdata_read_all = VB2_SUCCESS;
+	mock_snapshot.fwmp[1] = 41;
+	TEST_EQ(vb2api_secdata_read_all(&cc), VB2_ERROR_SECDATA_FWMP_SIZE,
+		"Bad FWMP size");
+	TEST_EQ(mock_read_all_calls, 1, "  not retried");
+	reset_common_data(FOR_MISC);
+	retval_vb2ex_secdata_read_all = VB2_SUCCESS;
+	mock_snapshot.fwmp_size = VB2_SECDATA_FWMP_MAX_SIZE + 1;
+	TEST_EQ(vb2api_secdata_read_all(&cc), VB2_ERROR_SECDATA_FWMP_SIZE,
+		"FWMP too big");
+
+	/* Missing spaces aren't checked or copied */
+	reset_common_data(FOR_MISC);
+	retval_vb2ex_secdata_read_all = VB2_SUCCESS;
+	mock_snapshot.spaces = VB2_SECDATA_SPACE_KERNEL;
+	mock_snapshot.secdata[2] ^= 0x01;
+	mock_snapshot.fwmp[1] = 0;
+	TEST_EQ(vb2api_secdata_read_all(&cc),
+		VB2_ERROR_SECDATA_SNAPSHOT_NO_FIRMWARE, "Only kernel space");
+	TEST_SUCC(vb2api_secdata_check(&cc), "  secdata untouched");
+	TEST_EQ(vb2api_get_secdata_snapshot(&cc, &snapshot),
+		VB2_ERROR_SECDATA_SNAPSHOT_MISSING, "  no snapshot");
+
+	reset_common_data(FOR_MISC);
+	retval_vb2ex_secdata_read_all = VB2_SUCCESS;
+	mock_snapshot.spaces = VB2_SECDATA_SPACE_FIRMWARE;
+	mock_snapshot.secdatak[2] ^= 0x01;
+	mock_snapshot.fwmp[1] = 0;
+	TEST_SUCC(vb2api_secdata_read_all(&cc), "Only firmware space");
+	TEST_SUCC(vb2api_secdata_check(&cc), "  secdata init");
+
+	/* Errors from the callback are passed back */
+	reset_common_data(FOR_MISC);
+	retval_vb2ex_secdata_read_all = VB2_SUCCESS;
+	retval_vb2ex_secdata_read_all =
+		VB2_ERROR_EX_SECDATA_READ_ALL_UNIMPLEMENTED;
+	TEST_EQ(vb2api_secdata_read_all(&cc),
+		VB2_ERROR_EX_SECDATA_READ_ALL_UNIMPLEMENTED, "Unimplemented");
+	TEST_EQ(vb2api_get_secdata_snapshot(&cc, &snapshot),
+		VB2_ERROR_SECDATA_SNAPSHOT_MISSING, "  no snapshot");
+
+	reset_common_data(FOR_MISC);
+	retval_vb2ex_secdata_read_all = VB2_SUCCESS;
+	cc.workbuf_size = cc.workbuf_used + sizeof(*snapshot) - 1;
+	TEST_EQ(vb2api_secdata_read_all(&cc),
+		VB2_ERROR_SECDATA_SNAPSHOT_WORKBUF, "Workbuf too small");
+}
+
 static void phase1_tests(void)
 {
 	reset_common_data(FOR_MISC);
@@ -156,6 +308,22 @@ static void phase1_tests(void)
 	TEST_NEQ(cc.flags & VB2_CONTEXT_RECOVERY_MODE, 0, "  recovery flag");
 	TEST_NEQ(cc.flags & VB2_CONTEXT_CLEAR_RAM, 0, "  clear ram flag");
 
+	/* Secdata from the platform's snapshot */
+	reset_common_data(FOR_MISC);
+	retval_vb2ex_secdata_read_all = VB2_SUCCESS;
+	cc.secdata[0] ^= 0x42;
+	TEST_SUCC(vb2api_fw_phase1(&cc), "phase1 secdata snapshot");
+	TEST_EQ(mock_read_all_calls, 1, "  one read");
+	TEST_EQ(sd->fw_version_secdata, 0x10002, "  secdata versions");
+	TEST_EQ(sd->recovery_reason, 0, "  not recovery");
+
+	reset_common_data(FOR_MISC);
+	retval_vb2ex_secdata_read_all = VB2_ERROR_MOCK;
+	TEST_EQ(vb2api_fw_phase1(&cc), VB2_ERROR_API_PHASE1_RECOVERY,
+		"phase1 secdata snapshot error");
+	TEST_EQ(sd->recovery_reason, VB2_RECOVERY_SECDATA_INIT,
+		"  recovery reason");
+
 	/* Test secdata-requested reboot */
 	reset_common_data(FOR_MISC);
 	cc.flags |= VB2_CONTEXT_SECDATA_WANTS_REBOOT;
@@ -318,6 +486,7 @@ static void get_pcr_digest_tests(void)
 int main(int argc, char* argv[])
 {
 	misc_tests();
+	secdata_read_all_tests();
 	phase1_tests();
 	phase2_tests();
 
@@ -19,6 +19,48 @@ static void test_memcmp(void)
 	TEST_EQ(vb2_safe_memcmp("foo1", "foo2", 0), 0, "memcmp 0-size");
 }
 
+/**
+ * Test word-width compares against the byte at every offset and alignment
+ */
+static void test_memcmp_words(void)
+{
+	uint8_t a[80], b[80];
+	int ok_cmp = 1, ok_fill = 1;
+	int start, len, i;
+
+	memset(a, 0x5a, sizeof(a));
+	memset(b, 0x5a, sizeof(b));
+	TEST_EQ(vb2_safe_memcmp(a, b, sizeof(a)), 0, "memcmp long equal");
+	TEST_EQ(vb2_safe_memcmp(a + 1, b + 3, 70), 0,
+		"memcmp misaligned equal");
+	TEST_EQ(vb2_safe_memcmp_fill(a + 3, 0x5a, 70), 0, "fill equal");
+	TEST_EQ(vb2_safe_memcmp_fill(a, 0xff, 0), 0, "fill 0-size");
+
+	for (start = 0; start < 9; start++) {
+		for (len = 1; len < 40; len++) {
+			for (i = start; i < start + len; i++) {
+				b[i] ^= 0x80;
+				if (!vb2_safe_memcmp(a + start, b + start, len))
+					ok_cmp = 0;
+				if (!vb2_safe_memcmp_fill(b + start, 0x5a, len))
+					ok_fill = 0;
+				b[i] ^= 0x80;
+			}
+			/* Bytes just outside the range don't count */
+			if (start)
+				b[start - 1] = 0;
+			b[start + len] = 0;
+			if (vb2_safe_memcmp(a + start, b + start, len))
+				ok_cmp = 0;
+			if (vb2_safe_memcmp_fill(b + start, 0x5a, len))
+				ok_fill = 0;
+			memset(b, 0x5a, sizeof(b));
+		}
+	}
+	TEST_TRUE(ok_cmp, "memcmp finds every differing byte");
+	TEST_TRUE(ok_fill, "fill finds every differing byte");
+}
+
 /**
  * Test alignment functions
  */
@@ -112,6 +154,7 @@ static void test_workbuf(void)
 int main(int argc, char* argv[])
 {
 	test_memcmp();
+	test_memcmp_words();
 	test_align();
 	test_workbuf();
 
@@ -0,0 +1,112 @@
+/* Copyright 2018 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Measure buffer compare and fill checks on firmware-image sized buffers,
+ * the way the updater compares and checks FMAP sections.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "2sysincludes.h"
+#include "2common.h"
+#include "host_misc.h"
+#include "timer_utils.h"
+
+#define ERASE_BLOCK_SIZE 0x1000
+
+/* Keeps the compiler from dropping results it thinks are unused */
+static volatile size_t sink;
+
+/* What vb2_safe_memcmp() used to do */
+static int bytewise_memcmp(const void *s1, const void *s2, size_t size)
+{
+	const unsigned char *us1 = s1;
+	const unsigned char *us2 = s2;
+	int result = 0;
+
+	while (size--)
+		result |= *us1++ ^ *us2++;
+	return result != 0;
+}
+
+/* What the updater's section_is_filled_with() used to do */
+static int bytewise_filled(const uint8_t *data, uint8_t c, size_t size)
+{
+	size_t i;
+
+	for (i = 0; i < size; i++)
+		if (data[i] != c)
+			return 0;
+	return 1;
+}
+
+static void print_result(const char *what, uint32_t mb, uint64_t nsecs)
+{
+	uint64_t usecs = nsecs / 1000;
+
+	fprintf(stderr, "#   %-22s %8u us  %6u MB/s\n", what, (uint32_t)usecs,
+		(uint32_t)(usecs ? mb * 1000000ULL / usecs : 0));
+	fprintf(stdout, "usecs_%s_%uMB:%u\n", what, mb, (uint32_t)usecs);
+}
+
+static int benchmark_size(uint32_t mb)
+{
+	size_t size = (size_t)mb << 20;
+	uint8_t *a = malloc(size), *b = malloc(size);
+	uint64_t nsecs;
+
+	if (!a || !b) {
+		fprintf(stderr, "Can't allocate %u MB\n", mb);
+		free(a);
+		free(b);
+		return 1;
+	}
+
+	/* Identical erased images are the worst case: nothing stops early */
+	memset(a, 0xff, size);
+	memset(b, 0xff, size);
+
+	if (vb2_safe_memcmp(a, b, size) || vb2_safe_memcmp_fill(a, 0xff, size) ||
+	    vb2_find_diff_block(a, b, size, ERASE_BLOCK_SIZE) != size ||
+	    vb2_find_unfilled_block(a, 0xff, size, 0) != size) {
+		fprintf(stderr, "Compare of identical buffers failed\n");
+		free(a);
+		free(b);
+		return 1;
+	}
+
+	fprintf(stderr, "# %u MB\n", mb);
+	TIME_LOOP(nsecs, sink = bytewise_memcmp(a, b, size));
+	print_result("bytewise_memcmp", mb, nsecs);
+	TIME_LOOP(nsecs, sink = vb2_safe_memcmp(a, b, size));
+	print_result("safe_memcmp", mb, nsecs);
+	TIME_LOOP(nsecs, sink = memcmp(a, b, size));
+	print_result("memcmp", mb, nsecs);
+	TIME_LOOP(nsecs, sink = vb2_find_diff_block(a, b, size,
+						   ERASE_BLOCK_SIZE));
+	print_result("find_diff_block", mb, nsecs);
+
+	TIME_LOOP(nsecs, sink = bytewise_filled(a, 0xff, size));
+	print_result("bytewise_filled", mb, nsecs);
+	TIME_LOOP(nsecs, sink = vb2_safe_memcmp_fill(a, 0xff, size));
+	print_result("safe_memcmp_fill", mb, nsecs);
+	TIME_LOOP(nsecs, sink = vb2_find_unfilled_block(a, 0xff, size, 0));
+	print_result("find_unfilled_block", mb, nsecs);
+
+	free(a);
+	free(b);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int errors = 0;
+
+	errors += benchmark_size(16);
+	errors += benchmark_size(32);
+
+	return errors ? 1 : 0;
+}
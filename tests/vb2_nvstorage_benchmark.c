@@ -0,0 +1,67 @@
+/* Copyright 2018 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Timing for the non-volatile storage accessors.
+ */
+
+#include <stdio.h>
+
+#include "2sysincludes.h"
+#include "2api.h"
+#include "2common.h"
+#include "2misc.h"
+#include "2nvstorage.h"
+
+#include "timer_utils.h"
+
+/* Operations per timer check, so the timer doesn't dominate */
+#define BATCH 1000
+
+static volatile uint32_t sink;
+
+static void benchmark(const char *name, uint32_t ctxflags)
+{
+	uint32_t values[VB2_NV_PARAM_COUNT];
+	struct vb2_context c = {
+		.flags = ctxflags,
+	};
+	uint64_t get_ns, set_ns, get_all_ns;
+	uint32_t toggle = 0;
+	int i, p;
+
+	vb2_nv_init(&c);
+
+	TIME_LOOP(get_ns,
+		  for (i = 0; i < BATCH; i++)
+			  for (p = 0; p < VB2_NV_PARAM_COUNT; p++)
+				  sink += vb2_nv_get(&c, p));
+	get_ns /= BATCH * VB2_NV_PARAM_COUNT;
+
+	TIME_LOOP(set_ns,
+		  for (i = 0; i < BATCH; i++) {
+			  toggle ^= 1;
+			  for (p = 0; p < VB2_NV_PARAM_COUNT; p++)
+				  vb2_nv_set(&c, p, toggle);
+		  });
+	set_ns /= BATCH * VB2_NV_PARAM_COUNT;
+
+	TIME_LOOP(get_all_ns,
+		  for (i = 0; i < BATCH; i++)
+			  sink += vb2_nv_get_all(&c, values,
+						 VB2_NV_PARAM_COUNT));
+	get_all_ns /= BATCH * VB2_NV_PARAM_COUNT;
+
+	fprintf(stderr, "# %s: get %u ns, set %u ns, get_all %u ns per param\n",
+		name, (uint32_t)get_ns, (uint32_t)set_ns, (uint32_t)get_all_ns);
+	fprintf(stdout, "nsecs_get_%s:%u\n", name, (uint32_t)get_ns);
+	fprintf(stdout, "nsecs_set_%s:%u\n", name, (uint32_t)set_ns);
+	fprintf(stdout, "nsecs_get_all_%s:%u\n", name, (uint32_t)get_all_ns);
+}
+
+int main(int argc, char *argv[])
+{
+	benchmark("v1", 0);
+	benchmark("v2", VB2_CONTEXT_NVDATA_V2);
+	return 0;
+}
@@ -269,6 +269,61 @@ static void nv_storage_test(uint32_t ctxflags)
 		   VB2_DEV_DEFAULT_BOOT_DISK + 100);
 	TEST_EQ(vb2_nv_get(&c, VB2_NV_DEV_DEFAULT_BOOT),
 		VB2_DEV_DEFAULT_BOOT_DISK, "default to booting from disk");
+
+	/* Out-of-range values which map to the current value change nothing */
+	vb2_nv_set(&c, VB2_NV_DEV_BOOT_USB, 1);
+	c.flags = ctxflags;
+	vb2_nv_set(&c, VB2_NV_DEV_BOOT_USB, 2);
+	vb2_nv_set(&c, VB2_NV_TRY_COUNT, 100);
+	TEST_EQ(vb2_nv_get(&c, VB2_NV_DEV_BOOT_USB), 1, "Bit set by 2");
+	test_changed(&c, 0, "No regen CRC if clipped value not changed");
+}
+
+static void nv_get_all_test(uint32_t ctxflags)
+{
+	struct nv_field *vnf;
+	uint32_t values[VB2_NV_PARAM_COUNT + 2];
+	struct vb2_context c = {
+		.flags = ctxflags,
+	};
+	int i;
+
+	vb2_nv_init(&c);
+	for (vnf = nvfields; vnf->desc; vnf++)
+		vb2_nv_set(&c, vnf->param, vnf->test_value);
+
+	/* Every param is known and matches what vb2_nv_get() says */
+	memset(values, 0xa5, sizeof(values));
+	TEST_EQ(vb2_nv_get_all(&c, values, ARRAY_SIZE(values)),
+		VB2_NV_PARAM_COUNT, "vb2_nv_get_all() count");
+	for (i = 0; i < VB2_NV_PARAM_COUNT; i++)
+		if (values[i] != vb2_nv_get(&c, i))
+			break;
+	TEST_EQ(i, VB2_NV_PARAM_COUNT, "vb2_nv_get_all() values");
+	TEST_EQ(values[VB2_NV_PARAM_COUNT], 0xa5a5a5a5,
+		"vb2_nv_get_all() stays in bounds");
+	TEST_EQ(values[VB2_NV_FW_MAX_ROLLFORWARD],
+		ctxflags ? 0 : VB2_FW_MAX_ROLLFORWARD_V1_DEFAULT,
+		"vb2_nv_get_all() V2 field");
+
+	/* Callers can ask for fewer */
+	memset(values, 0xa5, sizeof(values));
+	TEST_EQ(vb2_nv_get_all(&c, values, 3), 3, "vb2_nv_get_all() some");
+	TEST_EQ(values[2], 1, "  last value");
+	TEST_EQ(values[3], 0xa5a5a5a5, "  no more");
+
+	/* Each param has its own bits */
+	vb2_nv_init(&c);
+	for (i = 0; i < VB2_NV_PARAM_COUNT; i++) {
+		uint8_t before[VB2_NVDATA_SIZE_V2];
+
+		memcpy(before, c.nvdata, sizeof(before));
+		vb2_nv_set(&c, i, vb2_nv_get(&c, i) ? 0 : 1);
+		if (!memcmp(before, c.nvdata, sizeof(before)) &&
+		    !(i == VB2_NV_FW_MAX_ROLLFORWARD && !ctxflags))
+			break;
+	}
+	TEST_EQ(i, VB2_NV_PARAM_COUNT, "Every param can be written");
 }
 
 int main(int argc, char* argv[])
@@ -277,6 +332,8 @@ int main(int argc, char* argv[])
 	nv_storage_test(0);
 	printf("Testing V2\n");
 	nv_storage_test(VB2_CONTEXT_NVDATA_V2);
+	nv_get_all_test(0);
+	nv_get_all_test(VB2_CONTEXT_NVDATA_V2);
 
 	return gTestSuccess ? 0 : 255;
 }
@@ -36,6 +36,7 @@ static int shutdown_request_calls_left;
 static int shutdown_request_power_held;
 static int audio_looping_calls_left;
 static uint32_t vbtlk_retval;
+static int vbtlk_calls;
 static int vbexlegacy_called;
 static int altfw_num;
 static int trust_ec;
@@ -51,6 +52,9 @@ static uint32_t screens_displayed[8];
 static uint32_t screens_count = 0;
 static uint32_t mock_num_disks[8];
 static uint32_t mock_num_disks_count;
+static int mock_generation_supported;
+static int mock_generation_calls;
+static int mock_generation_change_at;
 
 extern enum VbEcBootMode_t VbGetMode(void);
 extern struct RollbackSpaceFwmp *VbApiKernelGetFwmp(void);
@@ -78,6 +82,7 @@ static void ResetMocks(void)
 	shutdown_request_power_held = -1;
 	audio_looping_calls_left = 30;
 	vbtlk_retval = 1000;
+	vbtlk_calls = 0;
 	vbexlegacy_called = 0;
 	altfw_num = -1;
 	trust_ec = 0;
@@ -97,6 +102,10 @@ static void ResetMocks(void)
 
 	memset(mock_num_disks, 0, sizeof(mock_num_disks));
 	mock_num_disks_count = 0;
+
+	mock_generation_supported = 0;
+	mock_generation_calls = 0;
+	mock_generation_change_at = 0;
 }
 
 /* Mock functions */
@@ -173,6 +182,18 @@ VbError_t VbExDiskFreeInfo(VbDiskInfo *infos,
 	return VBERROR_SUCCESS;
 }
 
+VbError_t VbExDiskGetGeneration(uint32_t disk_flags, uint32_t *generation)
+{
+	if (!mock_generation_supported)
+		return VBERROR_UNKNOWN;
+
+	/* Media changes on the given call, if any */
+	mock_generation_calls++;
+	*generation = (mock_generation_change_at &&
+		       mock_generation_calls >= mock_generation_change_at);
+	return VBERROR_SUCCESS;
+}
+
 int VbExTrustEC(int devidx)
 {
 	return trust_ec;
@@ -190,6 +211,7 @@ int vb2_audio_looping(void)
 
 uint32_t VbTryLoadKernel(struct vb2_context *ctx, uint32_t get_info_flags)
 {
+	vbtlk_calls++;
 	return vbtlk_retval + get_info_flags;
 }
 
@@ -870,6 +892,51 @@ static void VbBootRecTest(void)
 		VBERROR_TPM_SET_BOOT_MODE_STATE,
 		"Ctrl+D todev failure");
 
+	/* Disks are scanned every second if media changes can't be seen */
+	ResetMocks();
+	shutdown_request_calls_left = 100;
+	shared->flags = VBSD_BOOT_REC_SWITCH_ON;
+	trust_ec = 1;
+	vbtlk_retval = VBERROR_NO_DISK_FOUND - VB_DISK_FLAG_REMOVABLE;
+	TEST_EQ(VbBootRecovery(&ctx), VBERROR_SHUTDOWN_REQUESTED,
+		"Scan without media generation");
+	TEST_EQ(vbtlk_calls, 3, "  scanned every time");
+
+	/* Otherwise only when the media changes */
+	ResetMocks();
+	shutdown_request_calls_left = 100;
+	shared->flags = VBSD_BOOT_REC_SWITCH_ON;
+	trust_ec = 1;
+	vbtlk_retval = VBERROR_NO_DISK_FOUND - VB_DISK_FLAG_REMOVABLE;
+	mock_generation_supported = 1;
+	TEST_EQ(VbBootRecovery(&ctx), VBERROR_SHUTDOWN_REQUESTED,
+		"Media unchanged");
+	TEST_EQ(vbtlk_calls, 1, "  scanned once");
+	TEST_EQ(screens_displayed[0], VB_SCREEN_RECOVERY_INSERT,
+		"  insert screen");
+
+	ResetMocks();
+	shutdown_request_calls_left = 100;
+	shared->flags = VBSD_BOOT_REC_SWITCH_ON;
+	trust_ec = 1;
+	vbtlk_retval = VBERROR_NO_DISK_FOUND - VB_DISK_FLAG_REMOVABLE;
+	mock_generation_supported = 1;
+	mock_generation_change_at = 5;
+	TEST_EQ(VbBootRecovery(&ctx), VBERROR_SHUTDOWN_REQUESTED,
+		"Media changed");
+	TEST_EQ(vbtlk_calls, 2, "  scanned again");
+
+	ResetMocks();
+	shared->flags = VBSD_BOOT_REC_SWITCH_ON;
+	trust_ec = 1;
+	vbtlk_retval = VBERROR_NO_DISK_FOUND - VB_DISK_FLAG_REMOVABLE;
+	mock_generation_supported = 1;
+	mock_generation_change_at = 5;
+	shutdown_request_calls_left = 10;
+	TEST_EQ(VbBootRecovery(&ctx), VBERROR_SHUTDOWN_REQUESTED,
+		"Media changed before shutdown");
+	TEST_EQ(vbtlk_calls, 2, "  new media scanned quickly");
+
 	printf("...done.\n");
 }
 
@@ -13,6 +13,7 @@
 #include "2api.h"
 #include "2misc.h"
 #include "2nvstorage.h"
+#include "2secdata.h"
 #include "ec_sync.h"
 #include "gbb_header.h"
 #include "host_common.h"
@@ -38,6 +39,10 @@ static uint32_t rkr_version;
 static uint32_t new_version;
 static struct RollbackSpaceFwmp rfr_fwmp;
 static int rkr_retval, rkw_retval, rkl_retval, rfr_retval;
+static int rkr_calls, rfr_calls;
+static int snapshot_retval;
+static uint32_t snapshot_version;
+static uint8_t snapshot_fwmp_version;
 static VbError_t vbboot_retval;
 
 /* Reset mock data (for use before each test) */
@@ -74,6 +79,11 @@ static void ResetMocks(void)
 
 	rkr_version = new_version = 0x10002;
 	rkr_retval = rkw_retval = rkl_retval = VBERROR_SUCCESS;
+	rkr_calls = rfr_calls = 0;
+
+	snapshot_retval = VB2_ERROR_EX_SECDATA_READ_ALL_UNIMPLEMENTED;
+	snapshot_version = 0x10002;
+	snapshot_fwmp_version = ROLLBACK_SPACE_FWMP_VERSION;
 	vbboot_retval = VBERROR_SUCCESS;
 }
 
@@ -93,6 +103,7 @@ VbError_t VbExNvStorageWrite(const uint8_t *buf)
 
 uint32_t RollbackKernelRead(uint32_t *version)
 {
+	rkr_calls++;
 	*version = rkr_version;
 	return rkr_retval;
 }
@@ -110,10 +121,39 @@ uint32_t RollbackKernelLock(int recovery_mode)
 
 uint32_t RollbackFwmpRead(struct RollbackSpaceFwmp *fwmp)
 {
+	rfr_calls++;
 	memcpy(fwmp, &rfr_fwmp, sizeof(*fwmp));
 	return rfr_retval;
 }
 
+int vb2ex_secdata_read_all(struct vb2_context *c,
+			   struct vb2_secdata_snapshot *snapshot)
+{
+	struct RollbackSpaceFwmp *bf =
+		(struct RollbackSpaceFwmp *)snapshot->fwmp;
+
+	if (snapshot_retval)
+		return snapshot_retval;
+
+	vb2_secdata_create(c);
+	vb2_secdatak_create(c);
+	vb2_secdatak_init(c);
+	vb2_secdatak_set(c, VB2_SECDATAK_VERSIONS, snapshot_version);
+
+	snapshot->spaces = VB2_SECDATA_SPACE_FIRMWARE |
+		VB2_SECDATA_SPACE_KERNEL | VB2_SECDATA_SPACE_FWMP;
+	memcpy(snapshot->secdata, c->secdata, sizeof(c->secdata));
+	memcpy(snapshot->secdatak, c->secdatak, sizeof(c->secdatak));
+
+	bf->struct_size = sizeof(*bf);
+	bf->struct_version = snapshot_fwmp_version;
+	bf->flags = FWMP_DEV_ENABLE_USB;
+	bf->crc = vb2_crc8(snapshot->fwmp + 2, sizeof(*bf) - 2);
+	snapshot->fwmp_size = sizeof(*bf);
+
+	return VB2_SUCCESS;
+}
+
 uint32_t VbTryLoadKernel(struct vb2_context *ctx, uint32_t get_info_flags)
 {
 	shared->kernel_version_tpm = new_version;
@@ -259,6 +299,43 @@ static void VbSlkTest(void)
 	shared->recovery_reason = VB2_RECOVERY_TRAIN_AND_REBOOT;
 	test_slk(VBERROR_REBOOT_REQUIRED, 0, "Recovery train and reboot");
 
+	/* Secure storage snapshot from the platform */
+	ResetMocks();
+	snapshot_retval = VB2_SUCCESS;
+	snapshot_version = 0x20003;
+	new_version = 0x20003;
+	rkr_retval = rfr_retval = VBERROR_SIMULATED;
+	test_slk(0, 0, "Snapshot");
+	TEST_EQ(rkr_calls, 0, "  no kernel space read");
+	TEST_EQ(rfr_calls, 0, "  no FWMP read");
+	TEST_EQ(rkr_version, 0x10002, "  no roll forward");
+	TEST_EQ(vb2_get_fwmp_flags(), FWMP_DEV_ENABLE_USB, "  FWMP flags");
+
+	ResetMocks();
+	snapshot_retval = VB2_SUCCESS;
+	gbb.flags |= GBB_FLAG_DISABLE_FWMP;
+	test_slk(0, 0, "Snapshot FWMP disabled by GBB");
+	TEST_EQ(vb2_get_fwmp_flags(), 0, "  FWMP flags");
+
+	ResetMocks();
+	snapshot_retval = VB2_SUCCESS;
+	snapshot_fwmp_version = 0x20;
+	test_slk(VBERROR_TPM_READ_KERNEL,
+		 VB2_RECOVERY_RW_TPM_R_ERROR, "Snapshot FWMP version");
+
+	ResetMocks();
+	snapshot_retval = VB2_ERROR_MOCK;
+	test_slk(VBERROR_TPM_READ_KERNEL,
+		 VB2_RECOVERY_RW_TPM_R_ERROR, "Snapshot error");
+	TEST_EQ(rkr_calls, 0, "  no kernel space read");
+
+	ResetMocks();
+	shared->recovery_reason = 123;
+	snapshot_retval = VB2_ERROR_MOCK;
+	test_slk(0, 0, "Snapshot error in recovery reads TPM");
+	TEST_EQ(rkr_calls, 1, "  kernel space read");
+	TEST_EQ(rfr_calls, 1, "  FWMP read");
+
 	// todo: rkr/w/l fail ignored if recovery
 
 
@@ -40,6 +40,7 @@ static VbError_t vbtlk_retval[5];
 static VbError_t vbtlk_last_retval;
 static int vbtlk_retval_count;
 static const VbError_t vbtlk_retval_fixed = 1002;
+static int vbtlk_calls;
 static int vbexlegacy_called;
 static int altfw_num;
 static int debug_info_displayed;
@@ -58,6 +59,9 @@ static uint32_t beeps_played[64];
 static uint32_t beeps_count = 0;
 static uint32_t mock_altfw_mask;
 static int vbexaltfwmask_called;
+static int mock_generation_supported;
+static int mock_generation_calls;
+static int mock_generation_change_at;
 
 extern enum VbEcBootMode_t VbGetMode(void);
 extern struct RollbackSpaceFwmp *VbApiKernelGetFwmp(void);
@@ -96,6 +100,7 @@ static void ResetMocks(void)
 	vbtlk_last_retval = vbtlk_retval_fixed - VB_DISK_FLAG_FIXED;
 	memset(vbtlk_retval, 0, sizeof(vbtlk_retval));
 	vbtlk_retval_count = 0;
+	vbtlk_calls = 0;
 
 	memset(screens_displayed, 0, sizeof(screens_displayed));
 	screens_count = 0;
@@ -112,6 +117,10 @@ static void ResetMocks(void)
 
 	mock_altfw_mask = 3 << 1;	/* This mask selects 1 and 2 */
 	vbexaltfwmask_called = 0;
+
+	mock_generation_supported = 0;
+	mock_generation_calls = 0;
+	mock_generation_change_at = 0;
 }
 
 static void ResetMocksForDeveloper(void)
@@ -197,8 +206,21 @@ int vb2_audio_looping(void)
 	return 1;
 }
 
+VbError_t VbExDiskGetGeneration(uint32_t disk_flags, uint32_t *generation)
+{
+	if (!mock_generation_supported)
+		return VBERROR_UNKNOWN;
+
+	/* Media changes on the given call, if any */
+	mock_generation_calls++;
+	*generation = (mock_generation_change_at &&
+		       mock_generation_calls >= mock_generation_change_at);
+	return VBERROR_SUCCESS;
+}
+
 VbError_t VbTryLoadKernel(struct vb2_context *ctx, uint32_t get_info_flags)
 {
+	vbtlk_calls++;
 	if (vbtlk_retval_count < ARRAY_SIZE(vbtlk_retval) &&
 	    vbtlk_retval[vbtlk_retval_count] != 0)
 		vbtlk_last_retval = vbtlk_retval[vbtlk_retval_count++];
@@ -1843,6 +1865,40 @@ static void VbBootRecTest(void)
 	TEST_EQ(screens_count, 3, "  no extra screens");
 	TEST_EQ(beeps_count, 0, "  no beeps");
 
+	/* Disks are scanned every second if media changes can't be seen */
+	ResetMocksForManualRecovery();
+	vbtlk_retval[0] = VBERROR_NO_DISK_FOUND - VB_DISK_FLAG_REMOVABLE;
+	TEST_EQ(VbBootRecoveryMenu(&ctx), VBERROR_SHUTDOWN_REQUESTED,
+		"Scan without media generation");
+	TEST_EQ(vbtlk_calls, 7, "  scanned every time");
+
+	/* Otherwise only when the media changes */
+	ResetMocksForManualRecovery();
+	vbtlk_retval[0] = VBERROR_NO_DISK_FOUND - VB_DISK_FLAG_REMOVABLE;
+	mock_generation_supported = 1;
+	TEST_EQ(VbBootRecoveryMenu(&ctx), VBERROR_SHUTDOWN_REQUESTED,
+		"Media unchanged");
+	TEST_EQ(vbtlk_calls, 1, "  scanned once");
+	TEST_EQ(screens_displayed[0], VB_SCREEN_RECOVERY_INSERT,
+		"  insert screen");
+
+	ResetMocksForManualRecovery();
+	vbtlk_retval[0] = VBERROR_NO_DISK_FOUND - VB_DISK_FLAG_REMOVABLE;
+	mock_generation_supported = 1;
+	mock_generation_change_at = 5;
+	TEST_EQ(VbBootRecoveryMenu(&ctx), VBERROR_SHUTDOWN_REQUESTED,
+		"Media changed");
+	TEST_EQ(vbtlk_calls, 2, "  scanned again");
+
+	ResetMocksForManualRecovery();
+	vbtlk_retval[0] = VBERROR_NO_DISK_FOUND - VB_DISK_FLAG_REMOVABLE;
+	mock_generation_supported = 1;
+	mock_generation_change_at = 5;
+	shutdown_request_calls_left = 10;
+	TEST_EQ(VbBootRecoveryMenu(&ctx), VBERROR_SHUTDOWN_REQUESTED,
+		"Media changed before shutdown");
+	TEST_EQ(vbtlk_calls, 2, "  new media scanned quickly");
+
 	printf("...done.\n");
 }
 
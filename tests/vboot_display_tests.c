@@ -14,11 +14,13 @@
 #include "2common.h"
 #include "2misc.h"
 #include "2nvstorage.h"
+#include "2rsa.h"
 #include "bmpblk_font.h"
 #include "gbb_access.h"
 #include "gbb_header.h"
 #include "host_common.h"
 #include "test_common.h"
+#include "vb2_common.h"
 #include "vboot_common.h"
 #include "vboot_display.h"
 #include "vboot_kernel.h"
@@ -142,6 +144,81 @@ static void DebugInfoTest(void)
 	TEST_NEQ(*debug_info, '\0', "Some debug info was displayed");
 }
 
+/* Test reading keys from the GBB */
+static void GbbKeyTest(void)
+{
+	const struct vb2_packed_key *packed, *packed2;
+	const struct vb2_public_key *key, *key2;
+	struct vb2_packed_key *gbb_key;
+	uint32_t *key_data;
+	uint32_t used;
+
+	/* Keys are copied into the work buffer once */
+	ResetMocks();
+	used = ctx.workbuf_used;
+	TEST_SUCC(VbGbbGetRootKey(&ctx, &packed, NULL), "Get root key");
+	TEST_PTR_NEQ(packed, NULL, "  not NULL");
+	TEST_NEQ(ctx.workbuf_used, used, "  workbuf used");
+	TEST_EQ(memcmp(packed, gbb_data + gbb->rootkey_offset,
+		       sizeof(*packed)), 0, "  contents");
+	used = ctx.workbuf_used;
+	gbb->rootkey_offset = gbb->recovery_key_offset;
+	TEST_SUCC(VbGbbGetRootKey(&ctx, &packed2, NULL), "Get root key again");
+	TEST_PTR_EQ(packed2, packed, "  same copy");
+	TEST_EQ(ctx.workbuf_used, used, "  no more workbuf used");
+
+	/* Recovery key is cached separately */
+	TEST_SUCC(VbGbbGetRecoveryKey(&ctx, &packed2, NULL),
+		  "Get recovery key");
+	TEST_PTR_NEQ(packed2, packed, "  different copy");
+	TEST_NEQ(ctx.workbuf_used, used, "  workbuf used");
+
+	/* The dummy keys don't unpack */
+	TEST_NEQ(VbGbbGetRecoveryKey(&ctx, NULL, &key), VBERROR_SUCCESS,
+		 "Unpack bad key");
+
+	/* Put a real-looking key in the GBB and unpack it */
+	ResetMocks();
+	gbb_key = (struct vb2_packed_key *)
+		(gbb_data + gbb->recovery_key_offset);
+	gbb_key->key_offset = sizeof(*gbb_key);
+	gbb_key->key_size = vb2_packed_key_size(VB2_SIG_RSA1024);
+	gbb_key->algorithm = VB2_ALG_RSA1024_SHA1;
+	key_data = (uint32_t *)(gbb_key + 1);
+	key_data[0] = vb2_rsa_sig_size(VB2_SIG_RSA1024) / sizeof(uint32_t);
+	key_data[1] = 0x12345679;	/* -1 / n[0] */
+	key_data[2] = 0x0e61cc37;
+	TEST_SUCC(VbGbbGetRecoveryKey(&ctx, &packed, &key),
+		  "Unpack recovery key");
+	TEST_EQ(key->n0inv, 0x12345679, "  n0inv");
+	TEST_PTR_EQ(key->n, (const uint32_t *)vb2_packed_key_data(packed) + 2,
+		    "  n points into cached copy");
+	key_data[1] = 0;
+	TEST_SUCC(VbGbbGetRecoveryKey(&ctx, NULL, &key2),
+		  "Unpack recovery key again");
+	TEST_PTR_EQ(key2, key, "  same key");
+	TEST_EQ(key2->n0inv, 0x12345679, "  still cached");
+
+	/* Keys which don't fit in the GBB are rejected */
+	ResetMocks();
+	gbb->rootkey_offset = sd->gbb_size - 4;
+	TEST_EQ(VbGbbGetRootKey(&ctx, &packed, NULL), VBERROR_INVALID_GBB,
+		"Root key past end");
+	TEST_EQ(sd->workbuf_gbb_rootkey_offset, 0, "  not cached");
+	gbb_key = (struct vb2_packed_key *)
+		(gbb_data + gbb->recovery_key_offset);
+	gbb_key->key_size = sd->gbb_size;
+	TEST_EQ(VbGbbGetRecoveryKey(&ctx, &packed, NULL), VBERROR_INVALID_GBB,
+		"Recovery key too big");
+
+	/* A full work buffer isn't a bad GBB */
+	ResetMocks();
+	ctx.workbuf_used = ctx.workbuf_size;
+	TEST_EQ(VbGbbGetRootKey(&ctx, &packed, NULL), VBERROR_OUT_OF_MEMORY,
+		"Work buffer full");
+	TEST_EQ(sd->workbuf_gbb_rootkey_offset, 0, "  not cached");
+}
+
 /* Test display key checking */
 static void DisplayKeyTest(void)
 {
@@ -184,6 +261,7 @@ static void DisplayKeyTest(void)
 int main(void)
 {
 	DebugInfoTest();
+	GbbKeyTest();
 	DisplayKeyTest();
 
 	return gTestSuccess ? 0 : 255;
@@ -57,6 +57,7 @@ static int key_block_verify_fail;  /* 0=ok, 1=sig, 2=hash */
 static int preamble_verify_fail;
 static int verify_data_fail;
 static int unpack_key_fail;
+static int unpack_key_calls;
 static int gpt_flag_external;
 
 static uint8_t gbb_data[sizeof(GoogleBinaryBlockHeader) + 2048];
@@ -134,6 +135,7 @@ static void ResetMocks(void)
 	preamble_verify_fail = 0;
 	verify_data_fail = 0;
 	unpack_key_fail = 0;
+	unpack_key_calls = 0;
 
 	gpt_flag_external = 0;
 
@@ -177,6 +179,7 @@ static void ResetMocks(void)
 	memset(&ctx, 0, sizeof(ctx));
 	ctx.workbuf = workbuf;
 	ctx.workbuf_size = sizeof(workbuf);
+	vb2_init_context(&ctx);
 	vb2_nv_init(&ctx);
 
 	struct vb2_shared_data *sd = vb2_get_sd(&ctx);
@@ -250,6 +253,7 @@ int vb2_unpack_key_buffer(struct vb2_public_key *key,
 		   const uint8_t *buf,
 		   uint32_t size)
 {
+	unpack_key_calls++;
 	if (--unpack_key_fail == 0)
 		return VB2_ERROR_MOCK;
 
@@ -589,6 +593,8 @@ static void InvalidParamsTest(void)
 
 static void LoadKernelTest(void)
 {
+	uint32_t used;
+
 	ResetMocks();
 
 	TestLoadKernel(0, "First kernel good");
@@ -717,6 +723,45 @@ static void LoadKernelTest(void)
 	ctx.flags |= VB2_CONTEXT_RECOVERY_MODE;
 	TestLoadKernel(0, "Key version ignored in rec mode");
 
+	/* Recovery key is only read from the GBB once */
+	ResetMocks();
+	ctx.flags |= VB2_CONTEXT_RECOVERY_MODE;
+	TestLoadKernel(0, "Rec mode");
+	used = ctx.workbuf_used;
+	mock_part_next = 0;
+	TestLoadKernel(0, "Rec mode again");
+	TEST_EQ(ctx.workbuf_used, used, "  recovery key cached");
+
+	/* A recovery key which doesn't unpack only matters if it's used */
+	ResetMocks();
+	ctx.flags |= VB2_CONTEXT_RECOVERY_MODE;
+	mock_parts[0].size = 0;
+	unpack_key_fail = 1;
+	TestLoadKernel(VBERROR_NO_KERNEL_FOUND, "Bad rec key, no kernels");
+
+	ResetMocks();
+	ctx.flags |= VB2_CONTEXT_RECOVERY_MODE;
+	unpack_key_fail = 1;
+	TestLoadKernel(VBERROR_INVALID_KERNEL_FOUND, "Bad rec key");
+	TEST_EQ(mock_part_next, 1, "  read kernel");
+
+	/* Kernel subkey is unpacked once for all the partitions */
+	ResetMocks();
+	kbh.data_key.key_version = 3;
+	mock_parts[1].start = 300;
+	mock_parts[1].size = 150;
+	TestLoadKernel(0, "Two kernels");
+	TEST_EQ(mock_part_next, 2, "  read both");
+	TEST_EQ(unpack_key_calls, 4, "  subkey unpacked once");
+
+	ResetMocks();
+	mock_parts[1].start = 300;
+	mock_parts[1].size = 150;
+	unpack_key_fail = 1;
+	TestLoadKernel(VBERROR_INVALID_KERNEL_FOUND, "Bad kernel subkey");
+	TEST_EQ(mock_part_next, 2, "  read both");
+	TEST_EQ(unpack_key_calls, 1, "  unpacked once");
+
 	ResetMocks();
 	unpack_key_fail = 2;
 	TestLoadKernel(VBERROR_INVALID_KERNEL_FOUND, "Bad data key");
@@ -9,11 +9,13 @@
 #include <errno.h>
 #include <getopt.h>
 #include <lzma.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <yaml.h>
 
 #include "bmpblk_utility.h"
@@ -55,6 +57,7 @@ namespace vboot_reference {
     support_font_ = true;
     got_font_ = false;
     got_rtol_font_ = false;
+    jobs_ = 1;
   }
 
   BmpBlockUtil::~BmpBlockUtil() {
@@ -65,6 +68,10 @@ namespace vboot_reference {
     set_compression_ = true;
   }
 
+  void BmpBlockUtil::set_jobs(unsigned int jobs) {
+    jobs_ = jobs ? jobs : 1;
+  }
+
   void BmpBlockUtil::load_from_config(const char *filename) {
     load_yaml_config(filename);
     fill_bmpblock_header();
@@ -385,7 +392,128 @@ namespace vboot_reference {
     }
   }
 
+  /* One unique image to compress, and where its result goes. */
+  typedef struct CompressJob {
+    const string *raw_content;
+    string compressed_content;
+    bool failed;
+  } CompressJob;
+
+  /* Shared state for the compression worker threads. */
+  typedef struct CompressPool {
+    uint32_t compression;
+    vector<CompressJob> *jobs;
+    pthread_mutex_t lock;
+    size_t next_job;
+  } CompressPool;
+
+  /* Compress one image. Returns false if the compressor fails. */
+  static bool compress_content(uint32_t compression, EFI_COMPRESS_CONTEXT *ctx,
+                               const string &content, string *out) {
+    switch(compression) {
+    case COMPRESS_EFIv1:
+    {
+      // The content will always compress smaller (so sez the docs).
+      uint32_t tmpsize = content.size();
+      uint8_t *tmpbuf = (uint8_t *)malloc(tmpsize);
+      // The size of the compressed content is also returned.
+      if (!tmpbuf ||
+          EFI_SUCCESS != EfiCompressWithContext(ctx,
+                                                (uint8_t *)content.c_str(),
+                                                tmpsize, tmpbuf, &tmpsize)) {
+        free(tmpbuf);
+        return false;
+      }
+      out->assign((const char *)tmpbuf, tmpsize);
+      free(tmpbuf);
+      return true;
+    }
+    case COMPRESS_LZMA1:
+    {
+      // Calculate the worst case of buffer size.
+      uint32_t tmpsize = lzma_stream_buffer_bound(content.size());
+      uint8_t *tmpbuf = (uint8_t *)malloc(tmpsize);
+      lzma_stream stream = LZMA_STREAM_INIT;
+      lzma_options_lzma options;
+      lzma_ret result;
+
+      if (!tmpbuf)
+        return false;
+
+      lzma_lzma_preset(&options, 9);
+      result = lzma_alone_encoder(&stream, &options);
+      if (result != LZMA_OK) {
+        fprintf(stderr, "Unable to initialize easy encoder (error: %d)!\n",
+                result);
+        free(tmpbuf);
+        return false;
+      }
+
+      stream.next_in = (uint8_t *)content.data();
+      stream.avail_in = content.size();
+      stream.next_out = tmpbuf;
+      stream.avail_out = tmpsize;
+      result = lzma_code(&stream, LZMA_FINISH);
+      if (result != LZMA_STREAM_END) {
+        fprintf(stderr, "Unable to encode data (error: %d)!\n", result);
+        lzma_end(&stream);
+        free(tmpbuf);
+        return false;
+      }
+
+      out->assign((const char *)tmpbuf, tmpsize - stream.avail_out);
+      lzma_end(&stream);
+      free(tmpbuf);
+      return true;
+    }
+    default:
+      return false;
+    }
+  }
+
+  /* Worker thread: take jobs off the shared list until there are none left. */
+  static void *compress_worker(void *arg) {
+    CompressPool *pool = (CompressPool *)arg;
+    EFI_COMPRESS_CONTEXT *ctx = NULL;
+
+    if (pool->compression == COMPRESS_EFIv1) {
+      ctx = EfiCompressContextNew();
+      if (!ctx)
+        return (void *)1;
+    }
+
+    for (;;) {
+      pthread_mutex_lock(&pool->lock);
+      size_t i = pool->next_job++;
+      pthread_mutex_unlock(&pool->lock);
+      if (i >= pool->jobs->size())
+        break;
+
+      CompressJob &job = (*pool->jobs)[i];
+      job.failed = !compress_content(pool->compression, ctx, *job.raw_content,
+                                     &job.compressed_content);
+    }
+
+    EfiCompressContextFree(ctx);
+    return NULL;
+  }
+
+  /* FNV-1a, to find images with the same content. */
+  static uint64_t content_hash(const string &content) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < content.size(); i++) {
+      hash ^= (uint8_t)content[i];
+      hash *= 0x100000001b3ULL;
+    }
+    return hash;
+  }
+
   void BmpBlockUtil::load_all_image_files() {
+    /* Which job compresses each image, and the jobs found by content hash */
+    vector<size_t> image_job(config_.image_names.size());
+    std::multimap<uint64_t, size_t> jobs_by_hash;
+    vector<CompressJob> jobs;
+
     for (unsigned int i = 0; i < config_.image_names.size(); i++) {
       StrImageConfigMap::iterator it =
         config_.images_map.find(config_.image_names[i]);
@@ -403,63 +531,83 @@ namespace vboot_reference {
       if (FORMAT_INVALID == it->second.data.format) {
         error("Unsupported image format in %s\n", it->second.filename.c_str());
       }
+      it->second.data.compression = compression_;
       switch(compression_) {
       case COMPRESS_NONE:
-        it->second.data.compression = compression_;
         it->second.compressed_content = content;
         it->second.data.compressed_size = content.size();
-        break;
+        continue;
       case COMPRESS_EFIv1:
-      {
-        // The content will always compress smaller (so sez the docs).
-        uint32_t tmpsize = content.size();
-        uint8_t *tmpbuf = (uint8_t *)malloc(tmpsize);
-        // The size of the compressed content is also returned.
-        if (EFI_SUCCESS != EfiCompress((uint8_t *)content.c_str(), tmpsize,
-                                       tmpbuf, &tmpsize)) {
-          error("Unable to compress!\n");
-        }
-        it->second.data.compression = compression_;
-        it->second.compressed_content.assign((const char *)tmpbuf, tmpsize);
-        it->second.data.compressed_size = tmpsize;
-        free(tmpbuf);
-      }
-      break;
       case COMPRESS_LZMA1:
-      {
-        // Calculate the worst case of buffer size.
-        uint32_t tmpsize = lzma_stream_buffer_bound(content.size());
-        uint8_t *tmpbuf = (uint8_t *)malloc(tmpsize);
-        lzma_stream stream = LZMA_STREAM_INIT;
-        lzma_options_lzma options;
-        lzma_ret result;
-
-        lzma_lzma_preset(&options, 9);
-        result = lzma_alone_encoder(&stream, &options);
-        if (result != LZMA_OK) {
-          error("Unable to initialize easy encoder (error: %d)!\n", result);
-        }
-
-        stream.next_in = (uint8_t *)content.data();
-        stream.avail_in = content.size();
-        stream.next_out = tmpbuf;
-        stream.avail_out = tmpsize;
-        result = lzma_code(&stream, LZMA_FINISH);
-        if (result != LZMA_STREAM_END) {
-          error("Unable to encode data (error: %d)!\n", result);
-        }
-
-        it->second.data.compression = compression_;
-        it->second.compressed_content.assign((const char *)tmpbuf,
-                                             tmpsize - stream.avail_out);
-        it->second.data.compressed_size = tmpsize - stream.avail_out;
-        lzma_end(&stream);
-        free(tmpbuf);
-      }
-      break;
+        break;
       default:
         error("Unsupported compression method attempted.\n");
       }
+
+      /* The same file is often used by many screens and locales. */
+      const string &raw = it->second.raw_content;
+      uint64_t hash = content_hash(raw);
+      std::pair<std::multimap<uint64_t, size_t>::iterator,
+                std::multimap<uint64_t, size_t>::iterator> range =
+        jobs_by_hash.equal_range(hash);
+      for (; range.first != range.second; ++range.first) {
+        if (*jobs[range.first->second].raw_content == raw)
+          break;
+      }
+      if (range.first != range.second) {
+        image_job[i] = range.first->second;
+      } else {
+        CompressJob job;
+        job.raw_content = &raw;
+        job.failed = false;
+        image_job[i] = jobs.size();
+        jobs_by_hash.insert(std::make_pair(hash, jobs.size()));
+        jobs.push_back(job);
+      }
+    }
+
+    if (jobs.empty())
+      return;
+
+    /* Compress the unique images on a pool of threads. */
+    CompressPool pool;
+    pool.compression = compression_;
+    pool.jobs = &jobs;
+    pool.next_job = 0;
+    pthread_mutex_init(&pool.lock, NULL);
+
+    size_t num_threads = jobs_;
+    if (num_threads > jobs.size())
+      num_threads = jobs.size();
+    vector<pthread_t> threads(num_threads);
+    for (size_t t = 0; t < num_threads; t++) {
+      if (pthread_create(&threads[t], NULL, compress_worker, &pool))
+        error("Unable to start compression thread.\n");
+    }
+    bool failed = false;
+    for (size_t t = 0; t < num_threads; t++) {
+      void *result;
+      pthread_join(threads[t], &result);
+      if (result)
+        failed = true;
+    }
+    pthread_mutex_destroy(&pool.lock);
+    if (failed)
+      error("Unable to compress!\n");
+
+    if (debug_) {
+      printf("compressed %zu unique images of %zu using %zu threads\n",
+             jobs.size(), config_.image_names.size(), num_threads);
+    }
+
+    for (unsigned int i = 0; i < config_.image_names.size(); i++) {
+      StrImageConfigMap::iterator it =
+        config_.images_map.find(config_.image_names[i]);
+      const CompressJob &job = jobs[image_job[i]];
+      if (job.failed)
+        error("Unable to compress %s!\n", it->second.filename.c_str());
+      it->second.compressed_content = job.compressed_content;
+      it->second.data.compressed_size = job.compressed_content.size();
     }
   }
 
@@ -649,12 +797,14 @@ namespace vboot_reference {
       "\n"
       "To create a new BMPBLOCK file using config from YAML file:\n"
       "\n"
-      "  %s [-z NUM] -c YAML BMPBLOCK\n"
+      "  %s [-z NUM] [-j NUM] -c YAML BMPBLOCK\n"
       "\n"
       "    -z NUM  = compression algorithm to use\n"
       "              0 = none\n"
       "              1 = EFIv1\n"
       "              2 = LZMA1\n"
+      "    -j NUM  = number of images to compress at once\n"
+      "              (default is the number of CPUs)\n"
       "\n", prog_name);
     printf(
       "To display the contents of a BMPBLOCK:\n"
@@ -688,6 +838,7 @@ namespace vboot_reference {
     int overwrite = 0, extract_mode = 0;
     int compression = 0;
     int set_compression = 0;
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
     const char *config_fn = 0, *bmpblock_fn = 0, *extract_dir = ".";
     int show_as_yaml = 0;
     bool debug = false;
@@ -696,7 +847,7 @@ namespace vboot_reference {
     opterr = 0;                           // quiet
     int errorcnt = 0;
     char *e = 0;
-    while ((opt = getopt(argc, argv, ":c:xz:fd:yD")) != -1) {
+    while ((opt = getopt(argc, argv, ":c:xz:j:fd:yD")) != -1) {
       switch (opt) {
       case 'c':
         config_fn = optarg;
@@ -721,6 +872,14 @@ namespace vboot_reference {
         }
         set_compression = 1;
         break;
+      case 'j':
+        jobs = strtol(optarg, &e, 0);
+        if (!*optarg || (e && *e) || jobs < 1) {
+          fprintf(stderr, "%s: invalid argument to -%c: \"%s\"\n",
+                  prog_name, opt, optarg);
+          errorcnt++;
+        }
+        break;
       case 'f':
         overwrite = 1;
         break;
@@ -760,6 +919,7 @@ namespace vboot_reference {
     if (config_fn) {
       if (set_compression)
         util.force_compression(compression);
+      util.set_jobs(jobs > 0 ? jobs : 1);
       util.load_from_config(config_fn);
       util.pack_bmpblock();
       util.write_to_bmpblock(bmpblock_fn);
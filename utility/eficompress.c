@@ -57,7 +57,7 @@ typedef INT16             NODE;
 #define MAX_HASH_VAL      (3 * WNDSIZ + (WNDSIZ / 512 + 1) * UINT8_MAX)
 #define HASH(p, c)        ((p) + ((c) << (WNDBIT - 9)) + WNDSIZ * 2)
 #define CRCPOLY           0xA001
-#define UPDATE_CRC(c)     mCrc = mCrcTable[(mCrc ^ (c)) & 0xFF] ^ (mCrc >> UINT8_BIT)
+#define UPDATE_CRC(c)     Ctx->mCrc = Ctx->mCrcTable[(Ctx->mCrc ^ (c)) & 0xFF] ^ (Ctx->mCrc >> UINT8_BIT)
 
 //
 // C: the Char&Len Set; P: the Position Set; T: the exTra Set
@@ -82,27 +82,32 @@ typedef INT16             NODE;
 STATIC
 VOID
 PutDword(
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   IN UINT32 Data
   );
 
 STATIC
 EFI_STATUS
 AllocateMemory (
+  IN EFI_COMPRESS_CONTEXT *Ctx
   );
 
 STATIC
 VOID
 FreeMemory (
+  IN EFI_COMPRESS_CONTEXT *Ctx
   );
 
 STATIC
 VOID
 InitSlide (
+  IN EFI_COMPRESS_CONTEXT *Ctx
   );
 
 STATIC
 NODE
 Child (
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   IN NODE q,
   IN UINT8 c
   );
@@ -110,6 +115,7 @@ Child (
 STATIC
 VOID
 MakeChild (
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   IN NODE q,
   IN UINT8 c,
   IN NODE r
@@ -118,37 +124,44 @@ MakeChild (
 STATIC
 VOID
 Split (
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   IN NODE Old
   );
 
 STATIC
 VOID
 InsertNode (
+  IN EFI_COMPRESS_CONTEXT *Ctx
   );
 
 STATIC
 VOID
 DeleteNode (
+  IN EFI_COMPRESS_CONTEXT *Ctx
   );
 
 STATIC
 VOID
 GetNextMatch (
+  IN EFI_COMPRESS_CONTEXT *Ctx
   );
 
 STATIC
 EFI_STATUS
 Encode (
+  IN EFI_COMPRESS_CONTEXT *Ctx
   );
 
 STATIC
 VOID
 CountTFreq (
+  IN EFI_COMPRESS_CONTEXT *Ctx
   );
 
 STATIC
 VOID
 WritePTLen (
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   IN INT32 n,
   IN INT32 nbit,
   IN INT32 Special
@@ -157,28 +170,33 @@ WritePTLen (
 STATIC
 VOID
 WriteCLen (
+  IN EFI_COMPRESS_CONTEXT *Ctx
   );
 
 STATIC
 VOID
 EncodeC (
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   IN INT32 c
   );
 
 STATIC
 VOID
 EncodeP (
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   IN UINT32 p
   );
 
 STATIC
 VOID
 SendBlock (
+  IN EFI_COMPRESS_CONTEXT *Ctx
   );
 
 STATIC
 VOID
 Output (
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   IN UINT32 c,
   IN UINT32 p
   );
@@ -186,21 +204,25 @@ Output (
 STATIC
 VOID
 HufEncodeStart (
+  IN EFI_COMPRESS_CONTEXT *Ctx
   );
 
 STATIC
 VOID
 HufEncodeEnd (
+  IN EFI_COMPRESS_CONTEXT *Ctx
   );
 
 STATIC
 VOID
 MakeCrcTable (
+  IN EFI_COMPRESS_CONTEXT *Ctx
   );
 
 STATIC
 VOID
 PutBits (
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   IN INT32 n,
   IN UINT32 x
   );
@@ -208,6 +230,7 @@ PutBits (
 STATIC
 INT32
 FreadCrc (
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   OUT UINT8 *p,
   IN  INT32 n
   );
@@ -215,29 +238,34 @@ FreadCrc (
 STATIC
 VOID
 InitPutBits (
+  IN EFI_COMPRESS_CONTEXT *Ctx
   );
 
 STATIC
 VOID
 CountLen (
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   IN INT32 i
   );
 
 STATIC
 VOID
 MakeLen (
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   IN INT32 Root
   );
 
 STATIC
 VOID
 DownHeap (
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   IN INT32 i
   );
 
 STATIC
 VOID
 MakeCode (
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   IN  INT32 n,
   IN  UINT8 Len[],
   OUT UINT16 Code[]
@@ -246,6 +274,7 @@ MakeCode (
 STATIC
 INT32
 MakeTree (
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   IN  INT32   NParm,
   IN  UINT16  FreqParm[],
   OUT UINT8   LenParm[],
@@ -254,30 +283,96 @@ MakeTree (
 
 
 //
-//  Global Variables
+//  Compression state, one per context
 //
 
-STATIC UINT8  *mSrc, *mDst, *mSrcUpperLimit, *mDstUpperLimit;
+struct _EFI_COMPRESS_CONTEXT {
+  UINT8  *mSrc, *mDst, *mSrcUpperLimit, *mDstUpperLimit;
 
-STATIC UINT8  *mLevel, *mText, *mChildCount, *mBuf, mCLen[NC], mPTLen[NPT], *mLen;
-STATIC INT16  mHeap[NC + 1];
-STATIC INT32  mRemainder, mMatchLen, mBitCount, mHeapSize, mN;
-STATIC UINT32 mBufSiz = 0, mOutputPos, mOutputMask, mSubBitBuf, mCrc;
-STATIC UINT32 mCompSize, mOrigSize;
+  UINT8  *mLevel, *mText, *mChildCount, *mBuf, mCLen[NC], mPTLen[NPT], *mLen;
+  INT16  mHeap[NC + 1];
+  INT32  mRemainder, mMatchLen, mBitCount, mHeapSize, mN, mDepth;
+  UINT32 mBufSiz, mOutputPos, mOutputMask, mSubBitBuf, mCrc, mCPos;
+  UINT32 mCompSize, mOrigSize;
 
-STATIC UINT16 *mFreq, *mSortPtr, mLenCnt[17], mLeft[2 * NC - 1], mRight[2 * NC - 1],
-              mCrcTable[UINT8_MAX + 1], mCFreq[2 * NC - 1], mCCode[NC],
-              mPFreq[2 * NP - 1], mPTCode[NPT], mTFreq[2 * NT - 1];
+  UINT16 *mFreq, *mSortPtr, mLenCnt[17], mLeft[2 * NC - 1], mRight[2 * NC - 1],
+         mCrcTable[UINT8_MAX + 1], mCFreq[2 * NC - 1], mCCode[NC],
+         mPFreq[2 * NP - 1], mPTCode[NPT], mTFreq[2 * NT - 1];
 
-STATIC NODE   mPos, mMatchPos, mAvail, *mPosition, *mParent, *mPrev, *mNext = NULL;
+  NODE   mPos, mMatchPos, mAvail, *mPosition, *mParent, *mPrev, *mNext;
+};
 
 
 //
 // functions
 //
 
+EFI_COMPRESS_CONTEXT *
+EfiCompressContextNew (
+  VOID
+  )
+/*++
+
+Routine Description:
+
+  Allocate a compression context. The context holds all of the working
+  state of the compressor, so any number of them can be used at once from
+  different threads. It can be reused for any number of compressions.
+
+Arguments: (VOID)
+
+Returns:
+
+  The new context, or NULL if there isn't enough memory.
+
+--*/
+{
+  EFI_COMPRESS_CONTEXT *Ctx;
+
+  Ctx = calloc (1, sizeof(*Ctx));
+  if (Ctx == NULL) {
+    return NULL;
+  }
+
+  if (EFI_ERROR (AllocateMemory(Ctx))) {
+    EfiCompressContextFree(Ctx);
+    return NULL;
+  }
+
+  MakeCrcTable(Ctx);
+
+  return Ctx;
+}
+
+VOID
+EfiCompressContextFree (
+  IN      EFI_COMPRESS_CONTEXT  *Ctx
+  )
+/*++
+
+Routine Description:
+
+  Free a context allocated by EfiCompressContextNew().
+
+Arguments:
+
+  Ctx         - The context to free; may be NULL.
+
+Returns: (VOID)
+
+--*/
+{
+  if (Ctx == NULL) {
+    return;
+  }
+
+  FreeMemory(Ctx);
+  free (Ctx);
+}
+
 EFI_STATUS
-EfiCompress (
+EfiCompressWithContext (
+  IN      EFI_COMPRESS_CONTEXT  *Ctx,
   IN      UINT8   *SrcBuffer,
   IN      UINT32  SrcSize,
   IN      UINT8   *DstBuffer,
@@ -287,10 +382,11 @@ EfiCompress (
 
 Routine Description:
 
-  The main compression routine.
+  The main compression routine, using the caller's context.
 
 Arguments:
 
+  Ctx         - A context from EfiCompressContextNew()
   SrcBuffer   - The buffer storing the source data
   SrcSize     - The size of source data
   DstBuffer   - The buffer to store the compressed data
@@ -310,35 +406,29 @@ Returns:
   //
   // Initializations
   //
-  mBufSiz = 0;
-  mBuf = NULL;
-  mText       = NULL;
-  mLevel      = NULL;
-  mChildCount = NULL;
-  mPosition   = NULL;
-  mParent     = NULL;
-  mPrev       = NULL;
-  mNext       = NULL;
-
-
-  mSrc = SrcBuffer;
-  mSrcUpperLimit = mSrc + SrcSize;
-  mDst = DstBuffer;
-  mDstUpperLimit = mDst + *DstSize;
+  Ctx->mSrc = SrcBuffer;
+  Ctx->mSrcUpperLimit = Ctx->mSrc + SrcSize;
+  Ctx->mDst = DstBuffer;
+  Ctx->mDstUpperLimit = Ctx->mDst + *DstSize;
 
-  PutDword(0L);
-  PutDword(0L);
+  PutDword(Ctx, 0L);
+  PutDword(Ctx, 0L);
 
-  MakeCrcTable ();
+  Ctx->mOrigSize = Ctx->mCompSize = 0;
+  Ctx->mCrc = INIT_CRC;
 
-  mOrigSize = mCompSize = 0;
-  mCrc = INIT_CRC;
+  //
+  // Start from a clean window, so the output only depends on the input
+  //
+  memset (Ctx->mText, 0, WNDSIZ * 2 + MAXMATCH);
+  Ctx->mBuf[0] = 0;
+  Ctx->mDepth = 0;
 
   //
   // Compress it
   //
 
-  Status = Encode();
+  Status = Encode(Ctx);
   if (EFI_ERROR (Status)) {
     return EFI_OUT_OF_RESOURCES;
   }
@@ -346,34 +436,78 @@ Returns:
   //
   // Null terminate the compressed data
   //
-  if (mDst < mDstUpperLimit) {
-    *mDst++ = 0;
+  if (Ctx->mDst < Ctx->mDstUpperLimit) {
+    *Ctx->mDst++ = 0;
   }
 
   //
   // Fill in compressed size and original size
   //
-  mDst = DstBuffer;
-  PutDword(mCompSize+1);
-  PutDword(mOrigSize);
+  Ctx->mDst = DstBuffer;
+  PutDword(Ctx, Ctx->mCompSize+1);
+  PutDword(Ctx, Ctx->mOrigSize);
 
   //
   // Return
   //
 
-  if (mCompSize + 1 + 8 > *DstSize) {
-    *DstSize = mCompSize + 1 + 8;
+  if (Ctx->mCompSize + 1 + 8 > *DstSize) {
+    *DstSize = Ctx->mCompSize + 1 + 8;
     return EFI_BUFFER_TOO_SMALL;
   } else {
-    *DstSize = mCompSize + 1 + 8;
+    *DstSize = Ctx->mCompSize + 1 + 8;
     return EFI_SUCCESS;
   }
 
 }
 
+EFI_STATUS
+EfiCompress (
+  IN      UINT8   *SrcBuffer,
+  IN      UINT32  SrcSize,
+  IN      UINT8   *DstBuffer,
+  IN OUT  UINT32  *DstSize
+  )
+/*++
+
+Routine Description:
+
+  The main compression routine, with a temporary context.
+
+Arguments:
+
+  SrcBuffer   - The buffer storing the source data
+  SrcSize     - The size of source data
+  DstBuffer   - The buffer to store the compressed data
+  DstSize     - On input, the size of DstBuffer; On output,
+                the size of the actual compressed data.
+
+Returns:
+
+  EFI_BUFFER_TOO_SMALL  - The DstBuffer is too small. In this case,
+                DstSize contains the size needed.
+  EFI_OUT_OF_RESOURCES  - Not enough memory for a context.
+  EFI_SUCCESS           - Compression is successful.
+
+--*/
+{
+  EFI_COMPRESS_CONTEXT *Ctx;
+  EFI_STATUS Status;
+
+  Ctx = EfiCompressContextNew();
+  if (Ctx == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = EfiCompressWithContext(Ctx, SrcBuffer, SrcSize, DstBuffer, DstSize);
+  EfiCompressContextFree(Ctx);
+  return Status;
+}
+
 STATIC
 VOID
 PutDword(
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   IN UINT32 Data
   )
 /*++
@@ -390,26 +524,28 @@ Returns: (VOID)
 
 --*/
 {
-  if (mDst < mDstUpperLimit) {
-    *mDst++ = (UINT8)(((UINT8)(Data        )) & 0xff);
+  if (Ctx->mDst < Ctx->mDstUpperLimit) {
+    *Ctx->mDst++ = (UINT8)(((UINT8)(Data        )) & 0xff);
   }
 
-  if (mDst < mDstUpperLimit) {
-    *mDst++ = (UINT8)(((UINT8)(Data >> 0x08)) & 0xff);
+  if (Ctx->mDst < Ctx->mDstUpperLimit) {
+    *Ctx->mDst++ = (UINT8)(((UINT8)(Data >> 0x08)) & 0xff);
   }
 
-  if (mDst < mDstUpperLimit) {
-    *mDst++ = (UINT8)(((UINT8)(Data >> 0x10)) & 0xff);
+  if (Ctx->mDst < Ctx->mDstUpperLimit) {
+    *Ctx->mDst++ = (UINT8)(((UINT8)(Data >> 0x10)) & 0xff);
   }
 
-  if (mDst < mDstUpperLimit) {
-    *mDst++ = (UINT8)(((UINT8)(Data >> 0x18)) & 0xff);
+  if (Ctx->mDst < Ctx->mDstUpperLimit) {
+    *Ctx->mDst++ = (UINT8)(((UINT8)(Data >> 0x18)) & 0xff);
   }
 }
 
 STATIC
 EFI_STATUS
-AllocateMemory ()
+AllocateMemory (
+  IN EFI_COMPRESS_CONTEXT *Ctx
+  )
 /*++
 
 Routine Description:
@@ -425,34 +561,34 @@ Returns:
 
 --*/
 {
-  UINT32      i;
-
-  mText       = malloc (WNDSIZ * 2 + MAXMATCH);
-  for (i = 0 ; i < WNDSIZ * 2 + MAXMATCH; i ++) {
-    mText[i] = 0;
+  Ctx->mText       = malloc (WNDSIZ * 2 + MAXMATCH);
+  Ctx->mLevel      = malloc ((WNDSIZ + UINT8_MAX + 1) * sizeof(*Ctx->mLevel));
+  Ctx->mChildCount = malloc ((WNDSIZ + UINT8_MAX + 1) * sizeof(*Ctx->mChildCount));
+  Ctx->mPosition   = malloc ((WNDSIZ + UINT8_MAX + 1) * sizeof(*Ctx->mPosition));
+  Ctx->mParent     = malloc (WNDSIZ * 2 * sizeof(*Ctx->mParent));
+  Ctx->mPrev       = malloc (WNDSIZ * 2 * sizeof(*Ctx->mPrev));
+  Ctx->mNext       = malloc ((MAX_HASH_VAL + 1) * sizeof(*Ctx->mNext));
+  if (!Ctx->mText || !Ctx->mLevel || !Ctx->mChildCount || !Ctx->mPosition ||
+      !Ctx->mParent || !Ctx->mPrev || !Ctx->mNext) {
+    return EFI_OUT_OF_RESOURCES;
   }
 
-  mLevel      = malloc ((WNDSIZ + UINT8_MAX + 1) * sizeof(*mLevel));
-  mChildCount = malloc ((WNDSIZ + UINT8_MAX + 1) * sizeof(*mChildCount));
-  mPosition   = malloc ((WNDSIZ + UINT8_MAX + 1) * sizeof(*mPosition));
-  mParent     = malloc (WNDSIZ * 2 * sizeof(*mParent));
-  mPrev       = malloc (WNDSIZ * 2 * sizeof(*mPrev));
-  mNext       = malloc ((MAX_HASH_VAL + 1) * sizeof(*mNext));
-
-  mBufSiz = 16 * 1024U;
-  while ((mBuf = malloc(mBufSiz)) == NULL) {
-    mBufSiz = (mBufSiz / 10U) * 9U;
-    if (mBufSiz < 4 * 1024U) {
+  Ctx->mBufSiz = 16 * 1024U;
+  while ((Ctx->mBuf = malloc(Ctx->mBufSiz)) == NULL) {
+    Ctx->mBufSiz = (Ctx->mBufSiz / 10U) * 9U;
+    if (Ctx->mBufSiz < 4 * 1024U) {
       return EFI_OUT_OF_RESOURCES;
     }
   }
-  mBuf[0] = 0;
+  Ctx->mBuf[0] = 0;
 
   return EFI_SUCCESS;
 }
 
 VOID
-FreeMemory ()
+FreeMemory (
+  IN EFI_COMPRESS_CONTEXT *Ctx
+  )
 /*++
 
 Routine Description:
@@ -465,36 +601,36 @@ Returns: (VOID)
 
 --*/
 {
-  if (mText) {
-    free (mText);
+  if (Ctx->mText) {
+    free (Ctx->mText);
   }
 
-  if (mLevel) {
-    free (mLevel);
+  if (Ctx->mLevel) {
+    free (Ctx->mLevel);
   }
 
-  if (mChildCount) {
-    free (mChildCount);
+  if (Ctx->mChildCount) {
+    free (Ctx->mChildCount);
   }
 
-  if (mPosition) {
-    free (mPosition);
+  if (Ctx->mPosition) {
+    free (Ctx->mPosition);
   }
 
-  if (mParent) {
-    free (mParent);
+  if (Ctx->mParent) {
+    free (Ctx->mParent);
   }
 
-  if (mPrev) {
-    free (mPrev);
+  if (Ctx->mPrev) {
+    free (Ctx->mPrev);
   }
 
-  if (mNext) {
-    free (mNext);
+  if (Ctx->mNext) {
+    free (Ctx->mNext);
   }
 
-  if (mBuf) {
-    free (mBuf);
+  if (Ctx->mBuf) {
+    free (Ctx->mBuf);
   }
 
   return;
@@ -503,7 +639,9 @@ Returns: (VOID)
 
 STATIC
 VOID
-InitSlide ()
+InitSlide (
+  IN EFI_COMPRESS_CONTEXT *Ctx
+  )
 /*++
 
 Routine Description:
@@ -519,20 +657,20 @@ Returns: (VOID)
   NODE i;
 
   for (i = WNDSIZ; i <= WNDSIZ + UINT8_MAX; i++) {
-    mLevel[i] = 1;
-    mPosition[i] = NIL;  /* sentinel */
+    Ctx->mLevel[i] = 1;
+    Ctx->mPosition[i] = NIL;  /* sentinel */
   }
   for (i = WNDSIZ; i < WNDSIZ * 2; i++) {
-    mParent[i] = NIL;
+    Ctx->mParent[i] = NIL;
   }
-  mAvail = 1;
+  Ctx->mAvail = 1;
   for (i = 1; i < WNDSIZ - 1; i++) {
-    mNext[i] = (NODE)(i + 1);
+    Ctx->mNext[i] = (NODE)(i + 1);
   }
 
-  mNext[WNDSIZ - 1] = NIL;
+  Ctx->mNext[WNDSIZ - 1] = NIL;
   for (i = WNDSIZ * 2; i <= MAX_HASH_VAL; i++) {
-    mNext[i] = NIL;
+    Ctx->mNext[i] = NIL;
   }
 }
 
@@ -540,6 +678,7 @@ Returns: (VOID)
 STATIC
 NODE
 Child (
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   IN NODE q,
   IN UINT8 c
   )
@@ -562,10 +701,10 @@ Returns:
 {
   NODE r;
 
-  r = mNext[HASH(q, c)];
-  mParent[NIL] = q;  /* sentinel */
-  while (mParent[r] != q) {
-    r = mNext[r];
+  r = Ctx->mNext[HASH(q, c)];
+  Ctx->mParent[NIL] = q;  /* sentinel */
+  while (Ctx->mParent[r] != q) {
+    r = Ctx->mNext[r];
   }
 
   return r;
@@ -574,6 +713,7 @@ Returns:
 STATIC
 VOID
 MakeChild (
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   IN NODE q,
   IN UINT8 c,
   IN NODE r
@@ -597,18 +737,19 @@ Returns: (VOID)
   NODE h, t;
 
   h = (NODE)HASH(q, c);
-  t = mNext[h];
-  mNext[h] = r;
-  mNext[r] = t;
-  mPrev[t] = r;
-  mPrev[r] = h;
-  mParent[r] = q;
-  mChildCount[q]++;
+  t = Ctx->mNext[h];
+  Ctx->mNext[h] = r;
+  Ctx->mNext[r] = t;
+  Ctx->mPrev[t] = r;
+  Ctx->mPrev[r] = h;
+  Ctx->mParent[r] = q;
+  Ctx->mChildCount[q]++;
 }
 
 STATIC
 VOID
 Split (
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   NODE Old
   )
 /*++
@@ -627,25 +768,27 @@ Returns: (VOID)
 {
   NODE New, t;
 
-  New = mAvail;
-  mAvail = mNext[New];
-  mChildCount[New] = 0;
-  t = mPrev[Old];
-  mPrev[New] = t;
-  mNext[t] = New;
-  t = mNext[Old];
-  mNext[New] = t;
-  mPrev[t] = New;
-  mParent[New] = mParent[Old];
-  mLevel[New] = (UINT8)mMatchLen;
-  mPosition[New] = mPos;
-  MakeChild(New, mText[mMatchPos + mMatchLen], Old);
-  MakeChild(New, mText[mPos + mMatchLen], mPos);
+  New = Ctx->mAvail;
+  Ctx->mAvail = Ctx->mNext[New];
+  Ctx->mChildCount[New] = 0;
+  t = Ctx->mPrev[Old];
+  Ctx->mPrev[New] = t;
+  Ctx->mNext[t] = New;
+  t = Ctx->mNext[Old];
+  Ctx->mNext[New] = t;
+  Ctx->mPrev[t] = New;
+  Ctx->mParent[New] = Ctx->mParent[Old];
+  Ctx->mLevel[New] = (UINT8)Ctx->mMatchLen;
+  Ctx->mPosition[New] = Ctx->mPos;
+  MakeChild(Ctx, New, Ctx->mText[Ctx->mMatchPos + Ctx->mMatchLen], Old);
+  MakeChild(Ctx, New, Ctx->mText[Ctx->mPos + Ctx->mMatchLen], Ctx->mPos);
 }
 
 STATIC
 VOID
-InsertNode ()
+InsertNode (
+  IN EFI_COMPRESS_CONTEXT *Ctx
+  )
 /*++
 
 Routine Description:
@@ -661,31 +804,31 @@ Returns: (VOID)
   NODE q, r, j, t;
   UINT8 c, *t1, *t2;
 
-  if (mMatchLen >= 4) {
+  if (Ctx->mMatchLen >= 4) {
 
     //
     // We have just got a long match, the target tree
     // can be located by MatchPos + 1. Travese the tree
     // from bottom up to get to a proper starting point.
     // The usage of PERC_FLAG ensures proper node deletion
-    // in DeleteNode() later.
+    // in DeleteNode(Ctx) later.
     //
 
-    mMatchLen--;
-    r = (INT16)((mMatchPos + 1) | WNDSIZ);
-    while ((q = mParent[r]) == NIL) {
-      r = mNext[r];
+    Ctx->mMatchLen--;
+    r = (INT16)((Ctx->mMatchPos + 1) | WNDSIZ);
+    while ((q = Ctx->mParent[r]) == NIL) {
+      r = Ctx->mNext[r];
     }
-    while (mLevel[q] >= mMatchLen) {
-      r = q;  q = mParent[q];
+    while (Ctx->mLevel[q] >= Ctx->mMatchLen) {
+      r = q;  q = Ctx->mParent[q];
     }
     t = q;
-    while (mPosition[t] < 0) {
-      mPosition[t] = mPos;
-      t = mParent[t];
+    while (Ctx->mPosition[t] < 0) {
+      Ctx->mPosition[t] = Ctx->mPos;
+      t = Ctx->mParent[t];
     }
     if (t < WNDSIZ) {
-      mPosition[t] = (NODE)(mPos | PERC_FLAG);
+      Ctx->mPosition[t] = (NODE)(Ctx->mPos | PERC_FLAG);
     }
   } else {
 
@@ -693,14 +836,14 @@ Returns: (VOID)
     // Locate the target tree
     //
 
-    q = (INT16)(mText[mPos] + WNDSIZ);
-    c = mText[mPos + 1];
-    if ((r = Child(q, c)) == NIL) {
-      MakeChild(q, c, mPos);
-      mMatchLen = 1;
+    q = (INT16)(Ctx->mText[Ctx->mPos] + WNDSIZ);
+    c = Ctx->mText[Ctx->mPos + 1];
+    if ((r = Child(Ctx, q, c)) == NIL) {
+      MakeChild(Ctx, q, c, Ctx->mPos);
+      Ctx->mMatchLen = 1;
       return;
     }
-    mMatchLen = 2;
+    Ctx->mMatchLen = 2;
   }
 
   //
@@ -712,55 +855,57 @@ Returns: (VOID)
   for ( ; ; ) {
     if (r >= WNDSIZ) {
       j = MAXMATCH;
-      mMatchPos = r;
+      Ctx->mMatchPos = r;
     } else {
-      j = mLevel[r];
-      mMatchPos = (NODE)(mPosition[r] & ~PERC_FLAG);
+      j = Ctx->mLevel[r];
+      Ctx->mMatchPos = (NODE)(Ctx->mPosition[r] & ~PERC_FLAG);
     }
-    if (mMatchPos >= mPos) {
-      mMatchPos -= WNDSIZ;
+    if (Ctx->mMatchPos >= Ctx->mPos) {
+      Ctx->mMatchPos -= WNDSIZ;
     }
-    t1 = &mText[mPos + mMatchLen];
-    t2 = &mText[mMatchPos + mMatchLen];
-    while (mMatchLen < j) {
+    t1 = &Ctx->mText[Ctx->mPos + Ctx->mMatchLen];
+    t2 = &Ctx->mText[Ctx->mMatchPos + Ctx->mMatchLen];
+    while (Ctx->mMatchLen < j) {
       if (*t1 != *t2) {
-        Split(r);
+        Split(Ctx, r);
         return;
       }
-      mMatchLen++;
+      Ctx->mMatchLen++;
       t1++;
       t2++;
     }
-    if (mMatchLen >= MAXMATCH) {
+    if (Ctx->mMatchLen >= MAXMATCH) {
       break;
     }
-    mPosition[r] = mPos;
+    Ctx->mPosition[r] = Ctx->mPos;
     q = r;
-    if ((r = Child(q, *t1)) == NIL) {
-      MakeChild(q, *t1, mPos);
+    if ((r = Child(Ctx, q, *t1)) == NIL) {
+      MakeChild(Ctx, q, *t1, Ctx->mPos);
       return;
     }
-    mMatchLen++;
+    Ctx->mMatchLen++;
   }
-  t = mPrev[r];
-  mPrev[mPos] = t;
-  mNext[t] = mPos;
-  t = mNext[r];
-  mNext[mPos] = t;
-  mPrev[t] = mPos;
-  mParent[mPos] = q;
-  mParent[r] = NIL;
+  t = Ctx->mPrev[r];
+  Ctx->mPrev[Ctx->mPos] = t;
+  Ctx->mNext[t] = Ctx->mPos;
+  t = Ctx->mNext[r];
+  Ctx->mNext[Ctx->mPos] = t;
+  Ctx->mPrev[t] = Ctx->mPos;
+  Ctx->mParent[Ctx->mPos] = q;
+  Ctx->mParent[r] = NIL;
 
   //
   // Special usage of 'next'
   //
-  mNext[r] = mPos;
+  Ctx->mNext[r] = Ctx->mPos;
 
 }
 
 STATIC
 VOID
-DeleteNode ()
+DeleteNode (
+  IN EFI_COMPRESS_CONTEXT *Ctx
+  )
 /*++
 
 Routine Description:
@@ -776,65 +921,67 @@ Returns: (VOID)
 {
   NODE q, r, s, t, u;
 
-  if (mParent[mPos] == NIL) {
+  if (Ctx->mParent[Ctx->mPos] == NIL) {
     return;
   }
 
-  r = mPrev[mPos];
-  s = mNext[mPos];
-  mNext[r] = s;
-  mPrev[s] = r;
-  r = mParent[mPos];
-  mParent[mPos] = NIL;
-  if (r >= WNDSIZ || --mChildCount[r] > 1) {
+  r = Ctx->mPrev[Ctx->mPos];
+  s = Ctx->mNext[Ctx->mPos];
+  Ctx->mNext[r] = s;
+  Ctx->mPrev[s] = r;
+  r = Ctx->mParent[Ctx->mPos];
+  Ctx->mParent[Ctx->mPos] = NIL;
+  if (r >= WNDSIZ || --Ctx->mChildCount[r] > 1) {
     return;
   }
-  t = (NODE)(mPosition[r] & ~PERC_FLAG);
-  if (t >= mPos) {
+  t = (NODE)(Ctx->mPosition[r] & ~PERC_FLAG);
+  if (t >= Ctx->mPos) {
     t -= WNDSIZ;
   }
   s = t;
-  q = mParent[r];
-  while ((u = mPosition[q]) & PERC_FLAG) {
+  q = Ctx->mParent[r];
+  while ((u = Ctx->mPosition[q]) & PERC_FLAG) {
     u &= ~PERC_FLAG;
-    if (u >= mPos) {
+    if (u >= Ctx->mPos) {
       u -= WNDSIZ;
     }
     if (u > s) {
       s = u;
     }
-    mPosition[q] = (INT16)(s | WNDSIZ);
-    q = mParent[q];
+    Ctx->mPosition[q] = (INT16)(s | WNDSIZ);
+    q = Ctx->mParent[q];
   }
   if (q < WNDSIZ) {
-    if (u >= mPos) {
+    if (u >= Ctx->mPos) {
       u -= WNDSIZ;
     }
     if (u > s) {
       s = u;
     }
-    mPosition[q] = (INT16)(s | WNDSIZ | PERC_FLAG);
-  }
-  s = Child(r, mText[t + mLevel[r]]);
-  t = mPrev[s];
-  u = mNext[s];
-  mNext[t] = u;
-  mPrev[u] = t;
-  t = mPrev[r];
-  mNext[t] = s;
-  mPrev[s] = t;
-  t = mNext[r];
-  mPrev[t] = s;
-  mNext[s] = t;
-  mParent[s] = mParent[r];
-  mParent[r] = NIL;
-  mNext[r] = mAvail;
-  mAvail = r;
+    Ctx->mPosition[q] = (INT16)(s | WNDSIZ | PERC_FLAG);
+  }
+  s = Child(Ctx, r, Ctx->mText[t + Ctx->mLevel[r]]);
+  t = Ctx->mPrev[s];
+  u = Ctx->mNext[s];
+  Ctx->mNext[t] = u;
+  Ctx->mPrev[u] = t;
+  t = Ctx->mPrev[r];
+  Ctx->mNext[t] = s;
+  Ctx->mPrev[s] = t;
+  t = Ctx->mNext[r];
+  Ctx->mPrev[t] = s;
+  Ctx->mNext[s] = t;
+  Ctx->mParent[s] = Ctx->mParent[r];
+  Ctx->mParent[r] = NIL;
+  Ctx->mNext[r] = Ctx->mAvail;
+  Ctx->mAvail = r;
 }
 
 STATIC
 VOID
-GetNextMatch ()
+GetNextMatch (
+  IN EFI_COMPRESS_CONTEXT *Ctx
+  )
 /*++
 
 Routine Description:
@@ -850,20 +997,22 @@ Returns: (VOID)
 {
   INT32 n;
 
-  mRemainder--;
-  if (++mPos == WNDSIZ * 2) {
-    memmove(&mText[0], &mText[WNDSIZ], WNDSIZ + MAXMATCH);
-    n = FreadCrc(&mText[WNDSIZ + MAXMATCH], WNDSIZ);
-    mRemainder += n;
-    mPos = WNDSIZ;
+  Ctx->mRemainder--;
+  if (++Ctx->mPos == WNDSIZ * 2) {
+    memmove(&Ctx->mText[0], &Ctx->mText[WNDSIZ], WNDSIZ + MAXMATCH);
+    n = FreadCrc(Ctx, &Ctx->mText[WNDSIZ + MAXMATCH], WNDSIZ);
+    Ctx->mRemainder += n;
+    Ctx->mPos = WNDSIZ;
   }
-  DeleteNode();
-  InsertNode();
+  DeleteNode(Ctx);
+  InsertNode(Ctx);
 }
 
 STATIC
 EFI_STATUS
-Encode ()
+Encode (
+  IN EFI_COMPRESS_CONTEXT *Ctx
+  )
 /*++
 
 Routine Description:
@@ -875,73 +1024,66 @@ Arguments: (VOID)
 Returns:
 
   EFI_SUCCESS           - The compression is successful
-  EFI_OUT_0F_RESOURCES  - Not enough memory for compression process
 
 --*/
 {
-  EFI_STATUS  Status;
   INT32       LastMatchLen;
   NODE        LastMatchPos;
 
-  Status = AllocateMemory();
-  if (EFI_ERROR(Status)) {
-    FreeMemory();
-    return Status;
-  }
+  InitSlide(Ctx);
 
-  InitSlide();
+  HufEncodeStart(Ctx);
 
-  HufEncodeStart();
+  Ctx->mRemainder = FreadCrc(Ctx, &Ctx->mText[WNDSIZ], WNDSIZ + MAXMATCH);
 
-  mRemainder = FreadCrc(&mText[WNDSIZ], WNDSIZ + MAXMATCH);
-
-  mMatchLen = 0;
-  mPos = WNDSIZ;
-  InsertNode();
-  if (mMatchLen > mRemainder) {
-    mMatchLen = mRemainder;
+  Ctx->mMatchLen = 0;
+  Ctx->mPos = WNDSIZ;
+  InsertNode(Ctx);
+  if (Ctx->mMatchLen > Ctx->mRemainder) {
+    Ctx->mMatchLen = Ctx->mRemainder;
   }
-  while (mRemainder > 0) {
-    LastMatchLen = mMatchLen;
-    LastMatchPos = mMatchPos;
-    GetNextMatch();
-    if (mMatchLen > mRemainder) {
-      mMatchLen = mRemainder;
+  while (Ctx->mRemainder > 0) {
+    LastMatchLen = Ctx->mMatchLen;
+    LastMatchPos = Ctx->mMatchPos;
+    GetNextMatch(Ctx);
+    if (Ctx->mMatchLen > Ctx->mRemainder) {
+      Ctx->mMatchLen = Ctx->mRemainder;
     }
 
-    if (mMatchLen > LastMatchLen || LastMatchLen < THRESHOLD) {
+    if (Ctx->mMatchLen > LastMatchLen || LastMatchLen < THRESHOLD) {
 
       //
       // Not enough benefits are gained by outputting a pointer,
       // so just output the original character
       //
 
-      Output(mText[mPos - 1], 0);
+      Output(Ctx, Ctx->mText[Ctx->mPos - 1], 0);
     } else {
 
       //
       // Outputting a pointer is beneficial enough, do it.
       //
 
-      Output(LastMatchLen + (UINT8_MAX + 1 - THRESHOLD),
-             (mPos - LastMatchPos - 2) & (WNDSIZ - 1));
+      Output(Ctx, LastMatchLen + (UINT8_MAX + 1 - THRESHOLD),
+             (Ctx->mPos - LastMatchPos - 2) & (WNDSIZ - 1));
       while (--LastMatchLen > 0) {
-        GetNextMatch();
+        GetNextMatch(Ctx);
       }
-      if (mMatchLen > mRemainder) {
-        mMatchLen = mRemainder;
+      if (Ctx->mMatchLen > Ctx->mRemainder) {
+        Ctx->mMatchLen = Ctx->mRemainder;
       }
     }
   }
 
-  HufEncodeEnd();
-  FreeMemory();
+  HufEncodeEnd(Ctx);
   return EFI_SUCCESS;
 }
 
 STATIC
 VOID
-CountTFreq ()
+CountTFreq (
+  IN EFI_COMPRESS_CONTEXT *Ctx
+  )
 /*++
 
 Routine Description:
@@ -957,33 +1099,33 @@ Returns: (VOID)
   INT32 i, k, n, Count;
 
   for (i = 0; i < NT; i++) {
-    mTFreq[i] = 0;
+    Ctx->mTFreq[i] = 0;
   }
   n = NC;
-  while (n > 0 && mCLen[n - 1] == 0) {
+  while (n > 0 && Ctx->mCLen[n - 1] == 0) {
     n--;
   }
   i = 0;
   while (i < n) {
-    k = mCLen[i++];
+    k = Ctx->mCLen[i++];
     if (k == 0) {
       Count = 1;
-      while (i < n && mCLen[i] == 0) {
+      while (i < n && Ctx->mCLen[i] == 0) {
         i++;
         Count++;
       }
       if (Count <= 2) {
-        mTFreq[0] = (UINT16)(mTFreq[0] + Count);
+        Ctx->mTFreq[0] = (UINT16)(Ctx->mTFreq[0] + Count);
       } else if (Count <= 18) {
-        mTFreq[1]++;
+        Ctx->mTFreq[1]++;
       } else if (Count == 19) {
-        mTFreq[0]++;
-        mTFreq[1]++;
+        Ctx->mTFreq[0]++;
+        Ctx->mTFreq[1]++;
       } else {
-        mTFreq[2]++;
+        Ctx->mTFreq[2]++;
       }
     } else {
-      mTFreq[k + 2]++;
+      Ctx->mTFreq[k + 2]++;
     }
   }
 }
@@ -991,6 +1133,7 @@ Returns: (VOID)
 STATIC
 VOID
 WritePTLen (
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   IN INT32 n,
   IN INT32 nbit,
   IN INT32 Special
@@ -1013,30 +1156,32 @@ Returns: (VOID)
 {
   INT32 i, k;
 
-  while (n > 0 && mPTLen[n - 1] == 0) {
+  while (n > 0 && Ctx->mPTLen[n - 1] == 0) {
     n--;
   }
-  PutBits(nbit, n);
+  PutBits(Ctx, nbit, n);
   i = 0;
   while (i < n) {
-    k = mPTLen[i++];
+    k = Ctx->mPTLen[i++];
     if (k <= 6) {
-      PutBits(3, k);
+      PutBits(Ctx, 3, k);
     } else {
-      PutBits(k - 3, (1U << (k - 3)) - 2);
+      PutBits(Ctx, k - 3, (1U << (k - 3)) - 2);
     }
     if (i == Special) {
-      while (i < 6 && mPTLen[i] == 0) {
+      while (i < 6 && Ctx->mPTLen[i] == 0) {
         i++;
       }
-      PutBits(2, (i - 3) & 3);
+      PutBits(Ctx, 2, (i - 3) & 3);
     }
   }
 }
 
 STATIC
 VOID
-WriteCLen ()
+WriteCLen (
+  IN EFI_COMPRESS_CONTEXT *Ctx
+  )
 /*++
 
 Routine Description:
@@ -1052,36 +1197,36 @@ Returns: (VOID)
   INT32 i, k, n, Count;
 
   n = NC;
-  while (n > 0 && mCLen[n - 1] == 0) {
+  while (n > 0 && Ctx->mCLen[n - 1] == 0) {
     n--;
   }
-  PutBits(CBIT, n);
+  PutBits(Ctx, CBIT, n);
   i = 0;
   while (i < n) {
-    k = mCLen[i++];
+    k = Ctx->mCLen[i++];
     if (k == 0) {
       Count = 1;
-      while (i < n && mCLen[i] == 0) {
+      while (i < n && Ctx->mCLen[i] == 0) {
         i++;
         Count++;
       }
       if (Count <= 2) {
         for (k = 0; k < Count; k++) {
-          PutBits(mPTLen[0], mPTCode[0]);
+          PutBits(Ctx, Ctx->mPTLen[0], Ctx->mPTCode[0]);
         }
       } else if (Count <= 18) {
-        PutBits(mPTLen[1], mPTCode[1]);
-        PutBits(4, Count - 3);
+        PutBits(Ctx, Ctx->mPTLen[1], Ctx->mPTCode[1]);
+        PutBits(Ctx, 4, Count - 3);
       } else if (Count == 19) {
-        PutBits(mPTLen[0], mPTCode[0]);
-        PutBits(mPTLen[1], mPTCode[1]);
-        PutBits(4, 15);
+        PutBits(Ctx, Ctx->mPTLen[0], Ctx->mPTCode[0]);
+        PutBits(Ctx, Ctx->mPTLen[1], Ctx->mPTCode[1]);
+        PutBits(Ctx, 4, 15);
       } else {
-        PutBits(mPTLen[2], mPTCode[2]);
-        PutBits(CBIT, Count - 20);
+        PutBits(Ctx, Ctx->mPTLen[2], Ctx->mPTCode[2]);
+        PutBits(Ctx, CBIT, Count - 20);
       }
     } else {
-      PutBits(mPTLen[k + 2], mPTCode[k + 2]);
+      PutBits(Ctx, Ctx->mPTLen[k + 2], Ctx->mPTCode[k + 2]);
     }
   }
 }
@@ -1089,15 +1234,17 @@ Returns: (VOID)
 STATIC
 VOID
 EncodeC (
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   IN INT32 c
   )
 {
-  PutBits(mCLen[c], mCCode[c]);
+  PutBits(Ctx, Ctx->mCLen[c], Ctx->mCCode[c]);
 }
 
 STATIC
 VOID
 EncodeP (
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   IN UINT32 p
   )
 {
@@ -1109,15 +1256,17 @@ EncodeP (
     q >>= 1;
     c++;
   }
-  PutBits(mPTLen[c], mPTCode[c]);
+  PutBits(Ctx, Ctx->mPTLen[c], Ctx->mPTCode[c]);
   if (c > 1) {
-    PutBits(c - 1, p & (0xFFFFU >> (17 - c)));
+    PutBits(Ctx, c - 1, p & (0xFFFFU >> (17 - c)));
   }
 }
 
 STATIC
 VOID
-SendBlock ()
+SendBlock (
+  IN EFI_COMPRESS_CONTEXT *Ctx
+  )
 /*++
 
 Routine Description:
@@ -1133,53 +1282,53 @@ Returns: (VOID)
   UINT32 i, k, Flags, Root, Pos, Size;
   Flags = 0;
 
-  Root = MakeTree(NC, mCFreq, mCLen, mCCode);
-  Size = mCFreq[Root];
-  PutBits(16, Size);
+  Root = MakeTree(Ctx, NC, Ctx->mCFreq, Ctx->mCLen, Ctx->mCCode);
+  Size = Ctx->mCFreq[Root];
+  PutBits(Ctx, 16, Size);
   if (Root >= NC) {
-    CountTFreq();
-    Root = MakeTree(NT, mTFreq, mPTLen, mPTCode);
+    CountTFreq(Ctx);
+    Root = MakeTree(Ctx, NT, Ctx->mTFreq, Ctx->mPTLen, Ctx->mPTCode);
     if (Root >= NT) {
-      WritePTLen(NT, TBIT, 3);
+      WritePTLen(Ctx, NT, TBIT, 3);
     } else {
-      PutBits(TBIT, 0);
-      PutBits(TBIT, Root);
+      PutBits(Ctx, TBIT, 0);
+      PutBits(Ctx, TBIT, Root);
     }
-    WriteCLen();
+    WriteCLen(Ctx);
   } else {
-    PutBits(TBIT, 0);
-    PutBits(TBIT, 0);
-    PutBits(CBIT, 0);
-    PutBits(CBIT, Root);
+    PutBits(Ctx, TBIT, 0);
+    PutBits(Ctx, TBIT, 0);
+    PutBits(Ctx, CBIT, 0);
+    PutBits(Ctx, CBIT, Root);
   }
-  Root = MakeTree(NP, mPFreq, mPTLen, mPTCode);
+  Root = MakeTree(Ctx, NP, Ctx->mPFreq, Ctx->mPTLen, Ctx->mPTCode);
   if (Root >= NP) {
-    WritePTLen(NP, PBIT, -1);
+    WritePTLen(Ctx, NP, PBIT, -1);
   } else {
-    PutBits(PBIT, 0);
-    PutBits(PBIT, Root);
+    PutBits(Ctx, PBIT, 0);
+    PutBits(Ctx, PBIT, Root);
   }
   Pos = 0;
   for (i = 0; i < Size; i++) {
     if (i % UINT8_BIT == 0) {
-      Flags = mBuf[Pos++];
+      Flags = Ctx->mBuf[Pos++];
     } else {
       Flags <<= 1;
     }
     if (Flags & (1U << (UINT8_BIT - 1))) {
-      EncodeC(mBuf[Pos++] + (1U << UINT8_BIT));
-      k = mBuf[Pos++] << UINT8_BIT;
-      k += mBuf[Pos++];
-      EncodeP(k);
+      EncodeC(Ctx, Ctx->mBuf[Pos++] + (1U << UINT8_BIT));
+      k = Ctx->mBuf[Pos++] << UINT8_BIT;
+      k += Ctx->mBuf[Pos++];
+      EncodeP(Ctx, k);
     } else {
-      EncodeC(mBuf[Pos++]);
+      EncodeC(Ctx, Ctx->mBuf[Pos++]);
     }
   }
   for (i = 0; i < NC; i++) {
-    mCFreq[i] = 0;
+    Ctx->mCFreq[i] = 0;
   }
   for (i = 0; i < NP; i++) {
-    mPFreq[i] = 0;
+    Ctx->mPFreq[i] = 0;
   }
 }
 
@@ -1187,6 +1336,7 @@ Returns: (VOID)
 STATIC
 VOID
 Output (
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   IN UINT32 c,
   IN UINT32 p
   )
@@ -1205,59 +1355,61 @@ Returns: (VOID)
 
 --*/
 {
-  STATIC UINT32 CPos;
-
-  if ((mOutputMask >>= 1) == 0) {
-    mOutputMask = 1U << (UINT8_BIT - 1);
-    if (mOutputPos >= mBufSiz - 3 * UINT8_BIT) {
-      SendBlock();
-      mOutputPos = 0;
+  if ((Ctx->mOutputMask >>= 1) == 0) {
+    Ctx->mOutputMask = 1U << (UINT8_BIT - 1);
+    if (Ctx->mOutputPos >= Ctx->mBufSiz - 3 * UINT8_BIT) {
+      SendBlock(Ctx);
+      Ctx->mOutputPos = 0;
     }
-    CPos = mOutputPos++;
-    mBuf[CPos] = 0;
+    Ctx->mCPos = Ctx->mOutputPos++;
+    Ctx->mBuf[Ctx->mCPos] = 0;
   }
-  mBuf[mOutputPos++] = (UINT8) c;
-  mCFreq[c]++;
+  Ctx->mBuf[Ctx->mOutputPos++] = (UINT8) c;
+  Ctx->mCFreq[c]++;
   if (c >= (1U << UINT8_BIT)) {
-    mBuf[CPos] |= mOutputMask;
-    mBuf[mOutputPos++] = (UINT8)(p >> UINT8_BIT);
-    mBuf[mOutputPos++] = (UINT8) p;
+    Ctx->mBuf[Ctx->mCPos] |= Ctx->mOutputMask;
+    Ctx->mBuf[Ctx->mOutputPos++] = (UINT8)(p >> UINT8_BIT);
+    Ctx->mBuf[Ctx->mOutputPos++] = (UINT8) p;
     c = 0;
     while (p) {
       p >>= 1;
       c++;
     }
-    mPFreq[c]++;
+    Ctx->mPFreq[c]++;
   }
 }
 
 STATIC
 VOID
-HufEncodeStart ()
+HufEncodeStart (
+  IN EFI_COMPRESS_CONTEXT *Ctx
+  )
 {
   INT32 i;
 
   for (i = 0; i < NC; i++) {
-    mCFreq[i] = 0;
+    Ctx->mCFreq[i] = 0;
   }
   for (i = 0; i < NP; i++) {
-    mPFreq[i] = 0;
+    Ctx->mPFreq[i] = 0;
   }
-  mOutputPos = mOutputMask = 0;
-  InitPutBits();
+  Ctx->mOutputPos = Ctx->mOutputMask = 0;
+  InitPutBits(Ctx);
   return;
 }
 
 STATIC
 VOID
-HufEncodeEnd ()
+HufEncodeEnd (
+  IN EFI_COMPRESS_CONTEXT *Ctx
+  )
 {
-  SendBlock();
+  SendBlock(Ctx);
 
   //
   // Flush remaining bits
   //
-  PutBits(UINT8_BIT - 1, 0);
+  PutBits(Ctx, UINT8_BIT - 1, 0);
 
   return;
 }
@@ -1265,7 +1417,9 @@ HufEncodeEnd ()
 
 STATIC
 VOID
-MakeCrcTable ()
+MakeCrcTable (
+  IN EFI_COMPRESS_CONTEXT *Ctx
+  )
 {
   UINT32 i, j, r;
 
@@ -1278,13 +1432,14 @@ MakeCrcTable ()
         r >>= 1;
       }
     }
-    mCrcTable[i] = (UINT16)r;
+    Ctx->mCrcTable[i] = (UINT16)r;
   }
 }
 
 STATIC
 VOID
 PutBits (
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   IN INT32 n,
   IN UINT32 x
   )
@@ -1305,27 +1460,27 @@ Returns: (VOID)
 {
   UINT8 Temp;
 
-  if (n < mBitCount) {
-    mSubBitBuf |= x << (mBitCount -= n);
+  if (n < Ctx->mBitCount) {
+    Ctx->mSubBitBuf |= x << (Ctx->mBitCount -= n);
   } else {
 
-    Temp = (UINT8)(mSubBitBuf | (x >> (n -= mBitCount)));
-    if (mDst < mDstUpperLimit) {
-      *mDst++ = Temp;
+    Temp = (UINT8)(Ctx->mSubBitBuf | (x >> (n -= Ctx->mBitCount)));
+    if (Ctx->mDst < Ctx->mDstUpperLimit) {
+      *Ctx->mDst++ = Temp;
     }
-    mCompSize++;
+    Ctx->mCompSize++;
 
     if (n < UINT8_BIT) {
-      mSubBitBuf = x << (mBitCount = UINT8_BIT - n);
+      Ctx->mSubBitBuf = x << (Ctx->mBitCount = UINT8_BIT - n);
     } else {
 
       Temp = (UINT8)(x >> (n - UINT8_BIT));
-      if (mDst < mDstUpperLimit) {
-        *mDst++ = Temp;
+      if (Ctx->mDst < Ctx->mDstUpperLimit) {
+        *Ctx->mDst++ = Temp;
       }
-      mCompSize++;
+      Ctx->mCompSize++;
 
-      mSubBitBuf = x << (mBitCount = 2 * UINT8_BIT - n);
+      Ctx->mSubBitBuf = x << (Ctx->mBitCount = 2 * UINT8_BIT - n);
     }
   }
 }
@@ -1333,6 +1488,7 @@ Returns: (VOID)
 STATIC
 INT32
 FreadCrc (
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   OUT UINT8 *p,
   IN  INT32 n
   )
@@ -1355,13 +1511,13 @@ Returns:
 {
   INT32 i;
 
-  for (i = 0; mSrc < mSrcUpperLimit && i < n; i++) {
-    *p++ = *mSrc++;
+  for (i = 0; Ctx->mSrc < Ctx->mSrcUpperLimit && i < n; i++) {
+    *p++ = *Ctx->mSrc++;
   }
   n = i;
 
   p -= n;
-  mOrigSize += n;
+  Ctx->mOrigSize += n;
   while (--i >= 0) {
     UPDATE_CRC(*p++);
   }
@@ -1371,15 +1527,18 @@ Returns:
 
 STATIC
 VOID
-InitPutBits ()
+InitPutBits (
+  IN EFI_COMPRESS_CONTEXT *Ctx
+  )
 {
-  mBitCount = UINT8_BIT;
-  mSubBitBuf = 0;
+  Ctx->mBitCount = UINT8_BIT;
+  Ctx->mSubBitBuf = 0;
 }
 
 STATIC
 VOID
 CountLen (
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   IN INT32 i
   )
 /*++
@@ -1396,21 +1555,20 @@ Returns: (VOID)
 
 --*/
 {
-  STATIC INT32 Depth = 0;
-
-  if (i < mN) {
-    mLenCnt[(Depth < 16) ? Depth : 16]++;
+  if (i < Ctx->mN) {
+    Ctx->mLenCnt[(Ctx->mDepth < 16) ? Ctx->mDepth : 16]++;
   } else {
-    Depth++;
-    CountLen(mLeft [i]);
-    CountLen(mRight[i]);
-    Depth--;
+    Ctx->mDepth++;
+    CountLen(Ctx, Ctx->mLeft [i]);
+    CountLen(Ctx, Ctx->mRight[i]);
+    Ctx->mDepth--;
   }
 }
 
 STATIC
 VOID
 MakeLen (
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   IN INT32 Root
   )
 /*++
@@ -1429,9 +1587,9 @@ Arguments:
   UINT32 Cum;
 
   for (i = 0; i <= 16; i++) {
-    mLenCnt[i] = 0;
+    Ctx->mLenCnt[i] = 0;
   }
-  CountLen(Root);
+  CountLen(Ctx, Root);
 
   //
   // Adjust the length count array so that
@@ -1440,23 +1598,23 @@ Arguments:
 
   Cum = 0;
   for (i = 16; i > 0; i--) {
-    Cum += mLenCnt[i] << (16 - i);
+    Cum += Ctx->mLenCnt[i] << (16 - i);
   }
   while (Cum != (1U << 16)) {
-    mLenCnt[16]--;
+    Ctx->mLenCnt[16]--;
     for (i = 15; i > 0; i--) {
-      if (mLenCnt[i] != 0) {
-        mLenCnt[i]--;
-        mLenCnt[i+1] += 2;
+      if (Ctx->mLenCnt[i] != 0) {
+        Ctx->mLenCnt[i]--;
+        Ctx->mLenCnt[i+1] += 2;
         break;
       }
     }
     Cum--;
   }
   for (i = 16; i > 0; i--) {
-    k = mLenCnt[i];
+    k = Ctx->mLenCnt[i];
     while (--k >= 0) {
-      mLen[*mSortPtr++] = (UINT8)i;
+      Ctx->mLen[*Ctx->mSortPtr++] = (UINT8)i;
     }
   }
 }
@@ -1464,6 +1622,7 @@ Arguments:
 STATIC
 VOID
 DownHeap (
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   IN INT32 i
   )
 {
@@ -1473,23 +1632,24 @@ DownHeap (
   // priority queue: send i-th entry down heap
   //
 
-  k = mHeap[i];
-  while ((j = 2 * i) <= mHeapSize) {
-    if (j < mHeapSize && mFreq[mHeap[j]] > mFreq[mHeap[j + 1]]) {
+  k = Ctx->mHeap[i];
+  while ((j = 2 * i) <= Ctx->mHeapSize) {
+    if (j < Ctx->mHeapSize && Ctx->mFreq[Ctx->mHeap[j]] > Ctx->mFreq[Ctx->mHeap[j + 1]]) {
       j++;
     }
-    if (mFreq[k] <= mFreq[mHeap[j]]) {
+    if (Ctx->mFreq[k] <= Ctx->mFreq[Ctx->mHeap[j]]) {
       break;
     }
-    mHeap[i] = mHeap[j];
+    Ctx->mHeap[i] = Ctx->mHeap[j];
     i = j;
   }
-  mHeap[i] = (INT16)k;
+  Ctx->mHeap[i] = (INT16)k;
 }
 
 STATIC
 VOID
 MakeCode (
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   IN  INT32 n,
   IN  UINT8 Len[],
   OUT UINT16 Code[]
@@ -1515,7 +1675,7 @@ Returns: (VOID)
 
   Start[1] = 0;
   for (i = 1; i <= 16; i++) {
-    Start[i + 1] = (UINT16)((Start[i] + mLenCnt[i]) << 1);
+    Start[i + 1] = (UINT16)((Start[i] + Ctx->mLenCnt[i]) << 1);
   }
   for (i = 0; i < n; i++) {
     Code[i] = Start[Len[i]]++;
@@ -1525,6 +1685,7 @@ Returns: (VOID)
 STATIC
 INT32
 MakeTree (
+  IN EFI_COMPRESS_CONTEXT *Ctx,
   IN  INT32   NParm,
   IN  UINT16  FreqParm[],
   OUT UINT8   LenParm[],
@@ -1555,52 +1716,52 @@ Returns:
   // make tree, calculate len[], return root
   //
 
-  mN = NParm;
-  mFreq = FreqParm;
-  mLen = LenParm;
-  Avail = mN;
-  mHeapSize = 0;
-  mHeap[1] = 0;
-  for (i = 0; i < mN; i++) {
-    mLen[i] = 0;
-    if (mFreq[i]) {
-      mHeap[++mHeapSize] = (INT16)i;
+  Ctx->mN = NParm;
+  Ctx->mFreq = FreqParm;
+  Ctx->mLen = LenParm;
+  Avail = Ctx->mN;
+  Ctx->mHeapSize = 0;
+  Ctx->mHeap[1] = 0;
+  for (i = 0; i < Ctx->mN; i++) {
+    Ctx->mLen[i] = 0;
+    if (Ctx->mFreq[i]) {
+      Ctx->mHeap[++Ctx->mHeapSize] = (INT16)i;
     }
   }
-  if (mHeapSize < 2) {
-    CodeParm[mHeap[1]] = 0;
-    return mHeap[1];
+  if (Ctx->mHeapSize < 2) {
+    CodeParm[Ctx->mHeap[1]] = 0;
+    return Ctx->mHeap[1];
   }
-  for (i = mHeapSize / 2; i >= 1; i--) {
+  for (i = Ctx->mHeapSize / 2; i >= 1; i--) {
 
     //
     // make priority queue
     //
-    DownHeap(i);
+    DownHeap(Ctx, i);
   }
-  mSortPtr = CodeParm;
+  Ctx->mSortPtr = CodeParm;
   do {
-    i = mHeap[1];
-    if (i < mN) {
-      *mSortPtr++ = (UINT16)i;
+    i = Ctx->mHeap[1];
+    if (i < Ctx->mN) {
+      *Ctx->mSortPtr++ = (UINT16)i;
     }
-    mHeap[1] = mHeap[mHeapSize--];
-    DownHeap(1);
-    j = mHeap[1];
-    if (j < mN) {
-      *mSortPtr++ = (UINT16)j;
+    Ctx->mHeap[1] = Ctx->mHeap[Ctx->mHeapSize--];
+    DownHeap(Ctx, 1);
+    j = Ctx->mHeap[1];
+    if (j < Ctx->mN) {
+      *Ctx->mSortPtr++ = (UINT16)j;
     }
     k = Avail++;
-    mFreq[k] = (UINT16)(mFreq[i] + mFreq[j]);
-    mHeap[1] = (INT16)k;
-    DownHeap(1);
-    mLeft[k] = (UINT16)i;
-    mRight[k] = (UINT16)j;
-  } while (mHeapSize > 1);
-
-  mSortPtr = CodeParm;
-  MakeLen(k);
-  MakeCode(NParm, LenParm, CodeParm);
+    Ctx->mFreq[k] = (UINT16)(Ctx->mFreq[i] + Ctx->mFreq[j]);
+    Ctx->mHeap[1] = (INT16)k;
+    DownHeap(Ctx, 1);
+    Ctx->mLeft[k] = (UINT16)i;
+    Ctx->mRight[k] = (UINT16)j;
+  } while (Ctx->mHeapSize > 1);
+
+  Ctx->mSortPtr = CodeParm;
+  MakeLen(Ctx, k);
+  MakeCode(Ctx, NParm, LenParm, CodeParm);
 
   //
   // return root
@@ -66,9 +66,9 @@ typedef struct {
   UINT32  mOutBuf;
   UINT32  mInBuf;
 
-  UINT16  mBitCount;
-  UINT32  mBitBuf;
-  UINT32  mSubBitBuf;
+  UINT64  mBitAcc;    // Upcoming bits of the source, MSB first
+  INT32   mAccBits;   // Number of valid bits in mBitAcc
+  UINT32  mBitBuf;    // The top BITBUFSIZ bits of mBitAcc
   UINT16  mBlockSize;
   UINT32  mCompSize;
   UINT32  mOrigSize;
@@ -102,6 +102,10 @@ Routine Description:
 
   Shift mBitBuf NumOfBits left. Read in NumOfBits of bits from source.
 
+  Whole source bytes are loaded into a 64-bit accumulator several at a time,
+  so most calls are just a shift. Past the end of the compressed data, zero
+  bits are read.
+
 Arguments:
 
   Sd        - The global scratch data
@@ -111,33 +115,46 @@ Returns: (VOID)
 
 --*/
 {
-  Sd->mBitBuf = (UINT32) (Sd->mBitBuf << NumOfBits);
-
-  while (NumOfBits > Sd->mBitCount) {
+  UINT64  Byte;
 
-    Sd->mBitBuf |= (UINT32) (Sd->mSubBitBuf << (NumOfBits = (UINT16) (NumOfBits - Sd->mBitCount)));
+  Sd->mBitAcc <<= NumOfBits;
+  Sd->mAccBits -= NumOfBits;
 
+  while (Sd->mAccBits <= 56) {
+    Byte = 0;
     if (Sd->mCompSize > 0) {
-      //
-      // Get 1 byte into SubBitBuf
-      //
       Sd->mCompSize--;
-      Sd->mSubBitBuf  = 0;
-      Sd->mSubBitBuf  = Sd->mSrcBase[Sd->mInBuf++];
-      Sd->mBitCount   = 8;
-
-    } else {
-      //
-      // No more bits from the source, just pad zero bit.
-      //
-      Sd->mSubBitBuf  = 0;
-      Sd->mBitCount   = 8;
-
+      Byte = Sd->mSrcBase[Sd->mInBuf++];
     }
+    Sd->mBitAcc |= Byte << (56 - Sd->mAccBits);
+    Sd->mAccBits += 8;
   }
 
-  Sd->mBitCount = (UINT16) (Sd->mBitCount - NumOfBits);
-  Sd->mBitBuf |= Sd->mSubBitBuf >> Sd->mBitCount;
+  Sd->mBitBuf = (UINT32) (Sd->mBitAcc >> (64 - BITBUFSIZ));
+}
+
+STATIC
+VOID
+InitBuf (
+  IN  SCRATCH_DATA  *Sd
+  )
+/*++
+
+Routine Description:
+
+  Fill the first BITBUFSIZ bits of mBitBuf from the source.
+
+Arguments:
+
+  Sd        - The global scratch data
+
+Returns: (VOID)
+
+--*/
+{
+  Sd->mBitAcc   = 0;
+  Sd->mAccBits  = BITBUFSIZ;
+  FillBuf (Sd, BITBUFSIZ);
 }
 
 STATIC
@@ -624,53 +641,66 @@ Returns: (VOID)
 
  --*/
 {
-  UINT16  BytesRemain;
-  UINT32  DataIdx;
+  UINT8   *Dst;
+  UINT32  OutBuf;
+  UINT32  OrigSize;
+  UINT32  Distance;
+  UINT32  Length;
+  UINT8   *From;
+  UINT8   *To;
   UINT16  CharC;
 
-  BytesRemain = (UINT16) (-1);
-
-  DataIdx     = 0;
+  Dst       = Sd->mDstBase;
+  OutBuf    = Sd->mOutBuf;
+  OrigSize  = Sd->mOrigSize;
 
-  for (;;) {
+  while (OutBuf < OrigSize) {
     CharC = DecodeC (Sd);
     if (Sd->mBadTableFlag != 0) {
-      return ;
+      break;
     }
 
     if (CharC < 256) {
       //
       // Process an Original character
       //
-      if (Sd->mOutBuf >= Sd->mOrigSize) {
-        return ;
-      } else {
-        Sd->mDstBase[Sd->mOutBuf++] = (UINT8) CharC;
-      }
+      Dst[OutBuf++] = (UINT8) CharC;
+      continue;
+    }
 
-    } else {
+    //
+    // Process a Pointer
+    //
+    Length    = CharC - (UINT8_MAX + 1 - THRESHOLD);
+    Distance  = DecodeP (Sd) + 1;
+    if (Distance > OutBuf) {
       //
-      // Process a Pointer
+      // Points before the start of the data; the source is corrupted
       //
-      CharC       = (UINT16) (CharC - (UINT8_MAX + 1 - THRESHOLD));
-
-      BytesRemain = CharC;
-
-      DataIdx     = Sd->mOutBuf - DecodeP (Sd) - 1;
+      Sd->mBadTableFlag = 1;
+      break;
+    }
 
-      BytesRemain--;
-      while ((INT16) (BytesRemain) >= 0) {
-        Sd->mDstBase[Sd->mOutBuf++] = Sd->mDstBase[DataIdx++];
-        if (Sd->mOutBuf >= Sd->mOrigSize) {
-          return ;
-        }
+    if (Length > OrigSize - OutBuf) {
+      Length = OrigSize - OutBuf;
+    }
 
-        BytesRemain--;
+    From = Dst + OutBuf - Distance;
+    To   = Dst + OutBuf;
+    OutBuf += Length;
+    if (Distance >= Length) {
+      memcpy (To, From, Length);
+    } else {
+      //
+      // Overlapping copy repeats the last Distance bytes
+      //
+      while (Length-- > 0) {
+        *To++ = *From++;
       }
     }
   }
 
-  return ;
+  Sd->mOutBuf = OutBuf;
 }
 
 EFI_STATUS
@@ -748,7 +778,6 @@ Returns:
 
 --*/
 {
-  UINT32        Index;
   UINT32        CompSize;
   UINT32        OrigSize;
   EFI_STATUS    Status;
@@ -790,9 +819,7 @@ Returns:
 
   Src = Src + 8;
 
-  for (Index = 0; Index < sizeof (SCRATCH_DATA); Index++) {
-    ((UINT8 *) Sd)[Index] = 0;
-  }
+  memset (Sd, 0, sizeof (SCRATCH_DATA));
   //
   // The length of the field 'Position Set Code Length Array Size' in Block Header.
   // For EFI 1.1 de/compression algorithm(Version 1), mPBit = 4
@@ -822,7 +849,7 @@ Returns:
   //
   // Fill the first BITBUFSIZ bits
   //
-  FillBuf (Sd, BITBUFSIZ);
+  InitBuf (Sd);
 
   //
   // Decompress it
@@ -1008,6 +1035,243 @@ Returns:
 }
 
 
+//
+// Streaming decompression
+//
+
+//
+// Largest match distance for each version, plus one: EFI 1.1 positions have
+// at most 14 bits, and the Tiano compressor uses a 19-bit window.
+//
+#define EFI_STREAM_WINDOW    (1U << 14)
+#define TIANO_STREAM_WINDOW  (1U << 19)
+
+struct _EFI_DECOMPRESS_STREAM {
+  SCRATCH_DATA  Sd;
+  UINT8         *Window;      // The last WindowSize bytes of output
+  UINT32        WindowSize;   // Always a power of two
+  UINT32        MatchRemain;  // Bytes left to copy for the current pointer
+  UINT32        MatchPos;     // Where to copy them from, in output offsets
+};
+
+EFI_DECOMPRESS_STREAM *
+EfiDecompressStreamNew (
+  IN      VOID    *Source,
+  IN      UINT32  SrcSize,
+  IN      UINT8   Version
+  )
+/*++
+
+Routine Description:
+
+  Start decompressing a buffer a piece at a time. The decompressed data only
+  needs to be held by the caller as long as it likes; the stream keeps its own
+  copy of the window that pointers can refer back to.
+
+Arguments:
+
+  Source      - The source buffer containing the compressed data. It must
+                stay valid until the stream is freed.
+  SrcSize     - The size of source buffer
+  Version     - The version of de/compression algorithm.
+                Version 1 for EFI 1.1 de/compression algorithm.
+                Version 2 for Tiano de/compression algorithm.
+
+Returns:
+
+  The new stream, or NULL if the source is corrupted or memory runs out.
+
+--*/
+{
+  EFI_DECOMPRESS_STREAM *Stream;
+  UINT8                 *Src;
+  UINT32                CompSize;
+  UINT32                OrigSize;
+
+  Src = Source;
+  if (SrcSize < 8 || (Version != 1 && Version != 2)) {
+    return NULL;
+  }
+
+  CompSize  = Src[0] + (Src[1] << 8) + (Src[2] << 16) + (Src[3] << 24);
+  OrigSize  = Src[4] + (Src[5] << 8) + (Src[6] << 16) + (Src[7] << 24);
+  if (OrigSize != 0 && SrcSize - 8 < CompSize) {
+    return NULL;
+  }
+
+  Stream = calloc (1, sizeof (*Stream));
+  if (Stream == NULL) {
+    return NULL;
+  }
+
+  Stream->WindowSize = (Version == 1) ? EFI_STREAM_WINDOW : TIANO_STREAM_WINDOW;
+  Stream->Window = malloc (Stream->WindowSize);
+  if (Stream->Window == NULL) {
+    free (Stream);
+    return NULL;
+  }
+
+  Stream->Sd.mPBit      = (Version == 1) ? 4 : 5;
+  Stream->Sd.mSrcBase   = Src + 8;
+  Stream->Sd.mCompSize  = CompSize;
+  Stream->Sd.mOrigSize  = OrigSize;
+  if (OrigSize != 0) {
+    InitBuf (&Stream->Sd);
+  }
+
+  return Stream;
+}
+
+EFI_STATUS
+EfiDecompressStreamRead (
+  IN      EFI_DECOMPRESS_STREAM  *Stream,
+  OUT     VOID                   *Destination,
+  IN      UINT32                 DstSize,
+  OUT     UINT32                 *Produced
+  )
+/*++
+
+Routine Description:
+
+  Decompress the next DstSize bytes of the stream.
+
+Arguments:
+
+  Stream      - The stream from EfiDecompressStreamNew()
+  Destination - Where to put the next piece of decompressed data
+  DstSize     - How much to produce
+  Produced    - How much was actually produced. This is less than DstSize
+                only at the end of the data.
+
+Returns:
+
+  EFI_SUCCESS           - Decompression is successfull
+  EFI_INVALID_PARAMETER - The source data is corrupted
+
+--*/
+{
+  SCRATCH_DATA  *Sd;
+  UINT8         *Dst;
+  UINT8         *Window;
+  UINT32        Mask;
+  UINT32        OutBuf;
+  UINT32        Count;
+  UINT32        Distance;
+  UINT32        Length;
+  UINT32        From;
+  UINT32        To;
+  UINT32        Run;
+  UINT16        CharC;
+
+  Sd      = &Stream->Sd;
+  Dst     = Destination;
+  Window  = Stream->Window;
+  Mask    = Stream->WindowSize - 1;
+  OutBuf  = Sd->mOutBuf;
+  Count   = 0;
+
+  while (Count < DstSize && OutBuf < Sd->mOrigSize) {
+    if (Stream->MatchRemain > 0) {
+      //
+      // Copy as much of the Pointer as fits in one go
+      //
+      Length = Stream->MatchRemain;
+      if (Length > DstSize - Count) {
+        Length = DstSize - Count;
+      }
+      if (Length > Sd->mOrigSize - OutBuf) {
+        Length = Sd->mOrigSize - OutBuf;
+      }
+      Stream->MatchRemain -= Length;
+      Distance = OutBuf - Stream->MatchPos;
+      if (Distance < 16) {
+        //
+        // Short distances repeat a few bytes over and over
+        //
+        while (Length-- > 0) {
+          Window[OutBuf & Mask] = Window[Stream->MatchPos++ & Mask];
+          Dst[Count++] = Window[OutBuf++ & Mask];
+        }
+        continue;
+      }
+      while (Length > 0) {
+        //
+        // Copy whole runs that don't wrap around the window
+        //
+        From = Stream->MatchPos & Mask;
+        To = OutBuf & Mask;
+        Run = (Length < Distance) ? Length : Distance;
+        if (Run > Stream->WindowSize - From) {
+          Run = Stream->WindowSize - From;
+        }
+        if (Run > Stream->WindowSize - To) {
+          Run = Stream->WindowSize - To;
+        }
+        memcpy (Window + To, Window + From, Run);
+        memcpy (Dst + Count, Window + To, Run);
+        Stream->MatchPos += Run;
+        OutBuf += Run;
+        Count += Run;
+        Length -= Run;
+      }
+      continue;
+    }
+
+    CharC = DecodeC (Sd);
+    if (Sd->mBadTableFlag != 0) {
+      break;
+    }
+
+    if (CharC >= 256) {
+      //
+      // Start copying a Pointer; the bytes come out on later iterations
+      //
+      Distance = DecodeP (Sd) + 1;
+      if (Distance > OutBuf || Distance > Stream->WindowSize) {
+        Sd->mBadTableFlag = 1;
+        break;
+      }
+      Stream->MatchRemain = CharC - (UINT8_MAX + 1 - THRESHOLD);
+      Stream->MatchPos = OutBuf - Distance;
+      continue;
+    }
+
+    Window[OutBuf++ & Mask] = (UINT8) CharC;
+    Dst[Count++] = (UINT8) CharC;
+  }
+
+  Sd->mOutBuf = OutBuf;
+  *Produced = Count;
+  return (Sd->mBadTableFlag != 0) ? EFI_INVALID_PARAMETER : EFI_SUCCESS;
+}
+
+VOID
+EfiDecompressStreamFree (
+  IN      EFI_DECOMPRESS_STREAM  *Stream
+  )
+/*++
+
+Routine Description:
+
+  Free a stream from EfiDecompressStreamNew().
+
+Arguments:
+
+  Stream      - The stream to free; may be NULL.
+
+Returns: (VOID)
+
+--*/
+{
+  if (Stream == NULL) {
+    return;
+  }
+
+  free (Stream->Window);
+  free (Stream);
+}
+
+
 #ifndef FOR_LIBRARY
 int main(int argc, char *argv[])
 {
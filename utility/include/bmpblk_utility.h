@@ -68,6 +68,9 @@ class BmpBlockUtil {
   /* What compression to use for the images */
   void force_compression(uint32_t compression);
 
+  /* How many images to compress at once */
+  void set_jobs(unsigned int jobs);
+
  private:
   /* Elemental function called from load_from_config.
    * Load the config file (yaml format) and parse it. */
@@ -118,6 +121,9 @@ class BmpBlockUtil {
   /* Internal variables to determine whether or not to specify compression */
   bool set_compression_;                // true if we force it
   uint32_t compression_;                // what we force it to
+
+  /* Number of threads to compress images with */
+  unsigned int jobs_;
 };
 
 }  // namespace vboot_reference
@@ -11,6 +11,7 @@
 #define UINT8 uint8_t
 #define INT32 int32_t
 #define UINT32 uint32_t
+#define UINT64 uint64_t
 #define STATIC static
 #define IN /**/
 #define OUT /**/
@@ -57,6 +58,32 @@
 
 #define EFI_ERROR(Status) (Status != 0 && Status < EFIWARN(1))
 
+/*
+ * Compressor working state. EfiCompress() uses a fresh one for each call;
+ * callers compressing many buffers, or on several threads at once, can keep
+ * one per thread and use EfiCompressWithContext() instead.
+ */
+typedef struct _EFI_COMPRESS_CONTEXT EFI_COMPRESS_CONTEXT;
+
+EFI_COMPRESS_CONTEXT *
+EfiCompressContextNew (
+  VOID
+  );
+
+VOID
+EfiCompressContextFree (
+  IN      EFI_COMPRESS_CONTEXT  *Ctx
+  );
+
+EFI_STATUS
+EfiCompressWithContext (
+  IN      EFI_COMPRESS_CONTEXT  *Ctx,
+  IN      UINT8   *SrcBuffer,
+  IN      UINT32  SrcSize,
+  IN      UINT8   *DstBuffer,
+  IN OUT  UINT32  *DstSize
+  );
+
 EFI_STATUS
 EfiCompress (
   IN      UINT8   *SrcBuffer,
@@ -84,3 +111,29 @@ EfiDecompress (
   IN OUT  VOID                    *Scratch,
   IN      UINT32                  ScratchSize
   );
+
+/*
+ * Decompression a piece at a time, for callers that consume the output as it
+ * is produced. Version is 1 for EFI 1.1 data and 2 for Tiano data.
+ */
+typedef struct _EFI_DECOMPRESS_STREAM EFI_DECOMPRESS_STREAM;
+
+EFI_DECOMPRESS_STREAM *
+EfiDecompressStreamNew (
+  IN      VOID    *Source,
+  IN      UINT32  SrcSize,
+  IN      UINT8   Version
+  );
+
+EFI_STATUS
+EfiDecompressStreamRead (
+  IN      EFI_DECOMPRESS_STREAM  *Stream,
+  OUT     VOID                   *Destination,
+  IN      UINT32                 DstSize,
+  OUT     UINT32                 *Produced
+  );
+
+VOID
+EfiDecompressStreamFree (
+  IN      EFI_DECOMPRESS_STREAM  *Stream
+  );